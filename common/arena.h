@@ -0,0 +1,61 @@
+#pragma once
+
+#include <google/protobuf/arena.h>
+
+#include <algorithm>
+#include <memory>
+
+#include "proto/internal.pb.h"
+
+namespace slog {
+
+/**
+ * Batches and their transactions can be allocated on a protobuf arena so that a whole batch is
+ * allocated in a few large blocks and freed at once instead of one malloc per message. An arena
+ * is owned by the top-level message allocated on it: deleting an Envelope or a Batch allocated on
+ * an arena deletes the whole arena. Messages not allocated on an arena are deleted as usual.
+ */
+template <typename T>
+struct ArenaOwnerDeleter {
+  ArenaOwnerDeleter() = default;
+  // Allows converting from std::unique_ptr<T> (e.g. std::make_unique)
+  ArenaOwnerDeleter(const std::default_delete<T>&) {}
+
+  void operator()(T* msg) const {
+    if (auto arena = msg->GetArena(); arena != nullptr) {
+      delete arena;
+    } else {
+      delete msg;
+    }
+  }
+};
+
+using EnvelopePtr = std::unique_ptr<internal::Envelope, ArenaOwnerDeleter<internal::Envelope>>;
+using BatchPtr = std::unique_ptr<internal::Batch, ArenaOwnerDeleter<internal::Batch>>;
+
+/**
+ * A transaction allocated on an arena is freed together with its arena, which is kept alive
+ * with an ArenaPtr by every holder of the transactions on it
+ */
+struct TxnDeleter {
+  void operator()(Transaction* txn) const {
+    if (txn->GetArena() == nullptr) {
+      delete txn;
+    }
+  }
+};
+
+using TxnPtr = std::unique_ptr<Transaction, TxnDeleter>;
+using ArenaPtr = std::shared_ptr<google::protobuf::Arena>;
+
+/**
+ * Creates an arena whose first block is about the size of the messages to be allocated on it
+ */
+inline std::unique_ptr<google::protobuf::Arena> NewArena(size_t expected_size = 0) {
+  google::protobuf::ArenaOptions options;
+  options.start_block_size = std::max(options.start_block_size, expected_size);
+  options.max_block_size = std::max(options.max_block_size, expected_size);
+  return std::make_unique<google::protobuf::Arena>(options);
+}
+
+}  // namespace slog
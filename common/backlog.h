@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+
+namespace slog {
+
+/**
+ * Number of txns that the modules downstream of the batching modules of a machine have accepted
+ * but not finished yet. The Interleaver and the Scheduler report their own backlog and the batching
+ * policies of the Sequencer and the MultiHomeOrderer read the total (see BatchingPolicy)
+ */
+class Backlog {
+ public:
+  enum Source { INTERLEAVER, SCHEDULER, NUM_SOURCES };
+
+  Backlog() {
+    for (auto& value : values_) {
+      value.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void Set(Source source, int64_t value) { values_[source].store(value, std::memory_order_relaxed); }
+
+  int64_t total() const {
+    int64_t total = 0;
+    for (auto& value : values_) {
+      total += value.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+ private:
+  std::array<std::atomic<int64_t>, NUM_SOURCES> values_;
+};
+
+using BacklogPtr = std::shared_ptr<Backlog>;
+
+}  // namespace slog
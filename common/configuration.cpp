@@ -21,6 +21,18 @@ using std::chrono::operator""ms;
 using std::string;
 using std::vector;
 
+namespace {
+
+internal::BatchingPolicy WithDefaultDelay(internal::BatchingPolicy policy, milliseconds default_delay) {
+  if (policy.max_delay_us() == 0) {
+    policy.set_max_delay_us(std::chrono::microseconds(default_delay).count());
+  }
+  policy.set_min_delay_us(std::min(policy.min_delay_us(), policy.max_delay_us()));
+  return policy;
+}
+
+}  // namespace
+
 ConfigurationPtr Configuration::FromFile(const string& file_path, const string& local_address) {
   int fd = open(file_path.c_str(), O_RDONLY);
   if (fd < 0) {
@@ -105,6 +117,13 @@ uint32_t Configuration::num_replicas() const { return config_.replicas_size(); }
 uint32_t Configuration::num_partitions() const { return config_.num_partitions(); }
 
 uint32_t Configuration::num_workers() const { return std::max(config_.num_workers(), 1U); }
+internal::WorkerHandoff Configuration::worker_handoff() const { return config_.worker_handoff(); }
+
+internal::WorkerDispatchPolicy Configuration::worker_dispatch_policy() const {
+  return config_.worker_dispatch_policy();
+}
+
+uint32_t Configuration::num_lock_manager_shards() const { return std::max(config_.num_lock_manager_shards(), 1U); }
 
 uint32_t Configuration::broker_ports(int i) const { return config_.broker_ports(i); }
 uint32_t Configuration::broker_ports_size() const { return config_.broker_ports_size(); }
@@ -213,6 +232,36 @@ std::array<int, 2> Configuration::interleaver_remote_to_local_ratio() const {
   return {std::stoi(ratio[0]), std::stoi(ratio[1])};
 }
 
+uint32_t Configuration::message_coalescing_max_bytes() const { return config_.message_coalescing_max_bytes(); }
+
+std::chrono::microseconds Configuration::message_coalescing_max_delay() const {
+  auto delay_us = config_.message_coalescing_max_delay_us();
+  return std::chrono::microseconds(delay_us == 0 ? 100 : delay_us);
+}
+
+internal::Compression Configuration::compression_to(uint32_t replica) const {
+  auto compression = config_.replicas(replica).compression();
+  if (compression.codec() == internal::CompressionCodec::NO_COMPRESSION) {
+    compression = config_.cross_region_compression();
+  }
+  if (compression.min_payload_bytes() == 0) {
+    compression.set_min_payload_bytes(1024);
+  }
+  return compression;
+}
+
+internal::BatchingPolicy Configuration::sequencer_batching() const {
+  return WithDefaultDelay(config_.sequencer_batching(), sequencer_batch_duration());
+}
+
+internal::BatchingPolicy Configuration::multi_home_orderer_batching() const {
+  return WithDefaultDelay(config_.multi_home_orderer_batching(), sequencer_batch_duration());
+}
+
+internal::BatchingPolicy Configuration::forwarder_batching() const {
+  return WithDefaultDelay(config_.forwarder_batching(), forwarder_batch_duration());
+}
+
 std::vector<int> Configuration::distance_ranking_from(int replica_id) const {
   auto ranking_str = Split(config_.replicas(replica_id).distance_ranking(), ",");
   std::vector<int> ranking;
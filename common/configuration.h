@@ -33,6 +33,9 @@ class Configuration {
   uint32_t num_replicas() const;
   uint32_t num_partitions() const;
   uint32_t num_workers() const;
+  internal::WorkerHandoff worker_handoff() const;
+  internal::WorkerDispatchPolicy worker_dispatch_policy() const;
+  uint32_t num_lock_manager_shards() const;
   std::vector<MachineId> all_machine_ids() const;
   std::chrono::milliseconds forwarder_batch_duration() const;
   std::chrono::milliseconds sequencer_batch_duration() const;
@@ -61,6 +64,13 @@ class Configuration {
   bool synchronized_batching() const;
   uint32_t sample_rate() const;
   std::array<int, 2> interleaver_remote_to_local_ratio() const;
+  uint32_t message_coalescing_max_bytes() const;
+  std::chrono::microseconds message_coalescing_max_delay() const;
+  // Compression of the messages sent to the given replica from another replica
+  internal::Compression compression_to(uint32_t replica) const;
+  internal::BatchingPolicy sequencer_batching() const;
+  internal::BatchingPolicy multi_home_orderer_batching() const;
+  internal::BatchingPolicy forwarder_batching() const;
   std::vector<int> distance_ranking_from(int replica_id) const;
 
  private:
@@ -29,6 +29,16 @@ const uint32_t kPaxosDefaultLeaderPosition = 0;
 
 const size_t kLockTableSizeLimit = 1000000;
 
+// Capacity of the lock-free queues between the scheduler and the workers
+const size_t kWorkerQueueCapacity = 16384;
+
+// With key-affinity dispatch, a txn goes to the least loaded worker instead of the worker
+// of its key if the latter has this many txns in progress
+const uint32_t kMaxWorkerLoadForKeyAffinity = 64;
+
+// Size of the first block of the arena on which the sequencer builds a batch
+const size_t kBatchArenaBlockSize = 64 * 1024;
+
 /****************************
  *      Statistic Keys
  ****************************/
@@ -52,15 +62,41 @@ const char MHO_BATCH_DURATION_MS_PCTLS[] = "mho_batch_duration_ms_pctls";
 const char SEQ_BATCH_SIZE_PCTLS[] = "seq_batch_size_pctls";
 const char SEQ_BATCH_DURATION_MS_PCTLS[] = "seq_batch_duration_ms_pctls";
 
+/* Batching policy, reported by the forwarder, the sequencer and the multi-home orderer */
+const char BATCHING_DELAY_US[] = "batching_delay_us";
+const char ARRIVAL_RATE[] = "arrival_rate";
+
+/* Coalescing of outbound messages, reported by the sequencer and the multi-home orderer */
+const char COALESCING[] = "coalescing";
+const char NUM_HELD_BACK_MSGS[] = "num_held_back_msgs";
+const char NUM_COALESCED_FRAMES[] = "num_coalesced_frames";
+const char NUM_COALESCED_MSGS[] = "num_coalesced_msgs";
+
+/* Compression of cross-region messages, reported by the sequencer and the multi-home orderer */
+const char COMPRESSION[] = "compression";
+const char NUM_COMPRESSED_MSGS[] = "num_compressed_msgs";
+const char NUM_UNCOMPRESSED_MSGS[] = "num_uncompressed_msgs";
+const char COMPRESSION_RATIO[] = "compression_ratio";
+const char COMPRESS_TIME_US[] = "compress_time_us";
+const char NUM_DECOMPRESSED_MSGS[] = "num_decompressed_msgs";
+const char DECOMPRESS_TIME_US[] = "decompress_time_us";
+
 /* Scheduler */
 const char ALL_TXNS[] = "all_txns";
 const char NUM_ALL_TXNS[] = "num_all_txns";
 const char NUM_LOCKED_KEYS[] = "num_locked_keys";
+const char NUM_LOCK_MANAGER_SHARDS[] = "num_lock_manager_shards";
+const char NUM_LOCK_SHARD_MESSAGES[] = "num_lock_shard_messages";
+const char WORKER_QUEUE_DEPTHS[] = "worker_queue_depths";
+const char WORKER_LOADS[] = "worker_loads";
 const char LOCK_MANAGER_TYPE[] = "lock_manager_type";
 const char NUM_TXNS_WAITING_FOR_LOCK[] = "num_txns_waiting_for_lock";
 const char NUM_WAITING_FOR_PER_TXN[] = "num_waiting_for_per_txn";
 const char LOCK_TABLE[] = "lock_table";
+const char LOCK_TABLE_SIZE[] = "lock_table_size";
+const char NUM_RECLAIMED_LOCK_QUEUE_TAILS[] = "num_reclaimed_lock_queue_tails";
 const char WAITED_BY_GRAPH[] = "waited_by_graph";
+const char NUM_CONFLICTS[] = "num_conflicts";
 const char TXN_ID[] = "id";
 const char TXN_DONE[] = "done";
 const char TXN_ABORTING[] = "aborting";
@@ -7,7 +7,7 @@
 #include <iostream>
 #include <optional>
 #include <sstream>
-#include <unordered_set>
+#include <unordered_map>
 
 using std::string;
 using std::vector;
@@ -110,10 +110,12 @@ Transaction* GenerateLockOnlyTxn(Transaction* txn, uint32_t lo_master, bool in_p
   return lock_only_txn;
 }
 
-Transaction* GeneratePartitionedTxn(const SharderPtr& sharder, Transaction* txn, uint32_t partition, bool in_place) {
+Transaction* GeneratePartitionedTxn(const SharderPtr& sharder, Transaction* txn, uint32_t partition, bool in_place,
+                                    google::protobuf::Arena* arena) {
   Transaction* new_txn = txn;
   if (!in_place) {
-    new_txn = new Transaction(*txn);
+    new_txn = google::protobuf::Arena::CreateMessage<Transaction>(arena);
+    new_txn->CopyFrom(*txn);
   }
 
   vector<bool> involved_replicas(8, false);
@@ -124,7 +126,7 @@ Transaction* GeneratePartitionedTxn(const SharderPtr& sharder, Transaction* txn,
 
   // Remove keys that are not in the target partition
   for (auto it = new_txn->mutable_keys()->begin(); it != new_txn->mutable_keys()->end();) {
-    if (sharder->compute_partition(it->key()) != partition) {
+    if (KeyPartition(sharder, *it) != partition) {
       it = new_txn->mutable_keys()->erase(it);
     } else {
       auto master = it->value_entry().metadata().master();
@@ -140,7 +142,9 @@ Transaction* GeneratePartitionedTxn(const SharderPtr& sharder, Transaction* txn,
 
   // Shortcut for when the key set is empty or there is no key mastered at the home region
   if (new_txn->keys().empty() || is_redundant) {
-    delete new_txn;
+    if (new_txn->GetArena() == nullptr) {
+      delete new_txn;
+    }
     return nullptr;
   }
 
@@ -157,6 +161,95 @@ Transaction* GeneratePartitionedTxn(const SharderPtr& sharder, Transaction* txn,
   return new_txn;
 }
 
+std::vector<Transaction*> GeneratePartitionedTxns(const SharderPtr& sharder, Transaction* txn,
+                                                  google::protobuf::Arena* arena) {
+  auto num_partitions = sharder->num_partitions();
+  vector<Transaction*> partitioned_txns(num_partitions, nullptr);
+
+  // Bucket the keys by partition in a single pass
+  vector<vector<int>> partition_keys(num_partitions);
+  vector<vector<bool>> involved_replicas(num_partitions);
+  // A partition without any key mastered at the home region is redundant. If this is a remaster txn,
+  // no partition is redundant
+  vector<bool> is_redundant(num_partitions, !txn->has_remaster());
+  for (int i = 0; i < txn->keys_size(); i++) {
+    auto kv = txn->mutable_keys(i);
+    auto partition = KeyPartition(sharder, *kv);
+    kv->mutable_value_entry()->set_partition(partition);
+    partition_keys[partition].push_back(i);
+
+    auto master = kv->value_entry().metadata().master();
+    auto& replicas = involved_replicas[partition];
+    if (master >= replicas.size()) {
+      replicas.resize(master + 1, false);
+    }
+    replicas[master] = true;
+    is_redundant[partition] = is_redundant[partition] && static_cast<int>(master) != txn->internal().home();
+  }
+
+  vector<uint32_t> partitions;
+  for (uint32_t p = 0; p < num_partitions; p++) {
+    if (!partition_keys[p].empty() && !is_redundant[p]) {
+      partitions.push_back(p);
+    }
+  }
+
+  if (partitions.empty()) {
+    if (txn->GetArena() == nullptr) {
+      delete txn;
+    }
+    return partitioned_txns;
+  }
+
+  // Every partition but the last gets a copy of the txn without the keys, to which only the keys of that
+  // partition are copied
+  auto in_place_partition = partitions.back();
+  partitions.pop_back();
+  if (!partitions.empty()) {
+    google::protobuf::RepeatedPtrField<KeyValueEntry> keys;
+    keys.Swap(txn->mutable_keys());
+    for (auto p : partitions) {
+      auto new_txn = google::protobuf::Arena::CreateMessage<Transaction>(arena);
+      new_txn->CopyFrom(*txn);
+      new_txn->mutable_keys()->Reserve(partition_keys[p].size());
+      for (auto i : partition_keys[p]) {
+        new_txn->add_keys()->CopyFrom(keys.Get(i));
+      }
+      partitioned_txns[p] = new_txn;
+    }
+    keys.Swap(txn->mutable_keys());
+  }
+
+  // The last partition takes over the original txn, whose keys are compacted without changing their order
+  auto txn_keys = txn->mutable_keys();
+  const auto& in_place_keys = partition_keys[in_place_partition];
+  for (size_t i = 0; i < in_place_keys.size(); i++) {
+    if (static_cast<int>(i) != in_place_keys[i]) {
+      txn_keys->SwapElements(i, in_place_keys[i]);
+    }
+  }
+  txn_keys->DeleteSubrange(in_place_keys.size(), txn_keys->size() - in_place_keys.size());
+  partitioned_txns[in_place_partition] = txn;
+
+  // Update involved replica list if needed
+  if (txn->internal().type() == TransactionType::MULTI_HOME_OR_LOCK_ONLY) {
+    for (uint32_t p = 0; p < num_partitions; p++) {
+      auto partitioned_txn = partitioned_txns[p];
+      if (partitioned_txn == nullptr) {
+        continue;
+      }
+      partitioned_txn->mutable_internal()->mutable_involved_replicas()->Clear();
+      for (size_t r = 0; r < involved_replicas[p].size(); ++r) {
+        if (involved_replicas[p][r]) {
+          partitioned_txn->mutable_internal()->add_involved_replicas(r);
+        }
+      }
+    }
+  }
+
+  return partitioned_txns;
+}
+
 void PopulateInvolvedReplicas(Transaction& txn) {
   if (txn.internal().type() == TransactionType::UNKNOWN) {
     return;
@@ -189,10 +282,12 @@ void PopulateInvolvedReplicas(Transaction& txn) {
 void PopulateInvolvedPartitions(const SharderPtr& sharder, Transaction& txn) {
   vector<bool> involved_partitions(sharder->num_partitions(), false);
   vector<bool> active_partitions(sharder->num_partitions(), false);
-  for (const auto& kv : txn.keys()) {
-    auto partition = sharder->compute_partition(kv.key());
+  for (auto& kv : *txn.mutable_keys()) {
+    auto partition = KeyPartition(sharder, kv);
+    CHECK_LT(partition, involved_partitions.size()) << "Invalid partition of key " << kv.key();
+    kv.mutable_value_entry()->set_partition(partition);
     involved_partitions[partition] = true;
-    if (kv.value_entry().type() == KeyType::WRITE) {
+    if (kv.value_entry().type() != KeyType::READ) {
       active_partitions[partition] = true;
     }
   }
@@ -227,13 +322,21 @@ void MergeTransaction(Transaction& txn, const Transaction& other) {
     txn.set_status(TransactionStatus::ABORTED);
     txn.set_abort_reason(other.abort_reason());
   } else if (txn.status() != TransactionStatus::ABORTED) {
-    std::unordered_set<std::string> existing_keys;
-    for (const auto& kv : txn.keys()) {
-      existing_keys.insert(kv.key());
+    std::unordered_map<std::string, int> existing_keys;
+    for (int i = 0; i < txn.keys_size(); i++) {
+      existing_keys.emplace(txn.keys(i).key(), i);
     }
     for (const auto& kv : other.keys()) {
-      if (existing_keys.find(kv.key()) == existing_keys.end()) {
+      auto it = existing_keys.find(kv.key());
+      if (it == existing_keys.end()) {
         txn.mutable_keys()->Add()->CopyFrom(kv);
+        continue;
+      }
+      // Keys read from remote partitions do not carry their master metadata so
+      // it is taken from the partition that owns the key
+      auto value_entry = txn.mutable_keys(it->second)->mutable_value_entry();
+      if (!value_entry->has_metadata() && kv.value_entry().has_metadata()) {
+        value_entry->mutable_metadata()->CopyFrom(kv.value_entry().metadata());
       }
     }
   }
@@ -284,6 +387,8 @@ std::ostream& operator<<(std::ostream& os, const Transaction& txn) {
     os << "\tValue: " << ToReadable(v.value()) << "\n";
     if (v.type() == KeyType::WRITE) {
       os << "\tNew value: " << ToReadable(v.new_value()) << "\n";
+    } else if (v.type() == KeyType::ADD) {
+      os << "\tDelta: " << v.delta() << "\n";
     }
     os << "\tMetadata: " << v.metadata() << "\n";
   }
@@ -352,7 +457,8 @@ vector<Transaction*> Unbatch(internal::Batch* batch) {
   vector<Transaction*> buffer(transactions->size());
 
   for (int i = transactions->size() - 1; i >= 0; i--) {
-    auto txn = transactions->ReleaseLast();
+    // Releasing normally would copy the txn if the batch is on an arena
+    auto txn = transactions->UnsafeArenaReleaseLast();
     auto txn_internal = txn->mutable_internal();
 
     // Transfer recorded events from batch to each txn in the batch
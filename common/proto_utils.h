@@ -59,10 +59,32 @@ TransactionType SetTransactionType(Transaction& txn);
 Transaction* GenerateLockOnlyTxn(Transaction* txn, uint32_t lo_master, bool in_place = false);
 
 /**
- * Returns nullptr if the generated txn contains no relevant key
+ * Returns nullptr if the generated txn contains no relevant key. If not in place, the generated txn
+ * is allocated on the given arena
  */
 Transaction* GeneratePartitionedTxn(const SharderPtr& sharder, Transaction* txn, uint32_t partition,
-                                    bool in_place = false);
+                                    bool in_place = false, google::protobuf::Arena* arena = nullptr);
+
+/**
+ * Splits a txn into one txn per partition with the keys of that partition in a single pass over the keys.
+ * The returned vector is indexed by partition and contains nullptr for the partitions for which
+ * GeneratePartitionedTxn would return nullptr. The given txn is reused for one of the partitions (or
+ * deleted if it is not on an arena and no partition needs it) and the other txns are allocated on the
+ * given arena. The partition of every key is cached in the generated txns
+ */
+std::vector<Transaction*> GeneratePartitionedTxns(const SharderPtr& sharder, Transaction* txn,
+                                                  google::protobuf::Arena* arena = nullptr);
+
+/**
+ * Returns the partition of a key, using the partition cached in the entry if there is one. The cache is
+ * only filled in by PopulateInvolvedPartitions so this must not be used on txns coming from a client
+ */
+inline uint32_t KeyPartition(const SharderPtr& sharder, const KeyValueEntry& kv) {
+  if (kv.value_entry().partition_optional_case() == ValueEntry::kPartition) {
+    return kv.value_entry().partition();
+  }
+  return sharder->compute_partition(kv.key());
+}
 
 /**
  * Populate the involved_replicas field in the transaction
@@ -70,7 +92,7 @@ Transaction* GeneratePartitionedTxn(const SharderPtr& sharder, Transaction* txn,
 void PopulateInvolvedReplicas(Transaction& txn);
 
 /**
- * Populate the involved_partitions field in the transaction
+ * Populate the involved_partitions field in the transaction and cache the partition of every key
  */
 void PopulateInvolvedPartitions(const SharderPtr& sharder, Transaction& txn);
 
@@ -91,7 +113,7 @@ bool operator==(const KeyValueEntry& kv1, const KeyValueEntry& kv2);
 bool operator==(const Transaction& txn1, const Transaction txn2);
 
 /**
- * Extract txns from a batch
+ * Extract txns from a batch. If the batch is allocated on an arena, the txns stay on that arena
  */
 std::vector<Transaction*> Unbatch(internal::Batch* batch);
 
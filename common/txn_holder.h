@@ -5,6 +5,7 @@
 #include <optional>
 #include <vector>
 
+#include "common/arena.h"
 #include "common/configuration.h"
 #include "common/proto_utils.h"
 #include "common/types.h"
@@ -12,54 +13,59 @@
 
 namespace slog {
 
-using EnvelopePtr = std::unique_ptr<internal::Envelope>;
-
 class TxnHolder {
  public:
-  TxnHolder(const ConfigurationPtr& config, Transaction* txn)
+  // If the txn is allocated on an arena, the holder keeps the arena alive until it is destroyed
+  TxnHolder(const ConfigurationPtr& config, Transaction* txn, const ArenaPtr& arena = nullptr)
       : txn_id_(txn->internal().id()),
-        main_txn_(txn->internal().home()),
-        lo_txns_(config->num_replicas()),
+        num_replicas_(config->num_replicas()),
+        main_txn_{txn->internal().home(), arena, TxnPtr(txn)},
         remaster_result_(std::nullopt),
         aborting_(false),
         done_(false),
-        num_lo_txns_(0),
+        num_lo_txns_(1),
         expected_num_lo_txns_(txn->internal().involved_replicas_size()),
-        num_dispatches_(0) {
-    lo_txns_[main_txn_].reset(txn);
-    ++num_lo_txns_;
-  }
+        num_dispatches_(0) {}
 
-  bool AddLockOnlyTxn(Transaction* txn) {
+  bool AddLockOnlyTxn(Transaction* txn, const ArenaPtr& arena = nullptr) {
     auto home = txn->internal().home();
-    CHECK_LT(home, static_cast<int>(lo_txns_.size()));
+    CHECK_LT(home, static_cast<int>(num_replicas_));
 
-    if (lo_txns_[home] != nullptr) {
+    if (FindLockOnlyTxn(home) != nullptr) {
       return false;
     }
 
-    lo_txns_[home].reset(txn);
+    // Most txns are single-home so the storage of the other lock-only txns is only allocated on demand
+    if (other_lo_txns_.empty() && expected_num_lo_txns_ > 1) {
+      other_lo_txns_.reserve(expected_num_lo_txns_ - 1);
+    }
+    other_lo_txns_.push_back({home, arena, TxnPtr(txn)});
 
     ++num_lo_txns_;
 
     return true;
   }
 
-  Transaction* Release() {
-    auto txn = lo_txns_[main_txn_].release();
-    // Do not use clear() here because lo_txns_ must never change in size
-    for (auto& lo_txn : lo_txns_) {
-      lo_txn.reset();
+  // The arena of the returned txn, if any, is still kept alive by this holder
+  TxnPtr Release() {
+    auto txn = std::move(main_txn_.txn);
+    for (auto& lo_txn : other_lo_txns_) {
+      lo_txn.txn.reset();
     }
     return txn;
   }
 
   TxnId txn_id() const { return txn_id_; }
   Transaction& txn() const {
-    CHECK(lo_txns_[main_txn_] != nullptr);
-    return *lo_txns_[main_txn_];
+    CHECK(main_txn_.txn != nullptr);
+    return *main_txn_.txn;
+  }
+  // Returns the lock-only txn of the given home
+  Transaction& lock_only_txn(size_t i) const {
+    auto lo_txn = FindLockOnlyTxn(i);
+    CHECK(lo_txn != nullptr) << "Lock-only txn of home " << i << " has not arrived";
+    return *lo_txn;
   }
-  Transaction& lock_only_txn(size_t i) const { return *lo_txns_[i]; }
 
   void SetRemasterResult(const Key& key, uint32_t counter) { remaster_result_.emplace(key, counter); }
   std::optional<pair<Key, uint32_t>> remaster_result() const { return remaster_result_; }
@@ -73,14 +79,36 @@ class TxnHolder {
   void IncNumDispatches() { num_dispatches_++; }
   int num_dispatches() const { return num_dispatches_; }
 
-  bool is_ready_for_gc() const { return done_ && num_lo_txns_ == expected_num_lo_txns_; }
+  bool has_all_lock_only_txns() const { return num_lo_txns_ == expected_num_lo_txns_; }
+  bool is_ready_for_gc() const { return done_ && has_all_lock_only_txns(); }
   int num_lock_only_txns() const { return num_lo_txns_; }
   int expected_num_lock_only_txns() const { return expected_num_lo_txns_; }
 
  private:
+  struct LockOnlyTxn {
+    int home;
+    // Declared before the txn so that the arena outlives it
+    ArenaPtr arena;
+    TxnPtr txn;
+  };
+
+  Transaction* FindLockOnlyTxn(size_t home) const {
+    if (static_cast<size_t>(main_txn_.home) == home) {
+      return main_txn_.txn.get();
+    }
+    for (const auto& lo_txn : other_lo_txns_) {
+      if (static_cast<size_t>(lo_txn.home) == home) {
+        return lo_txn.txn.get();
+      }
+    }
+    return nullptr;
+  }
+
   TxnId txn_id_;
-  size_t main_txn_;
-  std::vector<std::unique_ptr<Transaction>> lo_txns_;
+  uint32_t num_replicas_;
+  // The first txn that arrives, which is either the whole txn or one of its lock-only txns
+  LockOnlyTxn main_txn_;
+  std::vector<LockOnlyTxn> other_lo_txns_;
   std::optional<pair<Key, uint32_t>> remaster_result_;
   bool aborting_;
   bool done_;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <string>
 
 #include "proto/transaction.pb.h"
@@ -10,6 +11,8 @@ using Key = std::string;
 using KeyReplica = std::string;
 using Value = std::string;
 using TxnId = uint64_t;
+// Opaque reference to a txn given to the lock managers, which hand it back for the txns they unblock
+using TxnHandle = uint64_t;
 using BatchId = uint64_t;
 using SlotId = uint32_t;
 using Channel = uint64_t;
@@ -28,52 +31,42 @@ struct Metadata {
   uint32_t counter = 0;
 };
 
+/**
+ * The value of a record is an immutable buffer shared by all copies of the record, so
+ * copying a record, e.g. when reading it from storage, does not copy the value.
+ * Setting a new value replaces the buffer instead of modifying it in place.
+ */
 struct Record {
   Record(const std::string& v, uint32_t m = 0, uint32_t c = 0) : metadata_(m, c) { SetValue(v); }
-
-  Record(const Record& other) {
-    SetValue(other.data_.get(), other.size_);
-    SetMetadata(other.metadata_);
-  }
-
-  Record& operator=(const Record& other) {
-    Record tmp(other);
-    data_.swap(tmp.data_);
-    std::swap(size_, tmp.size_);
-    std::swap(metadata_, tmp.metadata_);
-    return *this;
-  }
+  Record(std::string&& v, uint32_t m = 0, uint32_t c = 0) : metadata_(m, c) { SetValue(std::move(v)); }
 
   void SetMetadata(const Metadata& metadata) { metadata_ = metadata; }
 
-  void SetValue(const std::string& v) { SetValue(v.data(), v.size()); }
+  void SetValue(const std::string& v) { data_ = std::make_shared<const std::string>(v); }
 
-  void SetValue(const char* data, size_t size) {
-    size_ = size;
-    data_.reset(new char[size_]);
-    memcpy(data_.get(), data, size_);
-  }
+  void SetValue(std::string&& v) { data_ = std::make_shared<const std::string>(std::move(v)); }
 
-  std::string to_string() const {
-    if (data_ == nullptr) {
-      return "";
-    }
-    return std::string(data_.get(), size_);
-  }
+  void SetValue(const char* data, size_t size) { data_ = std::make_shared<const std::string>(data, size); }
+
+  std::string to_string() const { return value(); }
 
   Record() = default;
 
   const Metadata& metadata() const { return metadata_; }
-  char* data() { return data_.get(); }
-  size_t size() { return size_; }
+  const std::string& value() const {
+    static const std::string kEmpty;
+    return data_ == nullptr ? kEmpty : *data_;
+  }
+  const char* data() const { return value().data(); }
+  size_t size() const { return value().size(); }
 
  private:
   Metadata metadata_;
-  std::unique_ptr<char[]> data_;
-  size_t size_ = 0;
+  std::shared_ptr<const std::string> data_;
 };
 
-enum class LockMode { UNLOCKED, READ, WRITE };
+// READ and ADD locks are shared by the txns requesting the same mode
+enum class LockMode { UNLOCKED, READ, WRITE, ADD };
 enum class AcquireLocksResult { ACQUIRED, WAITING, ABORT };
 
 inline KeyReplica MakeKeyReplica(const Key& key, uint32_t master) {
@@ -18,8 +18,6 @@ using std::vector;
 
 namespace slog {
 
-using internal::Envelope;
-
 namespace {
 class BrokerThread : public Module {
  public:
@@ -101,50 +99,50 @@ class BrokerThread : public Module {
 
  private:
   void HandleIncomingMessage(zmq::message_t&& msg) {
+    // The frames in a coalesced frame may go to different channels so each of them is handled on its own
+    if (IsCoalescedFrame(msg)) {
+      ForEachFrame(msg, [this](const char* data, size_t size) { HandleIncomingMessage(zmq::message_t(data, size)); });
+      return;
+    }
+
     Channel tag_or_chan_id;
     if (!ParseChannel(tag_or_chan_id, msg)) {
       LOG(ERROR) << "Message without channel info";
       return;
     }
 
-    auto chan_id = tag_or_chan_id;
-
-    // Check if this is a tag or a channel id.
-    // This condition effectively allows sending messages to a worker only via redirection since
-    // workers' channel ids are larger than kMaxChannel
-    if (tag_or_chan_id >= kMaxChannel) {
+    // Check if this is a tag or a channel id. The channels of the workers are larger than kMaxChannel
+    // but are registered, so they can be sent to directly
+    auto chan_it = channels_.find(tag_or_chan_id);
+    if (chan_it == channels_.end() && tag_or_chan_id >= kMaxChannel) {
       auto& entry = redirect_[tag_or_chan_id];
       if (!entry.to.has_value()) {
         entry.pending_msgs.push_back(move(msg));
         return;
       }
-      chan_id = entry.to.value();
+      chan_it = channels_.find(entry.to.value());
     }
 
-    auto chan_it = channels_.find(chan_id);
     if (chan_it == channels_.end()) {
-      LOG(ERROR) << "Unknown channel: \"" << chan_id << "\". Dropping message";
+      LOG(ERROR) << "Unknown channel: \"" << tag_or_chan_id << "\". Dropping message";
       return;
     }
     ForwardMessage(chan_it->second.socket, chan_it->second.send_raw, move(msg));
   }
 
   void ForwardMessage(zmq::socket_t& socket, bool send_raw, zmq::message_t&& msg) {
-    MachineId machine_id = -1;
-    ParseMachineId(machine_id, msg);
-
-    auto env = std::make_unique<Envelope>();
+    // A raw message is passed on without being copied and deserialized by the receiving module so
+    // that the broker thread only needs to look at the header
     if (send_raw) {
-      env->set_raw(msg.to_string());
-    } else {
-      if (!DeserializeProto(*env, msg)) {
-        LOG(ERROR) << "Malformed message";
-        return;
-      }
+      socket.send(msg, zmq::send_flags::dontwait);
+      return;
     }
 
-    // This must be set AFTER deserializing otherwise it will be overwritten by the deserialization function
-    env->set_from(machine_id);
+    auto env = DeserializeEnvelope(msg);
+    if (env == nullptr) {
+      LOG(ERROR) << "Malformed message";
+      return;
+    }
     SendEnvelope(socket, move(env));
   }
 
@@ -180,7 +178,11 @@ shared_ptr<Broker> Broker::New(const ConfigurationPtr& config, std::chrono::mill
 
 Broker::Broker(const ConfigurationPtr& config, const shared_ptr<zmq::context_t>& context,
                std::chrono::milliseconds poll_timeout_ms)
-    : config_(config), context_(context), poll_timeout_ms_(poll_timeout_ms), running_(false) {}
+    : config_(config),
+      context_(context),
+      poll_timeout_ms_(poll_timeout_ms),
+      backlog_(std::make_shared<Backlog>()),
+      running_(false) {}
 
 void Broker::AddChannel(Channel chan, bool send_raw) {
   CHECK(!running_) << "Cannot add new channel. The broker has already been running";
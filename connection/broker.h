@@ -5,6 +5,7 @@
 #include <unordered_map>
 #include <zmq.hpp>
 
+#include "common/backlog.h"
 #include "common/configuration.h"
 #include "common/constants.h"
 #include "common/types.h"
@@ -58,10 +59,14 @@ class Broker {
   void StartInNewThreads();
   void Stop();
 
+  // If send_raw is true, messages to this channel are passed on without being deserialized. Otherwise,
+  // they are deserialized on the broker thread. Either way, they can be received with RecvEnvelope
   void AddChannel(Channel chan, bool send_raw = false);
 
   const ConfigurationPtr& config() const { return config_; }
   const std::shared_ptr<zmq::context_t>& context() const { return context_; }
+  // Shared by the modules of this machine to report and read their backlog
+  const BacklogPtr& backlog() const { return backlog_; }
 
  private:
   Broker(const ConfigurationPtr& config, const std::shared_ptr<zmq::context_t>& context,
@@ -70,6 +75,7 @@ class Broker {
   ConfigurationPtr config_;
   std::shared_ptr<zmq::context_t> context_;
   std::chrono::milliseconds poll_timeout_ms_;
+  BacklogPtr backlog_;
 
   bool running_;
   std::vector<std::pair<Channel, bool>> channels_;
@@ -0,0 +1,165 @@
+#include "connection/compression.h"
+
+#include <glog/logging.h>
+#include <lz4.h>
+#include <lz4hc.h>
+#include <zstd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "common/constants.h"
+#include "connection/zmq_utils.h"
+
+using namespace std::chrono;
+
+namespace slog {
+
+namespace {
+
+// Each byte of an LZ4 block expands to at most 255 bytes
+const size_t kMaxLZ4CompressionRatio = 255;
+
+std::atomic<uint64_t> num_decompressed_payloads_ = 0;
+std::atomic<uint64_t> decompress_time_ns_ = 0;
+
+size_t MaxCompressedSize(internal::CompressionCodec codec, size_t size) {
+  switch (codec) {
+    case internal::CompressionCodec::LZ4:
+      return LZ4_compressBound(size);
+    case internal::CompressionCodec::ZSTD:
+      return ZSTD_compressBound(size);
+    default:
+      return 0;
+  }
+}
+
+// Returns the size of the compressed data or 0 if the data cannot be compressed into dst
+size_t Compress(const internal::Compression& options, const char* src, size_t src_sz, char* dst, size_t dst_capacity) {
+  switch (options.codec()) {
+    case internal::CompressionCodec::LZ4: {
+      int compressed_sz;
+      if (options.level() > 0) {
+        compressed_sz = LZ4_compress_HC(src, dst, src_sz, dst_capacity, options.level());
+      } else {
+        compressed_sz = LZ4_compress_default(src, dst, src_sz, dst_capacity);
+      }
+      return std::max(compressed_sz, 0);
+    }
+    case internal::CompressionCodec::ZSTD: {
+      auto compressed_sz = ZSTD_compress(dst, dst_capacity, src, src_sz, options.level());
+      return ZSTD_isError(compressed_sz) ? 0 : compressed_sz;
+    }
+    default:
+      return 0;
+  }
+}
+
+// Checks the claimed uncompressed size against what the compressed data can expand to
+bool IsPlausibleUncompressedSize(uint8_t codec, const char* src, size_t src_sz, uint32_t uncompressed_sz) {
+  switch (codec) {
+    case internal::CompressionCodec::LZ4:
+      return uncompressed_sz <= LZ4_MAX_INPUT_SIZE && uncompressed_sz <= src_sz * kMaxLZ4CompressionRatio;
+    case internal::CompressionCodec::ZSTD:
+      // ZSTD_compress always records the content size in the frame header
+      return ZSTD_getFrameContentSize(src, src_sz) == uncompressed_sz;
+    default:
+      LOG(ERROR) << "Unknown compression codec: " << static_cast<int>(codec);
+      return false;
+  }
+}
+
+}  // namespace
+
+bool CompressFrame(zmq::message_t& out, const char* frame, size_t frame_sz, const internal::Compression& options,
+                   CompressionStats& stats) {
+  uint32_t payload_sz = frame_sz - kFrameHeaderSize;
+  if (payload_sz < options.min_payload_bytes() || options.codec() == internal::CompressionCodec::NO_COMPRESSION) {
+    stats.num_uncompressed++;
+    return false;
+  }
+
+  auto start_time = steady_clock::now();
+  auto compressed_offset = kFrameHeaderSize + sizeof(payload_sz);
+  auto capacity = MaxCompressedSize(options.codec(), payload_sz);
+  auto data = new char[compressed_offset + capacity];
+  auto compressed_sz = Compress(options, frame + kFrameHeaderSize, payload_sz, data + compressed_offset, capacity);
+  stats.compress_time += steady_clock::now() - start_time;
+
+  uint32_t new_payload_sz = sizeof(payload_sz) + compressed_sz;
+  if (compressed_sz == 0 || new_payload_sz >= payload_sz) {
+    delete[] data;
+    stats.num_uncompressed++;
+    return false;
+  }
+  memcpy(data, frame, kFrameHeaderSize);
+  data[kFrameCodecOffset] = options.codec();
+  memcpy(data + kFramePayloadSizeOffset, &new_payload_sz, sizeof(new_payload_sz));
+  memcpy(data + kFrameHeaderSize, &payload_sz, sizeof(payload_sz));
+
+  // The message only covers the used part of the buffer, which is freed once zmq is done with it
+  out = zmq::message_t(
+      data, kFrameHeaderSize + new_payload_sz, [](void* data, void*) { delete[] static_cast<char*>(data); }, nullptr);
+
+  stats.num_compressed++;
+  stats.uncompressed_bytes += payload_sz;
+  stats.compressed_bytes += new_payload_sz;
+  return true;
+}
+
+bool DecompressPayload(uint8_t codec, const char* payload, size_t payload_sz, std::string& out) {
+  uint32_t uncompressed_sz;
+  if (payload_sz < sizeof(uncompressed_sz)) {
+    return false;
+  }
+  memcpy(&uncompressed_sz, payload, sizeof(uncompressed_sz));
+  auto src = payload + sizeof(uncompressed_sz);
+  auto src_sz = payload_sz - sizeof(uncompressed_sz);
+
+  // The uncompressed size comes off the wire so it is bounded before allocating the output
+  if (!IsPlausibleUncompressedSize(codec, src, src_sz, uncompressed_sz)) {
+    return false;
+  }
+
+  auto start_time = steady_clock::now();
+  out.resize(uncompressed_sz);
+  bool ok = false;
+  switch (codec) {
+    case internal::CompressionCodec::LZ4:
+      ok = LZ4_decompress_safe(src, out.data(), src_sz, uncompressed_sz) == static_cast<int>(uncompressed_sz);
+      break;
+    case internal::CompressionCodec::ZSTD: {
+      auto decompressed_sz = ZSTD_decompress(out.data(), uncompressed_sz, src, src_sz);
+      ok = !ZSTD_isError(decompressed_sz) && decompressed_sz == uncompressed_sz;
+      break;
+    }
+  }
+  auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start_time);
+  num_decompressed_payloads_.fetch_add(1, std::memory_order_relaxed);
+  decompress_time_ns_.fetch_add(elapsed.count(), std::memory_order_relaxed);
+  return ok;
+}
+
+uint64_t num_decompressed_payloads() { return num_decompressed_payloads_.load(std::memory_order_relaxed); }
+
+nanoseconds decompress_time() { return nanoseconds(decompress_time_ns_.load(std::memory_order_relaxed)); }
+
+rapidjson::Value CompressionStatsToJson(const CompressionStats& stats, rapidjson::Document::AllocatorType& alloc) {
+  using rapidjson::StringRef;
+
+  rapidjson::Value json(rapidjson::kObjectType);
+  json.AddMember(StringRef(NUM_COMPRESSED_MSGS), stats.num_compressed, alloc);
+  json.AddMember(StringRef(NUM_UNCOMPRESSED_MSGS), stats.num_uncompressed, alloc);
+  double ratio = 0;
+  if (stats.compressed_bytes > 0) {
+    ratio = static_cast<double>(stats.uncompressed_bytes) / stats.compressed_bytes;
+  }
+  json.AddMember(StringRef(COMPRESSION_RATIO), ratio, alloc);
+  json.AddMember(StringRef(COMPRESS_TIME_US), duration_cast<microseconds>(stats.compress_time).count(), alloc);
+  json.AddMember(StringRef(NUM_DECOMPRESSED_MSGS), num_decompressed_payloads(), alloc);
+  json.AddMember(StringRef(DECOMPRESS_TIME_US), duration_cast<microseconds>(decompress_time()).count(), alloc);
+  return json;
+}
+
+}  // namespace slog
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <zmq.hpp>
+
+#include "proto/configuration.pb.h"
+#include "rapidjson/document.h"
+
+namespace slog {
+
+/**
+ * The payload of a frame can be compressed with one of the codecs in CompressionCodec. The codec is
+ * written in the frame header (see zmq_utils.h) and the compressed payload is laid out as follows
+ *
+ *   | uncompressed payload size (4) | compressed payload |
+ *
+ * Frames are compressed by the Sender for the links configured with compression and decompressed
+ * by DeserializeProto, so the receivers do not need to know whether a frame was compressed.
+ */
+struct CompressionStats {
+  uint64_t num_compressed = 0;
+  // Frames that are too small or that do not shrink are sent uncompressed
+  uint64_t num_uncompressed = 0;
+  uint64_t uncompressed_bytes = 0;
+  uint64_t compressed_bytes = 0;
+  std::chrono::nanoseconds compress_time{0};
+};
+
+/**
+ * Compresses the payload of a complete frame, whose address and header are copied to the new frame.
+ * Returns false, leaving out untouched, if the payload is smaller than options.min_payload_bytes()
+ * or does not shrink
+ */
+bool CompressFrame(zmq::message_t& out, const char* frame, size_t frame_sz, const internal::Compression& options,
+                   CompressionStats& stats);
+
+/**
+ * Decompresses a compressed payload into out. Returns false if the payload is malformed
+ */
+bool DecompressPayload(uint8_t codec, const char* payload, size_t payload_sz, std::string& out);
+
+/* Number of payloads decompressed by all threads so far */
+uint64_t num_decompressed_payloads();
+/* Time spent decompressing payloads by all threads so far */
+std::chrono::nanoseconds decompress_time();
+
+/**
+ * {
+ *    num_compressed_msgs:   int,
+ *    num_uncompressed_msgs: int,
+ *    compression_ratio:     float,
+ *    compress_time_us:      int,
+ *    num_decompressed_msgs: int,
+ *    decompress_time_us:    int
+ * }
+ */
+rapidjson::Value CompressionStatsToJson(const CompressionStats& stats, rapidjson::Document::AllocatorType& alloc);
+
+}  // namespace slog
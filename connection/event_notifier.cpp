@@ -0,0 +1,35 @@
+#include "connection/event_notifier.h"
+
+#include <glog/logging.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cstring>
+
+namespace slog {
+
+EventNotifier::EventNotifier() : armed_(false) {
+  fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  CHECK_GE(fd_, 0) << "Failed to create eventfd: " << strerror(errno);
+}
+
+EventNotifier::~EventNotifier() { close(fd_); }
+
+void EventNotifier::Disarm(bool signaled) {
+  armed_.store(false, std::memory_order_relaxed);
+  if (!signaled) {
+    return;
+  }
+  // Consume the signal so that the file descriptor is not readable anymore
+  uint64_t count;
+  while (read(fd_, &count, sizeof(count)) < 0 && errno == EINTR) {
+  }
+}
+
+void EventNotifier::Signal() {
+  uint64_t one = 1;
+  while (write(fd_, &one, sizeof(one)) < 0 && errno == EINTR) {
+  }
+}
+
+}  // namespace slog
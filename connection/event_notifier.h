@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+
+namespace slog {
+
+/**
+ * Wakes up a thread that is blocked in a Poller when there is new work in a
+ * queue that cannot be polled by zmq, such as a lock-free ring.
+ *
+ * The waiting thread spins on its queue for a while before parking. Right before
+ * parking, it arms the notifier and checks the queue one last time. A producer only
+ * makes a system call to signal the file descriptor of the notifier if the notifier
+ * is armed, so the hand-off costs nothing while the waiting thread is busy.
+ */
+class EventNotifier {
+ public:
+  EventNotifier();
+  ~EventNotifier();
+
+  EventNotifier(const EventNotifier&) = delete;
+  EventNotifier& operator=(const EventNotifier&) = delete;
+
+  /**
+   * File descriptor to be polled by the waiting thread. It becomes readable after
+   * Notify is called on an armed notifier.
+   */
+  int fd() const { return fd_; }
+
+  /**
+   * To be called by the waiting thread before checking its queue for the last time
+   * before parking. The check must happen after this call so that no notification
+   * is missed.
+   */
+  void Arm() {
+    armed_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  /**
+   * To be called by the waiting thread after waking up
+   *
+   * @param signaled Whether the file descriptor was found readable
+   */
+  void Disarm(bool signaled);
+
+  /**
+   * To be called by a producer after adding work to the queue of the waiting thread
+   */
+  void Notify() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (armed_.load(std::memory_order_relaxed) && armed_.exchange(false, std::memory_order_relaxed)) {
+      Signal();
+    }
+  }
+
+ private:
+  void Signal();
+
+  int fd_;
+  std::atomic<bool> armed_;
+};
+
+}  // namespace slog
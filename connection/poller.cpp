@@ -16,6 +16,14 @@ void Poller::PushSocket(zmq::socket_t& socket) {
   });
 }
 
+void Poller::PushNotifier(EventNotifier& notifier, std::function<bool()>&& has_work) {
+  poll_items_.push_back({
+      nullptr, notifier.fd(), /* fd */
+      ZMQ_POLLIN, 0           /* revent */
+  });
+  notifiers_.push_back({&notifier, move(has_work), poll_items_.size() - 1});
+}
+
 bool Poller::NextEvent(bool dont_wait) {
   auto may_have_msg = true;
   if (!dont_wait) {
@@ -31,6 +39,16 @@ bool Poller::NextEvent(bool dont_wait) {
       }
     }
 
+    // Do not block if some work has arrived at the notified queues
+    bool has_work = false;
+    for (auto& n : notifiers_) {
+      n.notifier->Arm();
+      if (n.has_work()) {
+        has_work = true;
+        shortest_timeout = 0us;
+      }
+    }
+
     int rc = 0;
     // Wait until the next time event or some timeout.
     if (shortest_timeout.has_value()) {
@@ -42,7 +60,11 @@ bool Poller::NextEvent(bool dont_wait) {
       // No timed event to wait, wait until there is a new message
       rc = zmq::poll(poll_items_, -1);
     }
-    may_have_msg = rc > 0;
+    may_have_msg = rc > 0 || has_work;
+
+    for (auto& n : notifiers_) {
+      n.notifier->Disarm(poll_items_[n.poll_item].revents & ZMQ_POLLIN);
+    }
   }
 
   // Process and clean up triggered callbacks
@@ -6,6 +6,8 @@
 #include <vector>
 #include <zmq.hpp>
 
+#include "connection/event_notifier.h"
+
 namespace slog {
 
 class Poller {
@@ -18,6 +20,10 @@ class Poller {
 
   void PushSocket(zmq::socket_t& socket);
 
+  // Polls a notifier along with the sockets. Before blocking, the notifier is armed and
+  // has_work is called to check for work that arrived before the notifier was armed
+  void PushNotifier(EventNotifier& notifier, std::function<bool()>&& has_work);
+
   bool is_socket_ready(size_t i) const;
 
   void AddTimedCallback(std::chrono::microseconds timeout, std::function<void()>&& cb);
@@ -32,6 +38,13 @@ class Poller {
 
   std::optional<std::chrono::microseconds> poll_timeout_;
   std::vector<zmq::pollitem_t> poll_items_;
+
+  struct Notifier {
+    EventNotifier* notifier;
+    std::function<bool()> has_work;
+    size_t poll_item;
+  };
+  std::vector<Notifier> notifiers_;
   std::list<TimedCallback> timed_callbacks_;
 };
 
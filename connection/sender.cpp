@@ -1,15 +1,55 @@
 #include "sender.h"
 
+#include <algorithm>
+#include <cstring>
+#include <optional>
+
+#include "common/constants.h"
+
 using std::move;
 
 namespace slog {
 
-Sender::Sender(const ConfigurationPtr& config, const std::shared_ptr<zmq::context_t>& context)
-    : config_(config), context_(context) {}
+Sender::Sender(const ConfigurationPtr& config, const std::shared_ptr<zmq::context_t>& context, bool coalescing)
+    : config_(config),
+      context_(context),
+      coalescing_max_bytes_(coalescing ? config->message_coalescing_max_bytes() : 0),
+      coalescing_max_delay_(config->message_coalescing_max_delay()) {
+  for (uint32_t rep = 0; rep < config->num_replicas(); rep++) {
+    if (rep == config->local_replica()) {
+      compression_to_replica_.emplace_back();
+    } else {
+      compression_to_replica_.push_back(config->compression_to(rep));
+    }
+  }
+}
+
+Sender::~Sender() { Flush(); }
 
 void Sender::Send(const internal::Envelope& envelope, MachineId to_machine_id, Channel to_channel) {
-  auto& socket = GetRemoteSocket(to_machine_id, to_channel);
-  SendSerializedProto(*socket, envelope, config_->local_machine_id(), to_channel);
+  auto& remote = GetRemoteSocket(to_machine_id, to_channel);
+  if (auto compression = GetCompression(to_machine_id); compression != nullptr) {
+    // The message is compressed from its serialized form so it cannot be serialized into the coalesced frame
+    auto frame = SerializeProto(envelope);
+    WriteFrameAddress(frame.data<char>(), config_->local_machine_id(), to_channel);
+    if (zmq::message_t compressed; CompressFrame(compressed, frame.data<char>(), frame.size(), *compression,
+                                                 compression_stats_)) {
+      SendFrame(remote, move(compressed));
+    } else {
+      SendFrame(remote, move(frame));
+    }
+    return;
+  }
+  if (coalescing_max_bytes_ > 0) {
+    // Computing the size also caches the size of every sub-message for the serialization
+    uint32_t payload_sz = envelope.ByteSizeLong();
+    if (auto data = AppendFrame(remote, kFrameHeaderSize + payload_sz); data != nullptr) {
+      WriteFrameAddress(data, config_->local_machine_id(), to_channel);
+      WriteFrame(data, envelope, payload_sz);
+      return;
+    }
+  }
+  SendSerializedProto(remote.socket, envelope, config_->local_machine_id(), to_channel);
 }
 
 void Sender::Send(EnvelopePtr&& envelope, MachineId to_machine_id, Channel to_channel) {
@@ -36,34 +76,79 @@ void Sender::Send(EnvelopePtr&& envelope, Channel to_channel) {
 
 void Sender::Send(const internal::Envelope& envelope, const std::vector<MachineId>& to_machine_ids,
                   Channel to_channel) {
-  auto serialized = SerializeProto(envelope);
-  for (auto dest : to_machine_ids) {
-    zmq::message_t copied;
-    copied.copy(serialized);
-    auto& socket = GetRemoteSocket(dest, to_channel);
-    SendAddressedBuffer(*socket, move(copied), config_->local_machine_id(), to_channel);
-  }
+  // The message has the same sender and channel for every destination so they can all share one buffer
+  SharedFrame frame(envelope, config_->local_machine_id(), to_channel);
+  SendSharedFrame(frame, to_machine_ids, to_channel);
 }
 
 void Sender::Send(EnvelopePtr&& envelope, const std::vector<MachineId>& to_machine_ids, Channel to_channel) {
-  auto serialized = SerializeProto(*envelope);
+  std::vector<MachineId> remote_machine_ids;
   bool send_local = false;
   for (auto dest : to_machine_ids) {
     if (dest == config_->local_machine_id()) {
       send_local = true;
-      continue;
+    } else {
+      remote_machine_ids.push_back(dest);
     }
-    zmq::message_t copied;
-    copied.copy(serialized);
-    auto& socket = GetRemoteSocket(dest, to_channel);
-    SendAddressedBuffer(*socket, move(copied), config_->local_machine_id(), to_channel);
+  }
+  // Serialize only if the message is sent to a remote machine
+  if (!remote_machine_ids.empty()) {
+    SharedFrame frame(*envelope, config_->local_machine_id(), to_channel);
+    SendSharedFrame(frame, remote_machine_ids, to_channel);
   }
   if (send_local) {
     Send(std::move(envelope), to_channel);
   }
 }
 
-Sender::SocketPtr& Sender::GetRemoteSocket(MachineId machine_id, Channel channel) {
+void Sender::SendSharedFrame(SharedFrame& frame, const std::vector<MachineId>& to_machine_ids, Channel to_channel) {
+  // The frame is compressed at most once for each replica since the compression is configured per replica.
+  // An empty compressed frame means that the frame is sent uncompressed to that replica
+  std::vector<std::optional<zmq::message_t>> compressed_frames;
+  for (auto dest : to_machine_ids) {
+    auto& remote = GetRemoteSocket(dest, to_channel);
+    if (auto compression = GetCompression(dest); compression != nullptr) {
+      if (compressed_frames.empty()) {
+        compressed_frames.resize(config_->num_replicas());
+      }
+      auto& compressed = compressed_frames[config_->UnpackMachineId(dest).first];
+      if (!compressed.has_value()) {
+        compressed.emplace();
+        CompressFrame(*compressed, frame.data(), frame.size(), *compression, compression_stats_);
+      }
+      if (compressed->size() > 0) {
+        // Copying a message only shares its buffer
+        zmq::message_t msg;
+        msg.copy(*compressed);
+        SendFrame(remote, move(msg));
+        continue;
+      }
+    }
+    if (auto data = AppendFrame(remote, frame.size()); data != nullptr) {
+      memcpy(data, frame.data(), frame.size());
+    } else {
+      remote.socket.send(frame.MakeMessage(), zmq::send_flags::dontwait);
+    }
+  }
+}
+
+void Sender::SendFrame(RemoteSocket& remote, zmq::message_t&& frame) {
+  if (auto data = AppendFrame(remote, frame.size()); data != nullptr) {
+    memcpy(data, frame.data(), frame.size());
+  } else {
+    remote.socket.send(frame, zmq::send_flags::dontwait);
+  }
+}
+
+const internal::Compression* Sender::GetCompression(MachineId machine_id) const {
+  auto& compression = compression_to_replica_[config_->UnpackMachineId(machine_id).first];
+  if (compression.codec() == internal::CompressionCodec::NO_COMPRESSION) {
+    return nullptr;
+  }
+  return &compression;
+}
+
+Sender::RemoteSocket& Sender::GetRemoteSocket(MachineId machine_id, Channel channel) {
   uint32_t port;
   if (channel >= kMaxChannel) {
     port = config_->broker_ports(config_->broker_ports_size() - 1);
@@ -83,14 +168,93 @@ Sender::SocketPtr& Sender::GetRemoteSocket(MachineId machine_id, Channel channel
   // Lazily establish a new connection when necessary
   uint64_t machine_id_and_port = (static_cast<uint64_t>(machine_id) << 32) | port;
   auto ins = machine_id_and_port_to_sockets_.try_emplace(machine_id_and_port, nullptr);
-  auto& socket = ins.first->second;
-  if (socket == nullptr) {
-    socket = std::make_unique<zmq::socket_t>(*context_, ZMQ_PUSH);
-    socket->set(zmq::sockopt::sndhwm, 0);
+  auto& remote = ins.first->second;
+  if (remote == nullptr) {
+    zmq::socket_t socket(*context_, ZMQ_PUSH);
+    socket.set(zmq::sockopt::sndhwm, 0);
     auto endpoint = MakeRemoteAddress(config_->protocol(), config_->address(machine_id), port);
-    socket->connect(endpoint);
+    socket.connect(endpoint);
+    remote = std::make_unique<RemoteSocket>(move(socket));
+  }
+  return *remote;
+}
+
+char* Sender::AppendFrame(RemoteSocket& remote, size_t frame_sz) {
+  if (coalescing_max_bytes_ == 0) {
+    return nullptr;
+  }
+  bool has_pending = remote.num_pending > 0;
+  // Keep the frames in order by sending the held back frames before a frame that does not fit
+  if (has_pending && remote.pending.size() + frame_sz > coalescing_max_bytes_) {
+    Flush(remote);
+  }
+  if (kFrameHeaderSize + frame_sz > coalescing_max_bytes_) {
+    if (has_pending) {
+      pending_sockets_.erase(std::find(pending_sockets_.begin(), pending_sockets_.end(), &remote));
+    }
+    return nullptr;
+  }
+  if (remote.num_pending == 0) {
+    remote.pending.reserve(coalescing_max_bytes_);
+    remote.pending.resize(kFrameHeaderSize);
+    remote.pending_since = std::chrono::steady_clock::now();
+    if (!has_pending) {
+      pending_sockets_.push_back(&remote);
+    }
+  }
+  auto offset = remote.pending.size();
+  remote.pending.resize(offset + frame_sz);
+  remote.num_pending++;
+  coalescing_stats_.num_held_back++;
+  return remote.pending.data() + offset;
+}
+
+void Sender::Flush(bool expired_only) {
+  auto now = std::chrono::steady_clock::now();
+  auto it = pending_sockets_.begin();
+  while (it != pending_sockets_.end()) {
+    if (expired_only && now - (*it)->pending_since < coalescing_max_delay_) {
+      ++it;
+      continue;
+    }
+    Flush(**it);
+    it = pending_sockets_.erase(it);
+  }
+}
+
+void Sender::Flush(RemoteSocket& remote) {
+  if (remote.num_pending == 0) {
+    return;
+  }
+  // The buffer is handed over to zmq, which frees it once the message is sent
+  auto buffer = new std::vector<char>(move(remote.pending));
+  auto data = buffer->data();
+  auto size = buffer->size();
+  if (remote.num_pending == 1) {
+    // A single frame is sent as is
+    data += kFrameHeaderSize;
+    size -= kFrameHeaderSize;
+  } else {
+    WriteFrameAddress(data, config_->local_machine_id(), 0);
+    WriteFrameHeader(data, MessageType::COALESCED, size - kFrameHeaderSize);
+    coalescing_stats_.num_coalesced_frames++;
+    coalescing_stats_.num_coalesced_msgs += remote.num_pending;
   }
-  return socket;
+  zmq::message_t msg(
+      data, size, [](void*, void* hint) { delete static_cast<std::vector<char>*>(hint); }, buffer);
+  remote.socket.send(msg, zmq::send_flags::dontwait);
+  remote.pending.clear();
+  remote.num_pending = 0;
+}
+
+rapidjson::Value CoalescingStatsToJson(const CoalescingStats& stats, rapidjson::Document::AllocatorType& alloc) {
+  using rapidjson::StringRef;
+
+  rapidjson::Value json(rapidjson::kObjectType);
+  json.AddMember(StringRef(NUM_HELD_BACK_MSGS), stats.num_held_back, alloc);
+  json.AddMember(StringRef(NUM_COALESCED_FRAMES), stats.num_coalesced_frames, alloc);
+  json.AddMember(StringRef(NUM_COALESCED_MSGS), stats.num_coalesced_msgs, alloc);
+  return json;
 }
 
 }  // namespace slog
\ No newline at end of file
@@ -1,21 +1,50 @@
 #pragma once
 
+#include <chrono>
 #include <unordered_map>
+#include <vector>
 #include <zmq.hpp>
 
 #include "common/types.h"
 #include "connection/broker.h"
+#include "connection/compression.h"
 #include "connection/zmq_utils.h"
 #include "proto/internal.pb.h"
 
 namespace slog {
 
+struct CoalescingStats {
+  // Messages held back to be packed with the following messages to the same destination
+  uint64_t num_held_back = 0;
+  // Frames packing more than one message and the number of messages in them. A held back message
+  // that no other message joins before the flush is sent on its own
+  uint64_t num_coalesced_frames = 0;
+  uint64_t num_coalesced_msgs = 0;
+};
+
+/**
+ * {
+ *    num_held_back_msgs:   int,
+ *    num_coalesced_frames: int,
+ *    num_coalesced_msgs:   int
+ * }
+ */
+rapidjson::Value CoalescingStatsToJson(const CoalescingStats& stats, rapidjson::Document::AllocatorType& alloc);
+
 /*
  * See Broker class for details about this class
+ *
+ * If coalescing is requested and message_coalescing_max_bytes is set in the config, the messages sent to
+ * a remote machine are held back and packed together with the following messages to the same machine and
+ * port into one frame, which the receiving broker or module unpacks. The held back messages are sent when
+ * the frame is full or by calling Flush, which the owner of the sender must do when it runs out of work.
+ *
+ * The messages sent to another replica are compressed as configured by Configuration::compression_to.
  */
 class Sender {
  public:
-  Sender(const ConfigurationPtr& config, const std::shared_ptr<zmq::context_t>& context);
+  Sender(const ConfigurationPtr& config, const std::shared_ptr<zmq::context_t>& context, bool coalescing = false);
+  ~Sender();
 
   /**
    * Send a request or response to a given channel of a given machine
@@ -60,16 +89,56 @@ class Sender {
    */
   void Send(EnvelopePtr&& envelope, const std::vector<MachineId>& to_machine_ids, Channel to_channel);
 
+  /**
+   * Sends the messages held back for coalescing. If expired_only is true, only the messages
+   * to the destinations whose oldest message has waited longer than the max delay are sent
+   */
+  void Flush(bool expired_only = false);
+
+  bool has_pending_messages() const { return !pending_sockets_.empty(); }
+
+  const CoalescingStats& coalescing_stats() const { return coalescing_stats_; }
+  const CompressionStats& compression_stats() const { return compression_stats_; }
+
  private:
-  using SocketPtr = std::unique_ptr<zmq::socket_t>;
-  SocketPtr& GetRemoteSocket(MachineId machine_id, Channel channel);
+  struct RemoteSocket {
+    explicit RemoteSocket(zmq::socket_t&& socket) : socket(std::move(socket)), num_pending(0) {}
+    zmq::socket_t socket;
+    // The frames held back for coalescing, after room for the header of the coalesced frame
+    std::vector<char> pending;
+    uint32_t num_pending;
+    std::chrono::steady_clock::time_point pending_since;
+  };
+  using RemoteSocketPtr = std::unique_ptr<RemoteSocket>;
+  RemoteSocket& GetRemoteSocket(MachineId machine_id, Channel channel);
+
+  // Returns where to write a frame of the given size to be coalesced or nullptr if the frame
+  // must be sent on its own, in which case the frames held back for the socket are sent first
+  char* AppendFrame(RemoteSocket& remote, size_t frame_sz);
+  void Flush(RemoteSocket& remote);
+
+  void SendSharedFrame(SharedFrame& frame, const std::vector<MachineId>& to_machine_ids, Channel to_channel);
+  // Sends a complete frame, coalescing it if possible
+  void SendFrame(RemoteSocket& remote, zmq::message_t&& frame);
+  // Returns the compression for the messages sent to the given machine or nullptr if they are not compressed
+  const internal::Compression* GetCompression(MachineId machine_id) const;
 
   ConfigurationPtr config_;
   // Keep a pointer to context here to make sure that the below sockets
   // are destroyed before the context is
   std::shared_ptr<zmq::context_t> context_;
-  std::unordered_map<uint64_t, SocketPtr> machine_id_and_port_to_sockets_;
+  std::unordered_map<uint64_t, RemoteSocketPtr> machine_id_and_port_to_sockets_;
   std::unordered_map<Channel, zmq::socket_t> local_channel_to_socket_;
+
+  // Max size of a coalesced frame. Coalescing is disabled if this is 0
+  size_t coalescing_max_bytes_;
+  std::chrono::microseconds coalescing_max_delay_;
+  std::vector<RemoteSocket*> pending_sockets_;
+  CoalescingStats coalescing_stats_;
+
+  // Indexed by replica. The codec is NO_COMPRESSION for the local replica
+  std::vector<internal::Compression> compression_to_replica_;
+  CompressionStats compression_stats_;
 };
 
 }  // namespace slog
\ No newline at end of file
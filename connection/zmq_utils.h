@@ -1,17 +1,20 @@
 #pragma once
 
-#include <google/protobuf/any.pb.h>
+#include <glog/logging.h>
 
+#include <atomic>
+#include <cstring>
 #include <sstream>
 #include <zmq.hpp>
 
+#include "common/arena.h"
 #include "common/types.h"
+#include "connection/compression.h"
+#include "proto/api.pb.h"
 #include "proto/internal.pb.h"
 
 namespace slog {
 
-using EnvelopePtr = std::unique_ptr<internal::Envelope>;
-
 inline std::string MakeInProcChannelAddress(Channel chan) { return "inproc://channel_" + std::to_string(chan); }
 inline std::string MakeRemoteAddress(const std::string& protocol, const std::string& addr, uint32_t port,
                                      bool binding = false) {
@@ -37,39 +40,144 @@ inline void SendEnvelope(zmq::socket_t& socket, EnvelopePtr&& envelope) {
 }
 
 /**
- * Receives a pointer of an envelope
+ * A serialized message is sent in a frame laid out as follows. Numbers are in host byte order.
+ *
+ *   | sender machine id (4) | receiver channel (8) | version (1) | codec (1) | message type (2) |
+ *   | payload size (4) | payload |
+ *
+ * The payload is the serialized proto, written directly into the frame. If the codec is not
+ * NO_COMPRESSION, the payload is compressed as described in compression.h. The machine id and
+ * channel are filled in right before sending so the same frame can be sent to many receivers.
+ *
+ * The payload of a frame of type COALESCED is a sequence of complete frames, possibly to different
+ * channels, that are sent to the same machine and port together. See Sender for how they are made.
  */
-inline EnvelopePtr RecvEnvelope(zmq::socket_t& socket, bool dont_wait = false) {
-  zmq::message_t msg;
-  auto flag = dont_wait ? zmq::recv_flags::dontwait : zmq::recv_flags::none;
-  if (!socket.recv(msg, flag)) {
-    return nullptr;
+const uint8_t kFrameVersion = 1;
+const size_t kFrameVersionOffset = sizeof(MachineId) + sizeof(Channel);
+const size_t kFrameCodecOffset = kFrameVersionOffset + 1;
+const size_t kFrameMessageTypeOffset = kFrameCodecOffset + 1;
+const size_t kFramePayloadSizeOffset = kFrameMessageTypeOffset + sizeof(uint16_t);
+const size_t kFrameHeaderSize = kFramePayloadSizeOffset + sizeof(uint32_t);
+
+/**
+ * Tags of the protos that can be sent in a frame. The receiver uses the tag to reject
+ * a message of a different type than expected
+ */
+enum class MessageType : uint16_t {
+  UNKNOWN = 0,
+  ENVELOPE = 1,
+  INTERNAL_REQUEST = 2,
+  INTERNAL_RESPONSE = 3,
+  API_REQUEST = 4,
+  API_RESPONSE = 5,
+  COALESCED = 6,
+};
+
+inline MessageType GetMessageType(const google::protobuf::Descriptor* descriptor) {
+  if (descriptor == internal::Envelope::descriptor()) {
+    return MessageType::ENVELOPE;
+  } else if (descriptor == internal::Request::descriptor()) {
+    return MessageType::INTERNAL_REQUEST;
+  } else if (descriptor == internal::Response::descriptor()) {
+    return MessageType::INTERNAL_RESPONSE;
+  } else if (descriptor == api::Request::descriptor()) {
+    return MessageType::API_REQUEST;
+  } else if (descriptor == api::Response::descriptor()) {
+    return MessageType::API_RESPONSE;
   }
-  return EnvelopePtr(*(msg.data<internal::Envelope*>()));
+  return MessageType::UNKNOWN;
 }
 
-inline zmq::message_t SerializeProto(const google::protobuf::Message& proto) {
-  google::protobuf::Any any;
-  any.PackFrom(proto);
+/**
+ * Writes the frame of a proto into data, which must have room for kFrameHeaderSize + payload_sz bytes.
+ * payload_sz must be computed with proto.ByteSizeLong() right before calling this function
+ */
+inline void WriteFrameHeader(char* data, MessageType type, uint32_t payload_sz) {
+  data[kFrameVersionOffset] = kFrameVersion;
+  data[kFrameCodecOffset] = internal::CompressionCodec::NO_COMPRESSION;
+  memcpy(data + kFrameMessageTypeOffset, &type, sizeof(type));
+  memcpy(data + kFramePayloadSizeOffset, &payload_sz, sizeof(payload_sz));
+}
 
-  auto header_sz = sizeof(MachineId) + sizeof(Channel);
-  zmq::message_t msg(header_sz + any.ByteSizeLong());
-  any.SerializeToArray(msg.data<char>() + header_sz, any.ByteSizeLong());
+inline void WriteFrame(char* data, const google::protobuf::Message& proto, uint32_t payload_sz) {
+  auto type = GetMessageType(proto.GetDescriptor());
+  CHECK(type != MessageType::UNKNOWN) << "Cannot send message of type " << proto.GetTypeName();
+  WriteFrameHeader(data, type, payload_sz);
+  proto.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(data + kFrameHeaderSize));
+}
+
+inline void WriteFrameAddress(char* data, MachineId from_machine_id, Channel to_chan) {
+  memcpy(data, &from_machine_id, sizeof(from_machine_id));
+  memcpy(data + sizeof(from_machine_id), &to_chan, sizeof(to_chan));
+}
 
+inline zmq::message_t SerializeProto(const google::protobuf::Message& proto) {
+  // Computing the size also caches the size of every sub-message for the serialization
+  uint32_t payload_sz = proto.ByteSizeLong();
+  zmq::message_t msg(kFrameHeaderSize + payload_sz);
+  WriteFrame(msg.data<char>(), proto, payload_sz);
   return msg;
 }
 
 inline void SendAddressedBuffer(zmq::socket_t& socket, zmq::message_t&& msg, MachineId from_machine_id = -1,
                                 Channel to_chan = 0) {
-  auto machine_id_data = msg.data<MachineId>();
-  *machine_id_data = from_machine_id;
-
-  auto channel_data = reinterpret_cast<Channel*>(machine_id_data + 1);
-  *channel_data = to_chan;
-
+  WriteFrameAddress(msg.data<char>(), from_machine_id, to_chan);
   socket.send(msg, zmq::send_flags::dontwait);
 }
 
+/**
+ * A frame sent to many receivers without being copied. The proto is serialized once into a
+ * reference-counted buffer and every message made from this frame points to that buffer. The
+ * buffer is freed when this object and all messages made from it are gone, which, for a sent
+ * message, is when zmq is done with it.
+ */
+class SharedFrame {
+ public:
+  SharedFrame(const google::protobuf::Message& proto, MachineId from_machine_id, Channel to_chan) {
+    uint32_t payload_sz = proto.ByteSizeLong();
+    buffer_ = new Buffer(kFrameHeaderSize + payload_sz);
+    WriteFrameAddress(buffer_->data.get(), from_machine_id, to_chan);
+    WriteFrame(buffer_->data.get(), proto, payload_sz);
+    num_allocated_buffers_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  ~SharedFrame() { Release(buffer_); }
+
+  SharedFrame(const SharedFrame&) = delete;
+  SharedFrame& operator=(const SharedFrame&) = delete;
+
+  zmq::message_t MakeMessage() {
+    buffer_->refs.fetch_add(1, std::memory_order_relaxed);
+    return zmq::message_t(buffer_->data.get(), buffer_->size, &SharedFrame::Free, buffer_);
+  }
+
+  const char* data() const { return buffer_->data.get(); }
+  size_t size() const { return buffer_->size; }
+
+  /* Total number of buffers allocated by all shared frames so far */
+  static uint64_t num_allocated_buffers() { return num_allocated_buffers_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Buffer {
+    explicit Buffer(size_t size) : refs(1), data(new char[size]), size(size) {}
+    std::atomic<uint32_t> refs;
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+
+  static void Free(void*, void* hint) { Release(static_cast<Buffer*>(hint)); }
+
+  static void Release(Buffer* buffer) {
+    if (buffer->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete buffer;
+    }
+  }
+
+  Buffer* buffer_;
+
+  static inline std::atomic<uint64_t> num_allocated_buffers_ = 0;
+};
+
 /**
  * Serializes and send proto message. The sent buffer contains
  * <sender machine id> <receiver channel> <proto>
@@ -101,20 +209,63 @@ inline bool ParseChannel(Channel& chan, const zmq::message_t& msg) {
   return true;
 }
 
+inline bool IsCoalescedFrame(const char* data, size_t size) {
+  if (size < kFrameHeaderSize || static_cast<uint8_t>(data[kFrameVersionOffset]) != kFrameVersion) {
+    return false;
+  }
+  MessageType type;
+  memcpy(&type, data + kFrameMessageTypeOffset, sizeof(type));
+  return type == MessageType::COALESCED;
+}
+
+inline bool IsCoalescedFrame(const zmq::message_t& msg) { return IsCoalescedFrame(msg.data<char>(), msg.size()); }
+
+/**
+ * Calls fn(data, size) on each frame in msg, which is either a single frame or a coalesced frame
+ */
+template <typename Fn>
+inline void ForEachFrame(const zmq::message_t& msg, Fn&& fn) {
+  if (!IsCoalescedFrame(msg)) {
+    fn(msg.data<char>(), msg.size());
+    return;
+  }
+  auto data = msg.data<char>() + kFrameHeaderSize;
+  auto end = msg.data<char>() + msg.size();
+  while (data < end) {
+    size_t remaining = end - data;
+    uint32_t payload_sz = 0;
+    if (remaining >= kFrameHeaderSize) {
+      memcpy(&payload_sz, data + kFramePayloadSizeOffset, sizeof(payload_sz));
+    }
+    if (remaining < kFrameHeaderSize + payload_sz) {
+      LOG(ERROR) << "Malformed coalesced frame";
+      return;
+    }
+    fn(data, kFrameHeaderSize + payload_sz);
+    data += kFrameHeaderSize + payload_sz;
+  }
+}
+
 template <typename T>
 inline bool DeserializeProto(T& out, const char* data, size_t size) {
-  google::protobuf::Any any;
-  auto header_sz = sizeof(MachineId) + sizeof(Channel);
-  if (size < header_sz) {
+  if (size < kFrameHeaderSize || static_cast<uint8_t>(data[kFrameVersionOffset]) != kFrameVersion) {
     return false;
   }
-  // Skip the machineid and channel part
-  auto proto_data = data + header_sz;
-  auto proto_size = size - header_sz;
-  if (!any.ParseFromArray(proto_data, proto_size)) {
+  MessageType type;
+  memcpy(&type, data + kFrameMessageTypeOffset, sizeof(type));
+  uint32_t payload_sz;
+  memcpy(&payload_sz, data + kFramePayloadSizeOffset, sizeof(payload_sz));
+  if (type != GetMessageType(T::descriptor()) || payload_sz != size - kFrameHeaderSize) {
     return false;
   }
-  return any.UnpackTo(&out);
+  if (auto codec = static_cast<uint8_t>(data[kFrameCodecOffset]); codec != internal::CompressionCodec::NO_COMPRESSION) {
+    thread_local std::string uncompressed;
+    if (!DecompressPayload(codec, data + kFrameHeaderSize, payload_sz, uncompressed)) {
+      return false;
+    }
+    return out.ParseFromArray(uncompressed.data(), uncompressed.size());
+  }
+  return out.ParseFromArray(data + kFrameHeaderSize, payload_sz);
 }
 
 template <typename T>
@@ -140,15 +291,53 @@ inline bool RecvDeserializedProtoWithEmptyDelim(zmq::socket_t& socket, T& out, b
   return RecvDeserializedProto(socket, out, dont_wait);
 }
 
-inline EnvelopePtr DeserializeEnvelope(const zmq::message_t& msg) {
-  auto env = std::make_unique<internal::Envelope>();
-  if (!DeserializeProto(*env, msg)) {
+/**
+ * If on_arena is true, the envelope is deserialized on a new arena owned by the envelope
+ */
+inline EnvelopePtr DeserializeEnvelope(const char* data, size_t size, bool on_arena = false) {
+  EnvelopePtr env;
+  if (on_arena) {
+    // The parsed message takes a few times the space of its serialized form
+    env.reset(google::protobuf::Arena::CreateMessage<internal::Envelope>(NewArena(2 * size).release()));
+  } else {
+    env.reset(new internal::Envelope());
+  }
+  if (!DeserializeProto(*env, data, size)) {
     return nullptr;
   }
-  MachineId machine_id = -1;
-  ParseMachineId(machine_id, msg);
+  // The frame is at least as large as its header, which starts with the machine id
+  MachineId machine_id;
+  memcpy(&machine_id, data, sizeof(machine_id));
   env->set_from(machine_id);
   return env;
 }
 
+inline EnvelopePtr DeserializeEnvelope(const zmq::message_t& msg, bool on_arena = false) {
+  return DeserializeEnvelope(msg.data<char>(), msg.size(), on_arena);
+}
+
+/**
+ * A message received from an inproc socket is either a pointer of an envelope, sent with SendEnvelope, or
+ * a serialized envelope, forwarded as is by the broker. They are told apart by size since a frame is always
+ * longer than a pointer
+ */
+static_assert(sizeof(internal::Envelope*) < kFrameHeaderSize);
+
+/**
+ * Receives a pointer of an envelope or deserializes a serialized envelope. See DeserializeEnvelope for on_arena
+ */
+inline EnvelopePtr RecvEnvelope(zmq::socket_t& socket, bool dont_wait = false, bool on_arena = false) {
+  zmq::message_t msg;
+  auto flag = dont_wait ? zmq::recv_flags::dontwait : zmq::recv_flags::none;
+  if (!socket.recv(msg, flag)) {
+    return nullptr;
+  }
+  if (msg.size() == sizeof(internal::Envelope*)) {
+    return EnvelopePtr(*(msg.data<internal::Envelope*>()));
+  }
+  auto env = DeserializeEnvelope(msg, on_arena);
+  LOG_IF(ERROR, env == nullptr) << "Malformed message";
+  return env;
+}
+
 }  // namespace slog
\ No newline at end of file
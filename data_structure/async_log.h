@@ -1,7 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <optional>
 #include <sstream>
-#include <unordered_map>
+#include <stdexcept>
+#include <vector>
+
+#include "data_structure/ring_buffer.h"
 
 namespace slog {
 
@@ -13,27 +18,32 @@ namespace slog {
  * following their number. In other words, if the item right after the
  * most recently read item has not been added to the log, read cannot
  * advance. A log can only be iterated forward in one direction.
+ *
+ * Since positions are dense, the items are kept in a ring buffer indexed by
+ * position. The buffer covers positions [next, next + capacity) and doubles
+ * whenever an item beyond that range is inserted.
  */
 template <typename T>
 class AsyncLog {
  public:
-  AsyncLog(uint32_t start_from = 0) : next_(start_from) {}
+  AsyncLog(uint32_t start_from = 0, size_t initial_capacity = 16)
+      : buffer_(RoundUpToPowerOfTwo(std::max<size_t>(initial_capacity, 1))),
+        mask_(buffer_.size() - 1),
+        next_(start_from),
+        size_(0) {}
 
-  void Insert(uint32_t position, const T& item) {
-    if (position < next_) {
-      return;
-    }
-    auto ret = log_.emplace(position, item);
-    if (ret.second == false) {
-      std::ostringstream os;
-      os << "Log position " << position << " has already been taken";
-      throw std::runtime_error(os.str());
-    }
-  }
+  void Insert(uint32_t position, const T& item) { Emplace(position, item); }
 
-  bool HasNext() const { return log_.count(next_) > 0; }
+  void Insert(uint32_t position, T&& item) { Emplace(position, std::move(item)); }
 
-  const T& Peek() { return log_.at(next_); }
+  bool HasNext() const { return buffer_[next_ & mask_].has_value(); }
+
+  const T& Peek() {
+    if (!HasNext()) {
+      throw std::out_of_range("Next item does not exist");
+    }
+    return buffer_[next_ & mask_].value();
+  }
 
   std::pair<uint32_t, T> Next() {
     if (!HasNext()) {
@@ -42,18 +52,57 @@ class AsyncLog {
     auto position = next_;
     next_++;
 
-    auto it = log_.find(position);
-    auto res = *it;
-    log_.erase(it);
+    auto& entry = buffer_[position & mask_];
+    std::pair<uint32_t, T> res(position, std::move(entry.value()));
+    entry.reset();
+    size_--;
     return res;
   }
 
   /* For debugging */
-  size_t NumBufferredItems() const { return log_.size(); }
+  size_t NumBufferredItems() const { return size_; }
+
+  /* For debugging */
+  size_t capacity() const { return buffer_.size(); }
 
  private:
-  std::unordered_map<uint32_t, T> log_;
+  template <typename U>
+  void Emplace(uint32_t position, U&& item) {
+    if (position < next_) {
+      return;
+    }
+    if (position - next_ > mask_) {
+      Grow(position - next_ + 1);
+    }
+    auto& entry = buffer_[position & mask_];
+    if (entry.has_value()) {
+      std::ostringstream os;
+      os << "Log position " << position << " has already been taken";
+      throw std::runtime_error(os.str());
+    }
+    entry.emplace(std::forward<U>(item));
+    size_++;
+  }
+
+  void Grow(size_t min_capacity) {
+    std::vector<std::optional<T>> new_buffer(RoundUpToPowerOfTwo(min_capacity));
+    size_t new_mask = new_buffer.size() - 1;
+    // All buffered items are within [next_, next_ + old capacity)
+    for (size_t i = 0; i <= mask_; i++) {
+      auto position = next_ + i;
+      auto& entry = buffer_[position & mask_];
+      if (entry.has_value()) {
+        new_buffer[position & new_mask] = std::move(entry);
+      }
+    }
+    buffer_ = std::move(new_buffer);
+    mask_ = new_mask;
+  }
+
+  std::vector<std::optional<T>> buffer_;
+  size_t mask_;
   uint32_t next_;
+  size_t size_;
 };
 
-}  // namespace slog
\ No newline at end of file
+}  // namespace slog
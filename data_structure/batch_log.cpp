@@ -2,27 +2,30 @@
 
 #include <glog/logging.h>
 
-using std::make_pair;
 using std::move;
 
 namespace slog {
 
-BatchLog::BatchLog() {}
+BatchLog::BatchLog() : num_buffered_batches_(0) {}
 
 void BatchLog::AddBatch(BatchPtr&& batch) {
   auto batch_id = batch->id();
-  batches_.insert_or_assign(batch_id, move(batch));
+  auto& pending_batch = pending_batches_[batch_id];
+  if (pending_batch.batch == nullptr) {
+    num_buffered_batches_++;
+  }
+  pending_batch.batch = move(batch);
   UpdateReadyBatches();
 }
 
 void BatchLog::AckReplication(BatchId batch_id) {
-  replication_[batch_id]--;
+  pending_batches_[batch_id].remaining_replication--;
   UpdateReadyBatches();
 }
 
 void BatchLog::AddSlot(SlotId slot_id, BatchId batch_id, int replication_factor) {
   slots_.Insert(slot_id, batch_id);
-  replication_[batch_id] += replication_factor;
+  pending_batches_[batch_id].remaining_replication += replication_factor;
   UpdateReadyBatches();
 }
 
@@ -32,29 +35,23 @@ std::pair<SlotId, BatchPtr> BatchLog::NextBatch() {
   if (!HasNextBatch()) {
     throw std::runtime_error("NextBatch() was called when there is no ready batch");
   }
-  auto next_slot = ready_batches_.front().first;
-  auto next_batch_id = ready_batches_.front().second;
+  auto res = move(ready_batches_.front());
   ready_batches_.pop();
-
-  auto it = batches_.find(next_batch_id);
-  auto res = make_pair(move(next_slot), move(it->second));
-  batches_.erase(it);
-
+  num_buffered_batches_--;
   return res;
 }
 
 void BatchLog::UpdateReadyBatches() {
   while (slots_.HasNext()) {
-    auto next_batch_id = slots_.Peek();
-    auto batch_it = batches_.find(next_batch_id);
-    auto rep_it = replication_.find(next_batch_id);
-    if (batch_it != batches_.end() && rep_it != replication_.end() && rep_it->second == 0) {
-      replication_.erase(rep_it);
-      ready_batches_.push(slots_.Next());
-    } else {
+    auto it = pending_batches_.find(slots_.Peek());
+    // The slot of a batch is added together with its replication count so the entry is always there
+    DCHECK(it != pending_batches_.end());
+    if (it->second.batch == nullptr || it->second.remaining_replication != 0) {
       break;
     }
+    ready_batches_.emplace(slots_.Next().first, move(it->second.batch));
+    pending_batches_.erase(it);
   }
 }
 
-}  // namespace slog
\ No newline at end of file
+}  // namespace slog
@@ -3,14 +3,13 @@
 #include <queue>
 #include <unordered_map>
 
+#include "common/arena.h"
 #include "common/types.h"
 #include "data_structure/async_log.h"
 #include "proto/internal.pb.h"
 
 namespace slog {
 
-using BatchPtr = std::unique_ptr<internal::Batch>;
-
 class BatchLog {
  public:
   BatchLog();
@@ -26,15 +25,21 @@ class BatchLog {
   size_t NumBufferedSlots() const { return slots_.NumBufferredItems(); }
 
   /* For debugging */
-  size_t NumBufferedBatches() const { return batches_.size(); }
+  size_t NumBufferedBatches() const { return num_buffered_batches_; }
 
  private:
   void UpdateReadyBatches();
 
+  // A batch id may be known from its data, its slot or its replication acks, which can arrive in any order
+  struct PendingBatch {
+    BatchPtr batch;
+    int remaining_replication;
+  };
+
   AsyncLog<BatchId> slots_;
-  std::unordered_map<BatchId, BatchPtr> batches_;
-  std::unordered_map<BatchId, int> replication_;
-  std::queue<std::pair<SlotId, BatchId>> ready_batches_;
+  std::unordered_map<BatchId, PendingBatch> pending_batches_;
+  std::queue<std::pair<SlotId, BatchPtr>> ready_batches_;
+  size_t num_buffered_batches_;
 };
 
 }  // namespace slog
\ No newline at end of file
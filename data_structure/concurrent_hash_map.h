@@ -2,8 +2,11 @@
  * concurrent_hash_map.h
  *
  * This implementation borrows from folly::ConcurrentHashMap the idea of sharding key space
- * into different segments. However, each segment here is only coarsely guarded with a read-write
- * latch as opposed to a more granular approach in the highly-optimized folly::ConcurrentHashMap.
+ * into different segments. Writers to a segment are serialized by a mutex while readers take
+ * no latch at all: nodes are never modified after being published, so an update replaces the
+ * node of a key with a new one and a rehash builds new copies of all nodes in a new bucket
+ * array. The replaced nodes and bucket arrays are freed via epoch-based reclamation once no
+ * reader can still see them.
  *
  * This map should be used in conjuction with shared_ptr because its destructor is not
  * thread-safe. With shared_ptr, the last thread that releases the pointer will be the only
@@ -12,9 +15,12 @@
 #pragma once
 
 #include <atomic>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <utility>
 
-#include "data_structure/rwlatch.h"
+#include "data_structure/epoch.h"
 
 namespace slog {
 
@@ -22,17 +28,11 @@ namespace concurrent_hash_map {
 
 template <typename KeyType, typename ValueType>
 struct NodeT {
-  NodeT() = default;
+  NodeT(const KeyType& key, const ValueType& value, NodeT* next) : next(next), key(key), value(value) {}
 
-  NodeT(const NodeT& other) {
-    next = other.next;
-    key = other.key;
-    value = other.value;
-  }
-
-  NodeT* next{nullptr};
-  KeyType key;
-  ValueType value;
+  std::atomic<NodeT*> next;
+  const KeyType key;
+  const ValueType value;
 };
 
 template <typename KeyType, typename ValueType, typename HashFn = std::hash<KeyType>, uint8_t ShardBits = 8>
@@ -41,90 +41,158 @@ class SegmentT {
 
   static constexpr float kLoadFactor = 1.05;
 
+  // Number of retired objects accumulated before trying to reclaim them
+  static constexpr size_t kReclaimThreshold = 64;
+
  public:
   /**
    * initial_bucket_count must be a power of 2
    */
   SegmentT(size_t initial_bucket_count = 8)
-      : load_factor_max_size_(static_cast<size_t>(kLoadFactor * initial_bucket_count)), size_(0) {
-    buckets_.reset(Buckets::CreateBuckets(initial_bucket_count));
+      : buckets_(Buckets::CreateBuckets(initial_bucket_count)),
+        load_factor_max_size_(static_cast<size_t>(kLoadFactor * initial_bucket_count)),
+        size_(0) {}
+
+  ~SegmentT() {
+    delete buckets_.load();
+    for (auto& retired : retired_) {
+      delete retired.node;
+      delete retired.buckets;
+    }
   }
 
   bool Get(ValueType& res, const KeyType& key) const {
     auto h = HashFn{}(key);
-    bool found = false;
 
-    rw_latch_.RLock();
+    EpochManager::Guard guard;
 
-    auto idx = GetIndex(buckets_->count, h);
-    auto node = buckets_->bucket_roots[idx];
-    while (node) {
-      if (key == node->key) {
-        break;
-      }
-      node = node->next;
-    }
+    auto node = Find(buckets_.load(std::memory_order_acquire), h, key);
     if (node) {
       res = node->value;
-      found = true;
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * Calls visitor on the value of the key without copying it. The value must not be
+   * accessed after the visitor returns
+   */
+  template <typename Visitor>
+  bool Visit(const KeyType& key, Visitor&& visitor) const {
+    auto h = HashFn{}(key);
+
+    EpochManager::Guard guard;
+
+    auto node = Find(buckets_.load(std::memory_order_acquire), h, key);
+    if (node) {
+      visitor(node->value);
+      return true;
+    }
+    return false;
+  }
+
+  template <typename Fn>
+  void ForEach(Fn&& fn) const {
+    EpochManager::Guard guard;
+
+    auto buckets = buckets_.load(std::memory_order_acquire);
+    for (size_t idx = 0; idx < buckets->count; idx++) {
+      auto node = buckets->bucket_roots[idx].load(std::memory_order_acquire);
+      while (node) {
+        fn(node->key, node->value);
+        node = node->next.load(std::memory_order_acquire);
+      }
     }
+  }
+
+  /**
+   * The returned pointer is only valid until the next write to the map,
+   * so this can only be used when there is no concurrent writer
+   */
+  const ValueType* GetUnsafe(const KeyType& key) {
+    auto node = Find(buckets_.load(std::memory_order_relaxed), HashFn{}(key), key);
+    return node ? &node->value : nullptr;
+  }
 
-    rw_latch_.RUnlock();
+  bool InsertOrUpdate(const KeyType& key, const ValueType& value) {
+    auto h = HashFn{}(key);
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
 
-    return found;
+    return InsertOrUpdateLocked(h, key, value);
   }
 
-  ValueType* GetUnsafe(const KeyType& key) {
+  /**
+   * Replaces the value of the key with the result of calling updater on a copy of it, or on a
+   * default-constructed value if the key does not exist. The other writers of the segment are
+   * blocked while updater runs, so concurrent updates of a key never overwrite each other
+   */
+  template <typename Updater>
+  bool Update(const KeyType& key, Updater&& updater) {
     auto h = HashFn{}(key);
-    auto idx = GetIndex(buckets_->count, h);
-    auto node = buckets_->bucket_roots[idx];
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    auto node = Find(buckets_.load(std::memory_order_relaxed), h, key);
+    ValueType value = node ? node->value : ValueType();
+    updater(value);
+    return InsertOrUpdateLocked(h, key, value);
+  }
+
+  bool Erase(const KeyType& key) {
+    auto h = HashFn{}(key);
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    auto buckets = buckets_.load(std::memory_order_relaxed);
+    std::atomic<Node*>* link = &buckets->bucket_roots[GetIndex(buckets->count, h)];
+    auto node = link->load(std::memory_order_relaxed);
     while (node) {
       if (key == node->key) {
-        return &node->value;
+        // Readers that are on this node can still move on to the next one
+        link->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+        Retire(node, nullptr);
+        size_--;
+        return true;
       }
-      node = node->next;
+      link = &node->next;
+      node = node->next.load(std::memory_order_relaxed);
     }
-    return nullptr;
+
+    return false;
   }
 
-  bool InsertOrUpdate(const KeyType& key, const ValueType& value) {
-    auto h = HashFn{}(key);
+ private:
+  struct Buckets;
 
-    rw_latch_.WLock();
+  static uint64_t GetIndex(size_t nbuckets, size_t hash) { return (hash >> ShardBits) & (nbuckets - 1); }
 
-    auto idx = GetIndex(buckets_->count, h);
-    Node* prev = nullptr;
+  // Must hold the write mutex
+  bool InsertOrUpdateLocked(size_t h, const KeyType& key, const ValueType& value) {
+    auto buckets = buckets_.load(std::memory_order_relaxed);
+    auto& root = buckets->bucket_roots[GetIndex(buckets->count, h)];
+    std::atomic<Node*>* link = &root;
     bool key_exists = false;
-    auto node = buckets_->bucket_roots[idx];
+    auto node = root.load(std::memory_order_relaxed);
     while (node) {
       if (key == node->key) {
         key_exists = true;
         // If key already exists, replace the corresponding
         // node with a new node containing the new value
-        auto new_node = new Node();
-        new_node->key = key;
-        new_node->value = value;
-        new_node->next = node->next;
-        if (prev) {
-          prev->next = new_node;
-        } else {
-          buckets_->bucket_roots[idx] = new_node;
-        }
-        delete node;
-
+        auto new_node = new Node(key, value, node->next.load(std::memory_order_relaxed));
+        link->store(new_node, std::memory_order_release);
+        Retire(node, nullptr);
         break;
       }
-      prev = node;
-      node = node->next;
+      link = &node->next;
+      node = node->next.load(std::memory_order_relaxed);
     }
 
     if (!key_exists) {
       // If key does not exist, at new node to the bucket
-      auto new_node = new Node();
-      new_node->key = key;
-      new_node->value = value;
-      new_node->next = buckets_->bucket_roots[idx];
-      buckets_->bucket_roots[idx] = new_node;
+      auto new_node = new Node(key, value, root.load(std::memory_order_relaxed));
+      root.store(new_node, std::memory_order_release);
       size_++;
     }
 
@@ -132,83 +200,73 @@ class SegmentT {
       Rehash();
     }
 
-    rw_latch_.WUnlock();
-
     return key_exists;
   }
 
-  bool Erase(const KeyType& key) {
-    auto h = HashFn{}(key);
-
-    rw_latch_.WLock();
-
-    bool key_exists = false;
-    auto idx = GetIndex(buckets_->count, h);
-    Node* prev = nullptr;
-    auto node = buckets_->bucket_roots[idx];
+  // Must be in an epoch-protected critical section or hold the write mutex
+  static Node* Find(const Buckets* buckets, size_t hash, const KeyType& key) {
+    auto idx = GetIndex(buckets->count, hash);
+    auto node = buckets->bucket_roots[idx].load(std::memory_order_acquire);
     while (node) {
       if (key == node->key) {
-        key_exists = true;
-        if (prev) {
-          prev->next = node->next;
-        } else {
-          buckets_->bucket_roots[idx] = node->next;
-        }
-        delete node;
-        break;
+        return node;
       }
-      prev = node;
-      node = node->next;
+      node = node->next.load(std::memory_order_acquire);
     }
-
-    rw_latch_.WUnlock();
-
-    return key_exists;
+    return nullptr;
   }
 
- private:
-  // Must hold lock
-  static uint64_t GetIndex(size_t nbuckets, size_t hash) { return (hash >> ShardBits) & (nbuckets - 1); }
-
-  // Must hold lock
+  // Must hold the write mutex
   void Rehash() {
-    auto new_bucket_count = buckets_->count << 1;
+    auto old_buckets = buckets_.load(std::memory_order_relaxed);
+    auto new_bucket_count = old_buckets->count << 1;
     auto new_buckets = Buckets::CreateBuckets(new_bucket_count);
 
-    for (size_t idx = 0; idx < buckets_->count; idx++) {
-      auto node = buckets_->bucket_roots[idx];
-      if (node == nullptr) {
-        continue;
-      }
-
+    // Readers may still be traversing the old chains so the nodes are copied instead of relinked
+    for (size_t idx = 0; idx < old_buckets->count; idx++) {
+      auto node = old_buckets->bucket_roots[idx].load(std::memory_order_relaxed);
       while (node) {
-        auto next_node = node->next;
-
-        auto idx = GetIndex(new_bucket_count, HashFn{}(node->key));
-        node->next = new_buckets->bucket_roots[idx];
-        new_buckets->bucket_roots[idx] = node;
-
-        node = next_node;
+        auto& root = new_buckets->bucket_roots[GetIndex(new_bucket_count, HashFn{}(node->key))];
+        root.store(new Node(node->key, node->value, root.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+        node = node->next.load(std::memory_order_relaxed);
       }
-      buckets_->bucket_roots[idx] = nullptr;
     }
-    buckets_.reset(new_buckets);
-    load_factor_max_size_ = static_cast<size_t>(kLoadFactor * buckets_->count);
+    buckets_.store(new_buckets, std::memory_order_release);
+    Retire(nullptr, old_buckets);
+    load_factor_max_size_ = static_cast<size_t>(kLoadFactor * new_bucket_count);
+  }
+
+  // Must hold the write mutex
+  void Retire(Node* node, Buckets* buckets) {
+    auto& epoch_manager = EpochManager::Instance();
+    // The epoch must be read after the object is unlinked. Otherwise, a stale epoch would let the
+    // object be freed while a reader that entered after the epoch advanced still holds it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    retired_.push_back({epoch_manager.epoch(), node, buckets});
+    if (retired_.size() < kReclaimThreshold) {
+      return;
+    }
+    auto epoch = epoch_manager.TryAdvance();
+    while (!retired_.empty() && EpochManager::IsSafeToReclaim(retired_.front().epoch, epoch)) {
+      delete retired_.front().node;
+      delete retired_.front().buckets;
+      retired_.pop_front();
+    }
   }
 
   struct Buckets {
     static Buckets* CreateBuckets(size_t num_buckets) {
       auto buckets = new Buckets();
       buckets->count = num_buckets;
-      buckets->bucket_roots = std::make_unique<Node*[]>(num_buckets);
+      buckets->bucket_roots = std::make_unique<std::atomic<Node*>[]>(num_buckets);
       return buckets;
     }
 
     ~Buckets() {
       for (size_t i = 0; i < count; i++) {
-        auto node = bucket_roots[i];
+        auto node = bucket_roots[i].load(std::memory_order_relaxed);
         while (node) {
-          auto next = node->next;
+          auto next = node->next.load(std::memory_order_relaxed);
           delete node;
           node = next;
         }
@@ -216,11 +274,19 @@ class SegmentT {
     }
 
     size_t count;
-    std::unique_ptr<Node*[]> bucket_roots;
+    std::unique_ptr<std::atomic<Node*>[]> bucket_roots;
   };
 
-  mutable bustub::ReaderWriterLatch rw_latch_;
-  std::unique_ptr<Buckets> buckets_;
+  // A node or a bucket array that has been unlinked from the segment
+  struct Retired {
+    uint64_t epoch;
+    Node* node;
+    Buckets* buckets;
+  };
+
+  std::atomic<Buckets*> buckets_;
+  std::mutex write_mutex_;
+  std::deque<Retired> retired_;
   size_t load_factor_max_size_;
   size_t size_;
 };
@@ -247,7 +313,7 @@ class ConcurrentHashMap {
     }
   }
 
-  ValueType* GetUnsafe(const KeyType& key) {
+  const ValueType* GetUnsafe(const KeyType& key) {
     auto idx = PickSegment(key);
     return EnsureSegment(idx)->GetUnsafe(key);
   }
@@ -257,11 +323,40 @@ class ConcurrentHashMap {
     return EnsureSegment(idx)->Get(res, key);
   }
 
+  template <typename Visitor>
+  bool Visit(const KeyType& key, Visitor&& visitor) const {
+    auto idx = PickSegment(key);
+    return EnsureSegment(idx)->Visit(key, std::forward<Visitor>(visitor));
+  }
+
+  /**
+   * Calls fn on every key and value without blocking writers. Entries that are
+   * written concurrently may or may not be visited
+   */
+  template <typename Fn>
+  void ForEach(Fn&& fn) const {
+    for (uint64_t i = 0; i < NumShards; i++) {
+      if (auto segment = segments_[i].load(); segment != nullptr) {
+        segment->ForEach(fn);
+      }
+    }
+  }
+
   bool InsertOrUpdate(const KeyType& key, const ValueType& value) {
     auto idx = PickSegment(key);
     return EnsureSegment(idx)->InsertOrUpdate(key, value);
   }
 
+  /**
+   * Atomically replaces the value of the key with the result of calling updater on a copy of
+   * it. Returns true if the key existed
+   */
+  template <typename Updater>
+  bool Update(const KeyType& key, Updater&& updater) {
+    auto idx = PickSegment(key);
+    return EnsureSegment(idx)->Update(key, std::forward<Updater>(updater));
+  }
+
   bool Erase(const KeyType& key) {
     auto idx = PickSegment(key);
     return EnsureSegment(idx)->Erase(key);
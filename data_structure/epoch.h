@@ -0,0 +1,144 @@
+#pragma once
+
+#include <glog/logging.h>
+
+#include <atomic>
+#include <cstdint>
+
+#include "data_structure/ring_buffer.h"
+
+namespace slog {
+
+/**
+ * Epoch-based memory reclamation. It lets readers traverse a data structure
+ * without taking any latch while writers unlink objects from it concurrently.
+ *
+ * A reader wraps its accesses in an EpochManager::Guard, which announces the
+ * global epoch observed at the beginning of the critical section. A writer
+ * records the global epoch at which it unlinks an object and only frees the
+ * object once the global epoch has advanced twice since then. The global epoch
+ * only advances when every thread inside a critical section has observed the
+ * current epoch, so by that time no reader can still hold the object.
+ *
+ * Each thread takes a slot the first time it enters a critical section and
+ * gives it back when it exits.
+ */
+class EpochManager {
+  static constexpr size_t kMaxThreads = 512;
+  // Epoch announced by a thread that is not in a critical section
+  static constexpr uint64_t kQuiescent = 0;
+
+  struct alignas(kCacheLineSize) Slot {
+    std::atomic<uint64_t> epoch{kQuiescent};
+    std::atomic<bool> in_use{false};
+  };
+
+  struct ThreadState {
+    ThreadState() : slot(nullptr), depth(0) {}
+    ~ThreadState() {
+      if (slot != nullptr) {
+        slot->epoch.store(kQuiescent, std::memory_order_release);
+        slot->in_use.store(false, std::memory_order_release);
+      }
+    }
+
+    Slot* slot;
+    // Guards can be nested. Only the outermost one announces an epoch
+    uint32_t depth;
+  };
+
+ public:
+  static EpochManager& Instance() {
+    static EpochManager instance;
+    return instance;
+  }
+
+  class Guard {
+   public:
+    Guard() : manager_(EpochManager::Instance()) { manager_.Enter(); }
+    ~Guard() { manager_.Exit(); }
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+   private:
+    EpochManager& manager_;
+  };
+
+  uint64_t epoch() const { return epoch_.load(std::memory_order_acquire); }
+
+  /**
+   * Advances the global epoch if all threads in a critical section have observed it
+   *
+   * @return the global epoch after the attempt
+   */
+  uint64_t TryAdvance() {
+    // Pairs with the fence in Enter so that either this thread sees the epoch announced
+    // by a reader or the reader sees everything unlinked before this call
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto current = epoch_.load(std::memory_order_acquire);
+    auto num_slots = num_slots_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < num_slots; i++) {
+      auto e = slots_[i].epoch.load(std::memory_order_acquire);
+      if (e != kQuiescent && e != current) {
+        return current;
+      }
+    }
+    if (epoch_.compare_exchange_strong(current, current + 1, std::memory_order_acq_rel)) {
+      return current + 1;
+    }
+    return current;
+  }
+
+  /* An object unlinked at retired_epoch can be freed once this returns true */
+  static bool IsSafeToReclaim(uint64_t retired_epoch, uint64_t current_epoch) {
+    return current_epoch >= retired_epoch + 2;
+  }
+
+ private:
+  EpochManager() : epoch_(1), num_slots_(0) {}
+
+  void Enter() {
+    auto& state = thread_state_;
+    if (state.depth++ > 0) {
+      return;
+    }
+    if (state.slot == nullptr) {
+      state.slot = AcquireSlot();
+    }
+    state.slot->epoch.store(epoch_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  void Exit() {
+    auto& state = thread_state_;
+    if (--state.depth > 0) {
+      return;
+    }
+    state.slot->epoch.store(kQuiescent, std::memory_order_release);
+  }
+
+  Slot* AcquireSlot() {
+    for (size_t i = 0; i < kMaxThreads; i++) {
+      bool in_use = false;
+      if (!slots_[i].in_use.load(std::memory_order_relaxed) &&
+          slots_[i].in_use.compare_exchange_strong(in_use, true, std::memory_order_acq_rel)) {
+        auto num_slots = num_slots_.load(std::memory_order_relaxed);
+        while (num_slots < i + 1 &&
+               !num_slots_.compare_exchange_weak(num_slots, i + 1, std::memory_order_acq_rel)) {
+        }
+        return &slots_[i];
+      }
+    }
+    LOG(FATAL) << "Too many threads in epoch-protected critical sections";
+    return nullptr;
+  }
+
+  alignas(kCacheLineSize) std::atomic<uint64_t> epoch_;
+  // Number of slots that have ever been taken
+  std::atomic<size_t> num_slots_;
+  Slot slots_[kMaxThreads];
+
+  static inline thread_local ThreadState thread_state_;
+};
+
+}  // namespace slog
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <glog/logging.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "common/types.h"
+
+namespace slog {
+
+using KeyId = uint32_t;
+
+/**
+ * A key replica is a key tagged with the region holding its master. Its id
+ * is the id of the key in the upper half and the master in the lower half.
+ */
+using KeyReplicaId = uint64_t;
+
+inline KeyReplicaId MakeKeyReplicaId(KeyId key_id, uint32_t master) {
+  return (static_cast<KeyReplicaId>(key_id) << 32) | master;
+}
+
+inline KeyId GetKeyId(KeyReplicaId key_replica_id) { return key_replica_id >> 32; }
+
+inline uint32_t GetMaster(KeyReplicaId key_replica_id) { return key_replica_id & 0xFFFFFFFF; }
+
+/**
+ * Maps each distinct key to a compact integer id so that the hot paths can
+ * hash, compare, and store the id instead of the key. The ids are dense, which
+ * allows them to be used as array indices.
+ *
+ * An interned key stays interned as long as it is referenced or forever if it
+ * has never been referenced. When the last reference of a key is dropped, the
+ * key is forgotten and its id is reused for another key.
+ *
+ * This class is not thread-safe.
+ */
+class KeyInterner {
+ public:
+  KeyId Intern(const Key& key) {
+    auto ins = ids_.try_emplace(key, 0);
+    if (ins.second) {
+      KeyId id;
+      if (free_ids_.empty()) {
+        id = entries_.size();
+        entries_.emplace_back();
+      } else {
+        id = free_ids_.back();
+        free_ids_.pop_back();
+      }
+      entries_[id] = {&ins.first->first, 0};
+      ins.first->second = id;
+    }
+    return ins.first->second;
+  }
+
+  void Ref(KeyId id) {
+    DCHECK_LT(id, entries_.size());
+    entries_[id].ref_count++;
+  }
+
+  void Unref(KeyId id) {
+    DCHECK_LT(id, entries_.size());
+    auto& entry = entries_[id];
+    DCHECK_GT(entry.ref_count, 0U);
+    if (--entry.ref_count == 0) {
+      ids_.erase(ids_.find(*entry.key));
+      entry.key = nullptr;
+      free_ids_.push_back(id);
+    }
+  }
+
+  const Key& key(KeyId id) const {
+    DCHECK_LT(id, entries_.size());
+    DCHECK(entries_[id].key != nullptr);
+    return *entries_[id].key;
+  }
+
+  size_t size() const { return ids_.size(); }
+
+ private:
+  struct Entry {
+    const Key* key;
+    uint32_t ref_count;
+  };
+
+  std::unordered_map<Key, KeyId> ids_;
+  std::vector<Entry> entries_;
+  std::vector<KeyId> free_ids_;
+};
+
+}  // namespace slog
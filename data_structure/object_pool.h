@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace slog {
+
+/**
+ * An arena of objects of the same type. Objects are carved out of large
+ * blocks of memory and deleted objects are recycled via an intrusive free
+ * list, so creating an object rarely goes to the general-purpose allocator
+ * and the objects stay close together in memory.
+ *
+ * The memory is only returned to the system when the pool is destroyed.
+ * Objects that have not been deleted by then are freed without running their
+ * destructors, so only trivially destructible types are allowed.
+ *
+ * This class is not thread-safe.
+ */
+template <typename T, size_t kBlockSize = 1024>
+class ObjectPool {
+  static_assert(std::is_trivially_destructible_v<T>, "Objects in the pool must be trivially destructible");
+
+ public:
+  ObjectPool() = default;
+  ObjectPool(const ObjectPool&) = delete;
+  ObjectPool& operator=(const ObjectPool&) = delete;
+  ObjectPool(ObjectPool&&) = default;
+  ObjectPool& operator=(ObjectPool&&) = default;
+
+  template <typename... Args>
+  T* New(Args&&... args) {
+    Slot* slot = free_list_;
+    if (slot != nullptr) {
+      free_list_ = slot->next;
+    } else {
+      if (next_in_block_ == kBlockSize) {
+        blocks_.emplace_back(new Slot[kBlockSize]);
+        next_in_block_ = 0;
+      }
+      slot = &blocks_.back()[next_in_block_++];
+    }
+    num_objects_++;
+    return new (slot->storage) T{std::forward<Args>(args)...};
+  }
+
+  void Delete(T* obj) {
+    auto slot = reinterpret_cast<Slot*>(obj);
+    slot->next = free_list_;
+    free_list_ = slot;
+    num_objects_--;
+  }
+
+  size_t num_objects() const { return num_objects_; }
+  size_t capacity() const { return blocks_.size() * kBlockSize; }
+
+ private:
+  union Slot {
+    Slot* next;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  std::vector<std::unique_ptr<Slot[]>> blocks_;
+  size_t next_in_block_ = kBlockSize;
+  Slot* free_list_ = nullptr;
+  size_t num_objects_ = 0;
+};
+
+}  // namespace slog
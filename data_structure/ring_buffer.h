@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <type_traits>
+
+namespace slog {
+
+// Size of a cache line. Indices modified by different threads are kept on different
+// cache lines to avoid false sharing
+constexpr size_t kCacheLineSize = 64;
+
+inline size_t RoundUpToPowerOfTwo(size_t n) {
+  size_t p = 1;
+  while (p < n) {
+    p <<= 1;
+  }
+  return p;
+}
+
+/**
+ * A bounded lock-free queue for exactly one producer thread and one consumer thread.
+ * The capacity is rounded up to a power of two.
+ */
+template <typename T>
+class SPSCRing {
+  static_assert(std::is_trivially_copyable_v<T>, "Items in the ring must be trivially copyable");
+
+ public:
+  explicit SPSCRing(size_t capacity)
+      : mask_(RoundUpToPowerOfTwo(capacity) - 1),
+        buffer_(new T[mask_ + 1]),
+        head_(0),
+        cached_tail_(0),
+        tail_(0),
+        cached_head_(0) {}
+
+  SPSCRing(const SPSCRing&) = delete;
+  SPSCRing& operator=(const SPSCRing&) = delete;
+
+  /**
+   * To be called by the producer only
+   *
+   * @return false if the ring is full
+   */
+  bool TryPush(const T& item) {
+    auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ > mask_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ > mask_) {
+        return false;
+      }
+    }
+    buffer_[tail & mask_] = item;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * To be called by the consumer only
+   *
+   * @return false if the ring is empty
+   */
+  bool TryPop(T& item) {
+    auto head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) {
+        return false;
+      }
+    }
+    item = buffer_[head & mask_];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+
+  /* The result is only approximate if the ring is being modified concurrently */
+  size_t size() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire); }
+
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  const size_t mask_;
+  const std::unique_ptr<T[]> buffer_;
+
+  // Owned by the consumer
+  alignas(kCacheLineSize) std::atomic<size_t> head_;
+  size_t cached_tail_;
+
+  // Owned by the producer
+  alignas(kCacheLineSize) std::atomic<size_t> tail_;
+  size_t cached_head_;
+};
+
+/**
+ * A bounded lock-free queue for any number of producer threads and exactly one
+ * consumer thread. Each slot carries a sequence number telling whether it is ready
+ * to be written or read, so producers only contend on claiming a slot.
+ * The capacity is rounded up to a power of two.
+ */
+template <typename T>
+class MPSCRing {
+  static_assert(std::is_trivially_copyable_v<T>, "Items in the ring must be trivially copyable");
+
+ public:
+  explicit MPSCRing(size_t capacity)
+      : mask_(RoundUpToPowerOfTwo(capacity) - 1), slots_(new Slot[mask_ + 1]), head_(0), tail_(0) {
+    for (size_t i = 0; i <= mask_; i++) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MPSCRing(const MPSCRing&) = delete;
+  MPSCRing& operator=(const MPSCRing&) = delete;
+
+  /**
+   * Can be called by any thread
+   *
+   * @return false if the ring is full
+   */
+  bool TryPush(const T& item) {
+    auto tail = tail_.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+      slot = &slots_[tail & mask_];
+      auto sequence = slot->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::make_signed_t<size_t>>(sequence - tail);
+      if (diff == 0) {
+        // The slot is free. Try to claim it
+        if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // The slot still holds an item from the previous round
+        return false;
+      } else {
+        // Another producer claimed the slot
+        tail = tail_.load(std::memory_order_relaxed);
+      }
+    }
+    slot->item = item;
+    slot->sequence.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * To be called by the consumer only
+   *
+   * @return false if the ring is empty or the next item is still being written
+   */
+  bool TryPop(T& item) {
+    auto head = head_.load(std::memory_order_relaxed);
+    auto& slot = slots_[head & mask_];
+    if (slot.sequence.load(std::memory_order_acquire) != head + 1) {
+      return false;
+    }
+    item = slot.item;
+    // Make the slot available to the producers of the next round
+    slot.sequence.store(head + mask_ + 1, std::memory_order_release);
+    head_.store(head + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /* To be called by the consumer only */
+  bool empty() const {
+    auto head = head_.load(std::memory_order_relaxed);
+    return slots_[head & mask_].sequence.load(std::memory_order_acquire) != head + 1;
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    T item;
+  };
+
+  const size_t mask_;
+  const std::unique_ptr<Slot[]> slots_;
+
+  // Owned by the consumer
+  alignas(kCacheLineSize) std::atomic<size_t> head_;
+
+  // Shared by the producers
+  alignas(kCacheLineSize) std::atomic<size_t> tail_;
+};
+
+}  // namespace slog
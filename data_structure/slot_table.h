@@ -0,0 +1,145 @@
+#pragma once
+
+#include <glog/logging.h>
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace slog {
+
+/**
+ * A table of objects of the same type addressed by handles. Like the ObjectPool,
+ * objects are carved out of large blocks of memory and the slots of erased objects
+ * are recycled via a free list, so an object never moves and creating one rarely
+ * goes to the general-purpose allocator.
+ *
+ * A handle is made of the index of a slot and the generation of that slot. The
+ * generation is bumped every time an object is placed into or erased from the slot,
+ * so a handle of an erased object never resolves to the object that reuses its slot.
+ *
+ * The objects that are still in the table are destroyed with it.
+ *
+ * This class is not thread-safe, although other threads may access the objects
+ * through references obtained from the table.
+ */
+template <typename T, size_t kBlockSize = 1024>
+class SlotTable {
+ public:
+  using Handle = uint64_t;
+
+  SlotTable() = default;
+  SlotTable(const SlotTable&) = delete;
+  SlotTable& operator=(const SlotTable&) = delete;
+
+  ~SlotTable() {
+    for (uint32_t i = 0; i < num_slots_; i++) {
+      auto& slot = GetSlot(i);
+      if (IsOccupied(slot.generation)) {
+        slot.object()->~T();
+      }
+    }
+  }
+
+  template <typename... Args>
+  Handle Emplace(Args&&... args) {
+    uint32_t index;
+    if (free_list_ != kNoSlot) {
+      index = free_list_;
+      free_list_ = GetSlot(index).next_free;
+    } else {
+      if (num_slots_ == blocks_.size() * kBlockSize) {
+        blocks_.emplace_back(new Slot[kBlockSize]);
+      }
+      index = num_slots_++;
+      GetSlot(index).index = index;
+    }
+    auto& slot = GetSlot(index);
+    new (slot.storage) T(std::forward<Args>(args)...);
+    slot.generation++;
+    size_++;
+    return MakeHandle(index, slot.generation);
+  }
+
+  /**
+   * Returns nullptr if the object of the handle has been erased
+   */
+  T* Get(Handle handle) {
+    auto index = static_cast<uint32_t>(handle);
+    if (index >= num_slots_) {
+      return nullptr;
+    }
+    auto& slot = GetSlot(index);
+    if (slot.generation != static_cast<uint32_t>(handle >> 32)) {
+      return nullptr;
+    }
+    return slot.object();
+  }
+
+  /**
+   * Precondition: obj is in this table
+   */
+  Handle HandleOf(const T& obj) const {
+    auto slot = reinterpret_cast<const Slot*>(&obj);
+    DCHECK(IsOccupied(slot->generation));
+    return MakeHandle(slot->index, slot->generation);
+  }
+
+  /**
+   * Precondition: the object of the handle has not been erased
+   */
+  void Erase(Handle handle) {
+    auto index = static_cast<uint32_t>(handle);
+    auto& slot = GetSlot(index);
+    CHECK_EQ(slot.generation, static_cast<uint32_t>(handle >> 32)) << "Erasing a stale handle";
+    slot.object()->~T();
+    slot.generation++;
+    slot.next_free = free_list_;
+    free_list_ = index;
+    size_--;
+  }
+
+  /**
+   * Calls fn on every object in the table, in no particular order
+   */
+  template <typename Fn>
+  void ForEach(Fn&& fn) {
+    for (uint32_t i = 0; i < num_slots_; i++) {
+      auto& slot = GetSlot(i);
+      if (IsOccupied(slot.generation)) {
+        fn(*slot.object());
+      }
+    }
+  }
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return blocks_.size() * kBlockSize; }
+
+ private:
+  static constexpr uint32_t kNoSlot = ~uint32_t{0};
+
+  struct Slot {
+    // Must be the first member so that an object can be cast back to its slot
+    alignas(T) unsigned char storage[sizeof(T)];
+    // Odd if the slot holds an object
+    uint32_t generation = 0;
+    uint32_t index;
+    uint32_t next_free;
+
+    T* object() { return std::launder(reinterpret_cast<T*>(storage)); }
+  };
+
+  static bool IsOccupied(uint32_t generation) { return generation % 2 == 1; }
+  static Handle MakeHandle(uint32_t index, uint32_t generation) { return (Handle{generation} << 32) | index; }
+
+  Slot& GetSlot(uint32_t index) { return blocks_[index / kBlockSize][index % kBlockSize]; }
+
+  std::vector<std::unique_ptr<Slot[]>> blocks_;
+  uint32_t num_slots_ = 0;
+  uint32_t free_list_ = kNoSlot;
+  size_t size_ = 0;
+};
+
+}  // namespace slog
@@ -1,13 +1,53 @@
 #include "execution/execution.h"
 
+#include <glog/logging.h>
+
+#include <charconv>
+
+#include "common/proto_utils.h"
+
 namespace slog {
 
+namespace {
+
+// The value of a key that is added to is a decimal integer. Returns false if the value is not
+bool ParseCounter(const std::string& value, int64_t& counter) {
+  auto end = value.data() + value.size();
+  auto res = std::from_chars(value.data(), end, counter);
+  return res.ec == std::errc() && res.ptr == end;
+}
+
+}  // namespace
+
 void Execution::ApplyWrites(const Transaction& txn, const SharderPtr& sharder,
                             const std::shared_ptr<Storage>& storage) {
   for (const auto& kv : txn.keys()) {
     const auto& key = kv.key();
     const auto& value = kv.value_entry();
-    if (!sharder->is_local_key(key) || value.type() == KeyType::READ) {
+    if (KeyPartition(sharder, kv) != sharder->local_partition() || value.type() == KeyType::READ) {
+      continue;
+    }
+    if (value.type() == KeyType::ADD) {
+      // Other txns may be adding to the same key concurrently so the addition is done in place.
+      // The txn never reads the stored value so it cannot be aborted based on it. Instead, a stored
+      // value that is not a number is dropped and replaced with the delta, and a sum that overflows
+      // wraps around, which gives the same result on every replica regardless of the order in which
+      // the concurrent additions are applied
+      if (value.delta() != 0) {
+        storage->Update(key, [&key, &value](Record& record) {
+          int64_t counter = 0;
+          if (record.size() != 0 && !ParseCounter(record.value(), counter)) {
+            LOG(WARNING) << "Overwriting non-numeric value of key " << key << " with a counter";
+            counter = 0;
+          }
+          int64_t sum;
+          if (__builtin_add_overflow(counter, value.delta(), &sum)) {
+            LOG(WARNING) << "Counter of key " << key << " overflows";
+          }
+          record.SetMetadata(value.metadata());
+          record.SetValue(std::to_string(sum));
+        });
+      }
       continue;
     }
     Record new_record;
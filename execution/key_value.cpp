@@ -1,3 +1,4 @@
+#include <charconv>
 #include <sstream>
 #include <thread>
 
@@ -49,6 +50,31 @@ void KeyValueExecution::Execute(Transaction& txn) {
         continue;
       }
       dst_value->set_new_value(src_value.value());
+    } else if (args[0] == "INCR" || args[0] == "ADD") {
+      auto it = key_index.find(args[1]);
+      if (it == key_index.end()) {
+        continue;
+      }
+      auto value = txn.mutable_keys(it->second)->mutable_value_entry();
+      if (value->type() != KeyType::ADD) {
+        continue;
+      }
+      int64_t delta = 1;
+      if (args[0] == "ADD") {
+        const auto& amount = args[2];
+        if (std::from_chars(amount.data(), amount.data() + amount.size(), delta).ec != std::errc()) {
+          aborted = true;
+          abort_reason << "Key = " << args[1] << ". Invalid amount to add = " << amount;
+          continue;
+        }
+      }
+      int64_t new_delta;
+      if (__builtin_add_overflow(value->delta(), delta, &new_delta)) {
+        aborted = true;
+        abort_reason << "Key = " << args[1] << ". Amount to add overflows";
+        continue;
+      }
+      value->set_delta(new_delta);
     } else if (args[0] == "EQ") {
       auto it = key_index.find(args[1]);
       if (it == key_index.end()) {
@@ -15,8 +15,9 @@ const std::string* KVStorageAdapter::Read(const std::string& key) {
   if (!ok) {
     return nullptr;
   }
-  buffer_.push_back(r.to_string());
-  return &buffer_.back();
+  // The value is shared with the stored record so it stays at the same address when the buffer grows
+  buffer_.push_back(std::move(r));
+  return &buffer_.back().value();
 };
 
 bool KVStorageAdapter::Insert(const std::string& key, std::string&& value) {
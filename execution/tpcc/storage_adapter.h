@@ -36,7 +36,7 @@ class KVStorageAdapter : public StorageAdapter {
  private:
   std::shared_ptr<Storage> storage_;
   std::shared_ptr<MetadataInitializer> metadata_initializer_;
-  std::vector<std::string> buffer_;
+  std::vector<Record> buffer_;
 };
 
 class TxnStorageAdapter : public StorageAdapter {
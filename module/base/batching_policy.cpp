@@ -0,0 +1,62 @@
+#include "module/base/batching_policy.h"
+
+#include <algorithm>
+
+using std::chrono::duration;
+using std::chrono::microseconds;
+
+namespace slog {
+
+namespace {
+
+// Weight of the latest batch in the moving average of the arrival rate
+const double kArrivalRateWeight = 0.25;
+// The batch delay is multiplied by these factors when the backlog is above or below the target
+const double kDelayIncrease = 1.25;
+const double kDelayDecrease = 0.8;
+
+}  // namespace
+
+BatchingPolicy::BatchingPolicy(const internal::BatchingPolicy& config, const BacklogPtr& backlog)
+    : max_batch_size_(config.max_batch_size()),
+      min_delay_(config.min_delay_us()),
+      max_delay_(config.max_delay_us()),
+      target_backlog_(config.target_backlog()),
+      backlog_(backlog),
+      delay_(max_delay_),
+      arrival_rate_per_us_(0) {}
+
+microseconds BatchingPolicy::OpenBatch() const {
+  if (!is_adaptive()) {
+    return max_delay_;
+  }
+  // Waiting is pointless if no other txn is expected to join the batch in the meantime
+  if (last_close_time_.has_value() && arrival_rate_per_us_ * delay_.count() < 1) {
+    return min_delay_;
+  }
+  return delay_;
+}
+
+void BatchingPolicy::CloseBatch(int batch_size, Clock::time_point now) {
+  if (last_close_time_.has_value()) {
+    auto elapsed_us = duration<double, std::micro>(now - last_close_time_.value()).count();
+    if (elapsed_us > 0) {
+      arrival_rate_per_us_ =
+          kArrivalRateWeight * batch_size / elapsed_us + (1 - kArrivalRateWeight) * arrival_rate_per_us_;
+    }
+  }
+  last_close_time_ = now;
+
+  if (!is_adaptive()) {
+    return;
+  }
+  if (backlog_->total() > target_backlog_) {
+    // The downstream modules are falling behind so fewer but larger batches are sent to them
+    auto increased = microseconds(static_cast<int64_t>(delay_.count() * kDelayIncrease));
+    delay_ = std::min(max_delay_, std::max(increased, delay_ + microseconds(1)));
+  } else {
+    delay_ = std::max(min_delay_, microseconds(static_cast<int64_t>(delay_.count() * kDelayDecrease)));
+  }
+}
+
+}  // namespace slog
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+
+#include "common/backlog.h"
+#include "proto/configuration.pb.h"
+
+namespace slog {
+
+/**
+ * Decides when a batching module closes its current batch. See the BatchingPolicy message in
+ * configuration.proto for how the batch delay is chosen.
+ *
+ * A module calls OpenBatch when the first txn is added to a new batch and closes the batch after
+ * the returned delay or as soon as IsFull returns true, whichever comes first, then calls
+ * CloseBatch with the final size of the batch.
+ */
+class BatchingPolicy {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * If backlog is nullptr, the batch delay is not adjusted even with a target backlog
+   */
+  explicit BatchingPolicy(const internal::BatchingPolicy& config, const BacklogPtr& backlog = nullptr);
+
+  /**
+   * Returns how long a newly opened batch stays open if it does not get full
+   */
+  std::chrono::microseconds OpenBatch() const;
+
+  bool IsFull(int batch_size) const { return max_batch_size_ > 0 && batch_size >= max_batch_size_; }
+
+  /**
+   * Updates the arrival rate and adjusts the batch delay after a batch of the given size is closed
+   */
+  void CloseBatch(int batch_size, Clock::time_point now = Clock::now());
+
+  bool is_adaptive() const { return target_backlog_ > 0 && backlog_ != nullptr; }
+  std::chrono::microseconds delay() const { return delay_; }
+  /* Txns per second, averaged over the recent batches */
+  double arrival_rate() const { return arrival_rate_per_us_ * 1000000; }
+
+ private:
+  int max_batch_size_;
+  std::chrono::microseconds min_delay_;
+  std::chrono::microseconds max_delay_;
+  int64_t target_backlog_;
+  BacklogPtr backlog_;
+
+  std::chrono::microseconds delay_;
+  double arrival_rate_per_us_;
+  std::optional<Clock::time_point> last_close_time_;
+};
+
+}  // namespace slog
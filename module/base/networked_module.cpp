@@ -25,15 +25,18 @@ NetworkedModule::NetworkedModule(const std::shared_ptr<zmq::context_t>& context,
       config_(config),
       channel_(channel),
       port_(std::nullopt),
+      recv_on_arena_(false),
       metrics_manager_(metrics_manager),
       inproc_socket_(*context_, ZMQ_PULL),
-      sender_(config, context),
+      num_custom_notifiers_(0),
+      sender_(config, context, true /* coalescing */),
       poller_(poll_timeout),
       recv_retries_start_(config->recv_retries()),
       recv_retries_(0),
       weights_({1, 1}),
       counters_({0, 0}),
-      current_(0) {
+      current_(0),
+      idle_loops_(0) {
   std::ostringstream os;
   os << "rep = " << config->local_replica() << ", part = " << config->local_partition()
      << ", machine_id = " << config->local_machine_id();
@@ -45,6 +48,8 @@ NetworkedModule::NetworkedModule(const std::shared_ptr<Broker>& broker, ChannelO
                                  optional<std::chrono::milliseconds> poll_timeout)
     : NetworkedModule(broker->context(), broker->config(), chopt.channel, metrics_manager, poll_timeout) {
   broker->AddChannel(channel_, chopt.recv_raw);
+  recv_on_arena_ = chopt.recv_on_arena;
+  backlog_ = broker->backlog();
 }
 
 NetworkedModule::NetworkedModule(const std::shared_ptr<zmq::context_t>& context, const ConfigurationPtr& config,
@@ -61,6 +66,11 @@ void NetworkedModule::AddCustomSocket(zmq::socket_t&& new_socket) {
 
 zmq::socket_t& NetworkedModule::GetCustomSocket(size_t i) { return custom_sockets_.at(i); }
 
+void NetworkedModule::AddCustomNotifier(EventNotifier& notifier, std::function<bool()>&& has_work) {
+  poller_.PushNotifier(notifier, move(has_work));
+  num_custom_notifiers_++;
+}
+
 void NetworkedModule::SetUp() {
   VLOG(1) << "Thread info (" << name() << "): " << debug_info_;
 
@@ -87,24 +97,27 @@ void NetworkedModule::SetUp() {
 }
 
 bool NetworkedModule::Loop() {
-  if (!poller_.NextEvent(recv_retries_ > 0 /* dont_wait */)) {
+  // Do not block while some messages are held back for coalescing
+  if (!poller_.NextEvent(recv_retries_ > 0 || sender_.has_pending_messages() /* dont_wait */)) {
     return false;
   }
 
   bool got_message = false;
   if (current_ == 0) {
-    if (OnEnvelopeReceived(RecvEnvelope(inproc_socket_, true /* dont_wait */))) {
+    // Messages on a raw channel are deserialized here instead of on the broker thread
+    if (OnEnvelopeReceived(RecvEnvelope(inproc_socket_, true /* dont_wait */, recv_on_arena_))) {
       got_message = true;
       recv_retries_ = recv_retries_start_;
     }
 
     if (outproc_socket_.handle() != ZMQ_NULLPTR) {
       if (zmq::message_t msg; outproc_socket_.recv(msg, zmq::recv_flags::dontwait)) {
-        auto env = DeserializeEnvelope(msg);
-        if (OnEnvelopeReceived(move(env))) {
-          got_message = true;
-          recv_retries_ = recv_retries_start_;
-        }
+        ForEachFrame(msg, [this, &got_message](const char* data, size_t size) {
+          if (OnEnvelopeReceived(DeserializeEnvelope(data, size))) {
+            got_message = true;
+            recv_retries_ = recv_retries_start_;
+          }
+        });
       }
     }
   }
@@ -120,32 +133,33 @@ bool NetworkedModule::Loop() {
     recv_retries_--;
   }
 
+  // If there is no custom socket, we don't need to switch to the custom socket weight
+  uint8_t has_custom_sockets = !custom_sockets_.empty() || num_custom_notifiers_ > 0;
+
   if (got_message) {
     counters_[current_]++;
+    idle_loops_ = 0;
+  } else {
+    idle_loops_++;
   }
   if (!got_message || counters_[current_] >= weights_[current_]) {
-    // If there is no custom socket, we don't need to switch to the custom socket weight
-    uint8_t has_custom_sockets = !custom_sockets_.empty();
     current_ = (current_ + 1) & has_custom_sockets;
     counters_[current_] = 0;
   }
 
+  // Send the coalesced messages once both the main socket and the custom sockets run out of
+  // messages or when they have been held back for too long
+  if (sender_.has_pending_messages()) {
+    sender_.Flush(idle_loops_ <= has_custom_sockets /* expired_only */);
+  }
+
   return false;
 }
 
-bool NetworkedModule::OnEnvelopeReceived(EnvelopePtr&& wrapped_env) {
-  if (wrapped_env == nullptr) {
+bool NetworkedModule::OnEnvelopeReceived(EnvelopePtr&& env) {
+  if (env == nullptr) {
     return false;
   }
-  EnvelopePtr env;
-  if (wrapped_env->type_case() == Envelope::TypeCase::kRaw) {
-    env.reset(new Envelope());
-    if (DeserializeProto(*env, wrapped_env->raw().data(), wrapped_env->raw().size())) {
-      env->set_from(wrapped_env->from());
-    }
-  } else {
-    env = move(wrapped_env);
-  }
 
   if (env->has_request()) {
     if (env->request().has_ping()) {
@@ -17,9 +17,13 @@
 namespace slog {
 
 struct ChannelOption {
-  ChannelOption(Channel channel, bool recv_raw = true) : channel(channel), recv_raw(recv_raw) {}
+  ChannelOption(Channel channel, bool recv_raw = true, bool recv_on_arena = false)
+      : channel(channel), recv_raw(recv_raw), recv_on_arena(recv_on_arena) {}
   Channel channel;
+  // Receive messages from the broker in serialized form and deserialize them on the module thread
   bool recv_raw;
+  // Deserialize each raw message on its own arena, which is owned by the resulting envelope
+  bool recv_on_arena;
 };
 
 /**
@@ -51,6 +55,8 @@ class NetworkedModule : public Module {
 
   void AddCustomSocket(zmq::socket_t&& new_socket);
   zmq::socket_t& GetCustomSocket(size_t i);
+  // OnCustomSocket is also called when the notifier is signaled or has_work returns true
+  void AddCustomNotifier(EventNotifier& notifier, std::function<bool()>&& has_work);
   void SetMainVsCustomSocketWeights(std::array<int, 2> weights) { weights_ = weights; }
 
   inline static EnvelopePtr NewEnvelope() { return std::make_unique<internal::Envelope>(); }
@@ -67,21 +73,28 @@ class NetworkedModule : public Module {
 
   Channel channel() const { return channel_; }
   MetricsRepositoryManager& metrics_manager() { return *metrics_manager_; }
+  const CoalescingStats& coalescing_stats() const { return sender_.coalescing_stats(); }
+  const CompressionStats& compression_stats() const { return sender_.compression_stats(); }
+  // nullptr if the module is not created with a broker
+  const BacklogPtr& backlog() const { return backlog_; }
 
  private:
   void SetUp() final;
   bool Loop() final;
 
-  bool OnEnvelopeReceived(EnvelopePtr&& wrapped_env);
+  bool OnEnvelopeReceived(EnvelopePtr&& env);
 
   std::shared_ptr<zmq::context_t> context_;
   ConfigurationPtr config_;
   Channel channel_;
   std::optional<uint32_t> port_;
+  bool recv_on_arena_;
   MetricsRepositoryManagerPtr metrics_manager_;
+  BacklogPtr backlog_;
   zmq::socket_t inproc_socket_;
   zmq::socket_t outproc_socket_;
   std::vector<zmq::socket_t> custom_sockets_;
+  size_t num_custom_notifiers_;
   Sender sender_;
   Poller poller_;
   int recv_retries_start_;
@@ -91,6 +104,8 @@ class NetworkedModule : public Module {
   std::array<int, 2> weights_;
   std::array<int, 2> counters_;
   uint8_t current_;
+  // Number of consecutive loops without any message
+  int idle_loops_;
 
   std::string debug_info_;
 
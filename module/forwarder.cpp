@@ -32,12 +32,15 @@ uint32_t ChooseRandomPartition(const Transaction& txn, std::mt19937& rg) {
 Forwarder::Forwarder(const std::shared_ptr<zmq::context_t>& context, const ConfigurationPtr& config,
                      const shared_ptr<LookupMasterIndex>& lookup_master_index,
                      const std::shared_ptr<MetadataInitializer>& metadata_initializer,
-                     const MetricsRepositoryManagerPtr& metrics_manager, std::chrono::milliseconds poll_timeout)
+                     const MetricsRepositoryManagerPtr& metrics_manager, std::chrono::milliseconds poll_timeout,
+                     const BacklogPtr& backlog)
     : NetworkedModule(context, config, config->forwarder_port(), kForwarderChannel, metrics_manager, poll_timeout),
       sharder_(Sharder::MakeSharder(config)),
       lookup_master_index_(lookup_master_index),
       metadata_initializer_(metadata_initializer),
       batch_size_(0),
+      batch_counter_(0),
+      batching_policy_(config->forwarder_batching(), backlog),
       rg_(std::random_device()()),
       collecting_stats_(false) {
   partitioned_lookup_request_.resize(config->num_partitions());
@@ -64,6 +67,12 @@ void Forwarder::ProcessForwardTxn(EnvelopePtr&& env) {
 
   RECORD(txn->mutable_internal(), TransactionEvent::ENTER_FORWARDER);
 
+  // The partitions cached in the keys are only trusted after the txn leaves the Forwarder since a client
+  // can set them to anything
+  for (auto& kv : *txn->mutable_keys()) {
+    kv.mutable_value_entry()->clear_partition_optional();
+  }
+
   try {
     PopulateInvolvedPartitions(sharder_, *txn);
   } catch (std::invalid_argument& e) {
@@ -75,7 +84,7 @@ void Forwarder::ProcessForwardTxn(EnvelopePtr&& env) {
   for (auto& kv : *txn->mutable_keys()) {
     const auto& key = kv.key();
     auto value = kv.mutable_value_entry();
-    auto partition = sharder_->compute_partition(key);
+    auto partition = KeyPartition(sharder_, kv);
 
     // If this is a local partition, lookup the master info from the local storage
     if (partition == config()->local_partition()) {
@@ -118,13 +127,24 @@ void Forwarder::ProcessForwardTxn(EnvelopePtr&& env) {
 
   // If this is the first txn in the batch, schedule to send the batch at a later time
   if (batch_size_ == 1) {
-    NewTimedCallback(config()->forwarder_batch_duration(), [this]() { SendLookupMasterRequestBatch(); });
+    NewTimedCallback(batching_policy_.OpenBatch(), [this, batch_counter = batch_counter_]() {
+      // The batch has already been sent if it got full before the delay
+      if (batch_counter == batch_counter_) {
+        SendLookupMasterRequestBatch();
+      }
+    });
 
     batch_starting_time_ = std::chrono::steady_clock::now();
   }
+
+  if (batching_policy_.IsFull(batch_size_)) {
+    SendLookupMasterRequestBatch();
+  }
 }
 
 void Forwarder::SendLookupMasterRequestBatch() {
+  batching_policy_.CloseBatch(batch_size_);
+
   if (collecting_stats_) {
     stat_batch_sizes_.push_back(batch_size_);
     stat_batch_durations_ms_.push_back((std::chrono::steady_clock::now() - batch_starting_time_).count() / 1000000.0);
@@ -139,6 +159,7 @@ void Forwarder::SendLookupMasterRequestBatch() {
     }
   }
   batch_size_ = 0;
+  ++batch_counter_;
 }
 
 void Forwarder::ProcessLookUpMasterRequest(EnvelopePtr&& env) {
@@ -264,7 +285,9 @@ void Forwarder::Forward(EnvelopePtr&& env) {
 /**
  * {
  *    forw_batch_size_pctls:        [int],
- *    forw_batch_duration_ms_pctls: [float]
+ *    forw_batch_duration_ms_pctls: [float],
+ *    batching_delay_us:            int,
+ *    arrival_rate:                 float
  * }
  */
 void Forwarder::ProcessStatsRequest(const internal::StatsRequest& stats_request) {
@@ -288,6 +311,9 @@ void Forwarder::ProcessStatsRequest(const internal::StatsRequest& stats_request)
   stats.AddMember(StringRef(FORW_BATCH_DURATION_MS_PCTLS), Percentiles(stat_batch_durations_ms_, alloc), alloc);
   stat_batch_durations_ms_.clear();
 
+  stats.AddMember(StringRef(BATCHING_DELAY_US), batching_policy_.delay().count(), alloc);
+  stats.AddMember(StringRef(ARRIVAL_RATE), batching_policy_.arrival_rate(), alloc);
+
   // Write JSON object to a buffer and send back to the server
   rapidjson::StringBuffer buf;
   rapidjson::Writer<rapidjson::StringBuffer> writer(buf);
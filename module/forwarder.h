@@ -8,6 +8,7 @@
 #include "common/sharder.h"
 #include "common/types.h"
 #include "connection/broker.h"
+#include "module/base/batching_policy.h"
 #include "module/base/networked_module.h"
 #include "proto/transaction.pb.h"
 #include "storage/lookup_master_index.h"
@@ -38,7 +39,7 @@ class Forwarder : public NetworkedModule {
             const std::shared_ptr<LookupMasterIndex>& lookup_master_index,
             const std::shared_ptr<MetadataInitializer>& metadata_initializer,
             const MetricsRepositoryManagerPtr& metrics_manager,
-            std::chrono::milliseconds poll_timeout_ms = kModuleTimeout);
+            std::chrono::milliseconds poll_timeout_ms = kModuleTimeout, const BacklogPtr& backlog = nullptr);
 
   std::string name() const override { return "Forwarder"; }
 
@@ -64,6 +65,8 @@ class Forwarder : public NetworkedModule {
   std::unordered_map<TxnId, EnvelopePtr> pending_transactions_;
   std::vector<internal::Envelope> partitioned_lookup_request_;
   int batch_size_;
+  uint64_t batch_counter_;
+  BatchingPolicy batching_policy_;
 
   std::mt19937 rg_;
 
@@ -54,8 +54,12 @@ void LocalLog::UpdateReadyBatches() {
 
 Interleaver::Interleaver(const shared_ptr<Broker>& broker, const MetricsRepositoryManagerPtr& metrics_manager,
                          std::chrono::milliseconds poll_timeout)
-    : NetworkedModule(broker, kInterleaverChannel, metrics_manager, poll_timeout), rg_(std::random_device()()) {
-  broker->AddChannel(kLocalLogChannel);
+    : NetworkedModule(broker, {kInterleaverChannel, true /* recv_raw */, true /* recv_on_arena */}, metrics_manager,
+                      poll_timeout),
+      num_buffered_txns_(0),
+      rg_(std::random_device()()) {
+  // Batch data is deserialized on an arena here instead of on the heap by the broker
+  broker->AddChannel(kLocalLogChannel, true /* send_raw */);
 
   for (uint32_t p = 0; p < config()->num_partitions(); p++) {
     if (p != config()->local_partition()) {
@@ -86,7 +90,7 @@ void Interleaver::Initialize() {
  */
 bool Interleaver::OnCustomSocket() {
   auto& socket = GetCustomSocket(0);
-  auto env = RecvEnvelope(socket, true /* dont_wait */);
+  auto env = RecvEnvelope(socket, true /* dont_wait */, true /* on_arena */);
   if (env == nullptr) {
     return false;
   }
@@ -132,44 +136,52 @@ void Interleaver::ProcessBatchReplicationAck(EnvelopePtr&& env) {
 void Interleaver::ProcessForwardBatchData(EnvelopePtr&& env) {
   auto local_replica = config()->local_replica();
   auto forward_batch_data = env->mutable_request()->mutable_forward_batch_data();
+  auto batch_data = forward_batch_data->mutable_batch_data();
+  auto home = forward_batch_data->home();
   auto [from_replica, from_partition] = config()->UnpackMachineId(env->from());
-  BatchPtr my_batch;
-  if (from_replica == local_replica) {
-    my_batch = BatchPtr(forward_batch_data->mutable_batch_data()->ReleaseLast());
-  } else {
+  if (from_replica != local_replica) {
     // If this batch comes from a remote replica, distribute the batch partitions to the
     // corresponding local partitions
-    CHECK_EQ(forward_batch_data->batch_data_size(), config()->num_partitions());
-    uint32_t p = config()->num_partitions() - 1;
-    while (!forward_batch_data->mutable_batch_data()->empty()) {
-      auto batch_partition = forward_batch_data->mutable_batch_data()->ReleaseLast();
+    CHECK_EQ(batch_data->size(), config()->num_partitions());
+    Envelope new_env;
+    auto new_forward_batch = new_env.mutable_request()->mutable_forward_batch_data();
+    new_forward_batch->set_home(home);
+    new_forward_batch->set_home_position(forward_batch_data->home_position());
+    for (uint32_t p = 0; p < config()->num_partitions(); p++) {
       if (p == config()->local_partition()) {
-        my_batch = BatchPtr(batch_partition);
-      } else {
-        auto new_env = NewEnvelope();
-        auto new_forward_batch = new_env->mutable_request()->mutable_forward_batch_data();
-        new_forward_batch->set_home(forward_batch_data->home());
-        new_forward_batch->set_home_position(forward_batch_data->home_position());
-        new_forward_batch->mutable_batch_data()->AddAllocated(batch_partition);
-        Send(*new_env, config()->MakeMachineId(local_replica, p), kInterleaverChannel);
+        continue;
       }
-      p--;
+      // The batch partition is only lent to the new envelope since it is serialized right away
+      new_forward_batch->mutable_batch_data()->UnsafeArenaAddAllocated(batch_data->Mutable(p));
+      Send(new_env, config()->MakeMachineId(local_replica, p), kInterleaverChannel);
+      new_forward_batch->mutable_batch_data()->UnsafeArenaReleaseLast();
     }
+    batch_data->SwapElements(config()->local_partition(), batch_data->size() - 1);
   }
 
+  // If the envelope is allocated on an arena, the batch takes over that arena along with the rest of the envelope
+  BatchPtr my_batch(batch_data->UnsafeArenaReleaseLast());
+
   RECORD(my_batch.get(), TransactionEvent::ENTER_INTERLEAVER_IN_BATCH);
 
   VLOG(1) << "Received data for batch " << my_batch->id() << " from [" << env->from()
           << "]. Number of txns: " << my_batch->transactions_size();
 
-  if (forward_batch_data->home() == local_replica) {
+  if (home == local_replica) {
     local_log_.AddBatchId(from_partition /* queue_id */,
                           // Batches generated by the same machine need to follow the order
                           // of creation. This field is used to keep track of that order
                           forward_batch_data->home_position(), my_batch->id());
   }
 
-  single_home_logs_[forward_batch_data->home()].AddBatch(move(my_batch));
+  if (env->GetArena() != nullptr) {
+    env.release();
+  }
+
+  num_buffered_txns_ += my_batch->transactions_size();
+  backlog()->Set(Backlog::INTERLEAVER, num_buffered_txns_);
+
+  single_home_logs_[home].AddBatch(move(my_batch));
 }
 
 void Interleaver::ProcessForwardBatchOrder(EnvelopePtr&& env) {
@@ -265,15 +277,16 @@ void Interleaver::AdvanceLogs() {
 void Interleaver::EmitBatch(BatchPtr&& batch) {
   VLOG(1) << "Processing batch " << batch->id() << " from global log";
 
-  auto transactions = Unbatch(batch.get());
-  for (auto txn : transactions) {
-    RECORD(txn->mutable_internal(), TransactionEvent::EXIT_INTERLEAVER);
+  RECORD(batch.get(), TransactionEvent::EXIT_INTERLEAVER);
 
-    auto env = NewEnvelope();
-    auto forward_txn = env->mutable_request()->mutable_forward_txn();
-    forward_txn->set_allocated_txn(txn);
-    Send(move(env), kSchedulerChannel);
-  }
+  num_buffered_txns_ -= batch->transactions_size();
+  backlog()->Set(Backlog::INTERLEAVER, num_buffered_txns_);
+
+  // The whole batch is handed to the scheduler. The envelope is allocated on the same arena as the batch,
+  // if any, so that the scheduler takes over the arena and frees it once it is done with every txn in the batch
+  EnvelopePtr env(google::protobuf::Arena::CreateMessage<Envelope>(batch->GetArena()));
+  env->mutable_request()->mutable_forward_batch_data()->mutable_batch_data()->UnsafeArenaAddAllocated(batch.release());
+  Send(move(env), kSchedulerChannel);
 }
 
 }  // namespace slog
\ No newline at end of file
@@ -72,6 +72,9 @@ class Interleaver : public NetworkedModule {
   LocalLog local_log_;
   std::vector<MachineId> other_partitions_;
   std::vector<bool> need_ack_from_replica_;
+  // Number of txns in the batches that have been received but not emitted yet. It is reported as the backlog
+  // of this module
+  int64_t num_buffered_txns_;
 
   std::mt19937 rg_;
 };
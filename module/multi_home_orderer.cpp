@@ -19,6 +19,7 @@ MultiHomeOrderer::MultiHomeOrderer(const shared_ptr<Broker>& broker, const Metri
                                    std::chrono::milliseconds poll_timeout)
     : NetworkedModule(broker, kMultiHomeOrdererChannel, metrics_manager, poll_timeout),
       batch_id_counter_(0),
+      batching_policy_(config()->multi_home_orderer_batching(), backlog()),
       collecting_stats_(false) {
   batch_per_rep_.resize(config()->num_replicas());
   NewBatch();
@@ -123,18 +124,28 @@ void MultiHomeOrderer::AddToBatch(Transaction* txn) {
 
   // If this is the first txn in the batch, schedule to send the batch at a later time
   if (batch_size_ == 1) {
-    NewTimedCallback(config()->sequencer_batch_duration(), [this]() {
-      SendBatch();
-      NewBatch();
+    NewTimedCallback(batching_policy_.OpenBatch(), [this, batch_id_counter = batch_id_counter_]() {
+      // The batch has already been sent if it got full before the delay
+      if (batch_id_counter == batch_id_counter_) {
+        SendBatch();
+        NewBatch();
+      }
     });
 
     batch_starting_time_ = std::chrono::steady_clock::now();
   }
+
+  if (batching_policy_.IsFull(batch_size_)) {
+    SendBatch();
+    NewBatch();
+  }
 }
 
 void MultiHomeOrderer::SendBatch() {
   VLOG(3) << "Finished multi-home batch " << batch_id() << " of size " << batch_size_;
 
+  batching_policy_.CloseBatch(batch_size_);
+
   if (collecting_stats_) {
     stat_batch_sizes_.push_back(batch_size_);
     stat_batch_durations_ms_.push_back((std::chrono::steady_clock::now() - batch_starting_time_).count() / 1000000.0);
@@ -158,7 +169,11 @@ void MultiHomeOrderer::SendBatch() {
 /**
  * {
  *    mho_batch_size_pctls:        [int],
- *    mho_batch_duration_ms_pctls: [float]
+ *    mho_batch_duration_ms_pctls: [float],
+ *    batching_delay_us:           int,
+ *    arrival_rate:                float,
+ *    coalescing:                  object (see CoalescingStatsToJson)
+ *    compression:                 object (see CompressionStatsToJson)
  * }
  */
 void MultiHomeOrderer::ProcessStatsRequest(const internal::StatsRequest& stats_request) {
@@ -182,6 +197,12 @@ void MultiHomeOrderer::ProcessStatsRequest(const internal::StatsRequest& stats_r
   stats.AddMember(StringRef(MHO_BATCH_DURATION_MS_PCTLS), Percentiles(stat_batch_durations_ms_, alloc), alloc);
   stat_batch_durations_ms_.clear();
 
+  stats.AddMember(StringRef(BATCHING_DELAY_US), batching_policy_.delay().count(), alloc);
+  stats.AddMember(StringRef(ARRIVAL_RATE), batching_policy_.arrival_rate(), alloc);
+
+  stats.AddMember(StringRef(COALESCING), CoalescingStatsToJson(coalescing_stats(), alloc), alloc);
+  stats.AddMember(StringRef(COMPRESSION), CompressionStatsToJson(compression_stats(), alloc), alloc);
+
   // Write JSON object to a buffer and send back to the server
   rapidjson::StringBuffer buf;
   rapidjson::Writer<rapidjson::StringBuffer> writer(buf);
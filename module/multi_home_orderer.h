@@ -4,6 +4,7 @@
 #include "common/metrics.h"
 #include "connection/broker.h"
 #include "data_structure/batch_log.h"
+#include "module/base/batching_policy.h"
 #include "module/base/networked_module.h"
 
 namespace slog {
@@ -46,6 +47,7 @@ class MultiHomeOrderer : public NetworkedModule {
   std::vector<std::unique_ptr<internal::Batch>> batch_per_rep_;
   BatchId batch_id_counter_;
   int batch_size_;
+  BatchingPolicy batching_policy_;
 
   BatchLog multi_home_batch_log_;
 
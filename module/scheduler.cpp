@@ -18,9 +18,23 @@ using internal::Response;
 
 Scheduler::Scheduler(const shared_ptr<Broker>& broker, const shared_ptr<Storage>& storage,
                      const MetricsRepositoryManagerPtr& metrics_manager, std::chrono::milliseconds poll_timeout)
-    : NetworkedModule(broker, {kSchedulerChannel, false /* recv_raw */}, metrics_manager, poll_timeout) {
-  for (size_t i = 0; i < config()->num_workers(); i++) {
-    workers_.push_back(MakeRunnerFor<Worker>(broker, Worker::MakeChannel(i), storage, metrics_manager, poll_timeout));
+    : NetworkedModule(broker, {kSchedulerChannel, false /* recv_raw */}, metrics_manager, poll_timeout),
+      poll_timeout_(poll_timeout),
+      next_worker_(0),
+      key_affinity_dispatch_(config()->worker_dispatch_policy() == internal::WorkerDispatchPolicy::KEY_AFFINITY) {
+  auto num_workers = config()->num_workers();
+  worker_loads_.resize(num_workers, 0);
+  if (config()->worker_handoff() == internal::WorkerHandoff::LOCK_FREE_QUEUE) {
+    completion_queue_ = make_shared<CompletionQueue>(kWorkerQueueCapacity);
+    worker_overflows_.resize(num_workers);
+  }
+  for (size_t i = 0; i < num_workers; i++) {
+    std::shared_ptr<WorkerQueue> queue;
+    if (completion_queue_ != nullptr) {
+      queue = worker_queues_.emplace_back(make_shared<WorkerQueue>(i, kWorkerQueueCapacity));
+    }
+    workers_.push_back(MakeRunnerFor<Worker>(broker, Worker::MakeChannel(i), storage, metrics_manager, poll_timeout,
+                                             queue, completion_queue_));
   }
 
 #if defined(REMASTER_PROTOCOL_SIMPLE) || defined(REMASTER_PROTOCOL_PER_KEY)
@@ -40,18 +54,43 @@ void Scheduler::Initialize() {
     worker->StartInNewThread(cpu);
   }
 
-  zmq::socket_t worker_socket(*context(), ZMQ_DEALER);
-  worker_socket.set(zmq::sockopt::rcvhwm, 0);
-  worker_socket.set(zmq::sockopt::sndhwm, 0);
-  worker_socket.bind(MakeInProcChannelAddress(kWorkerChannel));
+  size_t num_custom_sockets = 0;
+  if (completion_queue_ != nullptr) {
+    // The scheduler keeps spinning instead of parking while some txns are waiting for room in
+    // the queues of the workers
+    AddCustomNotifier(completion_queue_->notifier, [this] {
+      return !completion_queue_->entries.empty() ||
+             std::any_of(worker_overflows_.begin(), worker_overflows_.end(), [](auto& o) { return !o.empty(); });
+    });
+  } else {
+    // The socket of each worker is the custom socket at the index of that worker
+    for (size_t i = 0; i < workers_.size(); i++) {
+      zmq::socket_t worker_socket(*context(), ZMQ_DEALER);
+      worker_socket.set(zmq::sockopt::rcvhwm, 0);
+      worker_socket.set(zmq::sockopt::sndhwm, 0);
+      worker_socket.bind(Worker::MakeHandoffAddress(i));
+
+      AddCustomSocket(move(worker_socket));
+      num_custom_sockets++;
+    }
+  }
 
-  AddCustomSocket(move(worker_socket));
+#if !defined(LOCK_MANAGER_OLD) && !defined(LOCK_MANAGER_DDR) && !defined(LOCK_MANAGER_CG)
+  if (config()->num_lock_manager_shards() > 1) {
+    lock_manager_socket_ = num_custom_sockets++;
+    AddCustomSocket(lock_manager_.StartShards(context(), config()->num_lock_manager_shards(),
+                                              config()->cpu_pinnings(ModuleId::LOCK_MANAGER_SHARD), poll_timeout_));
+  }
+#endif
 }
 
 void Scheduler::OnInternalRequestReceived(EnvelopePtr&& env) {
   switch (env->request().type_case()) {
     case Request::kForwardTxn:
-      ProcessTransaction(move(env));
+      ProcessTransaction(env->mutable_request()->mutable_forward_txn()->release_txn());
+      break;
+    case Request::kForwardBatchData:
+      ProcessForwardBatchData(move(env));
       break;
     case Request::kStats:
       ProcessStatsRequest(env->request().stats());
@@ -60,74 +99,164 @@ void Scheduler::OnInternalRequestReceived(EnvelopePtr&& env) {
       LOG(ERROR) << "Unexpected request type received: \"" << CASE_NAME(env->request().type_case(), Request) << "\"";
       break;
   }
+  backlog()->Set(Backlog::SCHEDULER, active_txns_.size());
 }
 
-// Handle responses from the workers
+// Handle responses from the workers and the lock threads
 bool Scheduler::OnCustomSocket() {
-  auto& worker_socket = GetCustomSocket(0);
   bool has_msg = false;
   zmq::message_t msg;
-  while (worker_socket.recv(msg, zmq::recv_flags::dontwait)) {
-    has_msg = true;
-    auto txn_id = *msg.data<TxnId>();
-    // Release locks held by this txn then dispatch the txns that become ready thanks to this release.
-    auto unblocked_txns = lock_manager_.ReleaseLocks(txn_id);
-    for (auto unblocked_txn : unblocked_txns) {
-      Dispatch(unblocked_txn, false);
+
+#if !defined(LOCK_MANAGER_OLD) && !defined(LOCK_MANAGER_DDR) && !defined(LOCK_MANAGER_CG)
+  if (lock_manager_socket_.has_value()) {
+    auto& lock_manager_socket = GetCustomSocket(lock_manager_socket_.value());
+    while (lock_manager_socket.recv(msg, zmq::recv_flags::dontwait)) {
+      has_msg = true;
+      for (auto ready_txn : lock_manager_.ProcessShardReply(msg)) {
+        Dispatch(ActiveTxn(ready_txn), false);
+      }
     }
+  }
+#endif
 
-    VLOG(2) << "Released locks of txn " << txn_id;
+  // The lock releases of all finished txns are sent to each lock thread in a single message
+#if !defined(LOCK_MANAGER_OLD) && !defined(LOCK_MANAGER_DDR) && !defined(LOCK_MANAGER_CG)
+  lock_manager_.BeginBatch();
+#endif
+  if (completion_queue_ != nullptr) {
+    for (CompletionQueue::Entry entry; completion_queue_->entries.TryPop(entry);) {
+      has_msg = true;
+      worker_loads_[entry.worker]--;
+      OnTxnFinished(*entry.txn_holder);
+    }
+    has_msg |= FlushWorkerOverflows();
+  } else {
+    for (size_t i = 0; i < workers_.size(); i++) {
+      auto& worker_socket = GetCustomSocket(i);
+      while (worker_socket.recv(msg, zmq::recv_flags::dontwait)) {
+        has_msg = true;
+        worker_loads_[i]--;
+        OnTxnFinished(**msg.data<TxnHolder*>());
+      }
+    }
+  }
+#if !defined(LOCK_MANAGER_OLD) && !defined(LOCK_MANAGER_DDR) && !defined(LOCK_MANAGER_CG)
+  lock_manager_.EndBatch();
+#endif
 
-    auto it = active_txns_.find(txn_id);
-    CHECK(it != active_txns_.end());
-    auto& txn_holder = it->second;
+  if (has_msg) {
+    backlog()->Set(Backlog::SCHEDULER, active_txns_.size());
+  }
+
+  return has_msg;
+}
+
+void Scheduler::OnTxnFinished(TxnHolder& txn_holder) {
+  auto txn_id = txn_holder.txn_id();
+
+  // Release locks held by this txn then dispatch the txns that become ready thanks to this release.
+  auto unblocked_txns = lock_manager_.ReleaseLocks(txn_id);
+  for (auto unblocked_txn : unblocked_txns) {
+    Dispatch(ActiveTxn(unblocked_txn), false);
+  }
+
+  VLOG(2) << "Released locks of txn " << txn_id;
 
 #if defined(REMASTER_PROTOCOL_SIMPLE) || defined(REMASTER_PROTOCOL_PER_KEY)
-    auto remaster_result = txn_holder.remaster_result();
-    // If a remaster transaction, trigger any unblocked txns
-    if (remaster_result.has_value()) {
-      ProcessRemasterResult(remaster_manager_.RemasterOccured(remaster_result->first, remaster_result->second));
-    }
+  auto remaster_result = txn_holder.remaster_result();
+  // If a remaster transaction, trigger any unblocked txns
+  if (remaster_result.has_value()) {
+    ProcessRemasterResult(remaster_manager_.RemasterOccured(remaster_result->first, remaster_result->second));
+  }
 #endif /* defined(REMASTER_PROTOCOL_SIMPLE) || \
           defined(REMASTER_PROTOCOL_PER_KEY) */
 
-    txn_holder.SetDone();
+  txn_holder.SetDone();
 
-    if (txn_holder.is_ready_for_gc()) {
-      active_txns_.erase(it);
-    }
+  if (txn_holder.is_ready_for_gc()) {
+    EraseActiveTxn(txn_holder);
   }
+}
 
-  return has_msg;
+TxnHolder& Scheduler::ActiveTxn(TxnHandle handle) {
+  auto txn_holder = active_txns_.Get(handle);
+  CHECK(txn_holder != nullptr) << "Txn of handle " << handle << " is not active";
+  return *txn_holder;
+}
+
+#if defined(REMASTER_PROTOCOL_SIMPLE) || defined(REMASTER_PROTOCOL_PER_KEY)
+TxnHolder& Scheduler::ActiveTxnById(TxnId txn_id) {
+  auto it = txn_handles_by_id_.find(txn_id);
+  CHECK(it != txn_handles_by_id_.end()) << "Txn " << txn_id << " is not active";
+  return ActiveTxn(it->second);
+}
+#endif
+
+void Scheduler::EraseActiveTxn(TxnHolder& txn_holder) {
+  txn_handles_by_id_.erase(txn_holder.txn_id());
+  active_txns_.Erase(active_txns_.HandleOf(txn_holder));
 }
 
-void Scheduler::ProcessTransaction(EnvelopePtr&& env) {
-  auto txn = env->mutable_request()->mutable_forward_txn()->release_txn();
+/**
+ * The interleaver hands over whole batches. A batch allocated on an arena comes in an envelope on the same
+ * arena. The arena is shared by the holders of the txns in the batch so that it is freed as a unit once
+ * all of them are garbage-collected. The lock requests of all txns in the batch are sent to each lock
+ * thread in a single message (RMA) or added to the conflict graph in a single pass (CG)
+ */
+void Scheduler::ProcessForwardBatchData(EnvelopePtr&& env) {
+  auto forward_batch_data = env->mutable_request()->mutable_forward_batch_data();
+  ArenaPtr arena;
+  if (env->GetArena() != nullptr) {
+    arena.reset(env.release()->GetArena());
+  }
+#if !defined(LOCK_MANAGER_OLD) && !defined(LOCK_MANAGER_DDR)
+  lock_manager_.BeginBatch();
+#endif
+  for (auto& batch : *forward_batch_data->mutable_batch_data()) {
+    for (auto txn : Unbatch(&batch)) {
+      ProcessTransaction(txn, arena);
+    }
+  }
+#if defined(LOCK_MANAGER_CG)
+  for (auto ready_txn : lock_manager_.EndBatch()) {
+    Dispatch(ActiveTxn(ready_txn), true);
+  }
+#elif !defined(LOCK_MANAGER_OLD) && !defined(LOCK_MANAGER_DDR)
+  lock_manager_.EndBatch();
+#endif
+}
+
+void Scheduler::ProcessTransaction(Transaction* txn, const ArenaPtr& arena) {
   auto txn_id = txn->internal().id();
-  auto ins = active_txns_.try_emplace(txn_id, config(), txn);
-  auto holder_it = ins.first;
-  auto& holder = holder_it->second;
 
-  if (ins.second) {
-    RECORD(holder.txn().mutable_internal(), TransactionEvent::ENTER_SCHEDULER);
+  // Every active txn is indexed so that a duplicate of a single-home txn is dropped like a duplicate
+  // lock-only txn
+  auto [index_it, inserted] = txn_handles_by_id_.try_emplace(txn_id);
+  TxnHolder* holder;
+  if (inserted) {
+    index_it->second = active_txns_.Emplace(config(), txn, arena);
+    holder = active_txns_.Get(index_it->second);
+
+    RECORD(holder->txn().mutable_internal(), TransactionEvent::ENTER_SCHEDULER);
 
     VLOG(2) << "Accepted " << ENUM_NAME(txn->internal().type(), TransactionType) << " transaction (" << txn_id << ", "
             << txn->internal().home() << ")";
   } else {
-    if (!holder.AddLockOnlyTxn(txn)) {
+    holder = &ActiveTxn(index_it->second);
+    if (!holder->AddLockOnlyTxn(txn, arena)) {
       LOG(ERROR) << "Already received txn: (" << txn_id << ", " << txn->internal().home() << ")";
       return;
     }
 
-    RECORD(holder.txn().mutable_internal(), TransactionEvent::ENTER_SCHEDULER_LO);
+    RECORD(holder->txn().mutable_internal(), TransactionEvent::ENTER_SCHEDULER_LO);
 
     VLOG(2) << "Added " << ENUM_NAME(txn->internal().type(), TransactionType) << " transaction (" << txn_id << ", "
             << txn->internal().home() << ")";
   }
 
-  if (holder.is_aborting()) {
-    if (holder.is_ready_for_gc()) {
-      active_txns_.erase(holder_it);
+  if (holder->is_aborting()) {
+    if (holder->is_ready_for_gc()) {
+      EraseActiveTxn(*holder);
     }
     return;
   }
@@ -135,7 +264,7 @@ void Scheduler::ProcessTransaction(EnvelopePtr&& env) {
 #if defined(REMASTER_PROTOCOL_SIMPLE) || defined(REMASTER_PROTOCOL_PER_KEY)
   SendToRemasterManager(*txn);
 #else
-  SendToLockManager(*txn);
+  SendToLockManager(*holder, *txn);
 #endif
 }
 
@@ -143,11 +272,11 @@ void Scheduler::ProcessTransaction(EnvelopePtr&& env) {
 void Scheduler::SendToRemasterManager(Transaction& txn) {
   switch (remaster_manager_.VerifyMaster(txn)) {
     case VerifyMasterResult::VALID: {
-      SendToLockManager(txn);
+      SendToLockManager(ActiveTxnById(txn.internal().id()), txn);
       break;
     }
     case VerifyMasterResult::ABORT: {
-      TriggerPreDispatchAbort(txn.internal().id());
+      TriggerPreDispatchAbort(ActiveTxnById(txn.internal().id()));
       break;
     }
     case VerifyMasterResult::WAITING: {
@@ -163,7 +292,7 @@ void Scheduler::SendToRemasterManager(Transaction& txn) {
 
 void Scheduler::ProcessRemasterResult(RemasterOccurredResult result) {
   for (auto unblocked_lo : result.unblocked) {
-    SendToLockManager(*unblocked_lo);
+    SendToLockManager(ActiveTxnById(unblocked_lo->internal().id()), *unblocked_lo);
   }
   // Check for duplicates
   // TODO: remove this set and check
@@ -173,25 +302,25 @@ void Scheduler::ProcessRemasterResult(RemasterOccurredResult result) {
   }
   CHECK_EQ(result.should_abort.size(), aborting_txn_ids.size()) << "Duplicate transactions returned for abort";
   for (auto txn_id : aborting_txn_ids) {
-    TriggerPreDispatchAbort(txn_id);
+    TriggerPreDispatchAbort(ActiveTxnById(txn_id));
   }
 }
 #endif /* defined(REMASTER_PROTOCOL_SIMPLE) || \
           defined(REMASTER_PROTOCOL_PER_KEY) */
 
-void Scheduler::SendToLockManager(Transaction& txn) {
+void Scheduler::SendToLockManager(TxnHolder& txn_holder, Transaction& txn) {
   auto txn_id = txn.internal().id();
 
   VLOG(2) << "Trying to acquires locks of txn " << txn_id;
 
   RECORD(txn.mutable_internal(), TransactionEvent::ENTER_LOCK_MANAGER);
 
-  switch (lock_manager_.AcquireLocks(txn)) {
+  switch (lock_manager_.AcquireLocks(txn, active_txns_.HandleOf(txn_holder))) {
     case AcquireLocksResult::ACQUIRED:
-      Dispatch(txn_id, true);
+      Dispatch(txn_holder, true);
       break;
     case AcquireLocksResult::ABORT:
-      TriggerPreDispatchAbort(txn_id);
+      TriggerPreDispatchAbort(txn_holder);
       break;
     case AcquireLocksResult::WAITING:
       VLOG(2) << "Txn " << txn_id << " cannot be dispatched yet";
@@ -202,10 +331,7 @@ void Scheduler::SendToLockManager(Transaction& txn) {
   }
 }
 
-void Scheduler::Dispatch(TxnId txn_id, bool is_fast) {
-  auto it = active_txns_.find(txn_id);
-  auto& txn_holder = it->second;
-
+void Scheduler::Dispatch(TxnHolder& txn_holder, bool is_fast) {
   if (is_fast) {
     RECORD(txn_holder.txn().mutable_internal(), TransactionEvent::DISPATCHED_FAST);
   } else {
@@ -214,22 +340,87 @@ void Scheduler::Dispatch(TxnId txn_id, bool is_fast) {
 
   txn_holder.IncNumDispatches();
 
-  zmq::message_t msg(sizeof(TxnHolder*));
-  *msg.data<TxnHolder*>() = &txn_holder;
-  GetCustomSocket(0).send(msg, zmq::send_flags::none);
+  auto worker = PickWorker(txn_holder.txn());
+  worker_loads_[worker]++;
+  if (completion_queue_ != nullptr) {
+    // Keep the txns in dispatch order if some txns are already waiting for room in the queue
+    auto& overflow = worker_overflows_[worker];
+    auto& queue = *worker_queues_[worker];
+    if (overflow.empty() && queue.txns.TryPush(&txn_holder)) {
+      queue.notifier.Notify();
+    } else {
+      overflow.push_back(&txn_holder);
+    }
+  } else {
+    zmq::message_t msg(sizeof(TxnHolder*));
+    *msg.data<TxnHolder*>() = &txn_holder;
+    GetCustomSocket(worker).send(msg, zmq::send_flags::none);
+  }
 
-  VLOG(2) << "Dispatched txn " << txn_id;
+  VLOG(2) << "Dispatched txn " << txn_holder.txn_id();
+}
+
+uint32_t Scheduler::PickWorker(const Transaction& txn) {
+  // The other partitions of a multi-partition txn send their remote reads to the worker determined by its id
+  if (txn.internal().involved_partitions_size() > 1) {
+    return Worker::WorkerForTxn(txn.internal().id(), worker_loads_.size());
+  }
+  if (key_affinity_dispatch_ && txn.keys_size() > 0) {
+    // Use the first written key as it is the one whose storage entry gets modified. If the txn
+    // writes nothing, use its first key
+    const std::string* key = &txn.keys(0).key();
+    for (const auto& kv : txn.keys()) {
+      if (kv.value_entry().type() != KeyType::READ) {
+        key = &kv.key();
+        break;
+      }
+    }
+    auto worker = std::hash<std::string>{}(*key) % worker_loads_.size();
+    // Let the other workers take over if this worker falls too far behind
+    if (worker_loads_[worker] < kMaxWorkerLoadForKeyAffinity) {
+      return worker;
+    }
+  }
+  return PickLeastLoadedWorker();
+}
+
+uint32_t Scheduler::PickLeastLoadedWorker() {
+  auto num_workers = worker_loads_.size();
+  auto worker = next_worker_;
+  for (size_t i = 1; i < num_workers; i++) {
+    auto candidate = (next_worker_ + i) % num_workers;
+    if (worker_loads_[candidate] < worker_loads_[worker]) {
+      worker = candidate;
+    }
+  }
+  next_worker_ = (worker + 1) % num_workers;
+  return worker;
+}
+
+bool Scheduler::FlushWorkerOverflows() {
+  bool flushed = false;
+  for (size_t i = 0; i < worker_overflows_.size(); i++) {
+    auto& overflow = worker_overflows_[i];
+    auto& queue = *worker_queues_[i];
+    auto num_overflowed = overflow.size();
+    while (!overflow.empty() && queue.txns.TryPush(overflow.front())) {
+      overflow.pop_front();
+    }
+    if (overflow.size() < num_overflowed) {
+      queue.notifier.Notify();
+      flushed = true;
+    }
+  }
+  return flushed;
 }
 
 // Disable pre-dispatch abort when DDR is used. Removing this method is sufficient to disable the
 // whole mechanism
 #ifdef LOCK_MANAGER_DDR
-void Scheduler::TriggerPreDispatchAbort(TxnId) {}
+void Scheduler::TriggerPreDispatchAbort(TxnHolder&) {}
 #else
-void Scheduler::TriggerPreDispatchAbort(TxnId txn_id) {
-  auto active_txn_it = active_txns_.find(txn_id);
-  CHECK(active_txn_it != active_txns_.end());
-  auto& txn_holder = active_txn_it->second;
+void Scheduler::TriggerPreDispatchAbort(TxnHolder& txn_holder) {
+  auto txn_id = txn_holder.txn_id();
 
   CHECK(!txn_holder.is_aborting()) << "Abort was triggered twice: " << txn_id;
 
@@ -254,12 +445,12 @@ void Scheduler::TriggerPreDispatchAbort(TxnId txn_id) {
   // become ready thanks to this release.
   auto unblocked_txns = lock_manager_.ReleaseLocks(txn_id);
   for (auto unblocked_txn : unblocked_txns) {
-    Dispatch(unblocked_txn, false);
+    Dispatch(ActiveTxn(unblocked_txn), false);
   }
 
   // Let a worker handle notifying other partitions and send back to the server.
   txn.set_status(TransactionStatus::ABORTED);
-  Dispatch(txn_id, false);
+  Dispatch(txn_holder, false);
 }
 #endif /* LOCK_MANAGER_DDR */
 
@@ -277,6 +468,8 @@ void Scheduler::TriggerPreDispatchAbort(TxnId txn_id) {
  *      },
  *      ...
  *    ],
+ *    worker_queue_depths (lock-free handoff only): [<number of txns waiting for each worker>, ...],
+ *    worker_loads: [<number of unfinished txns of each worker>, ...],
  *    ...<stats from lock manager>...
  * }
  */
@@ -292,17 +485,16 @@ void Scheduler::ProcessStatsRequest(const internal::StatsRequest& stats_request)
   // Add stats for current transactions in the system
   stats.AddMember(StringRef(NUM_ALL_TXNS), active_txns_.size(), alloc);
   if (level == 0) {
-    stats.AddMember(StringRef(ALL_TXNS),
-                    ToJsonArray(
-                        active_txns_, [](const auto& p) { return p.first; }, alloc),
-                    alloc);
+    rapidjson::Value txns(rapidjson::kArrayType);
+    active_txns_.ForEach([&txns, &alloc](const TxnHolder& txn_holder) { txns.PushBack(txn_holder.txn_id(), alloc); });
+    stats.AddMember(StringRef(ALL_TXNS), txns, alloc);
   }
 
   if (level >= 1) {
     rapidjson::Value txns(rapidjson::kArrayType);
-    for (const auto& [txn_id, txn_holder] : active_txns_) {
+    active_txns_.ForEach([&txns, &alloc](const TxnHolder& txn_holder) {
       rapidjson::Value txn_obj(rapidjson::kObjectType);
-      txn_obj.AddMember(StringRef(TXN_ID), txn_id, alloc)
+      txn_obj.AddMember(StringRef(TXN_ID), txn_holder.txn_id(), alloc)
           .AddMember(StringRef(TXN_DONE), txn_holder.is_done(), alloc)
           .AddMember(StringRef(TXN_ABORTING), txn_holder.is_aborting(), alloc)
           .AddMember(StringRef(TXN_NUM_LO), txn_holder.num_lock_only_txns(), alloc)
@@ -312,10 +504,20 @@ void Scheduler::ProcessStatsRequest(const internal::StatsRequest& stats_request)
                      txn_holder.txn().internal().type() == TransactionType::MULTI_HOME_OR_LOCK_ONLY, alloc)
           .AddMember(StringRef(TXN_MULTI_PARTITION), txn_holder.txn().internal().involved_partitions_size() > 1, alloc);
       txns.PushBack(txn_obj, alloc);
-    }
+    });
     stats.AddMember(StringRef(ALL_TXNS), txns, alloc);
   }
 
+  // Add stats for the queues of the workers
+  if (completion_queue_ != nullptr) {
+    rapidjson::Value depths(rapidjson::kArrayType);
+    for (size_t i = 0; i < worker_queues_.size(); i++) {
+      depths.PushBack(worker_queues_[i]->txns.size() + worker_overflows_[i].size(), alloc);
+    }
+    stats.AddMember(StringRef(WORKER_QUEUE_DEPTHS), depths, alloc);
+  }
+  stats.AddMember(StringRef(WORKER_LOADS), ToJsonArray(worker_loads_, alloc), alloc);
+
   // Add stats from the lock manager
   lock_manager_.GetStats(stats, level);
 
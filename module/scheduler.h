@@ -2,6 +2,7 @@
 
 #include <glog/logging.h>
 
+#include <deque>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -13,6 +14,7 @@
 #include "connection/broker.h"
 #include "connection/sender.h"
 #include "data_structure/batch_log.h"
+#include "data_structure/slot_table.h"
 #include "module/scheduler_components/worker.h"
 #include "storage/storage.h"
 
@@ -34,6 +36,8 @@
 #include "module/scheduler_components/old_lock_manager.h"
 #elif defined(LOCK_MANAGER_DDR)
 #include "module/scheduler_components/ddr_lock_manager.h"
+#elif defined(LOCK_MANAGER_CG)
+#include "module/scheduler_components/cg_lock_manager.h"
 #else
 #include "module/scheduler_components/rma_lock_manager.h"
 #endif
@@ -53,11 +57,12 @@ class Scheduler : public NetworkedModule {
 
   void OnInternalRequestReceived(EnvelopePtr&& env) final;
 
-  // Handle responses from the workers
+  // Handle responses from the workers and the lock threads
   bool OnCustomSocket() final;
 
  private:
-  void ProcessTransaction(EnvelopePtr&& env);
+  void ProcessForwardBatchData(EnvelopePtr&& env);
+  void ProcessTransaction(Transaction* txn, const ArenaPtr& arena = nullptr);
   void ProcessStatsRequest(const internal::StatsRequest& stats_request);
 
 #if defined(REMASTER_PROTOCOL_SIMPLE) || defined(REMASTER_PROTOCOL_PER_KEY)
@@ -67,11 +72,33 @@ class Scheduler : public NetworkedModule {
   void ProcessRemasterResult(RemasterOccurredResult result);
 #endif
 
-  // Send all transactions for locks
-  void SendToLockManager(Transaction& txn);
+  // Send all transactions for locks. txn is the txn held by txn_holder or one of its lock-only txns
+  void SendToLockManager(TxnHolder& txn_holder, Transaction& txn);
 
   // Send txn to worker
-  void Dispatch(TxnId txn_id, bool is_fast);
+  void Dispatch(TxnHolder& txn_holder, bool is_fast);
+
+  // Precondition: the txn is active
+  TxnHolder& ActiveTxn(TxnHandle handle);
+
+#if defined(REMASTER_PROTOCOL_SIMPLE) || defined(REMASTER_PROTOCOL_PER_KEY)
+  // Precondition: the txn is active
+  TxnHolder& ActiveTxnById(TxnId txn_id);
+#endif
+
+  // Pick a worker for a txn according to the dispatch policy, unless the txn is multi-partition
+  uint32_t PickWorker(const Transaction& txn);
+
+  // Pick the worker with the fewest unfinished txns. Ties are broken in a round-robin manner
+  uint32_t PickLeastLoadedWorker();
+
+  // Move the txns that did not fit in the queues of the workers into the queues
+  bool FlushWorkerOverflows();
+
+  // Release the resources of a txn after a worker finishes it
+  void OnTxnFinished(TxnHolder& txn_holder);
+
+  void EraseActiveTxn(TxnHolder& txn_holder);
 
   /**
    * Aborts
@@ -83,7 +110,7 @@ class Scheduler : public NetworkedModule {
    *
    * Before the transaction data is erased, we wait to collect all lock-onlys of a multi-home txn
    */
-  void TriggerPreDispatchAbort(TxnId txn_id);
+  void TriggerPreDispatchAbort(TxnHolder& txn_holder);
 
   void MaybeCleanUpTxn(TxnId txn_id);
 
@@ -98,11 +125,34 @@ class Scheduler : public NetworkedModule {
   OldLockManager lock_manager_;
 #elif defined(LOCK_MANAGER_DDR)
   DDRLockManager lock_manager_;
+#elif defined(LOCK_MANAGER_CG)
+  CGLockManager lock_manager_;
 #else
   RMALockManager lock_manager_;
 #endif
 
-  std::unordered_map<TxnId, TxnHolder> active_txns_;
+  // The holders never move so the workers are handed pointers to them and hand the same pointers back.
+  // The lock managers are given the handles of the holders and hand them back
+  SlotTable<TxnHolder> active_txns_;
+  // Handles of the active txns, needed when only the id of a txn is known, such as when a lock-only txn
+  // or a duplicate txn arrives
+  std::unordered_map<TxnId, TxnHandle> txn_handles_by_id_;
+
+  std::chrono::milliseconds poll_timeout_;
+
+  // Number of txns dispatched to each worker that are not finished yet
+  std::vector<uint32_t> worker_loads_;
+  uint32_t next_worker_;
+  bool key_affinity_dispatch_;
+
+  // Only used if txns are handed off to the workers via lock-free queues. Otherwise, they are handed
+  // off via one zmq socket per worker
+  std::vector<std::shared_ptr<WorkerQueue>> worker_queues_;
+  std::shared_ptr<CompletionQueue> completion_queue_;
+  // Txns that did not fit in the queue of each worker
+  std::vector<std::deque<TxnHolder*>> worker_overflows_;
+
+  std::optional<size_t> lock_manager_socket_;
 
   // This must be defined at the end so that the workers exit before any resources
   // in the scheduler is destroyed
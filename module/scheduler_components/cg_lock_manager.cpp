@@ -0,0 +1,273 @@
+#include "module/scheduler_components/cg_lock_manager.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+
+using std::move;
+
+namespace slog {
+
+AcquireLocksResult CGLockManager::AcquireLocks(const Transaction& txn, TxnHandle handle) {
+  auto txn_id = txn.internal().id();
+  auto home = txn.internal().home();
+  auto is_remaster = txn.program_case() == Transaction::kRemaster;
+
+  // A remaster txn only has one key K but it accesses (K, RO) and (K, RN)
+  // where RO and RN are the old and new region respectively.
+  auto num_required_locks = is_remaster ? 2 : txn.keys_size();
+  auto& txn_info = txn_info_.try_emplace(txn_id, num_required_locks, handle).first->second;
+
+  int num_relevant_locks = 0;
+  for (const auto& kv : txn.keys()) {
+    // Skip keys that does not belong to the assigned home. Remaster txn is an exception where
+    // it is allowed that the metadata on the txn does not match its assigned home
+    if (!is_remaster && static_cast<int>(kv.value_entry().metadata().master()) != home) {
+      continue;
+    }
+    ++num_relevant_locks;
+
+    auto key_replica_id = MakeKeyReplicaId(key_interner_.Intern(kv.key()), home);
+    pending_accesses_.push_back({key_replica_id, txn_id, &txn_info, kv.value_entry().type()});
+  }
+  txn_info.unarrived_lock_requests -= num_relevant_locks;
+
+  if (!txn_info.is_pending) {
+    txn_info.is_pending = true;
+    pending_txns_.push_back(txn_id);
+  }
+
+  if (in_batch_) {
+    return AcquireLocksResult::WAITING;
+  }
+
+  // Outside of a batch, this txn is the only one that can become ready
+  ProcessPendingAccesses();
+  ready_txns_.clear();
+
+  if (txn_info.is_ready()) {
+    return AcquireLocksResult::ACQUIRED;
+  }
+  return AcquireLocksResult::WAITING;
+}
+
+vector<TxnHandle> CGLockManager::EndBatch() {
+  in_batch_ = false;
+  ProcessPendingAccesses();
+
+  // Skip the txns that finished, e.g. due to an abort, after becoming ready
+  vector<TxnHandle> result;
+  for (auto txn_id : ready_txns_) {
+    if (auto it = txn_info_.find(txn_id); it != txn_info_.end()) {
+      result.push_back(it->second.handle);
+    }
+  }
+  ready_txns_.clear();
+  return result;
+}
+
+void CGLockManager::ProcessPendingAccesses() {
+  if (pending_txns_.empty()) {
+    return;
+  }
+
+  // Group the accesses by key replica. The sort is stable so the accesses to a key stay in log order
+  std::stable_sort(pending_accesses_.begin(), pending_accesses_.end(),
+                   [](const KeyAccess& a, const KeyAccess& b) { return a.key_replica_id < b.key_replica_id; });
+
+  for (size_t i = 0; i < pending_accesses_.size();) {
+    auto key_replica_id = pending_accesses_[i].key_replica_id;
+    auto [tail_it, inserted] = key_tails_.try_emplace(key_replica_id, KeyTail{0, {}, {}, 0});
+    if (inserted) {
+      key_interner_.Ref(GetKeyId(key_replica_id));
+    }
+    auto& tail = tail_it->second;
+
+    for (; i < pending_accesses_.size() && pending_accesses_[i].key_replica_id == key_replica_id; i++) {
+      const auto& access = pending_accesses_[i];
+      auto& txn_info = *access.txn_info;
+      txn_info.keys.push_back(key_replica_id);
+      tail.num_active++;
+
+      switch (access.type) {
+        case KeyType::READ: {
+          if (tail.last_writer != 0) {
+            AddConflict(access.txn_id, txn_info, tail.last_writer);
+          }
+          for (auto adder : tail.adders) {
+            AddConflict(access.txn_id, txn_info, adder);
+          }
+          DropFinished(tail.readers, tail.num_active);
+          tail.readers.push_back(access.txn_id);
+          break;
+        }
+        case KeyType::ADD: {
+          if (tail.last_writer != 0) {
+            AddConflict(access.txn_id, txn_info, tail.last_writer);
+          }
+          for (auto reader : tail.readers) {
+            AddConflict(access.txn_id, txn_info, reader);
+          }
+          DropFinished(tail.adders, tail.num_active);
+          tail.adders.push_back(access.txn_id);
+          break;
+        }
+        case KeyType::WRITE: {
+          // The readers and adders usually depend on the last writer already, but not if one of
+          // them aborted early
+          if (tail.last_writer != 0) {
+            AddConflict(access.txn_id, txn_info, tail.last_writer);
+          }
+          for (auto reader : tail.readers) {
+            AddConflict(access.txn_id, txn_info, reader);
+          }
+          for (auto adder : tail.adders) {
+            AddConflict(access.txn_id, txn_info, adder);
+          }
+          tail.readers.clear();
+          tail.adders.clear();
+          tail.last_writer = access.txn_id;
+          break;
+        }
+        default:
+          LOG(FATAL) << "Invalid lock mode";
+      }
+    }
+  }
+  pending_accesses_.clear();
+
+  for (auto txn_id : pending_txns_) {
+    auto& txn_info = txn_info_.at(txn_id);
+    txn_info.is_pending = false;
+    if (txn_info.is_ready()) {
+      ready_txns_.push_back(txn_id);
+    }
+  }
+  pending_txns_.clear();
+}
+
+void CGLockManager::AddConflict(TxnId txn_id, TxnInfo& txn_info, TxnId blocking_txn_id) {
+  if (blocking_txn_id == txn_id) {
+    VLOG(1) << "Txn " << txn_id << " accesses the same key twice";
+    return;
+  }
+  // The txns in the key tails might already leave the lock manager
+  auto blocking_it = txn_info_.find(blocking_txn_id);
+  if (blocking_it == txn_info_.end()) {
+    return;
+  }
+  // A txn might be added more than once to the waited_by list of another txn, in which case
+  // its num_waiting_for is also incremented more than once
+  txn_info.num_waiting_for++;
+  blocking_it->second.waited_by.push_back(txn_id);
+  num_conflicts_++;
+}
+
+void CGLockManager::DropFinished(vector<TxnId>& txns, uint32_t num_active) const {
+  if (txns.size() > 2 * num_active) {
+    txns.erase(std::remove_if(txns.begin(), txns.end(), [this](TxnId txn_id) { return !IsActive(txn_id); }),
+               txns.end());
+  }
+}
+
+vector<TxnHandle> CGLockManager::ReleaseLocks(TxnId txn_id) {
+  // The graph must be up to date before removing a txn from it
+  ProcessPendingAccesses();
+
+  vector<TxnHandle> result;
+  auto info_it = txn_info_.find(txn_id);
+  if (info_it == txn_info_.end()) {
+    return result;
+  }
+  auto& info = info_it->second;
+
+  for (auto blocked_txn_id : info.waited_by) {
+    auto it = txn_info_.find(blocked_txn_id);
+    if (it == txn_info_.end()) {
+      continue;
+    }
+    auto& blocked_txn = it->second;
+    blocked_txn.num_waiting_for--;
+    // While the waited_by list might contain duplicates, the blocked txn only becomes
+    // ready when its last entry in the list is accounted for
+    if (blocked_txn.is_ready()) {
+      result.push_back(blocked_txn.handle);
+    }
+  }
+
+  for (auto key_replica_id : info.keys) {
+    auto tail_it = key_tails_.find(key_replica_id);
+    DCHECK(tail_it != key_tails_.end());
+    auto& tail = tail_it->second;
+    if (tail.last_writer == txn_id) {
+      tail.last_writer = 0;
+    }
+    if (--tail.num_active == 0) {
+      key_interner_.Unref(GetKeyId(key_replica_id));
+      key_tails_.erase(tail_it);
+    }
+  }
+
+  txn_info_.erase(info_it);
+
+  return result;
+}
+
+/**
+ * {
+ *    lock_manager_type: 2,
+ *    num_txns_waiting_for_lock: <int>,
+ *    lock_table_size: <number of key tails>,
+ *    num_conflicts: <number of conflicts added to the graph so far>,
+ *    waited_by_graph (lvl >= 1): [
+ *      [<txn id>, [<waited by txn id>, ...]],
+ *      ...
+ *    ],
+ *    lock_table (lvl >= 2): [
+ *      [
+ *        <key>,
+ *        <last writer>,
+ *        [<reader>, ...],
+ *        [<adder>, ...],
+ *      ],
+ *      ...
+ *    ],
+ * }
+ */
+void CGLockManager::GetStats(rapidjson::Document& stats, uint32_t level) const {
+  using rapidjson::StringRef;
+
+  auto& alloc = stats.GetAllocator();
+
+  stats.AddMember(StringRef(LOCK_MANAGER_TYPE), 2, alloc);
+
+  stats.AddMember(StringRef(NUM_TXNS_WAITING_FOR_LOCK), txn_info_.size(), alloc);
+  stats.AddMember(StringRef(LOCK_TABLE_SIZE), key_tails_.size(), alloc);
+  stats.AddMember(StringRef(NUM_CONFLICTS), num_conflicts_, alloc);
+  if (level >= 1) {
+    rapidjson::Value waited_by_graph(rapidjson::kArrayType);
+    for (const auto& [txn_id, info] : txn_info_) {
+      rapidjson::Value entry(rapidjson::kArrayType);
+      entry.PushBack(txn_id, alloc).PushBack(ToJsonArray(info.waited_by, alloc), alloc);
+      waited_by_graph.PushBack(entry, alloc);
+    }
+    stats.AddMember(StringRef(WAITED_BY_GRAPH), move(waited_by_graph), alloc);
+  }
+
+  if (level >= 2) {
+    rapidjson::Value lock_table(rapidjson::kArrayType);
+    for (const auto& [key_replica_id, tail] : key_tails_) {
+      rapidjson::Value entry(rapidjson::kArrayType);
+      auto key_replica = MakeKeyReplica(key_interner_.key(GetKeyId(key_replica_id)), GetMaster(key_replica_id));
+      rapidjson::Value key_json(key_replica.c_str(), alloc);
+      entry.PushBack(key_json, alloc)
+          .PushBack(tail.last_writer, alloc)
+          .PushBack(ToJsonArray(tail.readers, alloc), alloc)
+          .PushBack(ToJsonArray(tail.adders, alloc), alloc);
+      lock_table.PushBack(move(entry), alloc);
+    }
+    stats.AddMember(StringRef(LOCK_TABLE), move(lock_table), alloc);
+  }
+}
+
+}  // namespace slog
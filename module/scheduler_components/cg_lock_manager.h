@@ -0,0 +1,152 @@
+#pragma once
+
+// Prevent mixing with other versions
+#ifdef LOCK_MANAGER
+#error "Only one lock manager can be included"
+#endif
+#define LOCK_MANAGER
+
+#include <unordered_map>
+#include <vector>
+
+#include "common/configuration.h"
+#include "common/constants.h"
+#include "common/json_utils.h"
+#include "common/txn_holder.h"
+#include "common/types.h"
+#include "data_structure/key_interner.h"
+
+using std::pair;
+using std::unordered_map;
+using std::vector;
+
+namespace slog {
+
+/**
+ * This is a deterministic scheduler that does not keep any lock queue. Since the
+ * read and write sets of all transactions are known when they are ordered, it
+ * directly builds the graph of conflicts between the transactions in log order:
+ * a read depends on the last write to the same key and on the adds after it, an
+ * add depends on the last write and on the reads after it, and a write depends on
+ * the last write and on all accesses that came after it. A transaction is ready once all
+ * of its lock-only transactions have arrived and all of the transactions it depends
+ * on have finished. If transaction X appears before transaction Y in the log and
+ * they conflict, Y is never ready before X finishes.
+ *
+ * CG stands for Conflict Graph. Like the RMA lock manager, it is remaster-aware:
+ * the conflicts are on the tuples <key, replica>, using the transaction's master
+ * metadata, and a remaster transaction accesses both <key, old replica> and
+ * <key, new replica>.
+ *
+ * Batching:
+ * The key accesses of the transactions added between BeginBatch and EndBatch are
+ * buffered. At EndBatch, they are sorted by key replica so that the conflicts of the
+ * whole batch are derived in a single pass, touching the tail of each key only once
+ * per batch no matter how many transactions of the batch access that key.
+ * Outside of a batch, AcquireLocks behaves like a batch of one transaction.
+ *
+ * Only the tail of the conflict chain of each key is kept: the last writer and the
+ * readers and adders after it. A tail is dropped once every transaction that accessed the key
+ * through it has finished.
+ */
+class CGLockManager {
+ public:
+  /**
+   * Adds a transaction to the conflict graph.
+   *
+   * @param txn    The transaction whose locks are acquired.
+   * @param handle Handle returned for the transaction once it is ready to run.
+   *               All lock-only txns of a transaction must use the same handle.
+   * @return       ACQUIRED if the transaction is ready to run. WAITING if it has to
+   *               wait for other transactions, or if a batch is open, in which case
+   *               the transaction may be returned by EndBatch.
+   */
+  AcquireLocksResult AcquireLocks(const Transaction& txn, TxnHandle handle);
+  AcquireLocksResult AcquireLocks(const Transaction& txn) { return AcquireLocks(txn, txn.internal().id()); }
+
+  /**
+   * Removes a finished transaction from the conflict graph.
+   *
+   * @param txn_id Id of transaction that finished.
+   * @return       A set of handles of transactions that are ready to run thanks
+   *               to this release.
+   */
+  vector<TxnHandle> ReleaseLocks(TxnId txn_id);
+
+  /**
+   * Starts buffering the key accesses of the transactions passed to AcquireLocks.
+   */
+  void BeginBatch() { in_batch_ = true; }
+
+  /**
+   * Adds the buffered key accesses to the conflict graph.
+   *
+   * @return Handles of the transactions of the batch that are ready to run, in the order
+   *         that they were added.
+   */
+  vector<TxnHandle> EndBatch();
+
+  /**
+   * Gets current statistics of the lock manager
+   *
+   * @param stats A JSON object where the statistics are stored into
+   */
+  void GetStats(rapidjson::Document& stats, uint32_t level) const;
+
+ private:
+  struct TxnInfo {
+    TxnInfo(int unarrived, TxnHandle handle)
+        : unarrived_lock_requests(unarrived), num_waiting_for(0), is_pending(false), handle(handle) {}
+    vector<TxnId> waited_by;
+    // Key replicas accessed by this txn, once per access
+    vector<KeyReplicaId> keys;
+    int unarrived_lock_requests;
+    int num_waiting_for;
+    // Whether this txn has buffered accesses
+    bool is_pending;
+    TxnHandle handle;
+
+    bool is_ready() const { return unarrived_lock_requests == 0 && num_waiting_for == 0; }
+  };
+
+  struct KeyAccess {
+    KeyReplicaId key_replica_id;
+    TxnId txn_id;
+    // The txn infos are never moved so the pointer stays valid while the txn is active
+    TxnInfo* txn_info;
+    KeyType type;
+  };
+
+  struct KeyTail {
+    // 0 if the last writer has finished
+    TxnId last_writer;
+    // Readers and adders after the last writer. Some of them might have finished
+    vector<TxnId> readers;
+    vector<TxnId> adders;
+    // Number of accesses to this key by the transactions that have not finished
+    uint32_t num_active;
+  };
+
+  // Adds the buffered key accesses to the conflict graph and appends the transactions
+  // that become ready to ready_txns_
+  void ProcessPendingAccesses();
+  void AddConflict(TxnId txn_id, TxnInfo& txn_info, TxnId blocking_txn_id);
+  // Drops the finished txns from a list of readers or adders once they make up most of the list
+  void DropFinished(vector<TxnId>& txns, uint32_t num_active) const;
+  bool IsActive(TxnId txn_id) const { return txn_info_.count(txn_id) > 0; }
+
+  unordered_map<TxnId, TxnInfo> txn_info_;
+  unordered_map<KeyReplicaId, KeyTail> key_tails_;
+  // Every key tail holds a reference to its key
+  KeyInterner key_interner_;
+
+  bool in_batch_ = false;
+  vector<KeyAccess> pending_accesses_;
+  // Transactions whose accesses are buffered, in the order that they were added
+  vector<TxnId> pending_txns_;
+  vector<TxnId> ready_txns_;
+
+  uint64_t num_conflicts_ = 0;
+};
+
+}  // namespace slog
@@ -7,26 +7,47 @@ using std::move;
 
 namespace slog {
 
-optional<TxnId> LockQueueTail::AcquireReadLock(TxnId txn_id) {
+namespace {
+
+// Number of lock table entries that are swept for every new lock queue tail. Sweeping
+// more than one entry per new tail bounds the number of dead tails by a fraction of
+// the table size
+const size_t kGCStepsPerNewTail = 2;
+
+}  // namespace
+
+void LockQueueTail::AcquireReadLock(TxnId txn_id, vector<TxnId>& deps) {
+  if (write_lock_requester_.has_value()) {
+    deps.push_back(write_lock_requester_.value());
+  }
+  deps.insert(deps.end(), add_lock_requesters_.begin(), add_lock_requesters_.end());
   read_lock_requesters_.push_back(txn_id);
-  return write_lock_requester_;
 }
 
-vector<TxnId> LockQueueTail::AcquireWriteLock(TxnId txn_id) {
-  vector<TxnId> deps;
-  if (read_lock_requesters_.empty()) {
+void LockQueueTail::AcquireAddLock(TxnId txn_id, vector<TxnId>& deps) {
+  if (write_lock_requester_.has_value()) {
+    deps.push_back(write_lock_requester_.value());
+  }
+  deps.insert(deps.end(), read_lock_requesters_.begin(), read_lock_requesters_.end());
+  add_lock_requesters_.push_back(txn_id);
+}
+
+void LockQueueTail::AcquireWriteLock(TxnId txn_id, vector<TxnId>& deps) {
+  if (read_lock_requesters_.empty() && add_lock_requesters_.empty()) {
     if (write_lock_requester_.has_value()) {
       deps.push_back(write_lock_requester_.value());
     }
   } else {
+    // The shared requesters already wait for the last writer
     deps.insert(deps.end(), read_lock_requesters_.begin(), read_lock_requesters_.end());
+    deps.insert(deps.end(), add_lock_requesters_.begin(), add_lock_requesters_.end());
     read_lock_requesters_.clear();
+    add_lock_requesters_.clear();
   }
   write_lock_requester_ = txn_id;
-  return deps;
 }
 
-AcquireLocksResult DDRLockManager::AcquireLocks(const Transaction& txn) {
+AcquireLocksResult DDRLockManager::AcquireLocks(const Transaction& txn, TxnHandle handle) {
   auto txn_id = txn.internal().id();
   auto home = txn.internal().home();
   auto is_remaster = txn.program_case() == Transaction::kRemaster;
@@ -34,7 +55,7 @@ AcquireLocksResult DDRLockManager::AcquireLocks(const Transaction& txn) {
   // A remaster txn only has one key K but it acquires locks on (K, RO) and (K, RN)
   // where RO and RN are the old and new region respectively.
   auto num_required_locks = is_remaster ? 2 : txn.keys_size();
-  auto ins = txn_info_.try_emplace(txn_id, num_required_locks);
+  auto ins = txn_info_.try_emplace(txn_id, num_required_locks, handle);
 
   int num_relevant_locks = 0;
   vector<TxnId> blocking_txns;
@@ -44,22 +65,24 @@ AcquireLocksResult DDRLockManager::AcquireLocks(const Transaction& txn) {
     }
     ++num_relevant_locks;
 
-    auto key_replica = MakeKeyReplica(kv.key(), home);
-    auto& lock_queue_tail = lock_table_[key_replica];
+    auto key_id = key_interner_.Intern(kv.key());
+    auto [lock_table_it, inserted] = lock_table_.try_emplace(MakeKeyReplicaId(key_id, home));
+    if (inserted) {
+      key_interner_.Ref(key_id);
+      gc_budget_ += kGCStepsPerNewTail;
+    }
+    auto& lock_queue_tail = lock_table_it->second;
 
     switch (kv.value_entry().type()) {
-      case KeyType::READ: {
-        auto b_txn = lock_queue_tail.AcquireReadLock(txn_id);
-        if (b_txn.has_value()) {
-          blocking_txns.push_back(b_txn.value());
-        }
+      case KeyType::READ:
+        lock_queue_tail.AcquireReadLock(txn_id, blocking_txns);
         break;
-      }
-      case KeyType::WRITE: {
-        auto b_txns = lock_queue_tail.AcquireWriteLock(txn_id);
-        blocking_txns.insert(blocking_txns.end(), b_txns.begin(), b_txns.end());
+      case KeyType::WRITE:
+        lock_queue_tail.AcquireWriteLock(txn_id, blocking_txns);
+        break;
+      case KeyType::ADD:
+        lock_queue_tail.AcquireAddLock(txn_id, blocking_txns);
         break;
-      }
       default:
         LOG(FATAL) << "Invalid lock mode";
     }
@@ -99,8 +122,8 @@ AcquireLocksResult DDRLockManager::AcquireLocks(const Transaction& txn) {
   return AcquireLocksResult::WAITING;
 }
 
-vector<TxnId> DDRLockManager::ReleaseLocks(TxnId txn_id) {
-  vector<TxnId> result;
+vector<TxnHandle> DDRLockManager::ReleaseLocks(TxnId txn_id) {
+  vector<TxnHandle> result;
   auto txn_info_it = txn_info_.find(txn_id);
   if (txn_info_it == txn_info_.end()) {
     return result;
@@ -121,17 +144,53 @@ vector<TxnId> DDRLockManager::ReleaseLocks(TxnId txn_id) {
       // While the waited_by list might contain duplicates, the blocked
       // txn only becomes ready when its last entry in the waited_by list
       // is accounted for.
-      result.push_back(blocked_txn_id);
+      result.push_back(blocked_txn.handle);
     }
   }
   txn_info_.erase(txn_id);
+
+  CollectGarbage();
+
   return result;
 }
 
+void DDRLockManager::CollectGarbage() {
+  if (lock_table_.empty()) {
+    gc_budget_ = 0;
+    return;
+  }
+
+  // Inserting into the lock table might have rehashed it and invalidated the cursor
+  if (gc_bucket_count_ != lock_table_.bucket_count()) {
+    gc_cursor_ = lock_table_.begin();
+    gc_bucket_count_ = lock_table_.bucket_count();
+  }
+
+  auto is_active = [this](TxnId txn_id) { return txn_info_.count(txn_id) > 0; };
+  // Always sweep at least one entry so that stale requesters are eventually removed
+  // even when no new tail is created
+  auto steps = std::min(std::max(gc_budget_, size_t{1}), lock_table_.size());
+  for (size_t i = 0; i < steps; i++) {
+    if (gc_cursor_ == lock_table_.end()) {
+      gc_cursor_ = lock_table_.begin();
+    }
+    if (gc_cursor_->second.RemoveInactiveRequesters(is_active)) {
+      key_interner_.Unref(GetKeyId(gc_cursor_->first));
+      gc_cursor_ = lock_table_.erase(gc_cursor_);
+      num_reclaimed_tails_++;
+    } else {
+      ++gc_cursor_;
+    }
+  }
+  gc_budget_ = 0;
+}
+
 /**
  * {
  *    lock_manager_type: 1,
  *    num_txns_waiting_for_lock: <int>,
+ *    lock_table_size: <number of lock queue tails>,
+ *    num_reclaimed_lock_queue_tails: <number of lock queue tails garbage-collected so far>,
  *    waited_by_graph (lvl >= 1): [
  *      [<txn id>, [<waited by txn id>, ...]],
  *      ...
@@ -141,6 +200,7 @@ vector<TxnId> DDRLockManager::ReleaseLocks(TxnId txn_id) {
  *        <key>,
  *        <write lock requester>,
  *        [<read lock requester>, ...],
+ *        [<add lock requester>, ...],
  *      ],
  *      ...
  *    ],
@@ -154,6 +214,8 @@ void DDRLockManager::GetStats(rapidjson::Document& stats, uint32_t level) const
   stats.AddMember(StringRef(LOCK_MANAGER_TYPE), 1, alloc);
 
   stats.AddMember(StringRef(NUM_TXNS_WAITING_FOR_LOCK), txn_info_.size(), alloc);
+  stats.AddMember(StringRef(LOCK_TABLE_SIZE), lock_table_.size(), alloc);
+  stats.AddMember(StringRef(NUM_RECLAIMED_LOCK_QUEUE_TAILS), num_reclaimed_tails_, alloc);
   if (level >= 1) {
     rapidjson::Value waited_by_graph(rapidjson::kArrayType);
     for (const auto& [txn_id, info] : txn_info_) {
@@ -167,12 +229,14 @@ void DDRLockManager::GetStats(rapidjson::Document& stats, uint32_t level) const
   if (level >= 2) {
     // Collect data from lock tables
     rapidjson::Value lock_table(rapidjson::kArrayType);
-    for (const auto& [key, lock_state] : lock_table_) {
+    for (const auto& [key_replica_id, lock_state] : lock_table_) {
       rapidjson::Value entry(rapidjson::kArrayType);
-      rapidjson::Value key_json(key.c_str(), alloc);
+      auto key_replica = MakeKeyReplica(key_interner_.key(GetKeyId(key_replica_id)), GetMaster(key_replica_id));
+      rapidjson::Value key_json(key_replica.c_str(), alloc);
       entry.PushBack(key_json, alloc)
           .PushBack(lock_state.write_lock_requester().value_or(0), alloc)
-          .PushBack(ToJsonArray(lock_state.read_lock_requesters(), alloc), alloc);
+          .PushBack(ToJsonArray(lock_state.read_lock_requesters(), alloc), alloc)
+          .PushBack(ToJsonArray(lock_state.add_lock_requesters(), alloc), alloc);
       lock_table.PushBack(move(entry), alloc);
     }
     stats.AddMember(StringRef(LOCK_TABLE), move(lock_table), alloc);
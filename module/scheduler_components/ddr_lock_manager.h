@@ -6,6 +6,7 @@
 #endif
 #define LOCK_MANAGER
 
+#include <algorithm>
 #include <list>
 #include <optional>
 #include <unordered_map>
@@ -17,6 +18,7 @@
 #include "common/json_utils.h"
 #include "common/txn_holder.h"
 #include "common/types.h"
+#include "data_structure/key_interner.h"
 
 using std::list;
 using std::optional;
@@ -36,8 +38,35 @@ namespace slog {
  */
 class LockQueueTail {
  public:
-  optional<TxnId> AcquireReadLock(TxnId txn_id);
-  vector<TxnId> AcquireWriteLock(TxnId txn_id);
+  /**
+   * Each of these methods appends the txns that the requesting txn must wait for to deps.
+   * A read or an add waits for the last write and for the requests of the other shared
+   * mode after it. A write waits for all of them.
+   */
+  void AcquireReadLock(TxnId txn_id, vector<TxnId>& deps);
+  void AcquireAddLock(TxnId txn_id, vector<TxnId>& deps);
+  void AcquireWriteLock(TxnId txn_id, vector<TxnId>& deps);
+
+  /**
+   * Removes the requesters that have left the lock manager.
+   *
+   * @param is_active A predicate telling whether a txn is still in the lock manager.
+   * @return          true if no requester is left, in which case this tail can be
+   *                  discarded without changing the result of future lock requests.
+   */
+  template <typename Pred>
+  bool RemoveInactiveRequesters(Pred&& is_active) {
+    if (write_lock_requester_.has_value() && !is_active(write_lock_requester_.value())) {
+      write_lock_requester_.reset();
+    }
+    auto is_inactive = [&is_active](TxnId txn_id) { return !is_active(txn_id); };
+    read_lock_requesters_.erase(
+        std::remove_if(read_lock_requesters_.begin(), read_lock_requesters_.end(), is_inactive),
+        read_lock_requesters_.end());
+    add_lock_requesters_.erase(std::remove_if(add_lock_requesters_.begin(), add_lock_requesters_.end(), is_inactive),
+                               add_lock_requesters_.end());
+    return !write_lock_requester_.has_value() && read_lock_requesters_.empty() && add_lock_requesters_.empty();
+  }
 
   /* For debugging */
   optional<TxnId> write_lock_requester() const { return write_lock_requester_; }
@@ -45,9 +74,13 @@ class LockQueueTail {
   /* For debugging */
   vector<TxnId> read_lock_requesters() const { return read_lock_requesters_; }
 
+  /* For debugging */
+  vector<TxnId> add_lock_requesters() const { return add_lock_requesters_; }
+
  private:
   optional<TxnId> write_lock_requester_;
   vector<TxnId> read_lock_requesters_;
+  vector<TxnId> add_lock_requesters_;
 };
 
 /**
@@ -67,6 +100,13 @@ class LockQueueTail {
  * transactions hold separate locks for the same key, then one has an
  * incorrect master and will be aborted. Remaster transactions request the
  * locks for both <key, old replica> and <key, new replica>.
+ *
+ * Garbage collection:
+ * Since the lock queue tails are not updated on release, they would accumulate
+ * forever. Instead, every call to ReleaseLocks sweeps a few entries of the lock
+ * table, dropping the requesters that have left and the tails that become empty.
+ * The number of swept entries grows with the number of tails created, so the
+ * sweeping keeps up with the growth of the table at an amortized constant cost.
  */
 class DDRLockManager {
  public:
@@ -75,21 +115,24 @@ class DDRLockManager {
    * all locks are acquired, the transaction is queued up to wait
    * for the current holders to release.
    *
-   * @param txn The transaction whose locks are acquired.
-   * @return    true if all locks are acquired, false if not and
-   *            the transaction is queued up.
+   * @param txn    The transaction whose locks are acquired.
+   * @param handle Handle returned for the transaction once it is unblocked.
+   *               All lock-only txns of a transaction must use the same handle.
+   * @return       true if all locks are acquired, false if not and
+   *               the transaction is queued up.
    */
-  AcquireLocksResult AcquireLocks(const Transaction& txn);
+  AcquireLocksResult AcquireLocks(const Transaction& txn, TxnHandle handle);
+  AcquireLocksResult AcquireLocks(const Transaction& txn) { return AcquireLocks(txn, txn.internal().id()); }
 
   /**
    * Releases all locks that a transaction is holding or waiting for.
    *
    * @param txn_holder Holder of the transaction whose locks are released.
    *            LockOnly txn is not accepted.
-   * @return    A set of IDs of transactions that are able to obtain
+   * @return    A set of handles of transactions that are able to obtain
    *            all of their locks thanks to this release.
    */
-  vector<TxnId> ReleaseLocks(TxnId txn_id);
+  vector<TxnHandle> ReleaseLocks(TxnId txn_id);
 
   /**
    * Gets current statistics of the lock manager
@@ -100,15 +143,28 @@ class DDRLockManager {
 
  private:
   struct TxnInfo {
-    TxnInfo(int unarrived) : unarrived_lock_requests(unarrived), waiting_for_cnt(0) {}
+    TxnInfo(int unarrived, TxnHandle handle) : unarrived_lock_requests(unarrived), waiting_for_cnt(0), handle(handle) {}
     vector<TxnId> waited_by;
     int unarrived_lock_requests;
     int waiting_for_cnt;
+    TxnHandle handle;
 
     bool is_ready() const { return waiting_for_cnt == 0 && unarrived_lock_requests == 0; }
   };
   unordered_map<TxnId, TxnInfo> txn_info_;
-  unordered_map<KeyReplica, LockQueueTail> lock_table_;
+  unordered_map<KeyReplicaId, LockQueueTail> lock_table_;
+  // Every lock queue tail holds a reference to its key
+  KeyInterner key_interner_;
+
+  void CollectGarbage();
+
+  // Position of the garbage collector in the lock table. It is only valid if the
+  // lock table has not been rehashed since the last collection
+  unordered_map<KeyReplicaId, LockQueueTail>::iterator gc_cursor_;
+  size_t gc_bucket_count_ = 0;
+  // Number of lock table entries that the next collection is allowed to sweep
+  size_t gc_budget_ = 0;
+  uint64_t num_reclaimed_tails_ = 0;
 };
 
 }  // namespace slog
\ No newline at end of file
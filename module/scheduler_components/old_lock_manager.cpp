@@ -9,28 +9,19 @@ using std::move;
 
 namespace slog {
 
-bool OldLockState::AcquireReadLock(TxnId txn_id) {
-  switch (mode) {
-    case LockMode::UNLOCKED:
-      holders_.insert(txn_id);
-      mode = LockMode::READ;
-      return true;
-    case LockMode::READ:
-      if (waiters_.empty()) {
-        holders_.insert(txn_id);
-        return true;
-      } else {
-        waiters_.insert(txn_id);
-        waiter_queue_.push_back(make_pair(txn_id, LockMode::READ));
-        return false;
-      }
-    case LockMode::WRITE:
-      waiters_.insert(txn_id);
-      waiter_queue_.push_back(make_pair(txn_id, LockMode::READ));
-      return false;
-    default:
-      return false;
+bool OldLockState::AcquireSharedLock(TxnId txn_id, LockMode shared_mode) {
+  if (mode == LockMode::UNLOCKED) {
+    holders_.insert(txn_id);
+    mode = shared_mode;
+    return true;
+  }
+  if (mode == shared_mode && waiters_.empty()) {
+    holders_.insert(txn_id);
+    return true;
   }
+  waiters_.insert(txn_id);
+  waiter_queue_.push_back(make_pair(txn_id, shared_mode));
+  return false;
 }
 
 bool OldLockState::AcquireWriteLock(TxnId txn_id) {
@@ -41,6 +32,7 @@ bool OldLockState::AcquireWriteLock(TxnId txn_id) {
       return true;
     case LockMode::READ:
     case LockMode::WRITE:
+    case LockMode::ADD:
       waiters_.insert(txn_id);
       waiter_queue_.push_back(make_pair(txn_id, LockMode::WRITE));
       return false;
@@ -80,16 +72,16 @@ unordered_set<TxnId> OldLockState::Release(TxnId txn_id) {
   }
 
   auto front = waiter_queue_.front();
-  if (front.second == LockMode::READ) {
-    // Gives the READ lock to all read transactions at the head of the queue
+  if (front.second == LockMode::READ || front.second == LockMode::ADD) {
+    // Gives the READ (or ADD) lock to all read (or add) transactions at the head of the queue
     do {
       auto txn_id = waiter_queue_.front().first;
       holders_.insert(txn_id);
       waiters_.erase(txn_id);
       waiter_queue_.pop_front();
-    } while (!waiter_queue_.empty() && waiter_queue_.front().second == LockMode::READ);
+    } while (!waiter_queue_.empty() && waiter_queue_.front().second == front.second);
 
-    mode = LockMode::READ;
+    mode = front.second;
 
   } else if (front.second == LockMode::WRITE) {
     // Give the WRITE lock to a single transaction at the head of the queue
@@ -101,10 +93,10 @@ unordered_set<TxnId> OldLockState::Release(TxnId txn_id) {
   return holders_;
 }
 
-AcquireLocksResult OldLockManager::AcquireLocks(const Transaction& txn) {
+AcquireLocksResult OldLockManager::AcquireLocks(const Transaction& txn, TxnHandle handle) {
   auto txn_id = txn.internal().id();
 
-  auto ins = txn_info_.try_emplace(txn_id, txn.keys_size());
+  auto ins = txn_info_.try_emplace(txn_id, txn.keys_size(), handle);
   auto& txn_info = ins.first->second;
 
   for (const auto& kv : txn.keys()) {
@@ -133,6 +125,11 @@ AcquireLocksResult OldLockManager::AcquireLocks(const Transaction& txn) {
           txn_info.num_waiting_for--;
         }
         break;
+      case KeyType::ADD:
+        if (lock_state.AcquireAddLock(txn_id)) {
+          txn_info.num_waiting_for--;
+        }
+        break;
       default:
         LOG(FATAL) << "Invalid lock mode";
         break;
@@ -148,8 +145,8 @@ AcquireLocksResult OldLockManager::AcquireLocks(const Transaction& txn) {
   return AcquireLocksResult::WAITING;
 }
 
-vector<TxnId> OldLockManager::ReleaseLocks(TxnId txn_id) {
-  vector<TxnId> result;
+vector<TxnHandle> OldLockManager::ReleaseLocks(TxnId txn_id) {
+  vector<TxnHandle> result;
   auto info_it = txn_info_.find(txn_id);
   if (info_it == txn_info_.end()) {
     return result;
@@ -178,7 +175,7 @@ vector<TxnId> OldLockManager::ReleaseLocks(TxnId txn_id) {
       DCHECK(it != txn_info_.end());
       it->second.num_waiting_for--;
       if (it->second.is_ready()) {
-        result.push_back(new_txn);
+        result.push_back(it->second.handle);
       }
     }
   }
@@ -32,7 +32,8 @@ namespace slog {
  */
 class OldLockState {
  public:
-  bool AcquireReadLock(TxnId txn_id);
+  bool AcquireReadLock(TxnId txn_id) { return AcquireSharedLock(txn_id, LockMode::READ); }
+  bool AcquireAddLock(TxnId txn_id) { return AcquireSharedLock(txn_id, LockMode::ADD); }
   bool AcquireWriteLock(TxnId txn_id);
   unordered_set<TxnId> Release(TxnId txn_id);
   bool Contains(TxnId txn_id);
@@ -46,6 +47,9 @@ class OldLockState {
   const list<pair<TxnId, LockMode>>& GetWaiters() const { return waiter_queue_; }
 
  private:
+  // A shared lock is held either by readers or by adders
+  bool AcquireSharedLock(TxnId txn_id, LockMode shared_mode);
+
   unordered_set<TxnId> holders_;
   unordered_set<TxnId> waiters_;
   list<pair<TxnId, LockMode>> waiter_queue_;
@@ -63,21 +67,24 @@ class OldLockManager {
    * all locks are acquired, the transaction is queued up to wait
    * for the current holders to release.
    *
-   * @param txn Transaction whose locks are acquired.
-   * @return    true if all locks are acquired, false if not and
-   *            the transaction is queued up.
+   * @param txn    Transaction whose locks are acquired.
+   * @param handle Handle returned for the transaction once it is unblocked.
+   *               All lock-only txns of a transaction must use the same handle.
+   * @return       true if all locks are acquired, false if not and
+   *               the transaction is queued up.
    */
-  AcquireLocksResult AcquireLocks(const Transaction& txn);
+  AcquireLocksResult AcquireLocks(const Transaction& txn, TxnHandle handle);
+  AcquireLocksResult AcquireLocks(const Transaction& txn) { return AcquireLocks(txn, txn.internal().id()); }
 
   /**
    * Releases all locks that a transaction is holding or waiting for.
    *
    * @param txn_id Id of transaction whose locks are released.
    *               LockOnly txn is not accepted.
-   * @return    A set of IDs of transactions that are able to obtain
+   * @return    A set of handles of transactions that are able to obtain
    *            all of their locks thanks to this release.
    */
-  vector<TxnId> ReleaseLocks(TxnId txn_id);
+  vector<TxnHandle> ReleaseLocks(TxnId txn_id);
 
   /**
    * Gets current statistics of the lock manager
@@ -88,11 +95,12 @@ class OldLockManager {
 
  private:
   struct TxnInfo {
-    TxnInfo(int num_keys) : num_waiting_for(num_keys) { keys.reserve(num_keys); }
+    TxnInfo(int num_keys, TxnHandle handle) : num_waiting_for(num_keys), handle(handle) { keys.reserve(num_keys); }
 
     bool is_ready() const { return num_waiting_for == 0; }
 
     int num_waiting_for;
+    TxnHandle handle;
     std::vector<Key> keys;
   };
   unordered_map<TxnId, TxnInfo> txn_info_;
@@ -76,10 +76,10 @@ class RemasterManager {
       }
       // Get current counter from storage
       uint32_t storage_counter = 0;  // default to 0 for a new key
-      Record record;
-      bool found = storage->Read(key, record);
+      Metadata metadata;
+      bool found = storage->ReadMetadata(key, metadata);
       if (found) {
-        storage_counter = record.metadata().counter;
+        storage_counter = metadata.counter;
       }
 
       if (value.metadata().counter() < storage_counter) {
@@ -87,9 +87,9 @@ class RemasterManager {
       } else if (value.metadata().counter() > storage_counter) {
         waiting = true;
       } else {
-        CHECK(value.metadata().master() == record.metadata().master)
+        CHECK(value.metadata().master() == metadata.master)
             << "Masters don't match for same key \"" << key << "\". In txn: " << value.metadata().master()
-            << ". In storage: " << record.metadata().master;
+            << ". In storage: " << metadata.master;
       }
     }
 
@@ -4,103 +4,333 @@
 
 #include <algorithm>
 
-using std::make_pair;
 using std::move;
 
 namespace slog {
 
-bool LockState::AcquireReadLock(TxnId txn_id) {
-  switch (mode) {
-    case LockMode::UNLOCKED:
-      holders_.push_back(txn_id);
-      mode = LockMode::READ;
+bool LockState::Acquire(LockRequest* request) {
+  DCHECK(!Contains(request->txn_id)) << "Txn requested lock twice: " << request->txn_id;
+
+  // The lock is granted right away if it is free or if it is shared in the same mode,
+  // by readers or by adders, and no one is waiting for it
+  request->granted = mode == LockMode::UNLOCKED ||
+                     (mode != LockMode::WRITE && request->mode == mode && num_waiters_ == 0);
+
+  request->lock_state = this;
+  request->prev = tail_;
+  request->next = nullptr;
+  if (tail_ == nullptr) {
+    head_ = request;
+  } else {
+    tail_->next = request;
+  }
+  tail_ = request;
+
+  if (request->granted) {
+    mode = request->mode;
+    num_holders_++;
+  } else {
+    num_waiters_++;
+  }
+  return request->granted;
+}
+
+void LockState::Release(LockRequest* request, vector<TxnId>& new_grantees) {
+  if (request->prev == nullptr) {
+    head_ = request->next;
+  } else {
+    request->prev->next = request->next;
+  }
+  if (request->next == nullptr) {
+    tail_ = request->prev;
+  } else {
+    request->next->prev = request->prev;
+  }
+
+  // If the transaction is only waiting for the lock, no new transaction gets the lock
+  if (!request->granted) {
+    num_waiters_--;
+    return;
+  }
+
+  num_holders_--;
+
+  // If there are still holders for this lock, do nothing
+  if (num_holders_ > 0) {
+    return;
+  }
+
+  // If all holders release the lock but there is no waiter, the current state is
+  // changed to unlocked
+  if (head_ == nullptr) {
+    mode = LockMode::UNLOCKED;
+    return;
+  }
+
+  // Since the holders are always at the front of the queue, the head is now a waiter
+  mode = head_->mode;
+  for (auto it = head_; it != nullptr; it = it->next) {
+    // Gives the READ (or ADD) lock to all read (or add) transactions at the head of the
+    // queue or the WRITE lock to a single transaction at the head of the queue
+    if (it != head_ && (mode == LockMode::WRITE || it->mode != mode)) {
+      break;
+    }
+    it->granted = true;
+    num_holders_++;
+    num_waiters_--;
+    new_grantees.push_back(it->txn_id);
+  }
+}
+
+bool LockState::Contains(TxnId txn_id) const {
+  for (auto it = head_; it != nullptr; it = it->next) {
+    if (it->txn_id == txn_id) {
       return true;
-    case LockMode::READ:
-      if (waiter_queue_.empty()) {
-        holders_.push_back(txn_id);
-        return true;
-      } else {
-        waiter_queue_.push_back(make_pair(txn_id, LockMode::READ));
-        return false;
+    }
+  }
+  return false;
+}
+
+vector<TxnId> LockState::GetHolders() const {
+  vector<TxnId> holders;
+  for (auto it = head_; it != nullptr && it->granted; it = it->next) {
+    holders.push_back(it->txn_id);
+  }
+  return holders;
+}
+
+vector<pair<TxnId, LockMode>> LockState::GetWaiters() const {
+  vector<pair<TxnId, LockMode>> waiters;
+  for (auto it = head_; it != nullptr; it = it->next) {
+    if (!it->granted) {
+      waiters.emplace_back(it->txn_id, it->mode);
+    }
+  }
+  return waiters;
+}
+
+namespace {
+
+const size_t kInitialLockTableCapacity = 1024;
+
+}  // namespace
+
+LockTable::LockTable()
+    : slots_(kInitialLockTableCapacity, Slot{0, nullptr}), num_lock_states_(0), num_locked_keys_(0) {}
+
+LockState* LockTable::GetOrCreateLockState(KeyReplicaId key_replica_id) {
+  auto mask = slots_.size() - 1;
+  for (auto i = HashKeyReplicaId(key_replica_id) & mask;; i = (i + 1) & mask) {
+    auto& slot = slots_[i];
+    if (slot.lock_state == nullptr) {
+      // Keep the load factor below 3/4 so that probe sequences stay short
+      if ((num_lock_states_ + 1) * 4 > slots_.size() * 3) {
+        Grow();
+        return GetOrCreateLockState(key_replica_id);
       }
-    case LockMode::WRITE:
-      waiter_queue_.push_back(make_pair(txn_id, LockMode::READ));
-      return false;
-    default:
-      return false;
+      slot.key_replica_id = key_replica_id;
+      slot.lock_state = lock_state_pool_.New();
+      num_lock_states_++;
+      return slot.lock_state;
+    }
+    if (slot.key_replica_id == key_replica_id) {
+      return slot.lock_state;
+    }
   }
 }
 
-bool LockState::AcquireWriteLock(TxnId txn_id) {
-  switch (mode) {
-    case LockMode::UNLOCKED:
-      holders_.push_back(txn_id);
+void LockTable::Grow() {
+  vector<Slot> old_slots(slots_.size() * 2, Slot{0, nullptr});
+  old_slots.swap(slots_);
+  auto mask = slots_.size() - 1;
+  for (const auto& old_slot : old_slots) {
+    if (old_slot.lock_state == nullptr) {
+      continue;
+    }
+    auto i = HashKeyReplicaId(old_slot.key_replica_id) & mask;
+    while (slots_[i].lock_state != nullptr) {
+      i = (i + 1) & mask;
+    }
+    slots_[i] = old_slot;
+  }
+}
+
+bool LockTable::AcquireLock(TxnId txn_id, KeyReplicaId key_replica_id, KeyType type, LockRequest*& txn_requests) {
+  auto mode = LockMode::UNLOCKED;
+  switch (type) {
+    case KeyType::READ:
+      mode = LockMode::READ;
+      break;
+    case KeyType::WRITE:
       mode = LockMode::WRITE;
-      return true;
-    case LockMode::READ:
-    case LockMode::WRITE:
-      waiter_queue_.push_back(make_pair(txn_id, LockMode::WRITE));
-      return false;
+      break;
+    case KeyType::ADD:
+      mode = LockMode::ADD;
+      break;
     default:
-      return false;
+      LOG(FATAL) << "Invalid lock mode";
   }
-}
 
-bool LockState::Contains(TxnId txn_id) {
-  return std::find(holders_.begin(), holders_.end(), txn_id) != holders_.end() ||
-         std::find_if(waiter_queue_.begin(), waiter_queue_.end(),
-                      [txn_id](auto& pair) { return pair.first == txn_id; }) != waiter_queue_.end();
+  auto lock_state = GetOrCreateLockState(key_replica_id);
+  if (lock_state->mode == LockMode::UNLOCKED) {
+    num_locked_keys_++;
+  }
+
+  auto request = lock_request_pool_.New();
+  request->txn_id = txn_id;
+  request->mode = mode;
+  request->next_of_txn = txn_requests;
+  txn_requests = request;
+
+  return lock_state->Acquire(request);
 }
 
-vector<TxnId> LockState::Release(TxnId txn_id) {
-  // If the transaction is not among the lock holders, find and remove it in
-  // the queue of waiters
-  auto it = std::find(holders_.begin(), holders_.end(), txn_id);
-  if (it == holders_.end()) {
-    waiter_queue_.erase(std::remove_if(waiter_queue_.begin(), waiter_queue_.end(),
-                                       [txn_id](auto& pair) { return pair.first == txn_id; }),
-                        waiter_queue_.end());
-    // No new transaction get the lock
-    return {};
+void LockTable::ReleaseLocks(LockRequest* txn_requests, vector<TxnId>& new_grantees) {
+  while (txn_requests != nullptr) {
+    auto request = txn_requests;
+    txn_requests = request->next_of_txn;
+
+    auto lock_state = request->lock_state;
+    lock_state->Release(request, new_grantees);
+    // Prevent the lock table from growing too big
+    // TODO: automatically delete remastered keys
+    if (lock_state->mode == LockMode::UNLOCKED) {
+      num_locked_keys_--;
+    }
+    lock_request_pool_.Delete(request);
   }
+}
 
-  holders_.erase(it);
+namespace {
 
-  // If there are still holders for this lock, do nothing
-  if (!holders_.empty()) {
-    // No new transaction gets the lock
-    return {};
+std::string MakeShardAddress(uint32_t shard) { return "inproc://lock_manager_shard_" + std::to_string(shard); }
+
+const std::string kShardReplyAddress = "inproc://lock_manager_shard_replies";
+
+template <typename T>
+void SendPointer(zmq::socket_t& socket, T* ptr) {
+  zmq::message_t msg(sizeof(T*));
+  *msg.data<T*>() = ptr;
+  socket.send(msg, zmq::send_flags::none);
+}
+
+}  // namespace
+
+/**
+ * A lock thread owns the lock states of the keys hashed to it. For each processed batch
+ * of requests, it replies to the scheduler with a list containing the ID of a txn once for
+ * every lock granted to that txn.
+ */
+class RMALockManagerShard : public Module {
+ public:
+  RMALockManagerShard(const std::shared_ptr<zmq::context_t>& context, uint32_t shard,
+                      std::chrono::milliseconds poll_timeout)
+      : context_(context),
+        shard_(shard),
+        request_socket_(*context, ZMQ_PULL),
+        reply_socket_(*context, ZMQ_PUSH),
+        poll_timeout_(poll_timeout) {
+    request_socket_.set(zmq::sockopt::rcvhwm, 0);
+    reply_socket_.set(zmq::sockopt::sndhwm, 0);
   }
 
-  // If all holders release the lock but there is no waiter, the current state is
-  // changed to unlocked
-  if (waiter_queue_.empty()) {
-    mode = LockMode::UNLOCKED;
-    // No new transaction get the lock
-    return {};
+  std::string name() const override { return "LockManager-" + std::to_string(shard_); }
+
+  void SetUp() final {
+    request_socket_.bind(MakeShardAddress(shard_));
+    reply_socket_.connect(kShardReplyAddress);
+    poll_items_ = {{static_cast<void*>(request_socket_), 0, ZMQ_POLLIN, 0}};
   }
 
-  auto front = waiter_queue_.front();
-  if (front.second == LockMode::READ) {
-    // Gives the READ lock to all read transactions at the head of the queue
-    do {
-      auto txn_id = waiter_queue_.front().first;
-      holders_.push_back(txn_id);
-      waiter_queue_.pop_front();
-    } while (!waiter_queue_.empty() && waiter_queue_.front().second == LockMode::READ);
+  bool Loop() final {
+    if (!zmq::poll(poll_items_, poll_timeout_)) {
+      return false;
+    }
+
+    auto grants = std::make_unique<vector<TxnId>>();
+    for (zmq::message_t msg; request_socket_.recv(msg, zmq::recv_flags::dontwait);) {
+      std::unique_ptr<vector<LockShardRequest>> requests(*msg.data<vector<LockShardRequest>*>());
+      for (const auto& request : *requests) {
+        auto txn_id = request.txn_id;
+        if (request.acquires.empty()) {
+          auto requests_it = txn_requests_.find(txn_id);
+          if (requests_it == txn_requests_.end()) {
+            continue;
+          }
+          lock_table_.ReleaseLocks(requests_it->second, *grants);
+          txn_requests_.erase(requests_it);
+        } else {
+          auto& txn_requests = txn_requests_[txn_id];
+          for (auto [key_replica_id, type] : request.acquires) {
+            if (lock_table_.AcquireLock(txn_id, key_replica_id, type, txn_requests)) {
+              grants->push_back(txn_id);
+            }
+          }
+        }
+      }
+    }
+
+    num_locked_keys_ = lock_table_.num_locked_keys();
 
-    mode = LockMode::READ;
+    if (!grants->empty()) {
+      SendPointer(reply_socket_, grants.release());
+    }
 
-  } else if (front.second == LockMode::WRITE) {
-    // Give the WRITE lock to a single transaction at the head of the queue
-    holders_.push_back(front.first);
-    waiter_queue_.pop_front();
-    mode = LockMode::WRITE;
+    return false;
   }
-  return holders_;
+
+  uint32_t num_locked_keys() const { return num_locked_keys_; }
+
+ private:
+  std::shared_ptr<zmq::context_t> context_;
+  uint32_t shard_;
+  zmq::socket_t request_socket_;
+  zmq::socket_t reply_socket_;
+  std::chrono::milliseconds poll_timeout_;
+  vector<zmq::pollitem_t> poll_items_;
+
+  unordered_map<TxnId, LockRequest*> txn_requests_;
+  LockTable lock_table_;
+  std::atomic<uint32_t> num_locked_keys_ = 0;
+};
+
+zmq::socket_t RMALockManager::StartShards(const std::shared_ptr<zmq::context_t>& context, uint32_t num_shards,
+                                          const vector<int>& cpus, std::chrono::milliseconds poll_timeout) {
+  CHECK(shards_.empty()) << "Lock manager shards have already been started";
+  CHECK(txn_info_.empty()) << "Lock manager shards must be started before any lock is requested";
+  CHECK_LE(num_shards, 64U) << "Too many lock manager shards";
+
+  zmq::socket_t reply_socket(*context, ZMQ_PULL);
+  reply_socket.set(zmq::sockopt::rcvhwm, 0);
+  reply_socket.bind(kShardReplyAddress);
+
+  for (uint32_t i = 0; i < num_shards; i++) {
+    auto shard = std::make_shared<RMALockManagerShard>(context, i, poll_timeout);
+    shards_.push_back(shard);
+
+    auto& runner = shard_runners_.emplace_back(std::make_unique<ModuleRunner>(shard));
+    std::optional<uint32_t> cpu = {};
+    if (i < cpus.size()) {
+      cpu = cpus[i];
+    }
+    runner->StartInNewThread(cpu);
+
+    auto& socket = shard_sockets_.emplace_back(*context, ZMQ_PUSH);
+    socket.set(zmq::sockopt::sndhwm, 0);
+    socket.connect(MakeShardAddress(i));
+  }
+  pending_shard_requests_.resize(num_shards);
+
+  LOG(INFO) << "Lock table is partitioned across " << num_shards << " lock threads";
+
+  return reply_socket;
 }
 
-AcquireLocksResult RMALockManager::AcquireLocks(const Transaction& txn) {
+AcquireLocksResult RMALockManager::AcquireLocks(const Transaction& txn, TxnHandle handle) {
+  if (!shards_.empty()) {
+    return AcquireShardedLocks(txn, handle);
+  }
+
   auto txn_id = txn.internal().id();
   auto home = txn.internal().home();
   auto is_remaster = txn.program_case() == Transaction::kRemaster;
@@ -108,7 +338,7 @@ AcquireLocksResult RMALockManager::AcquireLocks(const Transaction& txn) {
   // A remaster txn only has one key K but it acquires locks on (K, RO) and (K, RN)
   // where RO and RN are the old and new region respectively.
   auto num_required_locks = is_remaster ? 2 : txn.keys_size();
-  auto ins = txn_info_.try_emplace(txn_id, num_required_locks);
+  auto ins = txn_info_.try_emplace(txn_id, num_required_locks, handle);
   auto& txn_info = ins.first->second;
 
   for (const auto& kv : txn.keys()) {
@@ -118,69 +348,73 @@ AcquireLocksResult RMALockManager::AcquireLocks(const Transaction& txn) {
       continue;
     }
 
-    auto key_replica = MakeKeyReplica(kv.key(), home);
-    txn_info.keys.push_back(key_replica);
+    auto key_replica_id = MakeKeyReplicaId(key_interner_.Intern(kv.key()), home);
+    if (lock_table_.AcquireLock(txn_id, key_replica_id, kv.value_entry().type(), txn_info.requests)) {
+      txn_info.num_waiting_for--;
+    }
+  }
+
+  if (txn_info.is_ready()) {
+    return AcquireLocksResult::ACQUIRED;
+  }
+  return AcquireLocksResult::WAITING;
+}
 
-    auto& lock_state = lock_table_[key_replica];
+AcquireLocksResult RMALockManager::AcquireShardedLocks(const Transaction& txn, TxnHandle handle) {
+  auto txn_id = txn.internal().id();
+  auto home = txn.internal().home();
+  auto is_remaster = txn.program_case() == Transaction::kRemaster;
 
-    DCHECK(!lock_state.Contains(txn_id)) << "Txn requested lock twice: " << txn_id << ", " << key_replica;
+  auto num_required_locks = is_remaster ? 2 : txn.keys_size();
+  auto ins = txn_info_.try_emplace(txn_id, num_required_locks, handle);
+  auto& txn_info = ins.first->second;
 
-    auto before_mode = lock_state.mode;
-    switch (kv.value_entry().type()) {
-      case KeyType::READ:
-        if (lock_state.AcquireReadLock(txn_id)) {
-          txn_info.num_waiting_for--;
-        }
-        break;
-      case KeyType::WRITE:
-        if (lock_state.AcquireWriteLock(txn_id)) {
-          txn_info.num_waiting_for--;
-        }
-        break;
-      default:
-        LOG(FATAL) << "Invalid lock mode";
+  for (const auto& kv : txn.keys()) {
+    if (!is_remaster && static_cast<int>(kv.value_entry().metadata().master()) != home) {
+      continue;
     }
-    if (before_mode == LockMode::UNLOCKED && lock_state.mode != before_mode) {
-      num_locked_keys_++;
+
+    auto key_replica_id = MakeKeyReplicaId(key_interner_.Intern(kv.key()), home);
+    auto shard = HashKeyReplicaId(key_replica_id) % shards_.size();
+    auto& requests = pending_shard_requests_[shard];
+    if (requests.empty() || requests.back().txn_id != txn_id || requests.back().acquires.empty()) {
+      requests.push_back({txn_id, {}});
+      txn_info.shards |= 1ULL << shard;
     }
+    requests.back().acquires.emplace_back(key_replica_id, kv.value_entry().type());
+  }
+
+  if (!in_batch_) {
+    SendShardRequests();
   }
 
+  // Locks are granted asynchronously so the txn can only be ready at this point if
+  // all of its locks have been granted via the replies to its previous lock-only txns
   if (txn_info.is_ready()) {
     return AcquireLocksResult::ACQUIRED;
   }
   return AcquireLocksResult::WAITING;
 }
 
-vector<TxnId> RMALockManager::ReleaseLocks(TxnId txn_id) {
-  vector<TxnId> result;
+vector<TxnHandle> RMALockManager::ReleaseLocks(TxnId txn_id) {
+  if (!shards_.empty()) {
+    return ReleaseShardedLocks(txn_id);
+  }
+
+  vector<TxnHandle> result;
   auto info_it = txn_info_.find(txn_id);
   if (info_it == txn_info_.end()) {
     return result;
   }
   auto& info = info_it->second;
-  for (const auto& key_replica : info.keys) {
-    auto lock_state_it = lock_table_.find(key_replica);
-    if (lock_state_it == lock_table_.end()) {
-      continue;
-    }
-    auto& lock_state = lock_state_it->second;
-    auto old_mode = lock_state.mode;
-    auto new_grantees = lock_state.Release(txn_id);
-    // Prevent the lock table from growing too big
-    // TODO: automatically delete remastered keys
-    if (lock_state.mode == LockMode::UNLOCKED) {
-      if (old_mode != LockMode::UNLOCKED) {
-        num_locked_keys_--;
-      }
-    }
-
-    for (auto new_txn : new_grantees) {
-      auto it = txn_info_.find(new_txn);
-      DCHECK(it != txn_info_.end());
-      it->second.num_waiting_for--;
-      if (it->second.is_ready()) {
-        result.push_back(new_txn);
-      }
+  vector<TxnId> new_grantees;
+  lock_table_.ReleaseLocks(info.requests, new_grantees);
+  for (auto new_txn : new_grantees) {
+    auto it = txn_info_.find(new_txn);
+    DCHECK(it != txn_info_.end());
+    it->second.num_waiting_for--;
+    if (it->second.is_ready()) {
+      result.push_back(it->second.handle);
     }
   }
 
@@ -194,6 +428,62 @@ vector<TxnId> RMALockManager::ReleaseLocks(TxnId txn_id) {
   return result;
 }
 
+vector<TxnHandle> RMALockManager::ReleaseShardedLocks(TxnId txn_id) {
+  auto info_it = txn_info_.find(txn_id);
+  if (info_it == txn_info_.end()) {
+    return {};
+  }
+  auto shards = info_it->second.shards;
+  for (size_t i = 0; shards != 0; i++, shards >>= 1) {
+    if (shards & 1) {
+      pending_shard_requests_[i].push_back({txn_id, {}});
+    }
+  }
+  txn_info_.erase(info_it);
+
+  if (!in_batch_) {
+    SendShardRequests();
+  }
+
+  // The txns that get the released locks are reported later by the lock threads
+  return {};
+}
+
+void RMALockManager::EndBatch() {
+  in_batch_ = false;
+  SendShardRequests();
+}
+
+void RMALockManager::SendShardRequests() {
+  for (size_t i = 0; i < pending_shard_requests_.size(); i++) {
+    auto& requests = pending_shard_requests_[i];
+    if (!requests.empty()) {
+      // Ownership of the requests is passed to the lock thread
+      SendPointer(shard_sockets_[i], new vector<LockShardRequest>(std::move(requests)));
+      requests.clear();
+      num_shard_messages_++;
+    }
+  }
+}
+
+vector<TxnHandle> RMALockManager::ProcessShardReply(const zmq::message_t& msg) {
+  std::unique_ptr<vector<TxnId>> grants(*msg.data<vector<TxnId>*>());
+  vector<TxnHandle> result;
+  for (auto txn_id : *grants) {
+    auto it = txn_info_.find(txn_id);
+    // The txn might have released its locks, e.g. due to an abort, after the lock thread
+    // granted the lock
+    if (it == txn_info_.end()) {
+      continue;
+    }
+    it->second.num_waiting_for--;
+    if (it->second.is_ready()) {
+      result.push_back(it->second.handle);
+    }
+  }
+  return result;
+}
+
 /**
  * {
  *    lock_manager_type: 0,
@@ -203,7 +493,9 @@ vector<TxnId> RMALockManager::ReleaseLocks(TxnId txn_id) {
  *      ...
  *    ],
  *    num_locked_keys: <number of keys locked>,
- *    lock_table (lvl >= 2): [
+ *    num_lock_manager_shards: <number of lock threads>,
+ *    num_lock_shard_messages: <number of messages sent to the lock threads>,
+ *    lock_table (lvl >= 2, not sharded): [
  *      [
  *        <key>,
  *        <mode>,
@@ -229,16 +521,25 @@ void RMALockManager::GetStats(rapidjson::Document& stats, uint32_t level) const
                     alloc);
   }
 
-  stats.AddMember(StringRef(NUM_LOCKED_KEYS), num_locked_keys_, alloc);
-  if (level >= 2) {
+  auto num_locked_keys = lock_table_.num_locked_keys();
+  for (const auto& shard : shards_) {
+    num_locked_keys += shard->num_locked_keys();
+  }
+  stats.AddMember(StringRef(NUM_LOCKED_KEYS), num_locked_keys, alloc);
+  stats.AddMember(StringRef(NUM_LOCK_MANAGER_SHARDS), std::max(shards_.size(), 1UL), alloc);
+  stats.AddMember(StringRef(NUM_LOCK_SHARD_MESSAGES), num_shard_messages_, alloc);
+
+  // The lock states of a sharded lock table are owned by the lock threads so they cannot be read here
+  if (level >= 2 && shards_.empty()) {
     // Collect data from lock tables
     rapidjson::Value lock_table(rapidjson::kArrayType);
-    for (const auto& [key, lock_state] : lock_table_) {
+    lock_table_.ForEachLockState([&](KeyReplicaId key_replica_id, const LockState& lock_state) {
       if (lock_state.mode == LockMode::UNLOCKED) {
-        continue;
+        return;
       }
       rapidjson::Value entry(rapidjson::kArrayType);
-      rapidjson::Value key_json(key.c_str(), alloc);
+      auto key_replica = MakeKeyReplica(key_interner_.key(GetKeyId(key_replica_id)), GetMaster(key_replica_id));
+      rapidjson::Value key_json(key_replica.c_str(), alloc);
       entry.PushBack(key_json, alloc)
           .PushBack(static_cast<uint32_t>(lock_state.mode), alloc)
           .PushBack(ToJsonArray(lock_state.GetHolders(), alloc), alloc)
@@ -246,7 +547,7 @@ void RMALockManager::GetStats(rapidjson::Document& stats, uint32_t level) const
                         lock_state.GetWaiters(), [](const auto& v) { return static_cast<uint32_t>(v); }, alloc),
                     alloc);
       lock_table.PushBack(move(entry), alloc);
-    }
+    });
     stats.AddMember(StringRef(LOCK_TABLE), move(lock_table), alloc);
   }
 }
@@ -6,18 +6,21 @@
 #endif
 #define LOCK_MANAGER
 
-#include <list>
+#include <atomic>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
+#include <zmq.hpp>
 
 #include "common/configuration.h"
 #include "common/constants.h"
 #include "common/json_utils.h"
 #include "common/txn_holder.h"
 #include "common/types.h"
+#include "data_structure/key_interner.h"
+#include "data_structure/object_pool.h"
+#include "module/base/module.h"
 
-using std::list;
 using std::pair;
 using std::shared_ptr;
 using std::unordered_map;
@@ -26,29 +29,138 @@ using std::vector;
 
 namespace slog {
 
+inline uint64_t HashKeyReplicaId(KeyReplicaId key_replica_id) {
+  // Fibonacci hashing with the high bits folded in so that the low bits are well mixed
+  auto h = key_replica_id * 0x9E3779B97F4A7C15ULL;
+  return h ^ (h >> 32);
+}
+
+class LockState;
+
+/**
+ * A lock request of a transaction on a key. The requests on the same key are
+ * linked into a FIFO queue in the lock state of that key. The requests made by
+ * the same transaction are also linked together so that all of them can be
+ * released without looking up the lock table.
+ */
+struct LockRequest {
+  TxnId txn_id;
+  LockMode mode;
+  bool granted;
+  LockState* lock_state;
+  LockRequest* prev;
+  LockRequest* next;
+  LockRequest* next_of_txn;
+};
+
 /**
  * An object of this class represents the locking state of a key.
- * It contains the IDs of transactions that are holding and waiting
- * the lock and the mode of the lock.
+ * It contains a queue of lock requests where the requests of the
+ * transactions holding the lock are always at the front.
  */
 class LockState {
  public:
-  bool AcquireReadLock(TxnId txn_id);
-  bool AcquireWriteLock(TxnId txn_id);
-  vector<TxnId> Release(TxnId txn_id);
-  bool Contains(TxnId txn_id);
+  /**
+   * Appends a request to the queue.
+   *
+   * @return true if the lock is granted immediately.
+   */
+  bool Acquire(LockRequest* request);
+
+  /**
+   * Removes a request from the queue. IDs of transactions that get
+   * the lock thanks to this removal are appended to new_grantees.
+   */
+  void Release(LockRequest* request, vector<TxnId>& new_grantees);
+
+  bool Contains(TxnId txn_id) const;
 
   LockMode mode = LockMode::UNLOCKED;
 
   /* For debugging */
-  const vector<TxnId>& GetHolders() const { return holders_; }
+  vector<TxnId> GetHolders() const;
+
+  /* For debugging */
+  vector<pair<TxnId, LockMode>> GetWaiters() const;
+
+ private:
+  LockRequest* head_ = nullptr;
+  LockRequest* tail_ = nullptr;
+  uint32_t num_holders_ = 0;
+  uint32_t num_waiters_ = 0;
+};
+
+/**
+ * A lock table maps each key replica to its locking state. The lock manager
+ * keeps its whole lock table in one object of this class unless it is sharded,
+ * in which case each lock thread owns the part of the table that has the keys
+ * hashed to it.
+ *
+ * The key replicas are identified by ids made from the interned keys. The table
+ * is an open-addressing hash table on these ids. The lock states and lock requests
+ * are allocated from pools owned by the table.
+ */
+class LockTable {
+ public:
+  LockTable();
+
+  /**
+   * Requests a lock on a key replica for a transaction.
+   *
+   * @param txn_requests Head of the list of lock requests of the transaction. The new
+   *                     request is added to this list.
+   * @return true if the lock is granted immediately, false if the
+   *         transaction is queued up to wait for the lock.
+   */
+  bool AcquireLock(TxnId txn_id, KeyReplicaId key_replica_id, KeyType type, LockRequest*& txn_requests);
+
+  /**
+   * Releases all locks that a transaction is holding or waiting for.
+   *
+   * @param txn_requests Head of the list of lock requests of the transaction.
+   * @param new_grantees IDs of transactions that get a lock thanks to this release
+   *                     are appended to this vector, once per granted lock.
+   */
+  void ReleaseLocks(LockRequest* txn_requests, vector<TxnId>& new_grantees);
+
+  uint32_t num_locked_keys() const { return num_locked_keys_; }
 
   /* For debugging */
-  const list<pair<TxnId, LockMode>>& GetWaiters() const { return waiter_queue_; }
+  template <typename Fn>
+  void ForEachLockState(Fn&& fn) const {
+    for (const auto& slot : slots_) {
+      if (slot.lock_state != nullptr) {
+        fn(slot.key_replica_id, *slot.lock_state);
+      }
+    }
+  }
 
  private:
-  vector<TxnId> holders_;
-  list<pair<TxnId, LockMode>> waiter_queue_;
+  LockState* GetOrCreateLockState(KeyReplicaId key_replica_id);
+  void Grow();
+
+  struct Slot {
+    KeyReplicaId key_replica_id;
+    LockState* lock_state;
+  };
+  vector<Slot> slots_;
+  size_t num_lock_states_;
+  uint32_t num_locked_keys_;
+
+  ObjectPool<LockState> lock_state_pool_;
+  ObjectPool<LockRequest> lock_request_pool_;
+};
+
+class RMALockManagerShard;
+
+/**
+ * Lock requests of a transaction sent from the scheduler thread to a lock thread.
+ * If acquires is empty, this is a request to release all locks of the transaction
+ * in the lock thread.
+ */
+struct LockShardRequest {
+  TxnId txn_id;
+  vector<pair<KeyReplicaId, KeyType>> acquires;
 };
 
 /**
@@ -65,6 +177,15 @@ class LockState {
  * transactions hold separate locks for the same key, then one has an
  * incorrect master and will be aborted. Remaster transactions request the
  * locks for both <key, old replica> and <key, new replica>.
+ *
+ * Sharding:
+ * The lock table can be partitioned across multiple lock threads by the hash
+ * of the key replicas (see StartShards). The lock requests of a transaction are
+ * sent to the lock threads in the same order that AcquireLocks is called, so
+ * the requests on every key are still queued up in log order. In this mode,
+ * the readiness of a transaction is only known after the lock threads reply.
+ * The requests made between BeginBatch and EndBatch are sent to each lock thread
+ * in a single message.
  */
 class RMALockManager {
  public:
@@ -73,20 +194,61 @@ class RMALockManager {
    * all locks are acquired, the transaction is queued up to wait
    * for the current lock holders to release.
    *
-   * @param txn The transaction whose locks are acquired.
-   * @return    true if all locks are acquired, false if not and
-   *            the transaction is queued up.
+   * @param txn    The transaction whose locks are acquired.
+   * @param handle Handle returned for the transaction once it is unblocked.
+   *               All lock-only txns of a transaction must use the same handle.
+   * @return       true if all locks are acquired, false if not and
+   *               the transaction is queued up.
    */
-  AcquireLocksResult AcquireLocks(const Transaction& txn);
+  AcquireLocksResult AcquireLocks(const Transaction& txn, TxnHandle handle);
+  AcquireLocksResult AcquireLocks(const Transaction& txn) { return AcquireLocks(txn, txn.internal().id()); }
 
   /**
    * Releases all locks that a transaction is holding or waiting for.
    *
    * @param txn_id Id of transaction whose locks are released.
-   * @return       A set of IDs of transactions that are able to obtain
+   * @return       A set of handles of transactions that are able to obtain
    *               all of their locks thanks to this release.
    */
-  vector<TxnId> ReleaseLocks(TxnId txn_id);
+  vector<TxnHandle> ReleaseLocks(TxnId txn_id);
+
+  /**
+   * Partitions the lock table across a number of lock threads. After this is called,
+   * AcquireLocks only returns ACQUIRED for transactions that do not need to wait for
+   * any lock thread, and ReleaseLocks always returns an empty set. The transactions
+   * that become ready later are reported via the returned socket.
+   *
+   * This must be called before any lock is requested.
+   *
+   * @param num_shards   Number of lock threads. Must be at most 64.
+   * @param cpus         CPUs to pin the lock threads to.
+   * @param poll_timeout Poll timeout of the lock threads.
+   * @return             A socket that receives replies from the lock threads. Each
+   *                     received message must be passed to ProcessShardReply.
+   */
+  zmq::socket_t StartShards(const std::shared_ptr<zmq::context_t>& context, uint32_t num_shards,
+                            const vector<int>& cpus, std::chrono::milliseconds poll_timeout);
+
+  /**
+   * Processes a reply from a lock thread.
+   *
+   * @param msg A message received from the socket returned by StartShards.
+   * @return    A set of handles of transactions that are able to obtain
+   *            all of their locks thanks to this reply.
+   */
+  vector<TxnHandle> ProcessShardReply(const zmq::message_t& msg);
+
+  /**
+   * Starts buffering the requests to the lock threads, e.g. while the transactions
+   * of a batch are processed, until EndBatch is called. This has no effect if the
+   * lock table is not sharded.
+   */
+  void BeginBatch() { in_batch_ = true; }
+
+  /**
+   * Sends the requests buffered since BeginBatch, one message per lock thread.
+   */
+  void EndBatch();
 
   /**
    * Gets current statistics of the lock manager
@@ -96,17 +258,36 @@ class RMALockManager {
   void GetStats(rapidjson::Document& stats, uint32_t level) const;
 
  private:
+  AcquireLocksResult AcquireShardedLocks(const Transaction& txn, TxnHandle handle);
+  vector<TxnHandle> ReleaseShardedLocks(TxnId txn_id);
+  void SendShardRequests();
+
   struct TxnInfo {
-    TxnInfo(int num_keys) : num_waiting_for(num_keys) { keys.reserve(num_keys); }
+    TxnInfo(int num_keys, TxnHandle handle) : num_waiting_for(num_keys), handle(handle) {}
 
     bool is_ready() const { return num_waiting_for == 0; }
 
     int num_waiting_for;
-    std::vector<Key> keys;
+    TxnHandle handle;
+    // Head of the list of lock requests of this txn
+    LockRequest* requests = nullptr;
+    // Bitmap of the lock threads that were sent a lock request of this txn
+    uint64_t shards = 0;
   };
   unordered_map<TxnId, TxnInfo> txn_info_;
-  unordered_map<KeyReplica, LockState> lock_table_;
-  uint32_t num_locked_keys_ = 0;
+  LockTable lock_table_;
+
+  // The lock states are never removed so the keys are interned forever
+  KeyInterner key_interner_;
+
+  vector<std::shared_ptr<RMALockManagerShard>> shards_;
+  vector<std::unique_ptr<ModuleRunner>> shard_runners_;
+  // Sockets for sending requests to the lock threads
+  vector<zmq::socket_t> shard_sockets_;
+  // Requests to each lock thread that have not been sent yet
+  vector<vector<LockShardRequest>> pending_shard_requests_;
+  bool in_batch_ = false;
+  uint64_t num_shard_messages_ = 0;
 };
 
 }  // namespace slog
\ No newline at end of file
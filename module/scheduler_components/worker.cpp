@@ -14,14 +14,20 @@
 namespace slog {
 
 using std::make_unique;
+using std::shared_ptr;
 
 using internal::Envelope;
 using internal::Request;
 using internal::Response;
 
 Worker::Worker(const std::shared_ptr<Broker>& broker, Channel channel, const shared_ptr<Storage>& storage,
-               const MetricsRepositoryManagerPtr& metrics_manager, std::chrono::milliseconds poll_timeout)
-    : NetworkedModule(broker, channel, metrics_manager, poll_timeout), storage_(storage) {
+               const MetricsRepositoryManagerPtr& metrics_manager, std::chrono::milliseconds poll_timeout,
+               const std::shared_ptr<WorkerQueue>& queue, const std::shared_ptr<CompletionQueue>& completion_queue)
+    : NetworkedModule(broker, channel, metrics_manager, poll_timeout),
+      storage_(storage),
+      queue_(queue),
+      completion_queue_(completion_queue) {
+  CHECK_EQ(queue_ == nullptr, completion_queue_ == nullptr);
   switch (config()->execution_type()) {
     case internal::ExecutionType::KEY_VALUE:
       execution_ = make_unique<KeyValueExecution>(Sharder::MakeSharder(config()), storage);
@@ -36,10 +42,15 @@ Worker::Worker(const std::shared_ptr<Broker>& broker, Channel channel, const sha
 }
 
 void Worker::Initialize() {
+  if (queue_ != nullptr) {
+    AddCustomNotifier(queue_->notifier, [queue = queue_.get()] { return !queue->txns.empty(); });
+    return;
+  }
+
   zmq::socket_t sched_socket(*context(), ZMQ_DEALER);
   sched_socket.set(zmq::sockopt::rcvhwm, 0);
   sched_socket.set(zmq::sockopt::sndhwm, 0);
-  sched_socket.connect(MakeInProcChannelAddress(kWorkerChannel));
+  sched_socket.connect(MakeHandoffAddress(channel() - kMaxChannel));
 
   AddCustomSocket(std::move(sched_socket));
 }
@@ -48,17 +59,25 @@ void Worker::OnInternalRequestReceived(EnvelopePtr&& env) {
   if (env->request().type_case() != Request::kRemoteReadResult) {
     LOG(FATAL) << "Invalid request for worker";
   }
-  auto& read_result = env->request().remote_read_result();
-  auto txn_id = read_result.txn_id();
-  auto state_it = txn_states_.find(txn_id);
-  if (state_it == txn_states_.end()) {
-    VLOG(1) << "Transaction " << txn_id << " does not exist for remote read result";
+  auto txn_id = env->request().remote_read_result().txn_id();
+  auto state_it = remote_read_waiters_.find(txn_id);
+  if (state_it == remote_read_waiters_.end()) {
+    // The other partitions may run the txn before this partition dispatches it to this worker
+    VLOG(2) << "Got remote read result for txn " << txn_id << " before it is dispatched";
+    early_remote_reads_[txn_id].push_back(move(env));
     return;
   }
 
   VLOG(2) << "Got remote read result for txn " << txn_id;
 
-  auto& state = state_it->second;
+  auto& state = *state_it->second;
+
+  ApplyRemoteReadResult(state, *env->mutable_request()->mutable_remote_read_result());
+
+  AdvanceTransaction(state);
+}
+
+void Worker::ApplyRemoteReadResult(TransactionState& state, internal::RemoteReadResult& read_result) {
   auto& txn = state.txn_holder->txn();
 
   if (txn.status() != TransactionStatus::ABORTED) {
@@ -68,9 +87,19 @@ void Worker::OnInternalRequestReceived(EnvelopePtr&& env) {
       txn.set_status(TransactionStatus::ABORTED);
       txn.set_abort_reason(read_result.abort_reason());
     } else {
-      // Apply remote reads.
-      for (const auto& kv : read_result.reads()) {
-        txn.mutable_keys()->Add()->CopyFrom(kv);
+      // Apply remote reads. The keys are tagged with the partition that sent them so that they are
+      // never mistaken for local keys
+      auto num_reads = read_result.keys_size();
+      CHECK(read_result.values_size() == num_reads && read_result.types_size() == num_reads)
+          << "Malformed remote read result of txn " << read_result.txn_id();
+      txn.mutable_keys()->Reserve(txn.keys_size() + num_reads);
+      for (int i = 0; i < num_reads; i++) {
+        auto kv = txn.add_keys();
+        kv->set_key(std::move(*read_result.mutable_keys(i)));
+        auto value = kv->mutable_value_entry();
+        value->set_value(std::move(*read_result.mutable_values(i)));
+        value->set_type(read_result.types(i));
+        value->set_partition(read_result.partition());
       }
     }
   }
@@ -81,55 +110,50 @@ void Worker::OnInternalRequestReceived(EnvelopePtr&& env) {
   if (state.remote_reads_waiting_on == 0) {
     if (state.phase == TransactionState::Phase::WAIT_REMOTE_READ) {
       state.phase = TransactionState::Phase::EXECUTE;
-
-      // Remove the redirection at broker for this txn
-      auto redirect_env = NewEnvelope();
-      redirect_env->mutable_request()->mutable_broker_redirect()->set_tag(txn_id);
-      redirect_env->mutable_request()->mutable_broker_redirect()->set_stop(true);
-      Send(move(redirect_env), Broker::MakeChannel(config()->broker_ports_size() - 1));
-
-      VLOG(3) << "Execute txn " << txn_id << " after receving all remote read results";
+      remote_read_waiters_.erase(txn.internal().id());
+      VLOG(3) << "Execute txn " << txn.internal().id() << " after receving all remote read results";
     } else {
       LOG(FATAL) << "Invalid phase";
     }
   }
-
-  AdvanceTransaction(txn_id);
 }
 
 bool Worker::OnCustomSocket() {
-  auto& sched_socket = GetCustomSocket(0);
-
-  zmq::message_t msg;
-  if (!sched_socket.recv(msg, zmq::recv_flags::dontwait)) {
-    return false;
+  TxnHolder* txn_holder;
+  if (queue_ != nullptr) {
+    if (!queue_->txns.TryPop(txn_holder)) {
+      return false;
+    }
+  } else {
+    zmq::message_t msg;
+    if (!GetCustomSocket(0).recv(msg, zmq::recv_flags::dontwait)) {
+      return false;
+    }
+    txn_holder = *msg.data<TxnHolder*>();
   }
 
-  auto txn_holder = *msg.data<TxnHolder*>();
   auto& txn = txn_holder->txn();
   auto txn_id = txn.internal().id();
 
   RECORD(txn.mutable_internal(), TransactionEvent::ENTER_WORKER);
 
   // Create a state for the new transaction
-  auto [iter, ok] = txn_states_.try_emplace(txn_id, txn_holder);
+  auto state = txn_states_.New(txn_holder);
 
-  DCHECK(ok) << "Transaction " << txn_id << " has already been dispatched to this worker";
-
-  iter->second.phase = TransactionState::Phase::READ_LOCAL_STORAGE;
+  DCHECK(remote_read_waiters_.count(txn_id) == 0)
+      << "Transaction " << txn_id << " has already been dispatched to this worker";
 
   VLOG(3) << "Initialized state for txn " << txn_id;
 
-  AdvanceTransaction(txn_id);
+  AdvanceTransaction(*state);
 
   return true;
 }
 
-void Worker::AdvanceTransaction(TxnId txn_id) {
-  auto& state = TxnState(txn_id);
+void Worker::AdvanceTransaction(TransactionState& state) {
   switch (state.phase) {
     case TransactionState::Phase::READ_LOCAL_STORAGE:
-      ReadLocalStorage(txn_id);
+      ReadLocalStorage(state);
       [[fallthrough]];
     case TransactionState::Phase::WAIT_REMOTE_READ:
       if (state.phase == TransactionState::Phase::WAIT_REMOTE_READ) {
@@ -139,20 +163,20 @@ void Worker::AdvanceTransaction(TxnId txn_id) {
       [[fallthrough]];
     case TransactionState::Phase::EXECUTE:
       if (state.phase == TransactionState::Phase::EXECUTE) {
-        Execute(txn_id);
+        Execute(state);
       }
       [[fallthrough]];
     case TransactionState::Phase::FINISH:
-      Finish(txn_id);
+      Finish(state);
       // Never fallthrough after this point because Finish and PreAbort
       // has already destroyed the state object
       break;
   }
 }
 
-void Worker::ReadLocalStorage(TxnId txn_id) {
-  auto& state = TxnState(txn_id);
+void Worker::ReadLocalStorage(TransactionState& state) {
   auto txn_holder = state.txn_holder;
+  auto txn_id = txn_holder->txn_id();
   auto& txn = txn_holder->txn();
 
   if (txn.status() != TransactionStatus::ABORTED) {
@@ -181,6 +205,15 @@ void Worker::ReadLocalStorage(TxnId txn_id) {
     for (auto& kv : *(txn.mutable_keys())) {
       const auto& key = kv.key();
       auto value = kv.mutable_value_entry();
+      // The value of an ADD key is not read since other txns may be adding to it at the same time
+      if (value->type() == KeyType::ADD) {
+        if (Metadata metadata; storage_->ReadMetadata(key, metadata) && value->metadata().master() != metadata.master) {
+          txn.set_status(TransactionStatus::ABORTED);
+          txn.set_abort_reason("Outdated master");
+          break;
+        }
+        continue;
+      }
       if (Record record; storage_->Read(key, record)) {
         // Check whether the stored master metadata matches with the information
         // stored in the transaction
@@ -189,7 +222,7 @@ void Worker::ReadLocalStorage(TxnId txn_id) {
           txn.set_abort_reason("Outdated master");
           break;
         }
-        value->set_value(record.to_string());
+        value->set_value(record.value());
       } else if (txn.program_case() == Transaction::kRemaster) {
         txn.set_status(TransactionStatus::ABORTED);
         txn.set_abort_reason("Remaster non-existent key " + key);
@@ -198,7 +231,7 @@ void Worker::ReadLocalStorage(TxnId txn_id) {
     }
   }
 
-  NotifyOtherPartitions(txn_id);
+  NotifyOtherPartitions(state);
 
   // Set the number of remote reads that this partition needs to wait for
   state.remote_reads_waiting_on = 0;
@@ -212,19 +245,24 @@ void Worker::ReadLocalStorage(TxnId txn_id) {
     VLOG(3) << "Execute txn " << txn_id << " without remote reads";
     state.phase = TransactionState::Phase::EXECUTE;
   } else {
-    // Establish a redirection at broker for this txn so that we can receive remote reads
-    auto redirect_env = NewEnvelope();
-    redirect_env->mutable_request()->mutable_broker_redirect()->set_tag(txn_id);
-    redirect_env->mutable_request()->mutable_broker_redirect()->set_channel(channel());
-    Send(move(redirect_env), Broker::MakeChannel(config()->broker_ports_size() - 1));
-
     VLOG(3) << "Defer executing txn " << txn_id << " until having enough remote reads";
     state.phase = TransactionState::Phase::WAIT_REMOTE_READ;
+
+    // Apply the remote reads that arrived before the txn
+    if (auto early_it = early_remote_reads_.find(txn_id); early_it != early_remote_reads_.end()) {
+      for (auto& env : early_it->second) {
+        ApplyRemoteReadResult(state, *env->mutable_request()->mutable_remote_read_result());
+      }
+      early_remote_reads_.erase(early_it);
+    }
+    if (state.phase == TransactionState::Phase::WAIT_REMOTE_READ) {
+      remote_read_waiters_.emplace(txn_id, &state);
+    }
   }
 }
 
-void Worker::Execute(TxnId txn_id) {
-  auto& state = TxnState(txn_id);
+void Worker::Execute(TransactionState& state) {
+  auto txn_id = state.txn_holder->txn_id();
   auto& txn = state.txn_holder->txn();
 
   switch (txn.program_case()) {
@@ -259,9 +297,13 @@ void Worker::Execute(TxnId txn_id) {
   state.phase = TransactionState::Phase::FINISH;
 }
 
-void Worker::Finish(TxnId txn_id) {
-  auto& state = TxnState(txn_id);
-  auto txn = state.txn_holder->Release();
+void Worker::Finish(TransactionState& state) {
+  auto txn_holder = state.txn_holder;
+  auto txn_id = txn_holder->txn_id();
+  auto txn = txn_holder->Release();
+
+  // Done with this txn. Recycle its state
+  txn_states_.Delete(&state);
 
   RECORD(txn->mutable_internal(), TransactionEvent::EXIT_WORKER);
 
@@ -279,26 +321,33 @@ void Worker::Finish(TxnId txn_id) {
     Envelope env;
     auto completed_sub_txn = env.mutable_request()->mutable_completed_subtxn();
     completed_sub_txn->set_partition(config()->local_partition());
-    completed_sub_txn->set_allocated_txn(txn);
-    Send(env, txn->internal().coordinating_server(), kServerChannel);
-  } else {
-    delete txn;
+    // The txn may be allocated on an arena so it is only lent to the envelope to avoid a copy
+    completed_sub_txn->unsafe_arena_set_allocated_txn(txn.get());
+    Send(env, coordinator, kServerChannel);
+    completed_sub_txn->unsafe_arena_release_txn();
   }
+  // The arena of the txn may be freed as soon as the scheduler is notified
+  txn.reset();
 
   // Notify the scheduler that we're done
-  zmq::message_t msg(sizeof(TxnId));
-  *msg.data<TxnId>() = txn_id;
-  GetCustomSocket(0).send(msg, zmq::send_flags::none);
-
-  // Done with this txn. Remove it from the state map
-  txn_states_.erase(txn_id);
+  if (completion_queue_ != nullptr) {
+    // The scheduler never waits for the workers so it will eventually make room in the queue
+    while (!completion_queue_->entries.TryPush({txn_holder, queue_->worker})) {
+      std::this_thread::yield();
+    }
+    completion_queue_->notifier.Notify();
+  } else {
+    zmq::message_t msg(sizeof(TxnHolder*));
+    *msg.data<TxnHolder*>() = txn_holder;
+    GetCustomSocket(0).send(msg, zmq::send_flags::none);
+  }
 
   VLOG(3) << "Finished with txn " << txn_id;
 }
 
-void Worker::NotifyOtherPartitions(TxnId txn_id) {
-  auto& state = TxnState(txn_id);
+void Worker::NotifyOtherPartitions(TransactionState& state) {
   auto txn_holder = state.txn_holder;
+  auto txn_id = txn_holder->txn_id();
   auto& txn = txn_holder->txn();
 
   if (txn.internal().active_partitions().empty()) {
@@ -317,9 +366,17 @@ void Worker::NotifyOtherPartitions(TxnId txn_id) {
   rrr->set_will_abort(aborted);
   rrr->set_abort_reason(txn.abort_reason());
   if (!aborted) {
-    auto reads_to_be_sent = rrr->mutable_reads();
+    // Only the keys and values are needed to execute the txn. The values of ADD keys are never read.
+    // The values of WRITE keys are still sent even though the active partitions only need the keys that
+    // they read, because procedures like COPY and EQ read a WRITE key before it is overwritten
     for (const auto& kv : txn.keys()) {
-      reads_to_be_sent->Add()->CopyFrom(kv);
+      const auto& value = kv.value_entry();
+      if (value.type() == KeyType::ADD) {
+        continue;
+      }
+      rrr->add_keys(kv.key());
+      rrr->add_values(value.value());
+      rrr->add_types(value.type());
     }
   }
 
@@ -329,13 +386,7 @@ void Worker::NotifyOtherPartitions(TxnId txn_id) {
       destinations.push_back(config()->MakeMachineId(local_replica, p));
     }
   }
-  Send(env, destinations, txn_id);
-}
-
-TransactionState& Worker::TxnState(TxnId txn_id) {
-  auto state_it = txn_states_.find(txn_id);
-  DCHECK(state_it != txn_states_.end());
-  return state_it->second;
+  Send(env, destinations, MakeChannel(WorkerForTxn(txn_id, config()->num_workers())));
 }
 
 }  // namespace slog
\ No newline at end of file
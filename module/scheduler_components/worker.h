@@ -4,12 +4,17 @@
 #include <optional>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 #include <zmq.hpp>
 
 #include "common/configuration.h"
 #include "common/metrics.h"
 #include "common/txn_holder.h"
 #include "common/types.h"
+#include "connection/event_notifier.h"
+#include "connection/zmq_utils.h"
+#include "data_structure/object_pool.h"
+#include "data_structure/ring_buffer.h"
 #include "execution/execution.h"
 #include "module/base/networked_module.h"
 #include "proto/internal.pb.h"
@@ -28,20 +33,69 @@ struct TransactionState {
   Phase phase;
 };
 
+/**
+ * Queue of txns dispatched from the scheduler to a worker
+ */
+struct WorkerQueue {
+  WorkerQueue(uint32_t worker, size_t capacity) : worker(worker), txns(capacity) {}
+
+  const uint32_t worker;
+  SPSCRing<TxnHolder*> txns;
+  EventNotifier notifier;
+};
+
+/**
+ * Queue of txns finished by the workers, going back to the scheduler
+ */
+struct CompletionQueue {
+  struct Entry {
+    // The holder that was dispatched. The worker no longer accesses it
+    TxnHolder* txn_holder;
+    uint32_t worker;
+  };
+
+  CompletionQueue(size_t capacity) : entries(capacity) {}
+
+  MPSCRing<Entry> entries;
+  EventNotifier notifier;
+};
+
 /**
  * A worker executes and commits transactions. Every time it receives from
  * the scheduler a message pertaining to a transaction X, it will either
  * initializes the state for X if X is a new transaction or try to advance
  * X to the subsequent phases as much as possible.
+ *
+ * The txns are received from and returned to the scheduler either via the given
+ * lock-free queues or, if the queues are null, via a zmq socket. In both cases,
+ * the scheduler hands off a pointer to the holder of a txn and the worker hands
+ * the same pointer back when it is done with the txn.
+ *
+ * A multi-partition txn is run by the same worker at every partition, which is
+ * determined by its id, so that the partitions send their remote reads directly
+ * to the channel of that worker.
  */
 class Worker : public NetworkedModule {
  public:
   Worker(const std::shared_ptr<Broker>& broker, Channel channel, const std::shared_ptr<Storage>& storage,
          const MetricsRepositoryManagerPtr& metrics_manager,
-         std::chrono::milliseconds poll_timeout_ms = kModuleTimeout);
+         std::chrono::milliseconds poll_timeout_ms = kModuleTimeout,
+         const std::shared_ptr<WorkerQueue>& queue = nullptr,
+         const std::shared_ptr<CompletionQueue>& completion_queue = nullptr);
 
   static Channel MakeChannel(int worker_num) { return kMaxChannel + worker_num; }
 
+  // Address of the socket through which the scheduler hands off txns to a worker when zmq sockets are used
+  static std::string MakeHandoffAddress(int worker_num) {
+    return MakeInProcChannelAddress(kWorkerChannel) + "_" + std::to_string(worker_num);
+  }
+
+  // The worker that runs a multi-partition txn. A txn id is made of a counter and the id of the
+  // machine that issues the txn, so both parts are mixed in to spread the txns of a machine over the workers
+  static uint32_t WorkerForTxn(TxnId txn_id, uint32_t num_workers) {
+    return (txn_id / kMaxNumMachines + txn_id % kMaxNumMachines) % num_workers;
+  }
+
   std::string name() const override { return "Worker-" + std::to_string(channel()); }
 
  protected:
@@ -61,33 +115,41 @@ class Worker : public NetworkedModule {
   /**
    * Drives most of the phase transition of a transaction
    */
-  void AdvanceTransaction(TxnId txn_id);
+  void AdvanceTransaction(TransactionState& state);
 
   /**
    * Checks master metadata information and reads local data to the transaction
    * buffer, then broadcast local data to other partitions
    */
-  void ReadLocalStorage(TxnId txn_id);
+  void ReadLocalStorage(TransactionState& state);
 
   /**
    * Executes the code inside the transaction
    */
-  void Execute(TxnId txn_id);
+  void Execute(TransactionState& state);
 
   /**
    * Returns the result back to the scheduler and cleans up the transaction state
    */
-  void Finish(TxnId txn_id);
+  void Finish(TransactionState& state);
 
-  void NotifyOtherPartitions(TxnId txn_id);
+  void NotifyOtherPartitions(TransactionState& state);
 
-  // Precondition: txn_id must exists in txn states table
-  TransactionState& TxnState(TxnId txn_id);
+  // Precondition: the txn is in the WAIT_REMOTE_READ phase. The keys and values are moved out of read_result
+  void ApplyRemoteReadResult(TransactionState& state, internal::RemoteReadResult& read_result);
 
   std::shared_ptr<Storage> storage_;
   std::unique_ptr<Execution> execution_;
+  std::shared_ptr<WorkerQueue> queue_;
+  std::shared_ptr<CompletionQueue> completion_queue_;
+
+  ObjectPool<TransactionState> txn_states_;
+  // The remote reads are the only messages that refer to a txn by id, so only the txns waiting
+  // for them are looked up by id
+  std::unordered_map<TxnId, TransactionState*> remote_read_waiters_;
 
-  std::unordered_map<TxnId, TransactionState> txn_states_;
+  // Remote reads of txns that have not been dispatched to this worker yet
+  std::unordered_map<TxnId, std::vector<EnvelopePtr>> early_remote_reads_;
 };
 
 }  // namespace slog
\ No newline at end of file
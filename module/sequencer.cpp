@@ -19,10 +19,12 @@ using internal::Response;
 using std::chrono::milliseconds;
 
 Sequencer::Sequencer(const std::shared_ptr<zmq::context_t>& context, const ConfigurationPtr& config,
-                     const MetricsRepositoryManagerPtr& metrics_manager, milliseconds poll_timeout)
+                     const MetricsRepositoryManagerPtr& metrics_manager, milliseconds poll_timeout,
+                     const BacklogPtr& backlog)
     : NetworkedModule(context, config, config->sequencer_port(), kSequencerChannel, metrics_manager, poll_timeout),
       sharder_(Sharder::MakeSharder(config)),
       batch_id_counter_(0),
+      batching_policy_(config->sequencer_batching(), backlog),
       rg_(std::random_device()()),
       collecting_stats_(false) {
   partitioned_batch_.resize(config->num_partitions());
@@ -32,11 +34,9 @@ Sequencer::Sequencer(const std::shared_ptr<zmq::context_t>& context, const Confi
 void Sequencer::NewBatch() {
   ++batch_id_counter_;
   batch_size_ = 0;
+  batch_arena_ = NewArena(kBatchArenaBlockSize);
   for (auto& batch : partitioned_batch_) {
-    if (batch == nullptr) {
-      batch.reset(new Batch());
-    }
-    batch->Clear();
+    batch = google::protobuf::Arena::CreateMessage<Batch>(batch_arena_.get());
     batch->set_transaction_type(TransactionType::SINGLE_HOME);
     batch->set_id(batch_id());
   }
@@ -71,13 +71,10 @@ void Sequencer::BatchTxn(Transaction* txn) {
     txn = GenerateLockOnlyTxn(txn, config()->local_replica(), true /* in_place */);
   }
 
-  auto num_involved_partitions = txn->internal().involved_partitions_size();
-  for (int i = 0; i < num_involved_partitions; ++i) {
-    bool in_place = i == (num_involved_partitions - 1);
-    auto p = txn->internal().involved_partitions(i);
-    auto new_txn = GeneratePartitionedTxn(sharder_, txn, p, in_place);
-    if (new_txn != nullptr) {
-      partitioned_batch_[p]->mutable_transactions()->AddAllocated(new_txn);
+  auto partitioned_txns = GeneratePartitionedTxns(sharder_, txn, batch_arena_.get());
+  for (size_t p = 0; p < partitioned_txns.size(); ++p) {
+    if (partitioned_txns[p] != nullptr) {
+      partitioned_batch_[p]->mutable_transactions()->AddAllocated(partitioned_txns[p]);
     }
   }
 
@@ -85,19 +82,29 @@ void Sequencer::BatchTxn(Transaction* txn) {
 
   // If this is the first txn in the batch, schedule to send the batch at a later time
   if (batch_size_ == 1) {
-    NewTimedCallback(config()->sequencer_batch_duration(), [this]() {
-      SendBatch();
-      NewBatch();
+    NewTimedCallback(batching_policy_.OpenBatch(), [this, batch_id_counter = batch_id_counter_]() {
+      // The batch has already been sent if it got full before the delay
+      if (batch_id_counter == batch_id_counter_) {
+        SendBatch();
+        NewBatch();
+      }
     });
 
     batch_starting_time_ = std::chrono::steady_clock::now();
   }
+
+  if (batching_policy_.IsFull(batch_size_)) {
+    SendBatch();
+    NewBatch();
+  }
 }
 
 void Sequencer::SendBatch() {
   VLOG(3) << "Finished batch " << batch_id() << " of size " << batch_size_
           << ". Sending out for ordering and replicating";
 
+  batching_policy_.CloseBatch(batch_size_);
+
   if (collecting_stats_) {
     stat_batch_sizes_.push_back(batch_size_);
     stat_batch_durations_ms_.push_back((std::chrono::steady_clock::now() - batch_starting_time_).count() / 1000000.0);
@@ -117,7 +124,7 @@ void Sequencer::SendBatch() {
   auto num_partitions = config()->num_partitions();
   vector<internal::Batch*> batch_partitions;
   for (uint32_t p = 0; p < num_partitions; p++) {
-    auto batch_partition = partitioned_batch_[p].release();
+    auto batch_partition = partitioned_batch_[p];
 
     RECORD(batch_partition, TransactionEvent::EXIT_SEQUENCER_IN_BATCH);
 
@@ -125,11 +132,13 @@ void Sequencer::SendBatch() {
     Send(*env, config()->MakeMachineId(local_replica, p), kLocalLogChannel);
     // Collect back the batch partition to send to other replicas
     batch_partitions.push_back(
-        env->mutable_request()->mutable_forward_batch_data()->mutable_batch_data()->ReleaseLast());
+        env->mutable_request()->mutable_forward_batch_data()->mutable_batch_data()->UnsafeArenaReleaseLast());
   }
 
-  // Distribute the batch data to other replicas. All partitions of current batch are contained in a single message
-  auto env = NewBatchForwardingMessage(move(batch_partitions));
+  // Distribute the batch data to other replicas. All partitions of current batch are contained in a single message.
+  // This message takes over the arena of the batch
+  EnvelopePtr env(NewBatchForwardingMessage(move(batch_partitions)));
+  batch_arena_.release();
   // Send to any partition
   auto remote_partition = batch_id_counter_ % num_partitions;
   vector<MachineId> destinations;
@@ -149,10 +158,9 @@ void Sequencer::SendBatch() {
       VLOG(3) << "Delay batch " << batch_id() << " for " << delay_ms << " ms";
 
       NewTimedCallback(milliseconds(delay_ms),
-                       [this, destinations, batch_id = batch_id(), delayed_env = env.release()]() {
+                       [this, destinations, batch_id = batch_id(), delayed_env = std::shared_ptr(move(env))]() {
                          VLOG(3) << "Sending delayed batch " << batch_id;
                          Send(*delayed_env, destinations, kInterleaverChannel);
-                         delete delayed_env;
                        });
 
       return;
@@ -162,8 +170,8 @@ void Sequencer::SendBatch() {
   Send(*env, destinations, kInterleaverChannel);
 }
 
-EnvelopePtr Sequencer::NewBatchForwardingMessage(std::vector<internal::Batch*>&& batch) {
-  auto env = NewEnvelope();
+internal::Envelope* Sequencer::NewBatchForwardingMessage(std::vector<internal::Batch*>&& batch) {
+  auto env = google::protobuf::Arena::CreateMessage<internal::Envelope>(batch_arena_.get());
   auto forward_batch = env->mutable_request()->mutable_forward_batch_data();
   forward_batch->set_home(config()->local_replica());
   // Minus 1 so that batch id counter starts from 0
@@ -177,7 +185,11 @@ EnvelopePtr Sequencer::NewBatchForwardingMessage(std::vector<internal::Batch*>&&
 /**
  * {
  *    seq_batch_size_pctls:        [int],
- *    seq_batch_duration_ms_pctls: [float]
+ *    seq_batch_duration_ms_pctls: [float],
+ *    batching_delay_us:           int,
+ *    arrival_rate:                float,
+ *    coalescing:                  object (see CoalescingStatsToJson)
+ *    compression:                 object (see CompressionStatsToJson)
  * }
  */
 void Sequencer::ProcessStatsRequest(const internal::StatsRequest& stats_request) {
@@ -201,6 +213,12 @@ void Sequencer::ProcessStatsRequest(const internal::StatsRequest& stats_request)
   stats.AddMember(StringRef(SEQ_BATCH_DURATION_MS_PCTLS), Percentiles(stat_batch_durations_ms_, alloc), alloc);
   stat_batch_durations_ms_.clear();
 
+  stats.AddMember(StringRef(BATCHING_DELAY_US), batching_policy_.delay().count(), alloc);
+  stats.AddMember(StringRef(ARRIVAL_RATE), batching_policy_.arrival_rate(), alloc);
+
+  stats.AddMember(StringRef(COALESCING), CoalescingStatsToJson(coalescing_stats(), alloc), alloc);
+  stats.AddMember(StringRef(COMPRESSION), CompressionStatsToJson(compression_stats(), alloc), alloc);
+
   // Write JSON object to a buffer and send back to the server
   rapidjson::StringBuffer buf;
   rapidjson::Writer<rapidjson::StringBuffer> writer(buf);
@@ -8,6 +8,7 @@
 #include "common/sharder.h"
 #include "common/types.h"
 #include "connection/broker.h"
+#include "module/base/batching_policy.h"
 #include "module/base/networked_module.h"
 
 namespace slog {
@@ -23,12 +24,15 @@ namespace slog {
  *
  *         For a multi-home txn, a corresponding lock-only txn is created and then goes
  *         through the same process as a single-home txn above.
+ *
+ * When a batch is sent is decided by the sequencer batching policy, which can be driven
+ * by the backlog of the Interleaver and the Scheduler of the same machine.
  */
 class Sequencer : public NetworkedModule {
  public:
   Sequencer(const std::shared_ptr<zmq::context_t>& context, const ConfigurationPtr& config,
             const MetricsRepositoryManagerPtr& metrics_manager,
-            std::chrono::milliseconds poll_timeout = kModuleTimeout);
+            std::chrono::milliseconds poll_timeout = kModuleTimeout, const BacklogPtr& backlog = nullptr);
 
   std::string name() const override { return "Sequencer"; }
 
@@ -42,12 +46,15 @@ class Sequencer : public NetworkedModule {
   void NewBatch();
   BatchId batch_id() const { return batch_id_counter_ * kMaxNumMachines + config()->local_machine_id(); }
   void SendBatch();
-  EnvelopePtr NewBatchForwardingMessage(std::vector<internal::Batch*>&& batch);
+  internal::Envelope* NewBatchForwardingMessage(std::vector<internal::Batch*>&& batch);
 
   const SharderPtr sharder_;
-  std::vector<std::unique_ptr<internal::Batch>> partitioned_batch_;
+  // The batch partitions and everything in them are allocated on a new arena for each batch
+  std::unique_ptr<google::protobuf::Arena> batch_arena_;
+  std::vector<internal::Batch*> partitioned_batch_;
   BatchId batch_id_counter_;
   int batch_size_;
+  BatchingPolicy batching_policy_;
 
   std::mt19937 rg_;
 
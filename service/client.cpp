@@ -65,6 +65,12 @@ void ExecuteTxn(const char* txn_file) {
     keys.emplace_back(v.GetString(), KeyType::READ);
   }
 
+  if (d.HasMember("add_set")) {
+    for (const auto& v : d["add_set"].GetArray()) {
+      keys.emplace_back(v.GetString(), KeyType::ADD);
+    }
+  }
+
   Transaction* txn;
   if (d.HasMember("new_master")) {
     txn = MakeTransaction(keys, {}, d["new_master"].GetInt());
@@ -228,6 +234,8 @@ string LockModeStr(LockMode mode) {
       return "READ";
     case LockMode::WRITE:
       return "WRITE";
+    case LockMode::ADD:
+      return "ADD";
   }
   return "<error>";
 }
@@ -254,7 +262,7 @@ void PrintSchedulerStats(const rapidjson::Document& stats, uint32_t level) {
   cout << "\n";
   cout << "Waiting txns: " << stats[NUM_TXNS_WAITING_FOR_LOCK].GetUint() << "\n";
 
-  // 0: OLD or RMA. 1: DDR
+  // 0: OLD or RMA. 1: DDR. 2: CG
   auto lock_man_type = stats[LOCK_MANAGER_TYPE].GetInt();
 
   if (lock_man_type == 0) {
@@ -307,6 +315,10 @@ void PrintSchedulerStats(const rapidjson::Document& stats, uint32_t level) {
         cout << "\tWrite: " << entry[1].GetUint() << "\n";
         cout << "\tReads: ";
         TRUNCATED_FOR_EACH(requester, entry[2].GetArray()) { cout << requester.GetUint() << " "; }
+        if (entry.Size() > 3) {
+          cout << "\n\tAdds: ";
+          TRUNCATED_FOR_EACH(requester, entry[3].GetArray()) { cout << requester.GetUint() << " "; }
+        }
       }
       cout << "\n";
     }
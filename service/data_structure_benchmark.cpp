@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <queue>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
+#include "common/constants.h"
+#include "common/string_utils.h"
+#include "data_structure/async_log.h"
+#include "data_structure/batch_log.h"
+#include "data_structure/concurrent_hash_map.h"
+#include "service/service_utils.h"
+
+DEFINE_uint32(items, 1000000, "Number of items inserted into the AsyncLog");
+DEFINE_uint32(batches, 200000, "Number of batches and slots added to the BatchLog");
+DEFINE_uint32(keys, 100000, "Number of keys in the ConcurrentHashMap");
+DEFINE_uint32(reads, 500000, "Number of reads per reader thread of the ConcurrentHashMap");
+DEFINE_string(readers, "1,2,4,8", "Comma-separated numbers of reader threads of the ConcurrentHashMap");
+DEFINE_string(depths, "1,64,1024,16384", "Comma-separated sizes of the windows within which items are shuffled");
+
+using namespace slog;
+using namespace std::chrono;
+
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The implementation of AsyncLog before it was backed by a ring buffer
+template <typename T>
+class MapAsyncLog {
+ public:
+  void Insert(uint32_t position, const T& item) {
+    if (position >= next_) {
+      log_.emplace(position, item);
+    }
+  }
+  bool HasNext() const { return log_.count(next_) > 0; }
+  pair<uint32_t, T> Next() {
+    auto it = log_.find(next_++);
+    auto res = *it;
+    log_.erase(it);
+    return res;
+  }
+
+ private:
+  std::unordered_map<uint32_t, T> log_;
+  uint32_t next_ = 0;
+};
+
+// The implementation of BatchLog before it was backed by ring buffers
+class MapBatchLog {
+ public:
+  void AddBatch(BatchPtr&& batch) {
+    auto batch_id = batch->id();
+    batches_.insert_or_assign(batch_id, std::move(batch));
+    UpdateReadyBatches();
+  }
+  void AddSlot(SlotId slot_id, BatchId batch_id) {
+    slots_.emplace(slot_id, batch_id);
+    replication_[batch_id] += 0;
+    UpdateReadyBatches();
+  }
+  bool HasNextBatch() const { return !ready_batches_.empty(); }
+  pair<SlotId, BatchPtr> NextBatch() {
+    auto [slot, batch_id] = ready_batches_.front();
+    ready_batches_.pop();
+    auto it = batches_.find(batch_id);
+    auto res = std::make_pair(slot, std::move(it->second));
+    batches_.erase(it);
+    return res;
+  }
+
+ private:
+  void UpdateReadyBatches() {
+    for (auto slot_it = slots_.find(next_slot_); slot_it != slots_.end(); slot_it = slots_.find(next_slot_)) {
+      auto batch_id = slot_it->second;
+      auto rep_it = replication_.find(batch_id);
+      if (batches_.count(batch_id) == 0 || rep_it == replication_.end() || rep_it->second != 0) {
+        break;
+      }
+      replication_.erase(rep_it);
+      ready_batches_.emplace(next_slot_++, batch_id);
+      slots_.erase(slot_it);
+    }
+  }
+
+  std::unordered_map<SlotId, BatchId> slots_;
+  SlotId next_slot_ = 0;
+  std::unordered_map<BatchId, BatchPtr> batches_;
+  std::unordered_map<BatchId, int> replication_;
+  std::queue<pair<SlotId, BatchId>> ready_batches_;
+};
+
+// Shuffles the elements within consecutive windows of the given size
+template <typename T>
+void ShuffleWithinWindows(vector<T>& v, uint32_t depth, std::mt19937& rg) {
+  for (size_t i = 0; i < v.size(); i += depth) {
+    std::shuffle(v.begin() + i, v.begin() + std::min(v.size(), i + depth), rg);
+  }
+}
+
+// Inserts the items in the given order and consumes them as soon as they are ready. Returns the throughput
+// in million items/s
+template <typename Log>
+double RunAsyncLog(Log& log, const vector<uint32_t>& positions) {
+  uint64_t sum = 0;
+  auto start_time = steady_clock::now();
+  for (auto position : positions) {
+    log.Insert(position, position);
+    while (log.HasNext()) {
+      sum += log.Next().second;
+    }
+  }
+  auto elapsed = duration_cast<duration<double>>(steady_clock::now() - start_time);
+  CHECK_EQ(sum, static_cast<uint64_t>(positions.size()) * (positions.size() - 1) / 2);
+  return positions.size() / elapsed.count() / 1e6;
+}
+
+// Batch ids of the slots as generated by the sequencers of 4 machines
+BatchId BatchIdOfSlot(SlotId slot) { return (slot / 4) * kMaxNumMachines + slot % 4; }
+
+// Adds the batches and slots out of order and consumes the batches as soon as they are ready. Returns the
+// throughput in million batches/s
+template <typename Log>
+double RunBatchLog(Log& log, uint32_t num_batches, uint32_t depth) {
+  vector<BatchPtr> batches(num_batches);
+  vector<SlotId> slots(num_batches);
+  for (uint32_t i = 0; i < num_batches; i++) {
+    batches[i] = std::make_unique<internal::Batch>();
+    batches[i]->set_id(BatchIdOfSlot(i));
+    slots[i] = i;
+  }
+  std::mt19937 rg(0);
+  ShuffleWithinWindows(batches, depth, rg);
+  ShuffleWithinWindows(slots, depth, rg);
+
+  uint32_t num_ready = 0;
+  auto start_time = steady_clock::now();
+  for (uint32_t i = 0; i < num_batches; i++) {
+    log.AddBatch(std::move(batches[i]));
+    log.AddSlot(slots[i], BatchIdOfSlot(slots[i]));
+    while (log.HasNextBatch()) {
+      CHECK_EQ(log.NextBatch().first, num_ready++);
+    }
+  }
+  auto elapsed = duration_cast<duration<double>>(steady_clock::now() - start_time);
+  CHECK_EQ(num_ready, num_batches);
+  return num_batches / elapsed.count() / 1e6;
+}
+
+// Reads random keys from num_readers threads while one thread keeps updating the keys. Returns the
+// throughput in million reads/s
+double RunConcurrentHashMap(ConcurrentHashMap<string, string>& map, uint32_t num_readers) {
+  std::atomic<bool> stop = false;
+  std::thread writer([&map, &stop] {
+    for (uint32_t i = 0; !stop; i = (i + 1) % FLAGS_keys) {
+      map.InsertOrUpdate(std::to_string(i), string(100, 'y'));
+    }
+  });
+
+  vector<std::thread> readers;
+  auto start_time = steady_clock::now();
+  for (uint32_t t = 0; t < num_readers; t++) {
+    readers.emplace_back([&map, t] {
+      std::mt19937 rg(t);
+      std::uniform_int_distribution<uint32_t> dis(0, FLAGS_keys - 1);
+      string result;
+      for (uint32_t i = 0; i < FLAGS_reads; i++) {
+        CHECK(map.Get(result, std::to_string(dis(rg))));
+      }
+    });
+  }
+  for (auto& r : readers) {
+    r.join();
+  }
+  auto elapsed = duration_cast<duration<double>>(steady_clock::now() - start_time);
+  stop = true;
+  writer.join();
+  return num_readers * FLAGS_reads / elapsed.count() / 1e6;
+}
+
+vector<uint32_t> ParseList(const string& str) {
+  vector<uint32_t> list;
+  for (const auto& n : Split(str, ",")) {
+    list.push_back(std::stoul(n));
+  }
+  return list;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  InitializeService(&argc, &argv);
+
+  auto depths = ParseList(FLAGS_depths);
+
+  for (auto depth : depths) {
+    vector<uint32_t> positions(FLAGS_items);
+    for (uint32_t i = 0; i < FLAGS_items; i++) {
+      positions[i] = i;
+    }
+    std::mt19937 rg(0);
+    ShuffleWithinWindows(positions, depth, rg);
+
+    MapAsyncLog<uint64_t> map_log;
+    AsyncLog<uint64_t> log;
+    auto map_throughput = RunAsyncLog(map_log, positions);
+    auto throughput = RunAsyncLog(log, positions);
+    LOG(INFO) << "AsyncLog, out-of-order depth " << depth << ": unordered_map " << std::fixed << std::setprecision(2)
+              << map_throughput << " M items/s, ring buffer " << throughput << " M items/s";
+  }
+
+  for (auto depth : depths) {
+    MapBatchLog map_log;
+    BatchLog log;
+    auto map_throughput = RunBatchLog(map_log, FLAGS_batches, depth);
+    auto throughput = RunBatchLog(log, FLAGS_batches, depth);
+    LOG(INFO) << "BatchLog, out-of-order depth " << depth << ": unordered_map " << std::fixed << std::setprecision(2)
+              << map_throughput << " M batches/s, ring buffer " << throughput << " M batches/s";
+  }
+
+  ConcurrentHashMap<string, string> map;
+  for (uint32_t i = 0; i < FLAGS_keys; i++) {
+    map.InsertOrUpdate(std::to_string(i), string(100, 'x'));
+  }
+  for (auto num_readers : ParseList(FLAGS_readers)) {
+    auto throughput = RunConcurrentHashMap(map, num_readers);
+    LOG(INFO) << "ConcurrentHashMap, " << num_readers << " reader(s) and 1 writer: " << std::fixed
+              << std::setprecision(2) << throughput << " M reads/s";
+  }
+
+  return 0;
+}
@@ -1,22 +1,39 @@
 #include <chrono>
+#include <thread>
 
 #include "common/configuration.h"
 #include "common/csv_writer.h"
+#include "common/proto_utils.h"
 #include "common/string_utils.h"
 #include "connection/broker.h"
+#include "execution/tpcc/load_tables.h"
+#include "execution/tpcc/metadata_initializer.h"
 #include "module/scheduler.h"
 #include "service/service_utils.h"
 #include "storage/mem_only_storage.h"
 #include "workload/basic_workload.h"
+#include "workload/tpcc_workload.h"
 
 DEFINE_uint32(txns, 100, "Number of transactions");
 DEFINE_uint32(workers, 3, "Number of workers");
+DEFINE_uint32(partitions, 1, "Number of partitions. Each partition runs its own scheduler in this process");
 DEFINE_uint32(records, 100000, "Number of records");
 DEFINE_uint32(record_size, 100, "Size of a record in bytes");
-DEFINE_string(params, "hot=0,hot_records=0", "Basic workload params");
+DEFINE_string(wl, "basic", "Name of the workload to use (options: basic, tpcc)");
+DEFINE_string(params, "hot=0,hot_records=0", "Parameters of the workload");
+DEFINE_uint32(warehouses, 10, "Number of warehouses of the tpcc workload");
+DEFINE_uint32(batch_size, 1,
+              "Number of txns sent to a scheduler in one message. With more than 1, the txns are sent in batches "
+              "like the Interleaver does");
 DEFINE_double(sample, 10, "Percent of sampled transactions to be written to result files");
 DEFINE_string(out_dir, ".", "Directory containing output data");
-DEFINE_string(execution, "key_value", "Execution type. Choose from (noop and key_value)");
+DEFINE_string(execution, "key_value", "Execution type. Choose from (noop, key_value and tpcc)");
+DEFINE_string(handoff, "lock_free", "How txns are handed off to the workers. Choose from (lock_free and zmq)");
+DEFINE_string(dispatch, "least_loaded",
+              "How the scheduler picks a worker for a txn. Choose from (least_loaded and key_affinity)");
+DEFINE_bool(handoff_only, false,
+            "Only measure the throughput of handing off txns to the workers and back, using both "
+            "the lock-free queues and the zmq sockets");
 
 using namespace slog;
 using namespace std::chrono;
@@ -31,9 +48,126 @@ struct TxnInfo {
   TimePoint sent_at;
 };
 
+// Hands off FLAGS_txns fake txns to the workers via lock-free queues. Each worker only sends the txns back
+milliseconds BenchmarkLockFreeHandoff() {
+  auto completion_queue = std::make_shared<CompletionQueue>(kWorkerQueueCapacity);
+  vector<std::shared_ptr<WorkerQueue>> queues;
+  vector<std::thread> workers;
+  std::atomic<bool> running = true;
+  for (uint32_t i = 0; i < FLAGS_workers; i++) {
+    auto& queue = queues.emplace_back(std::make_shared<WorkerQueue>(i, kWorkerQueueCapacity));
+    workers.emplace_back([&running, queue, completion_queue] {
+      // Spin for a while after receiving a txn then park, like a worker module
+      const int kSpins = 1000;
+      Poller poller(milliseconds(10));
+      poller.PushNotifier(queue->notifier, [&queue] { return !queue->txns.empty(); });
+      int spins = 0;
+      while (running) {
+        poller.NextEvent(spins > 0);
+        spins = std::max(spins - 1, 0);
+        for (TxnHolder* txn; queue->txns.TryPop(txn);) {
+          while (!completion_queue->entries.TryPush({txn, queue->worker})) {
+            std::this_thread::yield();
+          }
+          completion_queue->notifier.Notify();
+          spins = kSpins;
+        }
+      }
+    });
+  }
+
+  auto start_time = steady_clock::now();
+  vector<uint32_t> loads(FLAGS_workers);
+  uint32_t sent = 0, received = 0;
+  while (received < FLAGS_txns) {
+    for (; sent < FLAGS_txns; sent++) {
+      auto worker = std::min_element(loads.begin(), loads.end()) - loads.begin();
+      auto& queue = *queues[worker];
+      if (!queue.txns.TryPush(reinterpret_cast<TxnHolder*>(sent + 1))) {
+        break;
+      }
+      queue.notifier.Notify();
+      loads[worker]++;
+    }
+    for (CompletionQueue::Entry entry; completion_queue->entries.TryPop(entry);) {
+      loads[entry.worker]--;
+      received++;
+    }
+  }
+  auto duration = duration_cast<milliseconds>(steady_clock::now() - start_time);
+
+  running = false;
+  for (auto& w : workers) {
+    w.join();
+  }
+  return duration;
+}
+
+// Hands off FLAGS_txns fake txns to the workers via zmq sockets. Each worker only sends the txns back
+milliseconds BenchmarkZmqHandoff() {
+  zmq::context_t context;
+  const string kAddress = "inproc://handoff_benchmark";
+  zmq::socket_t scheduler_socket(context, ZMQ_DEALER);
+  scheduler_socket.set(zmq::sockopt::rcvhwm, 0);
+  scheduler_socket.set(zmq::sockopt::sndhwm, 0);
+  scheduler_socket.bind(kAddress);
+
+  vector<std::thread> workers;
+  std::atomic<bool> running = true;
+  for (uint32_t i = 0; i < FLAGS_workers; i++) {
+    workers.emplace_back([&context, &running, &kAddress] {
+      zmq::socket_t socket(context, ZMQ_DEALER);
+      socket.set(zmq::sockopt::rcvhwm, 0);
+      socket.set(zmq::sockopt::sndhwm, 0);
+      socket.set(zmq::sockopt::rcvtimeo, 10);
+      socket.connect(kAddress);
+      while (running) {
+        zmq::message_t msg;
+        if (!socket.recv(msg)) {
+          continue;
+        }
+        socket.send(msg, zmq::send_flags::none);
+      }
+    });
+  }
+
+  auto start_time = steady_clock::now();
+  for (uint32_t i = 0; i < FLAGS_txns; i++) {
+    zmq::message_t msg(sizeof(TxnHolder*));
+    *msg.data<TxnHolder*>() = reinterpret_cast<TxnHolder*>(i + 1);
+    scheduler_socket.send(msg, zmq::send_flags::none);
+  }
+  for (uint32_t i = 0; i < FLAGS_txns; i++) {
+    zmq::message_t msg;
+    (void)scheduler_socket.recv(msg);
+  }
+  auto duration = duration_cast<milliseconds>(steady_clock::now() - start_time);
+
+  running = false;
+  for (auto& w : workers) {
+    w.join();
+  }
+  return duration;
+}
+
+void BenchmarkHandoff() {
+  auto report = [](const string& name, milliseconds duration) {
+    LOG(INFO) << name << ": " << FLAGS_txns << " txns in " << duration.count() << " ms ("
+              << std::fixed << std::setprecision(3) << FLAGS_txns / std::max(duration.count() / 1000.0, 1e-3)
+              << " txn/s)";
+  };
+  report("Lock-free queues", BenchmarkLockFreeHandoff());
+  report("Zmq sockets", BenchmarkZmqHandoff());
+}
+
 int main(int argc, char* argv[]) {
   InitializeService(&argc, &argv);
 
+  if (FLAGS_handoff_only) {
+    BenchmarkHandoff();
+    return 0;
+  }
+
   string address("/tmp/test_scheduler");
 
   internal::Configuration config_proto;
@@ -42,67 +176,150 @@ int main(int argc, char* argv[]) {
   config_proto.set_server_port(5000);
   config_proto.set_sequencer_port(5001);
   config_proto.set_forwarder_port(5002);
-  config_proto.set_num_partitions(1);
-  config_proto.mutable_simple_partitioning()->set_num_records(FLAGS_records);
-  config_proto.mutable_simple_partitioning()->set_record_size_bytes(FLAGS_record_size);
-  config_proto.add_replicas()->add_addresses(address);
+  config_proto.set_num_partitions(FLAGS_partitions);
+  if (FLAGS_wl == "tpcc") {
+    config_proto.mutable_tpcc_partitioning()->set_warehouses(FLAGS_warehouses);
+  } else {
+    config_proto.mutable_simple_partitioning()->set_num_records(FLAGS_records);
+    config_proto.mutable_simple_partitioning()->set_record_size_bytes(FLAGS_record_size);
+  }
+  auto replica = config_proto.add_replicas();
+  for (uint32_t p = 0; p < FLAGS_partitions; p++) {
+    replica->add_addresses(address + std::to_string(p));
+  }
   config_proto.set_num_workers(FLAGS_workers);
+  if (FLAGS_handoff == "lock_free") {
+    config_proto.set_worker_handoff(internal::WorkerHandoff::LOCK_FREE_QUEUE);
+  } else if (FLAGS_handoff == "zmq") {
+    config_proto.set_worker_handoff(internal::WorkerHandoff::ZMQ_SOCKET);
+  } else {
+    LOG(FATAL) << "Unknown handoff type: " << FLAGS_handoff;
+  }
+  if (FLAGS_dispatch == "least_loaded") {
+    config_proto.set_worker_dispatch_policy(internal::WorkerDispatchPolicy::LEAST_LOADED);
+  } else if (FLAGS_dispatch == "key_affinity") {
+    config_proto.set_worker_dispatch_policy(internal::WorkerDispatchPolicy::KEY_AFFINITY);
+  } else {
+    LOG(FATAL) << "Unknown dispatch policy: " << FLAGS_dispatch;
+  }
   if (FLAGS_execution == "noop") {
     config_proto.set_execution_type(internal::ExecutionType::NOOP);
   } else if (FLAGS_execution == "key_value") {
     config_proto.set_execution_type(internal::ExecutionType::KEY_VALUE);
+  } else if (FLAGS_execution == "tpcc") {
+    config_proto.set_execution_type(internal::ExecutionType::TPC_C);
   } else {
     LOG(FATAL) << "Unknown commands type: " << FLAGS_execution;
   }
 
-  auto config = make_shared<Configuration>(config_proto, address);
-  auto storage = make_shared<slog::MemOnlyStorage>();
-
-  // Prepare the modules
-  auto broker = Broker::New(config);
-  broker->AddChannel(kServerChannel);
-  auto scheduler = MakeRunnerFor<Scheduler>(broker, storage, nullptr);
-
-  broker->StartInNewThreads();
-  scheduler->StartInNewThread();
+  // Prepare the modules. The results of the txns of all partitions are sent to the first partition
+  vector<std::shared_ptr<Broker>> brokers;
+  vector<std::unique_ptr<ModuleRunner>> schedulers;
+  for (uint32_t p = 0; p < FLAGS_partitions; p++) {
+    auto config = make_shared<Configuration>(config_proto, config_proto.replicas(0).addresses(p));
+    auto& broker = brokers.emplace_back(Broker::New(config));
+    if (p == 0) {
+      broker->AddChannel(kServerChannel);
+    }
+    auto storage = make_shared<slog::MemOnlyStorage>();
+    if (FLAGS_wl == "tpcc") {
+      auto metadata_initializer =
+          make_shared<tpcc::TPCCMetadataInitializer>(config->num_replicas(), config->num_partitions());
+      auto storage_adapter = make_shared<tpcc::KVStorageAdapter>(storage, metadata_initializer);
+      tpcc::LoadTables(storage_adapter, FLAGS_warehouses, config->num_replicas(), config->num_partitions(), p);
+    }
+    schedulers.push_back(MakeRunnerFor<Scheduler>(broker, storage, nullptr));
+  }
+  for (size_t p = 0; p < brokers.size(); p++) {
+    brokers[p]->StartInNewThreads();
+    schedulers[p]->StartInNewThread();
+  }
+  auto config = brokers[0]->config();
+  auto sharder = Sharder::MakeSharder(config);
 
   // Prepare the workload
-  BasicWorkload workload(config, 0, "", FLAGS_params);
+  std::unique_ptr<Workload> workload;
+  if (FLAGS_wl == "basic") {
+    workload = std::make_unique<BasicWorkload>(config, 0, "", FLAGS_params);
+  } else if (FLAGS_wl == "tpcc") {
+    workload = std::make_unique<TPCCWorkload>(config, 0, FLAGS_params, std::make_pair(1, 1));
+  } else {
+    LOG(FATAL) << "Unknown workload: " << FLAGS_wl;
+  }
   vector<Transaction*> transactions;
   LOG(INFO) << "Generating " << FLAGS_txns << " transactions";
   for (size_t i = 0; i < FLAGS_txns; i++) {
-    auto txn = workload.NextTransaction().first;
+    auto txn = workload->NextTransaction().first;
+    // Number the txns like a server on machine 0 would
+    txn->mutable_internal()->set_id((i + 1) * kMaxNumMachines);
     txn->mutable_internal()->add_involved_replicas(0);
-    txn->mutable_internal()->add_involved_partitions(0);
+    PopulateInvolvedPartitions(sharder, *txn);
     txn->mutable_internal()->set_coordinating_server(0);
     transactions.push_back(txn);
   }
 
   // Prepare the socket that receives the results of the txns
-  zmq::socket_t result_socket(*broker->context(), ZMQ_PULL);
+  zmq::socket_t result_socket(*brokers[0]->context(), ZMQ_PULL);
   result_socket.bind(MakeInProcChannelAddress(kServerChannel));
 
   auto start_time = std::chrono::steady_clock::now();
 
-  // Send transactions to the scheduler
+  // Send transactions to the schedulers of their partitions
   LOG(INFO) << "Sending all transactions through the scheduler";
   std::unordered_map<TxnId, TxnInfo::TimePoint> sent_at;
-  Sender sender(config, broker->context());
+  std::unordered_map<TxnId, std::pair<Transaction*, int>> partial_results;
+  Sender sender(config, brokers[0]->context());
+  vector<EnvelopePtr> batches(FLAGS_partitions);
+  auto send_batch = [&](uint32_t p) {
+    sender.Send(std::move(batches[p]), config->MakeMachineId(0, p), kSchedulerChannel);
+  };
   for (auto txn : transactions) {
-    auto env = std::make_unique<internal::Envelope>();
-    env->mutable_request()->mutable_forward_txn()->set_allocated_txn(txn);
-    sender.Send(std::move(env), kSchedulerChannel);
-    sent_at[txn->internal().id()] = std::chrono::system_clock::now();
+    auto txn_id = txn->internal().id();
+    sent_at[txn_id] = std::chrono::system_clock::now();
+    partial_results[txn_id] = {nullptr, txn->internal().involved_partitions_size()};
+    for (auto p : txn->internal().involved_partitions()) {
+      auto sub_txn = GeneratePartitionedTxn(sharder, txn, p);
+      if (FLAGS_batch_size <= 1) {
+        auto env = std::make_unique<internal::Envelope>();
+        env->mutable_request()->mutable_forward_txn()->set_allocated_txn(sub_txn);
+        sender.Send(std::move(env), config->MakeMachineId(0, p), kSchedulerChannel);
+        continue;
+      }
+      if (batches[p] == nullptr) {
+        batches[p] = std::make_unique<internal::Envelope>();
+        batches[p]->mutable_request()->mutable_forward_batch_data()->add_batch_data();
+      }
+      auto batch = batches[p]->mutable_request()->mutable_forward_batch_data()->mutable_batch_data(0);
+      batch->mutable_transactions()->AddAllocated(sub_txn);
+      if (static_cast<uint32_t>(batch->transactions_size()) >= FLAGS_batch_size) {
+        send_batch(p);
+      }
+    }
+    delete txn;
+  }
+  for (uint32_t p = 0; p < FLAGS_partitions; p++) {
+    if (batches[p] != nullptr) {
+      send_batch(p);
+    }
   }
 
-  // Receive the results
+  // Receive the results and merge the results of the partitions of each txn
   LOG(INFO) << "Collecting results";
   vector<TxnInfo> results;
-  for (size_t i = 0; i < transactions.size(); i++) {
+  while (results.size() < transactions.size()) {
     auto env = RecvEnvelope(result_socket);
-    auto txn = env->mutable_request()->mutable_completed_subtxn()->release_txn();
-    auto txn_id = txn->internal().id();
-    results.push_back({.txn = txn, .sent_at = sent_at[txn_id]});
+    auto sub_txn = env->mutable_request()->mutable_completed_subtxn()->release_txn();
+    auto txn_id = sub_txn->internal().id();
+    auto& [txn, remaining] = partial_results[txn_id];
+    if (txn == nullptr) {
+      txn = sub_txn;
+    } else {
+      MergeTransaction(*txn, *sub_txn);
+      delete sub_txn;
+    }
+    if (--remaining == 0) {
+      results.push_back({.txn = txn, .sent_at = sent_at[txn_id]});
+    }
   }
 
   auto duration = duration_cast<milliseconds>(std::chrono::steady_clock::now() - start_time);
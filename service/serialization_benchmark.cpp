@@ -0,0 +1,142 @@
+#include <google/protobuf/any.pb.h>
+
+#include <chrono>
+#include <iomanip>
+
+#include "common/configuration.h"
+#include "connection/zmq_utils.h"
+#include "service/service_utils.h"
+#include "workload/basic_workload.h"
+
+DEFINE_uint32(batches, 1000, "Number of messages to serialize and deserialize");
+DEFINE_uint32(batch_size, 100, "Number of txns per batch");
+DEFINE_uint32(batches_per_message, 1, "Number of batches per ForwardBatchData message");
+DEFINE_uint32(replicas, 2, "Number of replicas used to generate the txns");
+DEFINE_uint32(partitions, 2, "Number of partitions used to generate the txns");
+DEFINE_uint32(records, 100000, "Number of records");
+DEFINE_uint32(record_size, 100, "Size of a record in bytes");
+DEFINE_string(params, "mh=50,mp=50", "Basic workload params");
+
+using namespace slog;
+using namespace std::chrono;
+
+using std::string;
+using std::vector;
+
+namespace {
+
+// The frame format used before the compact frame: the proto is packed into an Any, which is then
+// serialized after the machine id and channel
+zmq::message_t SerializeProtoWithAny(const google::protobuf::Message& proto) {
+  google::protobuf::Any any;
+  any.PackFrom(proto);
+  auto header_sz = sizeof(MachineId) + sizeof(Channel);
+  zmq::message_t msg(header_sz + any.ByteSizeLong());
+  any.SerializeToArray(msg.data<char>() + header_sz, any.ByteSizeLong());
+  return msg;
+}
+
+bool DeserializeProtoWithAny(google::protobuf::Message& out, const zmq::message_t& msg) {
+  google::protobuf::Any any;
+  auto header_sz = sizeof(MachineId) + sizeof(Channel);
+  if (!any.ParseFromArray(msg.data<char>() + header_sz, msg.size() - header_sz)) {
+    return false;
+  }
+  return any.UnpackTo(&out);
+}
+
+// A compact frame whose payload is compressed as it would be when sent to another region
+auto SerializeProtoCompressed(internal::CompressionCodec codec) {
+  return [codec](const google::protobuf::Message& proto) {
+    internal::Compression options;
+    options.set_codec(codec);
+    CompressionStats stats;
+    auto frame = SerializeProto(proto);
+    zmq::message_t compressed;
+    if (!CompressFrame(compressed, frame.data<char>(), frame.size(), options, stats)) {
+      return frame;
+    }
+    return compressed;
+  };
+}
+
+vector<internal::Envelope> MakeForwardBatchData() {
+  internal::Configuration config_proto;
+  config_proto.add_broker_ports(0);
+  config_proto.set_server_port(5000);
+  config_proto.set_sequencer_port(5001);
+  config_proto.set_forwarder_port(5002);
+  config_proto.set_num_partitions(FLAGS_partitions);
+  config_proto.mutable_simple_partitioning()->set_num_records(FLAGS_records);
+  config_proto.mutable_simple_partitioning()->set_record_size_bytes(FLAGS_record_size);
+  for (uint32_t r = 0; r < FLAGS_replicas; r++) {
+    auto replica = config_proto.add_replicas();
+    for (uint32_t p = 0; p < FLAGS_partitions; p++) {
+      replica->add_addresses("/tmp/serialization_benchmark_" + std::to_string(r) + "_" + std::to_string(p));
+    }
+  }
+  auto config = std::make_shared<Configuration>(config_proto, config_proto.replicas(0).addresses(0));
+  BasicWorkload workload(config, 0, "", FLAGS_params, 0);
+
+  vector<internal::Envelope> envelopes(FLAGS_batches);
+  uint64_t batch_id = 0;
+  for (auto& env : envelopes) {
+    auto forward_batch_data = env.mutable_request()->mutable_forward_batch_data();
+    forward_batch_data->set_home(0);
+    for (uint32_t b = 0; b < FLAGS_batches_per_message; b++) {
+      auto batch = forward_batch_data->add_batch_data();
+      batch->set_id(batch_id++);
+      batch->set_transaction_type(TransactionType::SINGLE_HOME);
+      for (uint32_t t = 0; t < FLAGS_batch_size; t++) {
+        batch->mutable_transactions()->AddAllocated(workload.NextTransaction().first);
+      }
+    }
+  }
+  return envelopes;
+}
+
+template <typename SerializeFn, typename DeserializeFn>
+void Run(const string& name, const vector<internal::Envelope>& envelopes, SerializeFn&& serialize,
+         DeserializeFn&& deserialize) {
+  vector<zmq::message_t> messages;
+  messages.reserve(envelopes.size());
+  size_t total_bytes = 0;
+
+  auto start_time = steady_clock::now();
+  for (const auto& env : envelopes) {
+    auto& msg = messages.emplace_back(serialize(env));
+    total_bytes += msg.size();
+  }
+  auto serialize_time = duration_cast<nanoseconds>(steady_clock::now() - start_time);
+
+  start_time = steady_clock::now();
+  for (const auto& msg : messages) {
+    internal::Envelope env;
+    CHECK(deserialize(env, msg)) << "Failed to deserialize";
+  }
+  auto deserialize_time = duration_cast<nanoseconds>(steady_clock::now() - start_time);
+
+  auto n = envelopes.size();
+  LOG(INFO) << name << ": " << total_bytes / n << " bytes/msg, serialize " << std::fixed << std::setprecision(1)
+            << serialize_time.count() / 1000.0 / n << " us/msg, deserialize " << deserialize_time.count() / 1000.0 / n
+            << " us/msg";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  InitializeService(&argc, &argv);
+
+  LOG(INFO) << "Generating " << FLAGS_batches << " messages";
+  auto envelopes = MakeForwardBatchData();
+
+  Run("Any-wrapped", envelopes, SerializeProtoWithAny, DeserializeProtoWithAny);
+  Run("Compact frame", envelopes, SerializeProto,
+      [](internal::Envelope& env, const zmq::message_t& msg) { return DeserializeProto(env, msg); });
+  for (auto codec : {internal::CompressionCodec::LZ4, internal::CompressionCodec::ZSTD}) {
+    Run("Compact frame with " + internal::CompressionCodec_Name(codec), envelopes, SerializeProtoCompressed(codec),
+        [](internal::Envelope& env, const zmq::message_t& msg) { return DeserializeProto(env, msg); });
+  }
+
+  return 0;
+}
@@ -1,4 +1,5 @@
 #include <fcntl.h>
+#include <unistd.h>
 
 #include <memory>
 #include <vector>
@@ -22,14 +23,24 @@
 #include "proto/internal.pb.h"
 #include "proto/offline_data.pb.h"
 #include "service/service_utils.h"
+#include "storage/durable_storage.h"
 #include "storage/mem_only_storage.h"
 #include "storage/metadata_initializer.h"
+#include "storage/snapshot.h"
 #include "version.h"
 
 DEFINE_string(config, "slog.conf", "Path to the configuration file");
 DEFINE_string(address, "", "Address of the local machine");
 DEFINE_string(data_dir, "", "Directory containing intial data");
-DEFINE_uint32(data_threads, 3, "Number of threads used to generate initial data");
+DEFINE_uint32(data_threads, 3, "Number of threads used to generate or load initial data");
+DEFINE_string(wal_dir, "",
+              "Directory containing the write-ahead log and checkpoints of the storage. If empty, the data is only "
+              "kept in memory. If the directory has data, the storage is recovered from it instead of being "
+              "initialized");
+DEFINE_bool(wal_direct_io, false, "Bypass the page cache when writing the write-ahead log");
+DEFINE_bool(wal_sync_commit, false, "Make each write wait until its log entry is durable");
+DEFINE_uint32(wal_group_commit_us, 0, "How long the log flusher waits for more writes before each flush");
+DEFINE_uint32(checkpoint_interval_s, 300, "How often the storage is checkpointed. Set to 0 to disable checkpointing");
 
 using slog::Broker;
 using slog::ConfigurationPtr;
@@ -46,6 +57,31 @@ void LoadData(slog::Storage& storage, const ConfigurationPtr& config, const stri
     return;
   }
 
+  auto sharder = slog::Sharder::MakeSharder(config);
+
+  // Prefer the snapshot format since it can be loaded in parallel
+  auto snapshot_file = data_dir + "/" + std::to_string(config->local_partition()) + ".snap";
+  if (access(snapshot_file.c_str(), F_OK) == 0) {
+    auto start_time = std::chrono::steady_clock::now();
+    slog::SnapshotReader reader(snapshot_file);
+    CHECK_EQ(reader.partition(), config->local_partition()) << "Snapshot is for a different partition";
+    CHECK_EQ(reader.num_partitions(), config->num_partitions()) << "Snapshot is for a different number of partitions";
+    LOG(INFO) << "Loading " << reader.num_records() << " records from snapshot using " << FLAGS_data_threads
+              << " threads...";
+    reader.ParallelForEach(FLAGS_data_threads, [&](std::string_view key_view, std::string_view value,
+                                                   const Metadata& metadata) {
+      Key key(key_view);
+      CHECK(sharder->is_local_key(key)) << "Key " << key << " does not belong to partition "
+                                        << config->local_partition();
+      CHECK_LT(metadata.master, config->num_replicas()) << "Master number exceeds number of replicas";
+      storage.Write(key, Record(std::string(value), metadata.master, metadata.counter));
+    });
+    auto elapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+    LOG(INFO) << "Loaded snapshot in " << elapsed.count() << " ms";
+    return;
+  }
+
   auto data_file = data_dir + "/" + std::to_string(config->local_partition()) + ".dat";
 
   auto fd = open(data_file.c_str(), O_RDONLY);
@@ -58,8 +94,6 @@ void LoadData(slog::Storage& storage, const ConfigurationPtr& config, const stri
   slog::OfflineDataReader reader(fd);
   LOG(INFO) << "Loading " << reader.GetNumDatums() << " datums...";
 
-  auto sharder = slog::Sharder::MakeSharder(config);
-
   VLOG(1) << "First 10 datums are: ";
   int c = 10;
   while (reader.HasNextDatum()) {
@@ -173,24 +207,58 @@ int main(int argc, char* argv[]) {
   auto broker = Broker::New(config);
 
   // Create and initialize storage layer
-  auto storage = make_shared<slog::MemOnlyStorage>();
+  std::shared_ptr<slog::Storage> storage;
+  std::shared_ptr<slog::LookupMasterIndex> lookup_master_index;
+  std::shared_ptr<slog::DurableStorage> durable_storage;
+  if (FLAGS_wal_dir.empty()) {
+    auto mem_only_storage = make_shared<slog::MemOnlyStorage>();
+    storage = mem_only_storage;
+    lookup_master_index = mem_only_storage;
+  } else {
+    slog::DurableStorageOptions options;
+    options.dir = FLAGS_wal_dir;
+    options.use_direct_io = FLAGS_wal_direct_io;
+    options.synchronous_commit = FLAGS_wal_sync_commit;
+    options.group_commit_interval = std::chrono::microseconds(FLAGS_wal_group_commit_us);
+    options.checkpoint_interval = std::chrono::seconds(FLAGS_checkpoint_interval_s);
+    options.recovery_threads = FLAGS_data_threads;
+    durable_storage = make_shared<slog::DurableStorage>(options);
+    storage = durable_storage;
+    lookup_master_index = durable_storage;
+  }
+  // A node that crashed in the middle of the initial load recovers only part of the initial data,
+  // so the data is loaded again on top of it
+  bool recovered = durable_storage != nullptr && durable_storage->initialized();
+  if (durable_storage != nullptr && durable_storage->recovered() && !recovered) {
+    LOG(WARNING) << "Recovered storage was not completely initialized. Loading the initial data again";
+  }
   std::shared_ptr<slog::MetadataInitializer> metadata_initializer;
   switch (config->proto_config().partitioning_case()) {
     case slog::internal::Configuration::kSimplePartitioning:
       metadata_initializer =
           make_shared<slog::SimpleMetadataInitializer>(config->num_replicas(), config->num_partitions());
-      GenerateSimpleData(storage, metadata_initializer, config);
+      if (!recovered) {
+        GenerateSimpleData(storage, metadata_initializer, config);
+      }
       break;
     case slog::internal::Configuration::kTpccPartitioning:
       metadata_initializer =
           make_shared<slog::tpcc::TPCCMetadataInitializer>(config->num_replicas(), config->num_partitions());
-      GenerateTPCCData(storage, metadata_initializer, config);
+      if (!recovered) {
+        GenerateTPCCData(storage, metadata_initializer, config);
+      }
       break;
     default:
       metadata_initializer = make_shared<slog::ConstantMetadataInitializer>(0);
-      LoadData(*storage, config, FLAGS_data_dir);
+      if (!recovered) {
+        LoadData(*storage, config, FLAGS_data_dir);
+      }
       break;
   }
+  // Checkpoint the initial data so that it does not have to be replayed from the log after a restart
+  if (durable_storage != nullptr && !recovered) {
+    durable_storage->MarkInitialized();
+  }
 
   auto config_name = FLAGS_config;
   if (auto pos = config_name.rfind('/'); pos != std::string::npos) {
@@ -206,10 +274,12 @@ int main(int argc, char* argv[]) {
                        slog::ModuleId::MHORDERER);
   modules.emplace_back(MakeRunnerFor<slog::LocalPaxos>(broker),
                        slog::ModuleId::LOCALPAXOS);
-  modules.emplace_back(MakeRunnerFor<slog::Forwarder>(broker->context(), broker->config(), storage,
-                                                      metadata_initializer, metrics_manager),
+  modules.emplace_back(MakeRunnerFor<slog::Forwarder>(broker->context(), broker->config(), lookup_master_index,
+                                                      metadata_initializer, metrics_manager, slog::kModuleTimeout,
+                                                      broker->backlog()),
                        slog::ModuleId::FORWARDER);
-  modules.emplace_back(MakeRunnerFor<slog::Sequencer>(broker->context(), broker->config(), metrics_manager),
+  modules.emplace_back(MakeRunnerFor<slog::Sequencer>(broker->context(), broker->config(), metrics_manager,
+                                                      slog::kModuleTimeout, broker->backlog()),
                        slog::ModuleId::SEQUENCER);
   modules.emplace_back(MakeRunnerFor<slog::Interleaver>(broker, metrics_manager),
                        slog::ModuleId::INTERLEAVER);
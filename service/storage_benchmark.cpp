@@ -0,0 +1,118 @@
+#include <dirent.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <iomanip>
+#include <random>
+#include <thread>
+
+#include "service/service_utils.h"
+#include "storage/durable_storage.h"
+#include "storage/mem_only_storage.h"
+
+DEFINE_string(dir, "/tmp/slog_storage_benchmark", "Directory for the write-ahead log and checkpoints");
+DEFINE_uint32(threads, 4, "Number of writing threads");
+DEFINE_uint32(writes, 200000, "Number of writes per thread");
+DEFINE_uint32(records, 1000000, "Number of distinct keys");
+DEFINE_uint32(record_size, 100, "Size of a record in bytes");
+DEFINE_uint32(group_commit_us, 0, "How long the log flusher waits for more writes before each flush");
+
+using namespace slog;
+using namespace std::chrono;
+
+using std::string;
+using std::vector;
+
+namespace {
+
+void RemoveDir(const string& dir) {
+  if (auto d = opendir(dir.c_str())) {
+    while (auto ent = readdir(d)) {
+      string name(ent->d_name);
+      if (name != "." && name != "..") {
+        unlink((dir + "/" + name).c_str());
+      }
+    }
+    closedir(d);
+  }
+  rmdir(dir.c_str());
+}
+
+// Runs FLAGS_threads threads, each doing FLAGS_writes writes to random keys. Returns the throughput in writes/s
+double RunWrites(Storage& storage) {
+  vector<std::thread> threads;
+  auto start_time = steady_clock::now();
+  for (uint32_t t = 0; t < FLAGS_threads; t++) {
+    threads.emplace_back([&storage, t] {
+      std::mt19937 rg(t);
+      std::uniform_int_distribution<uint32_t> dis(0, FLAGS_records - 1);
+      string value(FLAGS_record_size, 'a' + t % 26);
+      for (uint32_t i = 0; i < FLAGS_writes; i++) {
+        storage.Write(std::to_string(dis(rg)), Record(value));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  auto elapsed = duration_cast<duration<double>>(steady_clock::now() - start_time);
+  return FLAGS_threads * FLAGS_writes / elapsed.count();
+}
+
+double BenchmarkDurable(const string& name, DurableStorageOptions options, double baseline) {
+  RemoveDir(options.dir);
+  double throughput;
+  {
+    DurableStorage storage(options);
+    throughput = RunWrites(storage);
+    LOG(INFO) << name << ": " << std::fixed << std::setprecision(0) << throughput << " writes/s ("
+              << std::setprecision(1) << (1 - throughput / baseline) * 100 << "% overhead, "
+              << storage.log().num_flushes() << " flushes, " << storage.log().num_flushed_bytes() / (1 << 20)
+              << " MB flushed)";
+  }
+  return throughput;
+}
+
+// Recovers the storage left in the directory and returns the time it takes
+milliseconds BenchmarkRecovery(const DurableStorageOptions& options) {
+  auto start_time = steady_clock::now();
+  DurableStorage storage(options);
+  return duration_cast<milliseconds>(steady_clock::now() - start_time);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  InitializeService(&argc, &argv);
+
+  MemOnlyStorage mem_only_storage;
+  auto baseline = RunWrites(mem_only_storage);
+  LOG(INFO) << "In-memory only: " << std::fixed << std::setprecision(0) << baseline << " writes/s";
+
+  DurableStorageOptions options;
+  options.dir = FLAGS_dir;
+  options.group_commit_interval = microseconds(FLAGS_group_commit_us);
+  options.recovery_threads = FLAGS_threads;
+
+  BenchmarkDurable("Buffered log", options, baseline);
+
+  auto direct_io_options = options;
+  direct_io_options.use_direct_io = true;
+  BenchmarkDurable("Direct I/O log", direct_io_options, baseline);
+
+  auto sync_commit_options = options;
+  sync_commit_options.synchronous_commit = true;
+  BenchmarkDurable("Synchronous commit", sync_commit_options, baseline);
+
+  // The directory now contains the log of the last run only
+  LOG(INFO) << "Recovery from log only: " << BenchmarkRecovery(options).count() << " ms";
+
+  {
+    DurableStorage storage(options);
+    storage.Checkpoint();
+  }
+  LOG(INFO) << "Recovery from checkpoint: " << BenchmarkRecovery(options).count() << " ms";
+
+  RemoveDir(FLAGS_dir);
+  return 0;
+}
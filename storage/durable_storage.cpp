@@ -0,0 +1,172 @@
+#include "storage/durable_storage.h"
+
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+namespace slog {
+
+namespace {
+
+// The checkpoint is a snapshot whose sequence is the LSN to replay the log from
+const char kCheckpointFile[] = "checkpoint";
+// Created once the initial data is in a checkpoint
+const char kInitializedFile[] = "initialized";
+
+}  // namespace
+
+DurableStorage::DurableStorage(const DurableStorageOptions& options)
+    : options_(options), initialized_(false), num_recovered_records_(0), num_replayed_log_entries_(0), stop_(false) {
+  if (mkdir(options_.dir.c_str(), 0755) != 0) {
+    CHECK_EQ(errno, EEXIST) << "Cannot create storage directory " << options_.dir << ": " << strerror(errno);
+  }
+
+  auto initialized_path = options_.dir + "/" + kInitializedFile;
+  if (access(initialized_path.c_str(), F_OK) == 0) {
+    initialized_ = true;
+  } else {
+    CHECK_EQ(errno, ENOENT) << "Cannot access file " << initialized_path << ": " << strerror(errno);
+  }
+
+  auto start_time = std::chrono::steady_clock::now();
+  auto from_lsn = LoadCheckpoint();
+  auto next_lsn = WriteAheadLog::Replay(options_.dir, from_lsn, [this](WriteAheadLog::Entry&& entry) {
+    if (entry.type == WriteAheadLog::EntryType::WRITE) {
+      table_.Write(entry.key, entry.record);
+    } else {
+      table_.Delete(entry.key);
+    }
+    num_replayed_log_entries_++;
+  });
+  if (recovered()) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+    LOG(INFO) << "Recovered " << num_recovered_records_ << " records from checkpoint and replayed "
+              << num_replayed_log_entries_ << " log entries in " << elapsed.count() << " ms";
+  }
+
+  log_ = std::make_unique<WriteAheadLog>(options_.dir, next_lsn, options_.use_direct_io,
+                                         options_.group_commit_interval);
+
+  if (options_.checkpoint_interval.count() > 0) {
+    checkpointer_ = std::thread(&DurableStorage::RunCheckpointer, this);
+  }
+}
+
+DurableStorage::~DurableStorage() {
+  if (checkpointer_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(checkpointer_mut_);
+      stop_ = true;
+    }
+    checkpointer_cv_.notify_one();
+    checkpointer_.join();
+  }
+}
+
+bool DurableStorage::Write(const Key& key, const Record& record) {
+  // The table must be updated before the log so that a concurrent checkpoint either
+  // sees this write or starts replaying from before its log entry
+  auto key_exists = table_.Write(key, record);
+  auto lsn = log_->AppendWrite(key, record);
+  if (options_.synchronous_commit) {
+    log_->WaitForDurable(lsn);
+  }
+  return key_exists;
+}
+
+bool DurableStorage::Delete(const Key& key) {
+  auto key_exists = table_.Delete(key);
+  auto lsn = log_->AppendDelete(key);
+  if (options_.synchronous_commit) {
+    log_->WaitForDurable(lsn);
+  }
+  return key_exists;
+}
+
+bool DurableStorage::Update(const Key& key, const std::function<void(Record&)>& updater) {
+  // Concurrent updates of the same key may run in any order, so the new record is logged while the
+  // table is still blocking the other updates. Otherwise, the log could end with an older record
+  uint64_t lsn;
+  auto key_exists = table_.Update(key, [&](Record& record) {
+    updater(record);
+    lsn = log_->AppendWrite(key, record);
+  });
+  if (options_.synchronous_commit) {
+    log_->WaitForDurable(lsn);
+  }
+  return key_exists;
+}
+
+void DurableStorage::Checkpoint() {
+  std::lock_guard<std::mutex> lock(checkpoint_mut_);
+
+  auto start_time = std::chrono::steady_clock::now();
+  auto path = options_.dir + "/" + kCheckpointFile;
+  auto tmp_path = path + ".tmp";
+  auto begin_lsn = log_->next_lsn();
+
+  SnapshotWriter writer(tmp_path, 0, 1, begin_lsn);
+  table_.ForEach([&writer](const Key& key, const Record& record) { writer.Add(key, record); });
+  writer.Finish();
+
+  // The snapshot may contain writes whose log entries are not durable yet. Wait for them so
+  // that the recovered state never has a write without the writes logged before it
+  log_->WaitForDurable(log_->next_lsn() - 1);
+
+  CHECK_EQ(rename(tmp_path.c_str(), path.c_str()), 0) << "Cannot rename checkpoint file: " << strerror(errno);
+  SyncDir(options_.dir);
+  log_->Truncate(begin_lsn);
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time);
+  LOG(INFO) << "Checkpointed " << writer.num_records() << " records at LSN " << begin_lsn << " in " << elapsed.count()
+            << " ms";
+}
+
+void DurableStorage::MarkInitialized() {
+  // A checkpoint taken in the background may only have part of the initial data, so a new one is
+  // taken before the marker is created
+  Checkpoint();
+
+  auto path = options_.dir + "/" + kInitializedFile;
+  auto fd = open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+  CHECK_GE(fd, 0) << "Cannot create file " << path << ": " << strerror(errno);
+  CHECK_EQ(fsync(fd), 0) << "Cannot sync file " << path << ": " << strerror(errno);
+  close(fd);
+  SyncDir(options_.dir);
+
+  initialized_ = true;
+}
+
+uint64_t DurableStorage::LoadCheckpoint() {
+  // LSNs start from 1
+  const uint64_t kFirstLsn = 1;
+
+  // The checkpoint file is only renamed into place after it is complete so a corrupted
+  // checkpoint cannot be recovered from. The log entries before it are already gone.
+  auto path = options_.dir + "/" + kCheckpointFile;
+  if (access(path.c_str(), F_OK) != 0) {
+    CHECK_EQ(errno, ENOENT) << "Cannot access checkpoint file " << path << ": " << strerror(errno);
+    return kFirstLsn;
+  }
+  SnapshotReader reader(path);
+  reader.ParallelForEach(options_.recovery_threads,
+                         [this](std::string_view key, std::string_view value, const Metadata& metadata) {
+                           table_.Write(Key(key), Record(std::string(value), metadata.master, metadata.counter));
+                         });
+  num_recovered_records_ = reader.num_records();
+  return reader.sequence();
+}
+
+void DurableStorage::RunCheckpointer() {
+  std::unique_lock<std::mutex> lock(checkpointer_mut_);
+  while (!checkpointer_cv_.wait_for(lock, options_.checkpoint_interval, [this] { return stop_; })) {
+    lock.unlock();
+    Checkpoint();
+    lock.lock();
+  }
+}
+
+}  // namespace slog
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "storage/lookup_master_index.h"
+#include "storage/mem_only_storage.h"
+#include "storage/snapshot.h"
+#include "storage/storage.h"
+#include "storage/write_ahead_log.h"
+
+namespace slog {
+
+struct DurableStorageOptions {
+  // Directory containing the log segments and the checkpoint
+  std::string dir;
+  // Bypass the page cache when writing the log
+  bool use_direct_io = false;
+  // How long the log flusher waits for more writes before each flush
+  std::chrono::microseconds group_commit_interval{0};
+  // Whether a write only returns after it is durable
+  bool synchronous_commit = false;
+  // How often a checkpoint is taken in the background. No checkpoint is taken if this is 0
+  std::chrono::milliseconds checkpoint_interval{0};
+  // Number of threads loading the checkpoint on recovery
+  uint32_t recovery_threads = 1;
+};
+
+/**
+ * An in-memory storage made durable with a redo log and periodic checkpoints.
+ *
+ * Every write or delete is applied to the in-memory table and then appended to
+ * the write-ahead log. A checkpoint is a fuzzy snapshot of the table taken while
+ * writes keep going: it records the next LSN of the log before scanning the table,
+ * so replaying the log from that LSN on top of the snapshot brings every key to its
+ * latest value. Since an entry carries the whole record, replaying an entry whose
+ * effect is already in the snapshot is harmless. This relies on the writes to
+ * the same key being ordered by the caller, which the lock manager guarantees.
+ *
+ * On construction, the storage recovers from the checkpoint and the log found in
+ * the directory, if any. A marker file tells whether the recovered data is complete
+ * or comes from a crash in the middle of the initial load.
+ */
+class DurableStorage : public Storage, public LookupMasterIndex {
+ public:
+  explicit DurableStorage(const DurableStorageOptions& options);
+  ~DurableStorage();
+
+  bool Read(const Key& key, Record& result) const final { return table_.Read(key, result); }
+  bool ReadMetadata(const Key& key, Metadata& metadata) const final { return table_.ReadMetadata(key, metadata); }
+  bool GetMasterMetadata(const Key& key, Metadata& metadata) const final { return table_.ReadMetadata(key, metadata); }
+  bool Write(const Key& key, const Record& record) final;
+  bool Delete(const Key& key) final;
+  bool Update(const Key& key, const std::function<void(Record&)>& updater) final;
+
+  /**
+   * Writes a snapshot of the storage to the checkpoint file and removes the log
+   * segments that are no longer needed to recover
+   */
+  void Checkpoint();
+
+  /**
+   * Checkpoints the initial data of the storage and records that it has been completely
+   * loaded. Until then, whatever is recovered after a restart may be only part of it
+   */
+  void MarkInitialized();
+
+  /* Whether the initial data was completely loaded before the storage was recovered */
+  bool initialized() const { return initialized_; }
+  /* Whether anything was recovered on construction */
+  bool recovered() const { return num_recovered_records_ > 0 || num_replayed_log_entries_ > 0; }
+  size_t num_recovered_records() const { return num_recovered_records_; }
+  size_t num_replayed_log_entries() const { return num_replayed_log_entries_; }
+  const WriteAheadLog& log() const { return *log_; }
+
+ private:
+  // Returns the LSN to start replaying the log from
+  uint64_t LoadCheckpoint();
+  void RunCheckpointer();
+
+  const DurableStorageOptions options_;
+  MemOnlyStorage table_;
+  std::unique_ptr<WriteAheadLog> log_;
+  // Only one checkpoint is taken at a time
+  std::mutex checkpoint_mut_;
+
+  bool initialized_;
+  size_t num_recovered_records_;
+  size_t num_replayed_log_entries_;
+
+  std::mutex checkpointer_mut_;
+  std::condition_variable checkpointer_cv_;
+  bool stop_;
+  std::thread checkpointer_;
+};
+
+}  // namespace slog
@@ -14,15 +14,22 @@ class MemOnlyStorage : public Storage, public LookupMasterIndex {
 
   bool Delete(const Key& key) final { return table_.Erase(key); }
 
-  bool GetMasterMetadata(const Key& key, Metadata& metadata) const final {
-    Record rec;
-    if (!table_.Get(rec, key)) {
-      return false;
-    }
-    metadata = rec.metadata();
-    return true;
+  bool Update(const Key& key, const std::function<void(Record&)>& updater) final {
+    return table_.Update(key, updater);
   }
 
+  bool ReadMetadata(const Key& key, Metadata& metadata) const final {
+    return table_.Visit(key, [&metadata](const Record& record) { metadata = record.metadata(); });
+  }
+
+  bool GetMasterMetadata(const Key& key, Metadata& metadata) const final { return ReadMetadata(key, metadata); }
+
+  /**
+   * Calls fn on every key and record. Records written concurrently may or may not be visited
+   */
+  template <typename Fn>
+  void ForEach(Fn&& fn) const { table_.ForEach(std::forward<Fn>(fn)); }
+
  private:
   ConcurrentHashMap<Key, Record> table_;
 };
@@ -0,0 +1,190 @@
+#include "storage/snapshot.h"
+
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "storage/write_ahead_log.h"
+
+namespace slog {
+
+namespace {
+
+const size_t kMagicSize = 8;
+const size_t kIndexEntrySize = 16;
+
+// Numbers are encoded byte by byte so that the format does not depend on the byte order of the host
+template <typename T>
+void Put(std::string& buf, T v) {
+  for (size_t i = 0; i < sizeof(v); i++) {
+    buf.push_back(static_cast<char>(v >> (8 * i)));
+  }
+}
+
+template <typename T>
+T Take(const char*& p) {
+  T v = 0;
+  for (size_t i = 0; i < sizeof(v); i++) {
+    v |= static_cast<T>(static_cast<unsigned char>(p[i])) << (8 * i);
+  }
+  p += sizeof(v);
+  return v;
+}
+
+}  // namespace
+
+SnapshotWriter::SnapshotWriter(const std::string& path, uint32_t partition, uint32_t num_partitions,
+                               uint64_t sequence)
+    : path_(path),
+      partition_(partition),
+      num_partitions_(num_partitions),
+      sequence_(sequence),
+      num_chunk_records_(0),
+      offset_(kSnapshotHeaderSize),
+      num_records_(0) {
+  fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  CHECK_GE(fd_, 0) << "Cannot open snapshot file " << path << ": " << strerror(errno);
+  chunk_.reserve(kSnapshotChunkSize + (1 << 16));
+}
+
+SnapshotWriter::~SnapshotWriter() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+void SnapshotWriter::Add(std::string_view key, std::string_view value, const Metadata& metadata) {
+  Put(chunk_, static_cast<uint32_t>(key.size()));
+  Put(chunk_, static_cast<uint32_t>(value.size()));
+  Put(chunk_, metadata.master);
+  Put(chunk_, metadata.counter);
+  chunk_.append(key);
+  chunk_.append(value);
+  num_chunk_records_++;
+  num_records_++;
+  if (chunk_.size() >= kSnapshotChunkSize) {
+    FlushChunk();
+  }
+}
+
+void SnapshotWriter::Finish() {
+  CHECK_GE(fd_, 0) << "Snapshot is already finished";
+  FlushChunk();
+
+  std::string index;
+  for (const auto& chunk : chunks_) {
+    Put(index, chunk.offset);
+    Put(index, chunk.num_records);
+    Put(index, chunk.checksum);
+  }
+  auto index_offset = offset_;
+  WriteAll(index.data(), index.size(), index_offset);
+
+  std::string header(kSnapshotMagic, kMagicSize);
+  Put(header, kSnapshotVersion);
+  Put(header, partition_);
+  Put(header, num_partitions_);
+  Put(header, uint32_t{0});
+  Put(header, num_records_);
+  Put(header, static_cast<uint64_t>(index_offset));
+  Put(header, static_cast<uint64_t>(chunks_.size()));
+  Put(header, sequence_);
+  Put(header, uint32_t{0});
+  Put(header, Crc32c(header.data(), header.size()));
+  DCHECK_EQ(header.size(), kSnapshotHeaderSize);
+  WriteAll(header.data(), header.size(), 0);
+
+  CHECK_EQ(fsync(fd_), 0) << "Cannot sync snapshot file " << path_ << ": " << strerror(errno);
+  close(fd_);
+  fd_ = -1;
+}
+
+void SnapshotWriter::FlushChunk() {
+  if (chunk_.empty()) {
+    return;
+  }
+  chunks_.push_back({static_cast<uint64_t>(offset_), num_chunk_records_, Crc32c(chunk_.data(), chunk_.size())});
+  WriteAll(chunk_.data(), chunk_.size(), offset_);
+  offset_ += chunk_.size();
+  chunk_.clear();
+  num_chunk_records_ = 0;
+}
+
+void SnapshotWriter::WriteAll(const char* data, size_t size, off_t offset) {
+  while (size > 0) {
+    auto n = pwrite(fd_, data, size, offset);
+    if (n < 0) {
+      CHECK_EQ(errno, EINTR) << "Cannot write snapshot file " << path_ << ": " << strerror(errno);
+      continue;
+    }
+    data += n;
+    size -= n;
+    offset += n;
+  }
+}
+
+SnapshotReader::SnapshotReader(const std::string& path) : path_(path) {
+  fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  CHECK_GE(fd_, 0) << "Cannot open snapshot file " << path << ": " << strerror(errno);
+  struct stat st;
+  CHECK_EQ(fstat(fd_, &st), 0) << "Cannot stat snapshot file " << path << ": " << strerror(errno);
+  size_ = st.st_size;
+  CHECK_GE(size_, kSnapshotHeaderSize) << "Snapshot file " << path << " is truncated";
+
+  data_ = static_cast<const char*>(mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0));
+  CHECK(data_ != MAP_FAILED) << "Cannot map snapshot file " << path << ": " << strerror(errno);
+  // The chunks are read by many threads at once so read ahead as much as possible
+  madvise(const_cast<char*>(data_), size_, MADV_WILLNEED);
+
+  CHECK_EQ(memcmp(data_, kSnapshotMagic, kMagicSize), 0) << path << " is not a snapshot file";
+  const char* p = data_ + kMagicSize;
+  version_ = Take<uint32_t>(p);
+  CHECK_LE(version_, kSnapshotVersion) << "Snapshot file " << path << " has unsupported version " << version_;
+  partition_ = Take<uint32_t>(p);
+  num_partitions_ = Take<uint32_t>(p);
+  Take<uint32_t>(p);
+  num_records_ = Take<uint64_t>(p);
+  auto index_offset = Take<uint64_t>(p);
+  num_chunks_ = Take<uint64_t>(p);
+  sequence_ = Take<uint64_t>(p);
+  Take<uint32_t>(p);
+  auto checksum_end = p;
+  auto checksum = Take<uint32_t>(p);
+  CHECK_EQ(Crc32c(data_, checksum_end - data_), checksum) << "Header of snapshot file " << path << " is corrupted";
+  CHECK_GE(index_offset, kSnapshotHeaderSize) << "Header of snapshot file " << path << " is corrupted";
+  CHECK_LE(index_offset + num_chunks_ * kIndexEntrySize, size_) << "Snapshot file " << path << " is truncated";
+  index_ = data_ + index_offset;
+}
+
+SnapshotReader::~SnapshotReader() {
+  munmap(const_cast<char*>(data_), size_);
+  close(fd_);
+}
+
+const char* SnapshotReader::ChunkBegin(size_t chunk) const {
+  const char* p = index_ + chunk * kIndexEntrySize;
+  auto offset = Take<uint64_t>(p);
+  Take<uint32_t>(p);
+  auto checksum = Take<uint32_t>(p);
+  auto begin = data_ + offset;
+  auto end = ChunkEnd(chunk);
+  CHECK(offset >= kSnapshotHeaderSize && begin <= end && end <= index_)
+      << "Index of snapshot file " << path_ << " is corrupted";
+  CHECK_EQ(Crc32c(begin, end - begin), checksum)
+      << "Chunk " << chunk << " of snapshot file " << path_ << " is corrupted";
+  return begin;
+}
+
+const char* SnapshotReader::ChunkEnd(size_t chunk) const {
+  if (chunk + 1 == num_chunks_) {
+    return index_;
+  }
+  const char* p = index_ + (chunk + 1) * kIndexEntrySize;
+  return data_ + Take<uint64_t>(p);
+}
+
+}  // namespace slog
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <glog/logging.h>
+
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "common/types.h"
+
+namespace slog {
+
+/**
+ * A snapshot is a binary file containing the records of one partition. It is laid out so
+ * that it can be memory-mapped and loaded by many threads at once. All numbers are little-endian,
+ * regardless of the byte order of the host.
+ *
+ *   Header (64 bytes):
+ *     | magic "SLOGSNAP" (8) | version (4) | partition (4) | number of partitions (4) | reserved (4) |
+ *     | number of records (8) | index offset (8) | number of chunks (8) | sequence (8) |
+ *     | reserved (4) | checksum of the header (4) |
+ *   Records, grouped into chunks of about kSnapshotChunkSize bytes:
+ *     | key size (4) | value size (4) | master (4) | counter (4) | key | value |
+ *   Index, one entry per chunk:
+ *     | chunk offset (8) | number of records in the chunk (4) | checksum of the chunk (4) |
+ *
+ * Checksums are CRC-32C. The sequence is left to the writer, e.g. the log sequence
+ * number to replay the write-ahead log from when the snapshot is a checkpoint.
+ *
+ * tools/snapshot.py writes the same format.
+ */
+const char kSnapshotMagic[] = "SLOGSNAP";
+const uint32_t kSnapshotVersion = 1;
+const size_t kSnapshotHeaderSize = 64;
+const size_t kSnapshotChunkSize = 1 << 20;
+
+class SnapshotWriter {
+ public:
+  SnapshotWriter(const std::string& path, uint32_t partition = 0, uint32_t num_partitions = 1,
+                 uint64_t sequence = 0);
+  ~SnapshotWriter();
+
+  SnapshotWriter(const SnapshotWriter&) = delete;
+  SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+  void Add(std::string_view key, std::string_view value, const Metadata& metadata);
+  void Add(const Key& key, const Record& record) {
+    Add(key, std::string_view(record.data(), record.size()), record.metadata());
+  }
+
+  /**
+   * Writes the index and the header then syncs the file. Nothing can be added afterwards
+   */
+  void Finish();
+
+  uint64_t num_records() const { return num_records_; }
+
+ private:
+  struct ChunkInfo {
+    uint64_t offset;
+    uint32_t num_records;
+    uint32_t checksum;
+  };
+
+  void FlushChunk();
+  void WriteAll(const char* data, size_t size, off_t offset);
+
+  std::string path_;
+  int fd_;
+  uint32_t partition_;
+  uint32_t num_partitions_;
+  uint64_t sequence_;
+  std::string chunk_;
+  uint32_t num_chunk_records_;
+  std::vector<ChunkInfo> chunks_;
+  off_t offset_;
+  uint64_t num_records_;
+};
+
+class SnapshotReader {
+ public:
+  /**
+   * Maps the snapshot at path into memory. Dies if the file is not a valid snapshot
+   */
+  explicit SnapshotReader(const std::string& path);
+  ~SnapshotReader();
+
+  SnapshotReader(const SnapshotReader&) = delete;
+  SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+  uint32_t version() const { return version_; }
+  uint32_t partition() const { return partition_; }
+  uint32_t num_partitions() const { return num_partitions_; }
+  uint64_t num_records() const { return num_records_; }
+  uint64_t sequence() const { return sequence_; }
+  size_t num_chunks() const { return num_chunks_; }
+
+  /**
+   * Calls fn(std::string_view key, std::string_view value, const Metadata& metadata) on every
+   * record in a chunk. The key and value point directly into the mapped file so they are only
+   * valid as long as the reader is alive. Dies if the chunk is corrupted.
+   */
+  template <typename Fn>
+  void ForEachInChunk(size_t chunk, Fn&& fn) const {
+    const char* p = ChunkBegin(chunk);
+    const char* end = ChunkEnd(chunk);
+    while (p < end) {
+      CHECK_LE(kRecordHeaderSize, static_cast<size_t>(end - p))
+          << "Chunk " << chunk << " of snapshot file " << path_ << " is corrupted";
+      auto key_size = DecodeUint32(p);
+      auto value_size = DecodeUint32(p + 4);
+      Metadata metadata(DecodeUint32(p + 8), DecodeUint32(p + 12));
+      p += kRecordHeaderSize;
+      CHECK_LE(uint64_t{key_size} + value_size, static_cast<uint64_t>(end - p))
+          << "Chunk " << chunk << " of snapshot file " << path_ << " is corrupted";
+      std::string_view key(p, key_size);
+      p += key_size;
+      std::string_view value(p, value_size);
+      p += value_size;
+      fn(key, value, metadata);
+    }
+  }
+
+  /**
+   * Calls fn on every record using num_threads threads, each taking one chunk at a time.
+   * fn must be thread-safe.
+   */
+  template <typename Fn>
+  void ParallelForEach(uint32_t num_threads, Fn&& fn) const {
+    std::atomic<size_t> next_chunk = 0;
+    auto Work = [this, &next_chunk, &fn] {
+      for (auto c = next_chunk++; c < num_chunks_; c = next_chunk++) {
+        ForEachInChunk(c, fn);
+      }
+    };
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < num_threads; i++) {
+      threads.emplace_back(Work);
+    }
+    Work();
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+
+ private:
+  static constexpr size_t kRecordHeaderSize = 16;
+
+  static uint32_t DecodeUint32(const char* p) {
+    auto u = reinterpret_cast<const unsigned char*>(p);
+    return uint32_t{u[0]} | uint32_t{u[1]} << 8 | uint32_t{u[2]} << 16 | uint32_t{u[3]} << 24;
+  }
+
+  // Verifies the checksum of the chunk before returning its beginning
+  const char* ChunkBegin(size_t chunk) const;
+  const char* ChunkEnd(size_t chunk) const;
+
+  std::string path_;
+  int fd_;
+  const char* data_;
+  size_t size_;
+  uint32_t version_;
+  uint32_t partition_;
+  uint32_t num_partitions_;
+  uint64_t num_records_;
+  uint64_t sequence_;
+  const char* index_;
+  size_t num_chunks_;
+};
+
+}  // namespace slog
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <functional>
+
 #include "common/types.h"
 
 namespace slog {
@@ -7,11 +9,24 @@ namespace slog {
 class Storage {
  public:
   virtual ~Storage() = default;
+  // The value of the result shares its buffer with the stored record instead of being copied
   virtual bool Read(const Key& key, Record& result) const = 0;
+  // Only reads the metadata of a record
+  virtual bool ReadMetadata(const Key& key, Metadata& metadata) const {
+    Record record;
+    if (!Read(key, record)) {
+      return false;
+    }
+    metadata = record.metadata();
+    return true;
+  }
   // Returns true if key exists
   virtual bool Write(const Key& key, const Record& record) = 0;
   virtual bool Write(const Key& key, Record&& record) { return Write(key, record); };
   virtual bool Delete(const Key& key) = 0;
+  // Atomically replaces the record of key with the result of calling updater on a copy of it, or on an
+  // empty record if key does not exist. Returns true if key exists
+  virtual bool Update(const Key& key, const std::function<void(Record&)>& updater) = 0;
 };
 
 }  // namespace slog
\ No newline at end of file
@@ -0,0 +1,404 @@
+#include "storage/write_ahead_log.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace slog {
+
+namespace {
+
+const char kSegmentPrefix[] = "wal.";
+// Prefix given to the segments that cannot be replayed because of missing or corrupted entries before them
+const char kDiscardedSegmentPrefix[] = "discarded.";
+// A new segment is started once the current one grows past this size
+const size_t kMaxSegmentSize = 64 * 1024 * 1024;
+// Alignment of the offset, size, and memory address of a write with O_DIRECT
+const size_t kBlockSize = 4096;
+
+/**
+ * An entry is laid out as follows. Numbers are in host byte order.
+ *
+ *   | body size (4) | checksum of body (4) | type (1) | key size (4) | key |
+ *   | master (4) | counter (4) | value size (4) | value | lsn (8) |
+ *
+ * The metadata and value are only present in a WRITE entry. The LSN comes last so that
+ * the rest of the entry can be encoded before the LSN is assigned. A body size of 0 marks
+ * the end of the segment.
+ */
+const size_t kEntryHeaderSize = 8;
+
+template <typename T>
+void Put(std::string& buf, T v) {
+  buf.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+template <typename T>
+bool Get(const char*& p, const char* end, T& v) {
+  if (end - p < static_cast<ptrdiff_t>(sizeof(v))) {
+    return false;
+  }
+  memcpy(&v, p, sizeof(v));
+  p += sizeof(v);
+  return true;
+}
+
+std::string MakeSegmentName(uint64_t first_lsn) {
+  auto lsn_str = std::to_string(first_lsn);
+  // Pad the LSN so that the segments are sorted by name
+  return kSegmentPrefix + std::string(20 - lsn_str.size(), '0') + lsn_str;
+}
+
+// Returns pairs of (first LSN, path) sorted by first LSN
+std::vector<std::pair<uint64_t, std::string>> ListSegments(const std::string& dir) {
+  std::vector<std::pair<uint64_t, std::string>> segments;
+  auto d = opendir(dir.c_str());
+  if (d == nullptr) {
+    return segments;
+  }
+  const size_t prefix_len = strlen(kSegmentPrefix);
+  while (auto ent = readdir(d)) {
+    std::string name(ent->d_name);
+    if (name.compare(0, prefix_len, kSegmentPrefix) == 0) {
+      segments.emplace_back(std::stoull(name.substr(prefix_len)), dir + "/" + name);
+    }
+  }
+  closedir(d);
+  std::sort(segments.begin(), segments.end());
+  return segments;
+}
+
+// Renames the segments from the given index on so that they are never replayed. Otherwise, their entries
+// would be replayed on top of the newer entries written after the point where replaying stopped
+void DiscardSegments(const std::string& dir, const std::vector<std::pair<uint64_t, std::string>>& segments,
+                     size_t from) {
+  for (size_t i = from; i < segments.size(); i++) {
+    auto new_path = dir + "/" + kDiscardedSegmentPrefix + MakeSegmentName(segments[i].first);
+    CHECK_EQ(rename(segments[i].second.c_str(), new_path.c_str()), 0)
+        << "Cannot discard log segment " << segments[i].second << ": " << strerror(errno);
+    LOG(WARNING) << "Discarded log segment " << segments[i].second;
+  }
+  if (from < segments.size()) {
+    SyncDir(dir);
+  }
+}
+
+bool ReadFile(const std::string& path, std::string& content) {
+  auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  content.clear();
+  char buf[1 << 16];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) != 0) {
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      close(fd);
+      return false;
+    }
+    content.append(buf, n);
+  }
+  close(fd);
+  return true;
+}
+
+}  // namespace
+
+void SyncDir(const std::string& dir) {
+  auto fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  CHECK_GE(fd, 0) << "Cannot open directory " << dir << ": " << strerror(errno);
+  fsync(fd);
+  close(fd);
+}
+
+uint32_t Crc32c(const char* data, size_t size, uint32_t crc) {
+  static const auto kTable = [] {
+    std::array<uint32_t, 256> table;
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) ? (c >> 1) ^ 0x82F63B78 : c >> 1;
+      }
+      table[i] = c;
+    }
+    return table;
+  }();
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++) {
+    crc = kTable[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+uint64_t WriteAheadLog::Replay(const std::string& dir, uint64_t from_lsn, const std::function<void(Entry&&)>& fn) {
+  auto segments = ListSegments(dir);
+  uint64_t next_lsn = from_lsn;
+  bool replayed_any_segment = false;
+  std::string content;
+  for (size_t i = 0; i < segments.size(); i++) {
+    const auto& [first_lsn, path] = segments[i];
+    // Skip the segments that only contain entries below from_lsn
+    if (i + 1 < segments.size() && segments[i + 1].first <= from_lsn) {
+      continue;
+    }
+    // The first replayed segment may start before from_lsn but every other segment must start
+    // right after the last replayed entry
+    if (first_lsn > next_lsn) {
+      LOG(ERROR) << "Missing log entries from " << next_lsn << " to " << first_lsn - 1 << ". Stop replaying";
+      DiscardSegments(dir, segments, i);
+      break;
+    }
+    if (replayed_any_segment && first_lsn < next_lsn) {
+      LOG(ERROR) << "Log segment starting at " << first_lsn << " overlaps with the replayed entries up to "
+                 << next_lsn - 1 << ". Stop replaying";
+      DiscardSegments(dir, segments, i);
+      break;
+    }
+    replayed_any_segment = true;
+    CHECK(ReadFile(path, content)) << "Cannot read log segment " << path << ": " << strerror(errno);
+
+    auto expected_lsn = first_lsn;
+    const char* p = content.data();
+    const char* end = p + content.size();
+    for (;;) {
+      uint32_t body_size, checksum;
+      if (!Get(p, end, body_size) || body_size < sizeof(uint64_t) || !Get(p, end, checksum) ||
+          end - p < static_cast<ptrdiff_t>(body_size) || Crc32c(p, body_size) != checksum) {
+        break;
+      }
+      Entry entry;
+      const char* body_end = p + body_size - sizeof(entry.lsn);
+      memcpy(&entry.lsn, body_end, sizeof(entry.lsn));
+      uint8_t type;
+      uint32_t key_size, master, counter, value_size;
+      if (entry.lsn != expected_lsn || !Get(p, body_end, type) || !Get(p, body_end, key_size) ||
+          body_end - p < static_cast<ptrdiff_t>(key_size)) {
+        break;
+      }
+      entry.type = static_cast<EntryType>(type);
+      entry.key.assign(p, key_size);
+      p += key_size;
+      if (entry.type == EntryType::WRITE) {
+        if (!Get(p, body_end, master) || !Get(p, body_end, counter) || !Get(p, body_end, value_size) ||
+            body_end - p < static_cast<ptrdiff_t>(value_size)) {
+          break;
+        }
+        entry.record.SetValue(p, value_size);
+        entry.record.SetMetadata(Metadata(master, counter));
+      }
+      p = body_end + sizeof(entry.lsn);
+      expected_lsn++;
+      if (entry.lsn >= from_lsn) {
+        fn(std::move(entry));
+      }
+    }
+    next_lsn = std::max(next_lsn, expected_lsn);
+  }
+  return next_lsn;
+}
+
+WriteAheadLog::WriteAheadLog(const std::string& dir, uint64_t next_lsn, bool use_direct_io,
+                             std::chrono::microseconds group_commit_interval)
+    : dir_(dir),
+      use_direct_io_(use_direct_io),
+      group_commit_interval_(group_commit_interval),
+      next_lsn_(next_lsn),
+      durable_lsn_(next_lsn),
+      stop_(false),
+      fd_(-1),
+      aligned_buffer_(nullptr),
+      aligned_buffer_capacity_(0),
+      partial_block_size_(0),
+      num_flushes_(0),
+      num_flushed_bytes_(0) {
+  OpenSegment(next_lsn);
+  flusher_ = std::thread(&WriteAheadLog::RunFlusher, this);
+}
+
+WriteAheadLog::~WriteAheadLog() {
+  {
+    std::lock_guard<std::mutex> lock(mut_);
+    stop_ = true;
+  }
+  flusher_cv_.notify_one();
+  flusher_.join();
+  close(fd_);
+  free(aligned_buffer_);
+}
+
+uint64_t WriteAheadLog::AppendWrite(const Key& key, const Record& record) {
+  return Append(EntryType::WRITE, key, &record);
+}
+
+uint64_t WriteAheadLog::AppendDelete(const Key& key) { return Append(EntryType::DELETE, key, nullptr); }
+
+uint64_t WriteAheadLog::Append(EntryType type, const Key& key, const Record* record) {
+  // Encode everything but the LSN outside of the critical section
+  thread_local std::string entry;
+  entry.clear();
+  Put(entry, uint32_t(0));
+  Put(entry, uint32_t(0));
+  Put(entry, static_cast<uint8_t>(type));
+  Put(entry, static_cast<uint32_t>(key.size()));
+  entry.append(key);
+  if (record != nullptr) {
+    Put(entry, record->metadata().master);
+    Put(entry, record->metadata().counter);
+    Put(entry, static_cast<uint32_t>(record->size()));
+    entry.append(record->data(), record->size());
+  }
+  uint32_t body_size = entry.size() - kEntryHeaderSize + sizeof(uint64_t);
+  memcpy(entry.data(), &body_size, sizeof(body_size));
+  auto partial_checksum = Crc32c(entry.data() + kEntryHeaderSize, entry.size() - kEntryHeaderSize);
+
+  uint64_t lsn;
+  bool was_empty;
+  {
+    std::lock_guard<std::mutex> lock(mut_);
+    lsn = next_lsn_++;
+    was_empty = pending_.empty();
+
+    uint32_t checksum = Crc32c(reinterpret_cast<const char*>(&lsn), sizeof(lsn), partial_checksum);
+    memcpy(entry.data() + sizeof(body_size), &checksum, sizeof(checksum));
+    pending_.append(entry);
+    Put(pending_, lsn);
+  }
+
+  // The flusher only waits when there is nothing to flush
+  if (was_empty) {
+    flusher_cv_.notify_one();
+  }
+  return lsn;
+}
+
+void WriteAheadLog::WaitForDurable(uint64_t lsn) {
+  std::unique_lock<std::mutex> lock(mut_);
+  durable_cv_.wait(lock, [this, lsn] { return durable_lsn_ > lsn; });
+}
+
+uint64_t WriteAheadLog::next_lsn() const {
+  std::lock_guard<std::mutex> lock(mut_);
+  return next_lsn_;
+}
+
+void WriteAheadLog::Truncate(uint64_t lsn) {
+  auto segments = ListSegments(dir_);
+  // The last segment is never removed since it may be the one being written
+  for (size_t i = 0; i + 1 < segments.size(); i++) {
+    if (segments[i + 1].first <= lsn) {
+      unlink(segments[i].second.c_str());
+    }
+  }
+}
+
+void WriteAheadLog::RunFlusher() {
+  std::string data;
+  for (;;) {
+    uint64_t first_lsn, end_lsn;
+    {
+      std::unique_lock<std::mutex> lock(mut_);
+      flusher_cv_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+      if (pending_.empty()) {
+        return;
+      }
+      // Give other writers a chance to join this flush
+      if (group_commit_interval_.count() > 0 && !stop_) {
+        flusher_cv_.wait_for(lock, group_commit_interval_, [this] { return stop_; });
+      }
+      data.clear();
+      data.swap(pending_);
+      first_lsn = durable_lsn_;
+      end_lsn = next_lsn_;
+    }
+
+    if (segment_size_ >= kMaxSegmentSize) {
+      close(fd_);
+      OpenSegment(first_lsn);
+    }
+    Flush(data);
+
+    {
+      std::lock_guard<std::mutex> lock(mut_);
+      durable_lsn_ = end_lsn;
+    }
+    durable_cv_.notify_all();
+  }
+}
+
+void WriteAheadLog::Flush(const std::string& data) {
+  if (use_direct_io_) {
+    auto total_size = partial_block_size_ + data.size();
+    auto padded_size = (total_size + kBlockSize - 1) / kBlockSize * kBlockSize;
+    if (padded_size > aligned_buffer_capacity_) {
+      void* new_buffer;
+      CHECK_EQ(posix_memalign(&new_buffer, kBlockSize, padded_size), 0) << "Cannot allocate aligned buffer";
+      memcpy(new_buffer, aligned_buffer_, partial_block_size_);
+      free(aligned_buffer_);
+      aligned_buffer_ = static_cast<char*>(new_buffer);
+      aligned_buffer_capacity_ = padded_size;
+    }
+    memcpy(aligned_buffer_ + partial_block_size_, data.data(), data.size());
+    // The zero padding reads as the end of the segment
+    memset(aligned_buffer_ + total_size, 0, padded_size - total_size);
+    WriteAll(aligned_buffer_, padded_size, file_offset_);
+
+    // Keep the last partial block so that it is rewritten together with the next entries
+    auto full_blocks_size = total_size / kBlockSize * kBlockSize;
+    partial_block_size_ = total_size - full_blocks_size;
+    memmove(aligned_buffer_, aligned_buffer_ + full_blocks_size, partial_block_size_);
+    file_offset_ += full_blocks_size;
+  } else {
+    WriteAll(data.data(), data.size(), file_offset_);
+    file_offset_ += data.size();
+  }
+  CHECK_EQ(fdatasync(fd_), 0) << "Cannot sync log segment: " << strerror(errno);
+
+  segment_size_ += data.size();
+  num_flushes_.fetch_add(1, std::memory_order_relaxed);
+  num_flushed_bytes_.fetch_add(data.size(), std::memory_order_relaxed);
+}
+
+void WriteAheadLog::OpenSegment(uint64_t first_lsn) {
+  auto path = dir_ + "/" + MakeSegmentName(first_lsn);
+  int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+  if (use_direct_io_) {
+    fd_ = open(path.c_str(), flags | O_DIRECT, 0644);
+    if (fd_ < 0 && errno == EINVAL) {
+      LOG(WARNING) << "O_DIRECT is not supported for " << path << ". Falling back to buffered I/O";
+      fd_ = open(path.c_str(), flags, 0644);
+    }
+  } else {
+    fd_ = open(path.c_str(), flags, 0644);
+  }
+  CHECK_GE(fd_, 0) << "Cannot open log segment " << path << ": " << strerror(errno);
+  // Make sure that the new segment can be found after a crash
+  SyncDir(dir_);
+  file_offset_ = 0;
+  segment_size_ = 0;
+  partial_block_size_ = 0;
+}
+
+void WriteAheadLog::WriteAll(const char* data, size_t size, off_t offset) {
+  while (size > 0) {
+    auto n = pwrite(fd_, data, size, offset);
+    if (n < 0) {
+      CHECK_EQ(errno, EINTR) << "Cannot write to log segment: " << strerror(errno);
+      continue;
+    }
+    data += n;
+    size -= n;
+    offset += n;
+  }
+}
+
+}  // namespace slog
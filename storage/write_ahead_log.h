@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "common/types.h"
+
+namespace slog {
+
+/**
+ * CRC-32C of a buffer. Used to detect torn or corrupted entries in the log and snapshots
+ */
+uint32_t Crc32c(const char* data, size_t size, uint32_t crc = 0);
+
+/**
+ * Makes the creation, removal, or renaming of files in a directory durable
+ */
+void SyncDir(const std::string& dir);
+
+/**
+ * A redo log of the writes to the storage. Each entry is assigned a log sequence
+ * number (LSN) in the order it is appended.
+ *
+ * Appending an entry only copies it into an in-memory buffer. A flusher thread
+ * writes out everything accumulated in the buffer and syncs it with a single
+ * fdatasync (group commit), then wakes up the threads waiting for their entries
+ * to be durable. Optionally, the log bypasses the page cache with O_DIRECT, in
+ * which case the writes are padded to whole blocks and the last partial block is
+ * rewritten in the next flush.
+ *
+ * The log is split into segment files named after the LSN of their first entry.
+ * Segments whose entries are all covered by a checkpoint can be removed with Truncate.
+ */
+class WriteAheadLog {
+ public:
+  enum class EntryType : uint8_t { WRITE = 0, DELETE = 1 };
+
+  struct Entry {
+    uint64_t lsn;
+    EntryType type;
+    Key key;
+    Record record;
+  };
+
+  /**
+   * Calls fn on every entry whose LSN is at least from_lsn in the log at dir, in LSN order.
+   * Replaying stops at the first torn or corrupted entry. If entries are missing after that
+   * point, the remaining segments are discarded so that they are not replayed after the entries
+   * appended from the returned LSN on.
+   *
+   * @return the LSN following the last replayed entry, or from_lsn if nothing is replayed
+   */
+  static uint64_t Replay(const std::string& dir, uint64_t from_lsn, const std::function<void(Entry&&)>& fn);
+
+  /**
+   * Opens a new segment in dir whose first entry will have LSN next_lsn
+   */
+  WriteAheadLog(const std::string& dir, uint64_t next_lsn, bool use_direct_io = false,
+                std::chrono::microseconds group_commit_interval = std::chrono::microseconds(0));
+
+  /**
+   * Flushes all appended entries before returning
+   */
+  ~WriteAheadLog();
+
+  WriteAheadLog(const WriteAheadLog&) = delete;
+  WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+  /**
+   * Thread-safe
+   *
+   * @return LSN of the appended entry
+   */
+  uint64_t AppendWrite(const Key& key, const Record& record);
+  uint64_t AppendDelete(const Key& key);
+
+  /**
+   * Blocks until the entry with the given LSN and all entries before it are durable
+   */
+  void WaitForDurable(uint64_t lsn);
+
+  /**
+   * Removes the segments that only contain entries with LSN below lsn
+   */
+  void Truncate(uint64_t lsn);
+
+  /* LSN that will be assigned to the next appended entry */
+  uint64_t next_lsn() const;
+  uint64_t num_flushes() const { return num_flushes_.load(std::memory_order_relaxed); }
+  uint64_t num_flushed_bytes() const { return num_flushed_bytes_.load(std::memory_order_relaxed); }
+
+ private:
+  uint64_t Append(EntryType type, const Key& key, const Record* record);
+  void RunFlusher();
+  void Flush(const std::string& data);
+  void OpenSegment(uint64_t first_lsn);
+  void WriteAll(const char* data, size_t size, off_t offset);
+
+  const std::string dir_;
+  const bool use_direct_io_;
+  const std::chrono::microseconds group_commit_interval_;
+
+  mutable std::mutex mut_;
+  std::condition_variable flusher_cv_;
+  std::condition_variable durable_cv_;
+  // Entries that have been appended but not flushed yet. Protected by mut_
+  std::string pending_;
+  uint64_t next_lsn_;
+  // All entries with LSN below this are durable. Protected by mut_
+  uint64_t durable_lsn_;
+  bool stop_;
+
+  // Owned by the flusher thread
+  int fd_;
+  off_t file_offset_;
+  size_t segment_size_;
+  // With O_DIRECT, the block-aligned buffer to write from and the number of bytes
+  // at its beginning belonging to the last partial block written
+  char* aligned_buffer_;
+  size_t aligned_buffer_capacity_;
+  size_t partial_block_size_;
+
+  std::atomic<uint64_t> num_flushes_;
+  std::atomic<uint64_t> num_flushed_bytes_;
+
+  std::thread flusher_;
+};
+
+}  // namespace slog
@@ -0,0 +1,112 @@
+#include "common/arena.h"
+
+#include <gtest/gtest.h>
+
+#include "common/proto_utils.h"
+#include "common/txn_holder.h"
+#include "test/test_utils.h"
+
+using namespace std;
+using namespace slog;
+
+using google::protobuf::Arena;
+
+namespace {
+
+int num_freed_blocks = 0;
+
+void CountingDealloc(void* block, size_t) {
+  num_freed_blocks++;
+  free(block);
+}
+
+Arena* NewCountingArena() {
+  google::protobuf::ArenaOptions options;
+  options.block_alloc = malloc;
+  options.block_dealloc = CountingDealloc;
+  return new Arena(options);
+}
+
+}  // namespace
+
+class ArenaTest : public ::testing::Test {
+ protected:
+  void SetUp() { num_freed_blocks = 0; }
+};
+
+TEST_F(ArenaTest, EnvelopeOwnsArena) {
+  EnvelopePtr env(Arena::CreateMessage<internal::Envelope>(NewCountingArena()));
+  env->mutable_request()->mutable_forward_batch_data()->add_batch_data()->set_id(100);
+  env.reset();
+  ASSERT_GT(num_freed_blocks, 0);
+}
+
+TEST_F(ArenaTest, HeapEnvelope) {
+  EnvelopePtr env = std::make_unique<internal::Envelope>();
+  env->mutable_request()->mutable_forward_batch_data()->add_batch_data()->set_id(100);
+  env.reset();
+  ASSERT_EQ(num_freed_blocks, 0);
+}
+
+TEST_F(ArenaTest, UnbatchKeepsTxnsOnArena) {
+  auto arena = NewCountingArena();
+  BatchPtr batch(Arena::CreateMessage<internal::Batch>(arena));
+  batch->add_transactions()->mutable_internal()->set_id(1);
+  batch->add_transactions()->mutable_internal()->set_id(2);
+
+  auto txns = Unbatch(batch.get());
+  ASSERT_EQ(txns.size(), 2U);
+  ASSERT_EQ(txns[0]->internal().id(), 1U);
+  ASSERT_EQ(txns[1]->internal().id(), 2U);
+  for (auto txn : txns) {
+    ASSERT_EQ(txn->GetArena(), arena);
+  }
+  ASSERT_EQ(batch->transactions_size(), 0);
+}
+
+TEST_F(ArenaTest, PartitionedTxnOnArena) {
+  auto configs = MakeTestConfigurations("arena", 1, 2);
+  auto sharder = Sharder::MakeSharder(configs[0]);
+  auto txn = MakeTestTransaction(configs[0], 1000, {{"A", KeyType::READ, {{0, 0}}}, {"B", KeyType::WRITE, {{0, 0}}}});
+  auto arena = std::unique_ptr<Arena>(NewCountingArena());
+  for (auto p : txn->internal().involved_partitions()) {
+    auto new_txn = GeneratePartitionedTxn(sharder, txn, p, false /* in_place */, arena.get());
+    ASSERT_NE(new_txn, nullptr);
+    ASSERT_EQ(new_txn->GetArena(), arena.get());
+    ASSERT_EQ(new_txn->keys_size(), 1);
+  }
+  delete txn;
+}
+
+TEST_F(ArenaTest, TxnHoldersShareArena) {
+  auto configs = MakeTestConfigurations("arena", 2, 1);
+  ArenaPtr arena(NewCountingArena());
+  auto txn = MakeTestTransaction(configs[0], 1000, {{"A", KeyType::READ, {{0, 0}}}, {"B", KeyType::WRITE, {{1, 0}}}});
+  auto lo_txn_0 = Arena::CreateMessage<Transaction>(arena.get());
+  lo_txn_0->CopyFrom(*GenerateLockOnlyTxn(txn, 0, true /* in_place */));
+  auto other_txn = Arena::CreateMessage<Transaction>(arena.get());
+  other_txn->CopyFrom(*lo_txn_0);
+  other_txn->mutable_internal()->set_id(2000);
+  delete txn;
+
+  auto holder1 = make_unique<TxnHolder>(configs[0], lo_txn_0, arena);
+  auto holder2 = make_unique<TxnHolder>(configs[0], other_txn, arena);
+  arena.reset();
+
+  // Releasing a txn does not free its arena
+  auto released_txn = holder1->Release();
+  ASSERT_EQ(released_txn->internal().id(), 1000U);
+  released_txn.reset();
+  holder1.reset();
+  ASSERT_EQ(num_freed_blocks, 0);
+
+  // The arena is freed once the holders of all txns on it are destroyed
+  holder2.reset();
+  ASSERT_GT(num_freed_blocks, 0);
+}
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  google::InstallFailureSignalHandler();
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,127 @@
+#include "common/proto_utils.h"
+
+#include <gtest/gtest.h>
+
+#include "test/test_utils.h"
+
+using namespace std;
+using namespace slog;
+
+using google::protobuf::Arena;
+
+namespace {
+
+// Generates the partitioned txns one partition at a time for comparison
+vector<Transaction*> GeneratePartitionedTxnsOneByOne(const SharderPtr& sharder, const Transaction& txn) {
+  vector<Transaction*> partitioned_txns(sharder->num_partitions(), nullptr);
+  for (uint32_t p = 0; p < sharder->num_partitions(); p++) {
+    partitioned_txns[p] = GeneratePartitionedTxn(sharder, new Transaction(txn), p, true /* in_place */);
+  }
+  return partitioned_txns;
+}
+
+void CheckPartitionedTxns(const SharderPtr& sharder, Transaction* txn) {
+  auto expected = GeneratePartitionedTxnsOneByOne(sharder, *txn);
+  Arena arena;
+  auto actual = GeneratePartitionedTxns(sharder, txn, &arena);
+
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t p = 0; p < expected.size(); p++) {
+    if (expected[p] == nullptr) {
+      ASSERT_EQ(actual[p], nullptr);
+      continue;
+    }
+    ASSERT_NE(actual[p], nullptr);
+    ASSERT_EQ(*actual[p], *expected[p]);
+    const auto& actual_replicas = actual[p]->internal().involved_replicas();
+    const auto& expected_replicas = expected[p]->internal().involved_replicas();
+    ASSERT_EQ(vector<uint32_t>(actual_replicas.begin(), actual_replicas.end()),
+              vector<uint32_t>(expected_replicas.begin(), expected_replicas.end()));
+    for (int i = 0; i < actual[p]->keys_size(); i++) {
+      const auto& kv = actual[p]->keys(i);
+      ASSERT_EQ(kv.key(), expected[p]->keys(i).key());
+      ASSERT_EQ(kv.value_entry().partition_optional_case(), ValueEntry::kPartition);
+      ASSERT_EQ(kv.value_entry().partition(), p);
+      ASSERT_EQ(sharder->compute_partition(kv.key()), p);
+    }
+    delete expected[p];
+  }
+
+  // The original txn is reused for one of the partitions
+  int num_heap_txns = 0;
+  for (auto partitioned_txn : actual) {
+    if (partitioned_txn != nullptr && partitioned_txn->GetArena() == nullptr) {
+      num_heap_txns++;
+      delete partitioned_txn;
+    }
+  }
+  ASSERT_LE(num_heap_txns, 1);
+}
+
+}  // namespace
+
+TEST(ProtoUtilsTest, PopulateInvolvedPartitionsCachesPartitions) {
+  auto configs = MakeTestConfigurations("proto_utils", 1, 4);
+  auto sharder = Sharder::MakeSharder(configs[0]);
+  auto txn = MakeTestTransaction(configs[0], 1000, {{"A", KeyType::READ}, {"B", KeyType::WRITE}, {"C"}, {"D"}});
+  for (const auto& kv : txn->keys()) {
+    ASSERT_EQ(kv.value_entry().partition_optional_case(), ValueEntry::kPartition);
+    ASSERT_EQ(kv.value_entry().partition(), sharder->compute_partition(kv.key()));
+    ASSERT_EQ(KeyPartition(sharder, kv), kv.value_entry().partition());
+  }
+  delete txn;
+}
+
+TEST(ProtoUtilsTest, PartitionedTxnsSingleHome) {
+  auto configs = MakeTestConfigurations("proto_utils", 1, 3);
+  auto sharder = Sharder::MakeSharder(configs[0]);
+  vector<KeyMetadata> keys;
+  for (int i = 0; i < 20; i++) {
+    keys.emplace_back("key" + to_string(i), i % 2 ? KeyType::READ : KeyType::WRITE, 0);
+  }
+  CheckPartitionedTxns(sharder, MakeTestTransaction(configs[0], 1000, keys));
+}
+
+TEST(ProtoUtilsTest, PartitionedTxnsLockOnly) {
+  auto configs = MakeTestConfigurations("proto_utils", 3, 3);
+  auto sharder = Sharder::MakeSharder(configs[0]);
+  vector<KeyMetadata> keys;
+  for (int i = 0; i < 20; i++) {
+    keys.emplace_back("key" + to_string(i), KeyType::WRITE, i % 3);
+  }
+  auto txn = MakeTestTransaction(configs[0], 1000, keys);
+  ASSERT_EQ(txn->internal().type(), TransactionType::MULTI_HOME_OR_LOCK_ONLY);
+  // Some partitions have no key mastered at the home of the lock-only txn
+  CheckPartitionedTxns(sharder, GenerateLockOnlyTxn(txn, 1, true /* in_place */));
+}
+
+TEST(ProtoUtilsTest, PartitionedTxnsNoRelevantKey) {
+  auto configs = MakeTestConfigurations("proto_utils", 2, 2);
+  auto sharder = Sharder::MakeSharder(configs[0]);
+  auto txn = MakeTestTransaction(configs[0], 1000, {{"A", KeyType::WRITE, 0}, {"B", KeyType::WRITE, 1}});
+  // Lock-only txn for a region where no key is mastered
+  txn->mutable_internal()->set_home(2);
+  Arena arena;
+  auto partitioned_txns = GeneratePartitionedTxns(sharder, txn, &arena);
+  ASSERT_EQ(partitioned_txns.size(), 2U);
+  ASSERT_EQ(partitioned_txns[0], nullptr);
+  ASSERT_EQ(partitioned_txns[1], nullptr);
+}
+
+TEST(ProtoUtilsTest, MergeTransactionFillsMissingMetadata) {
+  auto configs = MakeTestConfigurations("proto_utils", 1, 2);
+  auto txn = MakeTestTransaction(configs[0], 1000, {{"A", KeyType::READ, 1}, {"B", KeyType::WRITE, 0}});
+  Transaction other(*txn);
+  // A is read remotely in txn, B is read remotely in other
+  txn->mutable_keys(0)->mutable_value_entry()->clear_metadata();
+  other.mutable_keys(1)->mutable_value_entry()->clear_metadata();
+
+  MergeTransaction(*txn, other);
+
+  ASSERT_EQ(txn->keys_size(), 2);
+  ASSERT_TRUE(txn->keys(0).value_entry().has_metadata());
+  ASSERT_EQ(txn->keys(0).value_entry().metadata().master(), 1U);
+  ASSERT_TRUE(txn->keys(1).value_entry().has_metadata());
+  ASSERT_EQ(txn->keys(1).value_entry().metadata().master(), 0U);
+  delete txn;
+}
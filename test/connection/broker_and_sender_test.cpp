@@ -85,6 +85,158 @@ TEST(BrokerAndSenderTest, PingPong) {
   pong.join();
 }
 
+TEST(BrokerTest, RawChannel) {
+  const Channel RAW = 8;
+  ConfigVec configs = MakeTestConfigurations("raw_channel", 1, 2);
+  auto broker = Broker::New(configs[0], kTestModuleTimeout);
+  broker->AddChannel(RAW, true /* send_raw */);
+  broker->StartInNewThreads();
+
+  auto socket = MakePullSocket(*broker->context(), RAW);
+
+  auto sender_broker = Broker::New(configs[1], kTestModuleTimeout);
+  Sender sender(sender_broker->config(), sender_broker->context());
+  sender.Send(*MakePing(99), configs[0]->MakeMachineId(0, 0), RAW);
+
+  // The message is passed on in serialized form
+  zmq::message_t msg;
+  ASSERT_TRUE(socket.recv(msg));
+  ASSERT_GE(msg.size(), kFrameHeaderSize);
+  auto env = DeserializeEnvelope(msg);
+  ASSERT_TRUE(env != nullptr);
+  ASSERT_EQ(env->from(), configs[1]->local_machine_id());
+  ASSERT_EQ(99, env->request().ping().time());
+
+  // RecvEnvelope deserializes it
+  sender.Send(*MakePing(100), configs[0]->MakeMachineId(0, 0), RAW);
+  env = RecvEnvelope(socket, false /* dont_wait */, true /* on_arena */);
+  ASSERT_TRUE(env != nullptr);
+  ASSERT_TRUE(env->GetArena() != nullptr);
+  ASSERT_EQ(env->from(), configs[1]->local_machine_id());
+  ASSERT_EQ(100, env->request().ping().time());
+}
+
+TEST(BrokerTest, CoalescedMessages) {
+  const Channel PING = 8;
+  const Channel RAW = 9;
+  internal::Configuration common_config;
+  common_config.set_message_coalescing_max_bytes(1000);
+  common_config.set_message_coalescing_max_delay_us(100000);
+  ConfigVec configs = MakeTestConfigurations("coalesced", 1, 2, common_config);
+  auto broker = Broker::New(configs[0], kTestModuleTimeout);
+  broker->AddChannel(PING);
+  broker->AddChannel(RAW, true /* send_raw */);
+  broker->StartInNewThreads();
+
+  auto ping_socket = MakePullSocket(*broker->context(), PING);
+  auto raw_socket = MakePullSocket(*broker->context(), RAW);
+  ping_socket.set(zmq::sockopt::rcvtimeo, 1000);
+  raw_socket.set(zmq::sockopt::rcvtimeo, 1000);
+
+  auto sender_broker = Broker::New(configs[1], kTestModuleTimeout);
+  Sender sender(sender_broker->config(), sender_broker->context(), true /* coalescing */);
+  auto dest = configs[0]->MakeMachineId(0, 0);
+
+  // The broker unpacks the coalesced frame and passes each message on to its channel in order
+  for (int i = 0; i < 10; i++) {
+    sender.Send(*MakePing(i), dest, i % 2 == 0 ? PING : RAW);
+  }
+  ASSERT_TRUE(sender.has_pending_messages());
+  sender.Flush();
+  ASSERT_FALSE(sender.has_pending_messages());
+  ASSERT_EQ(sender.coalescing_stats().num_held_back, 10U);
+  ASSERT_EQ(sender.coalescing_stats().num_coalesced_frames, 1U);
+  ASSERT_EQ(sender.coalescing_stats().num_coalesced_msgs, 10U);
+  for (int i = 0; i < 10; i++) {
+    auto env = RecvEnvelope(i % 2 == 0 ? ping_socket : raw_socket);
+    ASSERT_TRUE(env != nullptr);
+    ASSERT_EQ(env->from(), configs[1]->local_machine_id());
+    ASSERT_EQ(env->request().ping().time(), i);
+  }
+
+  // The held back messages are sent when the next message does not fit
+  for (int i = 0; i < 100; i++) {
+    sender.Send(*MakePing(i), dest, PING);
+  }
+  for (int i = 0; i < 10; i++) {
+    auto env = RecvEnvelope(ping_socket);
+    ASSERT_TRUE(env != nullptr);
+    ASSERT_EQ(env->request().ping().time(), i);
+  }
+  sender.Flush();
+  for (int i = 10; i < 100; i++) {
+    auto env = RecvEnvelope(ping_socket);
+    ASSERT_TRUE(env != nullptr);
+    ASSERT_EQ(env->request().ping().time(), i);
+  }
+
+  // A message larger than a coalesced frame is sent on its own after the held back messages
+  Envelope large;
+  large.mutable_request()->mutable_remote_read_result()->set_abort_reason(string(2000, 'x'));
+  sender.Send(*MakePing(100), dest, PING);
+  sender.Send(large, dest, PING);
+  ASSERT_FALSE(sender.has_pending_messages());
+  auto env = RecvEnvelope(ping_socket);
+  ASSERT_TRUE(env != nullptr);
+  ASSERT_EQ(env->request().ping().time(), 100);
+  env = RecvEnvelope(ping_socket);
+  ASSERT_TRUE(env != nullptr);
+  ASSERT_EQ(env->request().remote_read_result().abort_reason().size(), 2000U);
+
+  // Only the messages that have waited longer than the max delay are sent
+  sender.Send(*MakePing(200), dest, PING);
+  sender.Flush(true /* expired_only */);
+  ASSERT_TRUE(sender.has_pending_messages());
+  this_thread::sleep_for(150ms);
+  sender.Flush(true /* expired_only */);
+  ASSERT_FALSE(sender.has_pending_messages());
+  env = RecvEnvelope(ping_socket);
+  ASSERT_TRUE(env != nullptr);
+  ASSERT_EQ(env->request().ping().time(), 200);
+}
+
+TEST(BrokerTest, CompressedCrossRegionMessages) {
+  const Channel PING = 8;
+  const Channel RAW = 9;
+  internal::Configuration common_config;
+  common_config.mutable_cross_region_compression()->set_codec(internal::CompressionCodec::ZSTD);
+  ConfigVec configs = MakeTestConfigurations("compressed", 2, 1, common_config);
+  auto broker = Broker::New(configs[0], kTestModuleTimeout);
+  broker->AddChannel(PING);
+  broker->AddChannel(RAW, true /* send_raw */);
+  broker->StartInNewThreads();
+
+  auto ping_socket = MakePullSocket(*broker->context(), PING);
+  auto raw_socket = MakePullSocket(*broker->context(), RAW);
+  ping_socket.set(zmq::sockopt::rcvtimeo, 1000);
+  raw_socket.set(zmq::sockopt::rcvtimeo, 1000);
+
+  auto sender_broker = Broker::New(configs[1], kTestModuleTimeout);
+  Sender sender(sender_broker->config(), sender_broker->context());
+  auto dest = configs[0]->MakeMachineId(0, 0);
+
+  Envelope large;
+  large.mutable_request()->mutable_remote_read_result()->set_abort_reason(string(2000, 'x'));
+  sender.Send(large, dest, PING);
+  sender.Send(large, {dest}, RAW);
+  // Small messages are sent uncompressed
+  sender.Send(*MakePing(1), dest, PING);
+
+  ASSERT_EQ(sender.compression_stats().num_compressed, 2U);
+  ASSERT_EQ(sender.compression_stats().num_uncompressed, 1U);
+  ASSERT_LT(sender.compression_stats().compressed_bytes, 100U);
+
+  for (auto socket : {&ping_socket, &raw_socket}) {
+    auto env = RecvEnvelope(*socket);
+    ASSERT_TRUE(env != nullptr);
+    ASSERT_EQ(env->from(), configs[1]->local_machine_id());
+    ASSERT_EQ(env->request().remote_read_result().abort_reason(), string(2000, 'x'));
+  }
+  auto env = RecvEnvelope(ping_socket);
+  ASSERT_TRUE(env != nullptr);
+  ASSERT_EQ(env->request().ping().time(), 1);
+}
+
 TEST(BrokerTest, LocalPingPong) {
   const Channel PING = 8;
   const Channel PONG = 9;
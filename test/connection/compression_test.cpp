@@ -0,0 +1,139 @@
+#include "connection/compression.h"
+
+#include <gtest/gtest.h>
+
+#include "connection/zmq_utils.h"
+
+using namespace std;
+using namespace slog;
+
+using internal::Envelope;
+
+namespace {
+
+Envelope MakeBatchEnvelope(int num_txns) {
+  Envelope env;
+  auto batch = env.mutable_request()->mutable_forward_batch_data()->add_batch_data();
+  batch->set_id(100);
+  for (int i = 0; i < num_txns; i++) {
+    auto txn = batch->add_transactions();
+    txn->mutable_internal()->set_id(i);
+    auto entry = txn->add_keys();
+    entry->set_key("key" + to_string(i));
+    entry->mutable_value_entry()->set_value(string(50, 'a' + i % 26));
+  }
+  return env;
+}
+
+internal::Compression MakeCompression(internal::CompressionCodec codec, int level = 0) {
+  internal::Compression compression;
+  compression.set_codec(codec);
+  compression.set_level(level);
+  compression.set_min_payload_bytes(1024);
+  return compression;
+}
+
+}  // namespace
+
+class CompressionTest : public ::testing::TestWithParam<internal::Compression> {};
+
+TEST_P(CompressionTest, RoundTrip) {
+  auto env = MakeBatchEnvelope(100);
+  auto frame = SerializeProto(env);
+  WriteFrameAddress(frame.data<char>(), 3, 7);
+
+  CompressionStats stats;
+  zmq::message_t compressed;
+  ASSERT_TRUE(CompressFrame(compressed, frame.data<char>(), frame.size(), GetParam(), stats));
+  ASSERT_LT(compressed.size(), frame.size());
+  ASSERT_EQ(stats.num_compressed, 1U);
+  ASSERT_EQ(stats.uncompressed_bytes, frame.size() - kFrameHeaderSize);
+  ASSERT_EQ(stats.compressed_bytes, compressed.size() - kFrameHeaderSize);
+
+  // The address is kept
+  MachineId machine_id;
+  ASSERT_TRUE(ParseMachineId(machine_id, compressed));
+  ASSERT_EQ(machine_id, 3);
+  Channel channel;
+  ASSERT_TRUE(ParseChannel(channel, compressed));
+  ASSERT_EQ(channel, 7U);
+
+  auto num_decompressed = num_decompressed_payloads();
+  auto decompressed_env = DeserializeEnvelope(compressed, true /* on_arena */);
+  ASSERT_NE(decompressed_env, nullptr);
+  ASSERT_EQ(num_decompressed_payloads(), num_decompressed + 1);
+  ASSERT_EQ(decompressed_env->from(), 3);
+  auto& batch = decompressed_env->request().forward_batch_data().batch_data(0);
+  ASSERT_EQ(batch.id(), 100U);
+  ASSERT_EQ(batch.transactions_size(), 100);
+  for (int i = 0; i < batch.transactions_size(); i++) {
+    auto& txn = batch.transactions(i);
+    ASSERT_EQ(txn.internal().id(), static_cast<TxnId>(i));
+    ASSERT_EQ(txn.keys(0).key(), "key" + to_string(i));
+    ASSERT_EQ(txn.keys(0).value_entry().value(), string(50, 'a' + i % 26));
+  }
+}
+
+TEST_P(CompressionTest, SkipSmallPayload) {
+  auto frame = SerializeProto(MakeBatchEnvelope(1));
+  ASSERT_LT(frame.size(), 1024U);
+
+  CompressionStats stats;
+  zmq::message_t compressed;
+  ASSERT_FALSE(CompressFrame(compressed, frame.data<char>(), frame.size(), GetParam(), stats));
+  ASSERT_EQ(compressed.size(), 0U);
+  ASSERT_EQ(stats.num_compressed, 0U);
+  ASSERT_EQ(stats.num_uncompressed, 1U);
+}
+
+TEST_P(CompressionTest, CorruptedPayload) {
+  auto frame = SerializeProto(MakeBatchEnvelope(100));
+  CompressionStats stats;
+  zmq::message_t compressed;
+  ASSERT_TRUE(CompressFrame(compressed, frame.data<char>(), frame.size(), GetParam(), stats));
+
+  // Claim a larger uncompressed size than the actual one
+  uint32_t uncompressed_sz = frame.size();
+  memcpy(compressed.data<char>() + kFrameHeaderSize, &uncompressed_sz, sizeof(uncompressed_sz));
+  Envelope env;
+  ASSERT_FALSE(DeserializeProto(env, compressed));
+}
+
+TEST_P(CompressionTest, ImplausibleUncompressedSize) {
+  auto frame = SerializeProto(MakeBatchEnvelope(100));
+  CompressionStats stats;
+  zmq::message_t compressed;
+  ASSERT_TRUE(CompressFrame(compressed, frame.data<char>(), frame.size(), GetParam(), stats));
+
+  // Such a size is rejected before the buffer for the uncompressed payload is allocated
+  uint32_t uncompressed_sz = 0xFFFFFFFF;
+  memcpy(compressed.data<char>() + kFrameHeaderSize, &uncompressed_sz, sizeof(uncompressed_sz));
+  Envelope env;
+  ASSERT_FALSE(DeserializeProto(env, compressed));
+}
+
+INSTANTIATE_TEST_SUITE_P(AllCodecs, CompressionTest,
+                         testing::Values(MakeCompression(internal::CompressionCodec::LZ4),
+                                         MakeCompression(internal::CompressionCodec::LZ4, 9),
+                                         MakeCompression(internal::CompressionCodec::ZSTD),
+                                         MakeCompression(internal::CompressionCodec::ZSTD, 19)),
+                         [](const testing::TestParamInfo<internal::Compression>& info) {
+                           return internal::CompressionCodec_Name(info.param.codec()) + "_" +
+                                  to_string(info.param.level());
+                         });
+
+TEST(CompressionStatsTest, ToJson) {
+  CompressionStats stats;
+  stats.num_compressed = 2;
+  stats.num_uncompressed = 5;
+  stats.uncompressed_bytes = 4000;
+  stats.compressed_bytes = 1000;
+  stats.compress_time = chrono::microseconds(30);
+
+  rapidjson::Document doc;
+  auto json = CompressionStatsToJson(stats, doc.GetAllocator());
+  ASSERT_EQ(json["num_compressed_msgs"].GetUint64(), 2U);
+  ASSERT_EQ(json["num_uncompressed_msgs"].GetUint64(), 5U);
+  ASSERT_DOUBLE_EQ(json["compression_ratio"].GetDouble(), 4.0);
+  ASSERT_EQ(json["compress_time_us"].GetInt64(), 30);
+}
@@ -116,4 +116,69 @@ TEST(ZmqUtilsTest, FailedParsing) {
   ASSERT_FALSE(ParseChannel(chan, msg));
   Request req;
   ASSERT_FALSE(DeserializeProto(req, msg));
-}
\ No newline at end of file
+}
+TEST(ZmqUtilsTest, FrameLayout) {
+  Request req;
+  req.mutable_ping()->set_time(99);
+  auto msg = SerializeProto(req);
+  ASSERT_EQ(msg.size(), kFrameHeaderSize + req.ByteSizeLong());
+
+  Request req2;
+  ASSERT_TRUE(DeserializeProto(req2, msg));
+  ASSERT_EQ(req2.ping().time(), 99);
+
+  // Truncated payload
+  ASSERT_FALSE(DeserializeProto(req2, msg.data<char>(), msg.size() - 1));
+
+  // Unknown version
+  msg.data<char>()[kFrameVersionOffset] = kFrameVersion + 1;
+  ASSERT_FALSE(DeserializeProto(req2, msg));
+}
+
+TEST(ZmqUtilsTest, SharedFrameFanOut) {
+  zmq::context_t context(1);
+  const int kMaxFanOut = 16;
+  vector<zmq::socket_t> pushes, pulls;
+  for (int i = 0; i < kMaxFanOut; i++) {
+    auto address = "inproc://test" + to_string(i);
+    pulls.emplace_back(context, ZMQ_PULL).bind(address);
+    pushes.emplace_back(context, ZMQ_PUSH).connect(address);
+  }
+
+  // Make the message large enough so that zmq would not copy it into the message itself
+  Request req;
+  req.mutable_forward_txn()->mutable_txn()->add_keys()->set_key(string(10000, 'x'));
+
+  for (int fan_out = 1; fan_out <= kMaxFanOut; fan_out *= 2) {
+    auto num_allocations = SharedFrame::num_allocated_buffers();
+    {
+      SharedFrame frame(req, 3, 7);
+      for (int i = 0; i < fan_out; i++) {
+        pushes[i].send(frame.MakeMessage(), zmq::send_flags::none);
+      }
+    }
+    // Only one buffer is allocated regardless of the fan-out
+    ASSERT_EQ(SharedFrame::num_allocated_buffers(), num_allocations + 1);
+
+    const void* first_data = nullptr;
+    for (int i = 0; i < fan_out; i++) {
+      zmq::message_t msg;
+      ASSERT_TRUE(pulls[i].recv(msg));
+      // All receivers see the same buffer
+      if (first_data == nullptr) {
+        first_data = msg.data();
+      }
+      ASSERT_EQ(msg.data(), first_data);
+
+      MachineId machine_id;
+      ASSERT_TRUE(ParseMachineId(machine_id, msg));
+      ASSERT_EQ(machine_id, 3);
+      Channel channel;
+      ASSERT_TRUE(ParseChannel(channel, msg));
+      ASSERT_EQ(channel, 7U);
+      Request req2;
+      ASSERT_TRUE(DeserializeProto(req2, msg));
+      ASSERT_EQ(req2.forward_txn().txn().keys(0).key(), req.forward_txn().txn().keys(0).key());
+    }
+  }
+}
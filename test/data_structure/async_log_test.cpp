@@ -0,0 +1,80 @@
+#include "data_structure/async_log.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+using namespace std;
+using namespace slog;
+
+TEST(AsyncLogTest, InOrder) {
+  AsyncLog<int> log;
+  for (int i = 0; i < 100; i++) {
+    log.Insert(i, i * 10);
+    ASSERT_TRUE(log.HasNext());
+    ASSERT_EQ(log.Peek(), i * 10);
+    auto next = log.Next();
+    ASSERT_EQ(next.first, static_cast<uint32_t>(i));
+    ASSERT_EQ(next.second, i * 10);
+    ASSERT_FALSE(log.HasNext());
+  }
+  ASSERT_EQ(log.NumBufferredItems(), 0U);
+}
+
+TEST(AsyncLogTest, OutOfOrderGrowsBuffer) {
+  AsyncLog<string> log(5 /* start_from */, 4 /* initial_capacity */);
+  log.Insert(100, "c");
+  log.Insert(6, "b");
+  ASSERT_FALSE(log.HasNext());
+  ASSERT_GE(log.capacity(), 96U);
+  ASSERT_EQ(log.NumBufferredItems(), 2U);
+
+  log.Insert(5, "a");
+  ASSERT_EQ(log.Next(), make_pair(5U, string("a")));
+  ASSERT_EQ(log.Next(), make_pair(6U, string("b")));
+  ASSERT_FALSE(log.HasNext());
+  ASSERT_THROW(log.Peek(), out_of_range);
+  ASSERT_THROW(log.Next(), runtime_error);
+
+  for (uint32_t i = 7; i < 100; i++) {
+    log.Insert(i, to_string(i));
+  }
+  for (uint32_t i = 7; i < 100; i++) {
+    ASSERT_EQ(log.Next(), make_pair(i, to_string(i)));
+  }
+  ASSERT_EQ(log.Next(), make_pair(100U, string("c")));
+  ASSERT_EQ(log.NumBufferredItems(), 0U);
+}
+
+TEST(AsyncLogTest, WrapsAround) {
+  AsyncLog<int> log(0, 8);
+  for (int round = 0; round < 10; round++) {
+    // Fill the whole buffer in reverse order
+    for (int i = 7; i >= 0; i--) {
+      log.Insert(round * 8 + i, round * 8 + i);
+    }
+    for (int i = 0; i < 8; i++) {
+      ASSERT_EQ(log.Next().second, round * 8 + i);
+    }
+  }
+  ASSERT_EQ(log.capacity(), 8U);
+}
+
+TEST(AsyncLogTest, IgnoreOldPositionsAndRejectDuplicates) {
+  AsyncLog<int> log;
+  log.Insert(0, 0);
+  log.Next();
+  log.Insert(0, 100);
+  ASSERT_FALSE(log.HasNext());
+
+  log.Insert(2, 2);
+  ASSERT_THROW(log.Insert(2, 3), runtime_error);
+}
+
+TEST(AsyncLogTest, MoveOnlyItems) {
+  AsyncLog<unique_ptr<int>> log;
+  log.Insert(1, make_unique<int>(1));
+  log.Insert(0, make_unique<int>(0));
+  ASSERT_EQ(*log.Next().second, 0);
+  ASSERT_EQ(*log.Next().second, 1);
+}
@@ -74,4 +74,22 @@ TEST_F(BatchLogTest, MultipleNextBatches) {
   ASSERT_TRUE(BatchEQ({1, 200}, log.NextBatch()));
   ASSERT_TRUE(BatchEQ({2, 300}, log.NextBatch()));
   ASSERT_FALSE(log.HasNextBatch());
-}
\ No newline at end of file
+}
+
+TEST_F(BatchLogTest, ReplicationAcks) {
+  BatchLog log;
+  log.AckReplication(200);
+  log.AddBatch(move(batches[0]));
+  log.AddBatch(move(batches[1]));
+  log.AddSlot(0 /* slot_id */, 100 /* batch_id */, 1 /* replication_factor */);
+  log.AddSlot(1 /* slot_id */, 200 /* batch_id */, 1 /* replication_factor */);
+  ASSERT_FALSE(log.HasNextBatch());
+  ASSERT_EQ(log.NumBufferedBatches(), 2U);
+
+  log.AckReplication(100);
+  ASSERT_TRUE(BatchEQ({0, 100}, log.NextBatch()));
+  ASSERT_TRUE(BatchEQ({1, 200}, log.NextBatch()));
+  ASSERT_FALSE(log.HasNextBatch());
+  ASSERT_EQ(log.NumBufferedBatches(), 0U);
+  ASSERT_EQ(log.NumBufferedSlots(), 0U);
+}
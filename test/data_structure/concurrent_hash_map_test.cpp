@@ -2,6 +2,7 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <thread>
 
 using namespace std;
@@ -38,6 +39,16 @@ TEST(ConcurrentHashMapTest, SerialBasicOperations) {
   }
 }
 
+TEST(ConcurrentHashMapTest, Visit) {
+  ConcurrentHashMap<string, string> map;
+  size_t size = 0;
+  auto visitor = [&size](const string& value) { size = value.size(); };
+  ASSERT_FALSE(map.Visit("test", visitor));
+  map.InsertOrUpdate("test", "foo");
+  ASSERT_TRUE(map.Visit("test", visitor));
+  ASSERT_EQ(size, 3U);
+}
+
 TEST(ConcurrentHashMapTest, TriggerRehash) {
   ConcurrentHashMap<string, string> map;
   string result;
@@ -134,6 +145,28 @@ TEST(ConcurrentHashMapTest, TwoWritersSameKey) {
   ASSERT_EQ(result, to_string(N - 1));
 }
 
+TEST(ConcurrentHashMapTest, TwoUpdatersSameKey) {
+  int N = 100000;
+  string key = "foo";
+  ConcurrentHashMap<string, int> map;
+
+  auto Increments = [&]() {
+    for (int i = 0; i < N; i++) {
+      map.Update(key, [](int& value) { value++; });
+    }
+  };
+
+  thread u1(Increments);
+  thread u2(Increments);
+  u1.join();
+  u2.join();
+
+  // No increment is lost
+  int result;
+  ASSERT_TRUE(map.Get(result, key));
+  ASSERT_EQ(result, 2 * N);
+}
+
 TEST(ConcurrentHashMapTest, OneWriterOneEraser) {
   int N = 100000;
   ConcurrentHashMap<string, string> map;
@@ -161,4 +194,36 @@ TEST(ConcurrentHashMapTest, OneWriterOneEraser) {
       ASSERT_EQ(result, to_string(i));
     }
   }
-}
\ No newline at end of file
+}
+
+TEST(ConcurrentHashMapTest, ReadersDuringRehashAndErase) {
+  int N = 50000;
+  ConcurrentHashMap<string, string> map;
+  atomic<bool> stop = false;
+
+  // Values are always equal to their keys so a reader seeing a freed node would likely fail
+  auto Gets = [&]() {
+    string result;
+    while (!stop) {
+      for (int i = 0; i < N; i += 7) {
+        if (map.Get(result, to_string(i))) {
+          ASSERT_EQ(result, to_string(i));
+        }
+      }
+    }
+  };
+
+  thread r1(Gets);
+  thread r2(Gets);
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < N; i++) {
+      map.InsertOrUpdate(to_string(i), to_string(i));
+    }
+    for (int i = 0; i < N; i++) {
+      map.Erase(to_string(i));
+    }
+  }
+  stop = true;
+  r1.join();
+  r2.join();
+}
@@ -0,0 +1,45 @@
+#include "data_structure/epoch.h"
+
+#include <gtest/gtest.h>
+
+#include <future>
+#include <thread>
+
+using namespace std;
+using namespace slog;
+
+TEST(EpochManagerTest, AdvanceWithoutReaders) {
+  auto& epoch_manager = EpochManager::Instance();
+  auto epoch = epoch_manager.epoch();
+  ASSERT_EQ(epoch_manager.TryAdvance(), epoch + 1);
+  ASSERT_EQ(epoch_manager.TryAdvance(), epoch + 2);
+  ASSERT_TRUE(EpochManager::IsSafeToReclaim(epoch, epoch_manager.epoch()));
+}
+
+TEST(EpochManagerTest, ReaderHoldsBackEpoch) {
+  auto& epoch_manager = EpochManager::Instance();
+  promise<void> entered, done;
+  auto reader = thread([&] {
+    EpochManager::Guard guard;
+    {
+      // Nested guards do not change the announced epoch
+      EpochManager::Guard nested_guard;
+    }
+    entered.set_value();
+    done.get_future().wait();
+  });
+  entered.get_future().wait();
+
+  // The reader has observed the current epoch so the epoch can advance once but not twice
+  auto retired_epoch = epoch_manager.epoch();
+  auto epoch = epoch_manager.TryAdvance();
+  ASSERT_EQ(epoch, retired_epoch + 1);
+  ASSERT_EQ(epoch_manager.TryAdvance(), epoch);
+  ASSERT_FALSE(EpochManager::IsSafeToReclaim(retired_epoch, epoch_manager.epoch()));
+
+  done.set_value();
+  reader.join();
+
+  ASSERT_EQ(epoch_manager.TryAdvance(), epoch + 1);
+  ASSERT_TRUE(EpochManager::IsSafeToReclaim(retired_epoch, epoch_manager.epoch()));
+}
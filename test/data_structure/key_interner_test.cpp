@@ -0,0 +1,43 @@
+#include "data_structure/key_interner.h"
+
+#include <gtest/gtest.h>
+
+using namespace std;
+using namespace slog;
+
+TEST(KeyInternerTest, InternSameKey) {
+  KeyInterner interner;
+  auto a = interner.Intern("A");
+  auto b = interner.Intern("B");
+  ASSERT_NE(a, b);
+  ASSERT_EQ(interner.Intern("A"), a);
+  ASSERT_EQ(interner.Intern("B"), b);
+  ASSERT_EQ(interner.key(a), "A");
+  ASSERT_EQ(interner.key(b), "B");
+  ASSERT_EQ(interner.size(), 2U);
+}
+
+TEST(KeyInternerTest, ReuseIdOfUnreferencedKey) {
+  KeyInterner interner;
+  auto a = interner.Intern("A");
+  interner.Ref(a);
+  interner.Ref(a);
+  interner.Unref(a);
+  ASSERT_EQ(interner.Intern("A"), a);
+
+  interner.Unref(a);
+  ASSERT_EQ(interner.size(), 0U);
+
+  auto b = interner.Intern("B");
+  ASSERT_EQ(b, a);
+  ASSERT_EQ(interner.key(b), "B");
+  ASSERT_NE(interner.Intern("A"), b);
+}
+
+TEST(KeyInternerTest, KeyReplicaId) {
+  auto id = MakeKeyReplicaId(12345, 7);
+  ASSERT_EQ(GetKeyId(id), 12345U);
+  ASSERT_EQ(GetMaster(id), 7U);
+  ASSERT_NE(MakeKeyReplicaId(12345, 8), id);
+  ASSERT_NE(MakeKeyReplicaId(12346, 7), id);
+}
@@ -0,0 +1,52 @@
+#include "data_structure/object_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <set>
+
+using namespace std;
+using namespace slog;
+
+struct Point {
+  int x;
+  int y;
+};
+
+TEST(ObjectPoolTest, NewAndDelete) {
+  ObjectPool<Point, 4> pool;
+  ASSERT_EQ(pool.num_objects(), 0U);
+  ASSERT_EQ(pool.capacity(), 0U);
+
+  vector<Point*> points;
+  for (int i = 0; i < 10; i++) {
+    points.push_back(pool.New(i, -i));
+  }
+  ASSERT_EQ(pool.num_objects(), 10U);
+  ASSERT_EQ(pool.capacity(), 12U);
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(points[i]->x, i);
+    ASSERT_EQ(points[i]->y, -i);
+  }
+
+  set<Point*> deleted;
+  for (int i = 0; i < 10; i += 2) {
+    pool.Delete(points[i]);
+    deleted.insert(points[i]);
+  }
+  ASSERT_EQ(pool.num_objects(), 5U);
+
+  // Deleted objects are recycled before new memory is allocated
+  for (int i = 0; i < 5; i++) {
+    auto p = pool.New(100, 100);
+    ASSERT_EQ(deleted.count(p), 1U);
+    deleted.erase(p);
+  }
+  ASSERT_EQ(pool.num_objects(), 10U);
+  ASSERT_EQ(pool.capacity(), 12U);
+
+  // The objects that were not deleted are untouched
+  for (int i = 1; i < 10; i += 2) {
+    ASSERT_EQ(points[i]->x, i);
+    ASSERT_EQ(points[i]->y, -i);
+  }
+}
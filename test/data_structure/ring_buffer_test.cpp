@@ -0,0 +1,107 @@
+#include "data_structure/ring_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+using namespace std;
+using namespace slog;
+
+TEST(SPSCRingTest, SerialPushAndPop) {
+  SPSCRing<int> ring(3);
+  ASSERT_EQ(ring.capacity(), 4U);
+  ASSERT_TRUE(ring.empty());
+
+  int item;
+  ASSERT_FALSE(ring.TryPop(item));
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(ring.TryPush(i));
+  }
+  ASSERT_FALSE(ring.TryPush(4));
+  ASSERT_EQ(ring.size(), 4U);
+
+  // Wrap around the end of the buffer
+  for (int round = 0; round < 3; round++) {
+    ASSERT_TRUE(ring.TryPop(item));
+    ASSERT_EQ(item, round);
+    ASSERT_TRUE(ring.TryPush(4 + round));
+  }
+  for (int i = 3; i < 7; i++) {
+    ASSERT_TRUE(ring.TryPop(item));
+    ASSERT_EQ(item, i);
+  }
+  ASSERT_TRUE(ring.empty());
+}
+
+TEST(SPSCRingTest, ConcurrentPushAndPop) {
+  const int kNumItems = 1000000;
+  SPSCRing<int> ring(64);
+  thread producer([&ring] {
+    for (int i = 0; i < kNumItems; i++) {
+      while (!ring.TryPush(i)) {
+        this_thread::yield();
+      }
+    }
+  });
+  for (int i = 0; i < kNumItems; i++) {
+    int item;
+    while (!ring.TryPop(item)) {
+      this_thread::yield();
+    }
+    ASSERT_EQ(item, i);
+  }
+  producer.join();
+  ASSERT_TRUE(ring.empty());
+}
+
+TEST(MPSCRingTest, SerialPushAndPop) {
+  MPSCRing<int> ring(4);
+  ASSERT_TRUE(ring.empty());
+
+  int item;
+  ASSERT_FALSE(ring.TryPop(item));
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < 4; i++) {
+      ASSERT_TRUE(ring.TryPush(round * 10 + i));
+    }
+    ASSERT_FALSE(ring.TryPush(100));
+    for (int i = 0; i < 4; i++) {
+      ASSERT_TRUE(ring.TryPop(item));
+      ASSERT_EQ(item, round * 10 + i);
+    }
+    ASSERT_TRUE(ring.empty());
+  }
+}
+
+TEST(MPSCRingTest, ConcurrentPushAndPop) {
+  const int kNumProducers = 4;
+  const int kNumItemsPerProducer = 200000;
+  struct Item {
+    int producer;
+    int seq;
+  };
+  MPSCRing<Item> ring(64);
+  vector<thread> producers;
+  for (int p = 0; p < kNumProducers; p++) {
+    producers.emplace_back([&ring, p] {
+      for (int i = 0; i < kNumItemsPerProducer; i++) {
+        while (!ring.TryPush({p, i})) {
+          this_thread::yield();
+        }
+      }
+    });
+  }
+  // Items from the same producer must come out in order
+  vector<int> next(kNumProducers, 0);
+  for (int i = 0; i < kNumProducers * kNumItemsPerProducer; i++) {
+    Item item;
+    while (!ring.TryPop(item)) {
+      this_thread::yield();
+    }
+    ASSERT_EQ(item.seq, next[item.producer]++);
+  }
+  for (auto& p : producers) {
+    p.join();
+  }
+  ASSERT_TRUE(ring.empty());
+}
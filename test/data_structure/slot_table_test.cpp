@@ -0,0 +1,79 @@
+#include "data_structure/slot_table.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+using namespace std;
+using namespace slog;
+
+TEST(SlotTableTest, EmplaceGetAndErase) {
+  SlotTable<string, 4> table;
+  ASSERT_EQ(table.size(), 0U);
+  ASSERT_EQ(table.capacity(), 0U);
+
+  vector<SlotTable<string, 4>::Handle> handles;
+  vector<string*> objects;
+  for (int i = 0; i < 10; i++) {
+    handles.push_back(table.Emplace(to_string(i)));
+    objects.push_back(table.Get(handles.back()));
+  }
+  ASSERT_EQ(table.size(), 10U);
+  ASSERT_EQ(table.capacity(), 12U);
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(*table.Get(handles[i]), to_string(i));
+    ASSERT_EQ(table.HandleOf(*objects[i]), handles[i]);
+  }
+
+  for (int i = 0; i < 10; i += 2) {
+    table.Erase(handles[i]);
+    ASSERT_EQ(table.Get(handles[i]), nullptr);
+  }
+  ASSERT_EQ(table.size(), 5U);
+
+  // The slots of the erased objects are reused but the old handles do not resolve to the new objects
+  for (int i = 0; i < 5; i++) {
+    auto handle = table.Emplace("new");
+    ASSERT_EQ(*table.Get(handle), "new");
+  }
+  ASSERT_EQ(table.capacity(), 12U);
+  for (int i = 0; i < 10; i += 2) {
+    ASSERT_EQ(table.Get(handles[i]), nullptr);
+  }
+
+  // The objects that were not erased stay where they were
+  for (int i = 1; i < 10; i += 2) {
+    ASSERT_EQ(table.Get(handles[i]), objects[i]);
+    ASSERT_EQ(*objects[i], to_string(i));
+  }
+}
+
+TEST(SlotTableTest, DestroyRemainingObjects) {
+  auto counter = make_shared<int>(0);
+  {
+    SlotTable<shared_ptr<int>, 4> table;
+    for (int i = 0; i < 6; i++) {
+      table.Emplace(counter);
+    }
+    table.Erase(table.Emplace(counter));
+    ASSERT_EQ(counter.use_count(), 7);
+  }
+  ASSERT_EQ(counter.use_count(), 1);
+}
+
+TEST(SlotTableTest, ForEach) {
+  SlotTable<int, 4> table;
+  vector<SlotTable<int, 4>::Handle> handles;
+  for (int i = 0; i < 6; i++) {
+    handles.push_back(table.Emplace(i));
+  }
+  table.Erase(handles[1]);
+  table.Erase(handles[4]);
+
+  vector<int> objects;
+  table.ForEach([&objects](int obj) { objects.push_back(obj); });
+  sort(objects.begin(), objects.end());
+  ASSERT_EQ(objects, (vector<int>{0, 2, 3, 5}));
+}
@@ -89,6 +89,42 @@ TEST_F(E2ETest, BasicSingleHomeSingleParition) {
   ASSERT_EQ(TxnValueEntry(txn2_resp, "A").value(), "newA");
 }
 
+TEST_F(E2ETest, AddToKey) {
+  auto txn1 = MakeTransaction({{"A", KeyType::ADD}}, {{"INCR", "A"}});
+  auto txn2 = MakeTransaction({{"A", KeyType::ADD}}, {{"ADD", "A", "10"}});
+  auto txn3 = MakeTransaction({{"A", KeyType::READ}}, {{"GET", "A"}});
+
+  test_slogs[0]->SendTxn(txn1);
+  auto txn1_resp = test_slogs[0]->RecvTxnResult();
+  ASSERT_EQ(txn1_resp.status(), TransactionStatus::COMMITTED);
+  ASSERT_EQ(TxnValueEntry(txn1_resp, "A").delta(), 1);
+
+  test_slogs[0]->SendTxn(txn2);
+  auto txn2_resp = test_slogs[0]->RecvTxnResult();
+  ASSERT_EQ(txn2_resp.status(), TransactionStatus::COMMITTED);
+  ASSERT_EQ(TxnValueEntry(txn2_resp, "A").delta(), 10);
+
+  // The original value is not a number so it is dropped and replaced with the sum of the additions
+  test_slogs[0]->SendTxn(txn3);
+  auto txn3_resp = test_slogs[0]->RecvTxnResult();
+  ASSERT_EQ(txn3_resp.status(), TransactionStatus::COMMITTED);
+  ASSERT_EQ(TxnValueEntry(txn3_resp, "A").value(), "11");
+}
+
+TEST_F(E2ETest, AddOverflow) {
+  auto txn1 = MakeTransaction({{"A", KeyType::ADD}}, {{"ADD", "A", "9223372036854775807"}, {"INCR", "A"}});
+  auto txn2 = MakeTransaction({{"A", KeyType::READ}}, {{"GET", "A"}});
+
+  test_slogs[0]->SendTxn(txn1);
+  auto txn1_resp = test_slogs[0]->RecvTxnResult();
+  ASSERT_EQ(txn1_resp.status(), TransactionStatus::ABORTED);
+
+  test_slogs[0]->SendTxn(txn2);
+  auto txn2_resp = test_slogs[0]->RecvTxnResult();
+  ASSERT_EQ(txn2_resp.status(), TransactionStatus::COMMITTED);
+  ASSERT_EQ(TxnValueEntry(txn2_resp, "A").value(), "valA");
+}
+
 TEST_F(E2ETest, MultiPartitionTxn) {
   for (size_t i = 0; i < NUM_MACHINES; i++) {
     auto txn = MakeTransaction({{"A", KeyType::READ}, {"B", KeyType::WRITE}}, {{"GET", "A"}, {"SET", "B", "newB"}});
@@ -225,6 +261,89 @@ TEST_F(E2ETestBypassMHOrderer, MultiHomeMultiPartitionTxn) {
   }
 }
 
+struct E2ETestConfig {
+  const char* name;
+  internal::Configuration config;
+};
+
+E2ETestConfig KeyAffinityDispatchConfig() {
+  E2ETestConfig test_config{"KeyAffinityDispatch", {}};
+  test_config.config.set_num_workers(3);
+  test_config.config.set_worker_dispatch_policy(internal::WorkerDispatchPolicy::KEY_AFFINITY);
+  return test_config;
+}
+
+E2ETestConfig MessageCoalescingConfig() {
+  E2ETestConfig test_config{"MessageCoalescing", {}};
+  test_config.config.set_message_coalescing_max_bytes(4096);
+  return test_config;
+}
+
+E2ETestConfig CompressionConfig() {
+  E2ETestConfig test_config{"Compression", {}};
+  test_config.config.mutable_cross_region_compression()->set_codec(internal::CompressionCodec::LZ4);
+  test_config.config.mutable_cross_region_compression()->set_min_payload_bytes(1);
+  return test_config;
+}
+
+class E2ETestKeyAffinityDispatch : public E2ETest {
+  internal::Configuration CustomConfig() final { return KeyAffinityDispatchConfig().config; }
+};
+
+TEST_F(E2ETestKeyAffinityDispatch, SingleHomeSinglePartitionTxns) {
+  // Txns on the same key are sent to the same worker so they must still see each other's writes
+  for (int i = 0; i < 10; i++) {
+    auto new_value = "newA" + to_string(i);
+    auto txn = MakeTransaction({{"A", KeyType::WRITE}}, {{"SET", "A", new_value}});
+    test_slogs[0]->SendTxn(txn);
+    auto txn_resp = test_slogs[0]->RecvTxnResult();
+    ASSERT_EQ(txn_resp.status(), TransactionStatus::COMMITTED);
+    ASSERT_EQ(TxnValueEntry(txn_resp, "A").value(), i == 0 ? "valA" : "newA" + to_string(i - 1));
+    ASSERT_EQ(TxnValueEntry(txn_resp, "A").new_value(), new_value);
+  }
+}
+
+class E2ETestWithConfig : public E2ETest, public ::testing::WithParamInterface<E2ETestConfig> {
+  internal::Configuration CustomConfig() final { return GetParam().config; }
+};
+
+TEST_P(E2ETestWithConfig, MultiHomeMultiPartitionTxn) {
+  // Large enough for the batches carrying the txn to be compressed
+  const string kNewC(1000, 'C');
+  for (size_t i = 0; i < NUM_MACHINES; i++) {
+    auto txn = MakeTransaction({{"A", KeyType::READ}, {"X", KeyType::READ}, {"C", KeyType::WRITE}},
+                               {{"GET", "A"}, {"GET", "X"}, {"SET", "C", kNewC}});
+
+    test_slogs[i]->SendTxn(txn);
+    auto txn_resp = test_slogs[i]->RecvTxnResult();
+    ASSERT_EQ(txn_resp.status(), TransactionStatus::COMMITTED);
+    ASSERT_EQ(txn_resp.internal().type(), TransactionType::MULTI_HOME_OR_LOCK_ONLY);
+    ASSERT_EQ(TxnValueEntry(txn_resp, "A").value(), "valA");
+    ASSERT_EQ(TxnValueEntry(txn_resp, "X").value(), "valX");
+    ASSERT_EQ(TxnValueEntry(txn_resp, "C").new_value(), kNewC);
+
+    // The multi-home orderer of the machine receiving the txn sends its batch to the other region
+    auto stats = test_slogs[i]->GetStats(ModuleId::MHORDERER);
+    const auto& coalescing = stats[COALESCING];
+    if (GetParam().config.message_coalescing_max_bytes() > 0) {
+      ASSERT_GT(coalescing[NUM_HELD_BACK_MSGS].GetUint64(), 0U);
+    } else {
+      ASSERT_EQ(coalescing[NUM_HELD_BACK_MSGS].GetUint64(), 0U);
+    }
+    const auto& compression = stats[COMPRESSION];
+    if (GetParam().config.has_cross_region_compression()) {
+      ASSERT_GT(compression[NUM_COMPRESSED_MSGS].GetUint64(), 0U);
+    } else {
+      ASSERT_EQ(compression[NUM_COMPRESSED_MSGS].GetUint64(), 0U);
+      ASSERT_EQ(compression[NUM_UNCOMPRESSED_MSGS].GetUint64(), 0U);
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(AllConfigs, E2ETestWithConfig,
+                         testing::Values(KeyAffinityDispatchConfig(), MessageCoalescingConfig(), CompressionConfig()),
+                         [](const testing::TestParamInfo<E2ETestConfig>& info) { return info.param.name; });
+
 int main(int argc, char* argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
   google::InstallFailureSignalHandler();
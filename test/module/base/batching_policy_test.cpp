@@ -0,0 +1,106 @@
+#include "module/base/batching_policy.h"
+
+#include <gtest/gtest.h>
+
+using namespace std;
+using namespace std::chrono;
+using namespace slog;
+
+namespace {
+
+internal::BatchingPolicy MakeConfig(uint32_t max_batch_size, uint64_t min_delay_us, uint64_t max_delay_us,
+                                    uint32_t target_backlog) {
+  internal::BatchingPolicy config;
+  config.set_max_batch_size(max_batch_size);
+  config.set_min_delay_us(min_delay_us);
+  config.set_max_delay_us(max_delay_us);
+  config.set_target_backlog(target_backlog);
+  return config;
+}
+
+}  // namespace
+
+TEST(BatchingPolicyTest, FixedDelayWithoutTarget) {
+  auto backlog = make_shared<Backlog>();
+  BatchingPolicy policy(MakeConfig(0, 100, 5000, 0), backlog);
+  ASSERT_FALSE(policy.is_adaptive());
+
+  backlog->Set(Backlog::SCHEDULER, 1000);
+  auto now = BatchingPolicy::Clock::now();
+  for (int i = 1; i <= 10; i++) {
+    policy.CloseBatch(10, now + milliseconds(i));
+    ASSERT_EQ(policy.OpenBatch(), microseconds(5000));
+  }
+}
+
+TEST(BatchingPolicyTest, FixedDelayWithoutBacklog) {
+  BatchingPolicy policy(MakeConfig(0, 100, 5000, 10));
+  ASSERT_FALSE(policy.is_adaptive());
+  ASSERT_EQ(policy.OpenBatch(), microseconds(5000));
+}
+
+TEST(BatchingPolicyTest, IsFull) {
+  BatchingPolicy unlimited(MakeConfig(0, 0, 5000, 0));
+  ASSERT_FALSE(unlimited.IsFull(1000000));
+
+  BatchingPolicy limited(MakeConfig(3, 0, 5000, 0));
+  ASSERT_FALSE(limited.IsFull(2));
+  ASSERT_TRUE(limited.IsFull(3));
+  ASSERT_TRUE(limited.IsFull(4));
+}
+
+TEST(BatchingPolicyTest, ArrivalRate) {
+  BatchingPolicy policy(MakeConfig(0, 0, 5000, 0));
+  auto now = BatchingPolicy::Clock::now();
+  // 100 txns every 10ms = 10000 txns/s
+  for (int i = 0; i <= 50; i++) {
+    policy.CloseBatch(100, now + milliseconds(10 * i));
+  }
+  ASSERT_NEAR(policy.arrival_rate(), 10000, 1);
+}
+
+TEST(BatchingPolicyTest, DelayFollowsBacklog) {
+  auto backlog = make_shared<Backlog>();
+  BatchingPolicy policy(MakeConfig(0, 100, 5000, 50), backlog);
+  ASSERT_TRUE(policy.is_adaptive());
+  auto now = BatchingPolicy::Clock::now();
+  int t = 0;
+
+  // Backlog below target shrinks the delay down to the minimum
+  backlog->Set(Backlog::INTERLEAVER, 10);
+  backlog->Set(Backlog::SCHEDULER, 10);
+  auto prev_delay = policy.delay();
+  for (int i = 0; i < 100; i++) {
+    policy.CloseBatch(100, now + milliseconds(++t));
+    ASSERT_LE(policy.delay(), prev_delay);
+    prev_delay = policy.delay();
+  }
+  ASSERT_EQ(policy.delay(), microseconds(100));
+  ASSERT_EQ(policy.OpenBatch(), microseconds(100));
+
+  // Backlog above target grows the delay up to the maximum
+  backlog->Set(Backlog::SCHEDULER, 100);
+  for (int i = 0; i < 100; i++) {
+    policy.CloseBatch(100, now + milliseconds(++t));
+    ASSERT_GE(policy.delay(), prev_delay);
+    prev_delay = policy.delay();
+  }
+  ASSERT_EQ(policy.delay(), microseconds(5000));
+  ASSERT_EQ(policy.OpenBatch(), microseconds(5000));
+}
+
+TEST(BatchingPolicyTest, MinDelayUnderLightLoad) {
+  auto backlog = make_shared<Backlog>();
+  backlog->Set(Backlog::SCHEDULER, 100);
+  BatchingPolicy policy(MakeConfig(0, 100, 5000, 50), backlog);
+  // No batch has been closed so the arrival rate is unknown
+  ASSERT_EQ(policy.OpenBatch(), microseconds(5000));
+
+  // One txn every second is not expected to join a batch within the delay
+  auto now = BatchingPolicy::Clock::now();
+  for (int i = 0; i < 10; i++) {
+    policy.CloseBatch(1, now + seconds(i));
+  }
+  ASSERT_EQ(policy.delay(), microseconds(5000));
+  ASSERT_EQ(policy.OpenBatch(), microseconds(100));
+}
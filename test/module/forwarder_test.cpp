@@ -164,6 +164,25 @@ TEST_F(ForwarderTest, TransactionHasNewKeys) {
   ASSERT_EQ(metadata2.counter, TxnValueEntry(*forwarded_txn, "KEY").metadata().counter());
 }
 
+TEST_F(ForwarderTest, IgnorePartitionsFromClient) {
+  auto txn = MakeTransaction({{"A"}, {"B", KeyType::WRITE}});
+  // A bogus partition that is out of range and another that is in range but wrong
+  for (auto& kv : *txn->mutable_keys()) {
+    kv.mutable_value_entry()->set_partition(kv.key() == "A" ? 100 : 0);
+  }
+  test_slogs[0]->SendTxn(txn);
+  auto forwarded_txn = ReceiveOnSequencerChannel({0});
+
+  ASSERT_TRUE(forwarded_txn != nullptr);
+  ASSERT_EQ(0U, TxnValueEntry(*forwarded_txn, "A").partition());
+  ASSERT_EQ(1U, TxnValueEntry(*forwarded_txn, "B").partition());
+  ASSERT_EQ(2, forwarded_txn->internal().involved_partitions_size());
+  ASSERT_EQ(0U, forwarded_txn->internal().involved_partitions(0));
+  ASSERT_EQ(1U, forwarded_txn->internal().involved_partitions(1));
+  ASSERT_EQ(0U, TxnValueEntry(*forwarded_txn, "B").metadata().master());
+  ASSERT_EQ(1U, TxnValueEntry(*forwarded_txn, "B").metadata().counter());
+}
+
 TEST_F(ForwarderTest, ForwardMultiHome) {
   // This txn involves data mastered by two regions
   auto txn = MakeTransaction({{"A"}, {"C", KeyType::WRITE}});
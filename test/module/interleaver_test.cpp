@@ -2,6 +2,7 @@
 
 #include <gtest/gtest.h>
 
+#include <queue>
 #include <vector>
 
 #include "common/proto_utils.h"
@@ -143,19 +144,34 @@ class InterleaverTest : public ::testing::Test {
     senders_[from]->Send(std::move(copied), to, kLocalLogChannel);
   }
 
+  // The interleaver sends whole batches to the scheduler, which may be allocated on an arena, so the
+  // txns are copied out of them
   Transaction* ReceiveTxn(int i) {
-    auto req_env = slogs_[i]->ReceiveFromOutputSocket(kSchedulerChannel);
-    if (req_env == nullptr) {
-      return nullptr;
+    if (received_txns_[i].empty()) {
+      auto req_env = slogs_[i]->ReceiveFromOutputSocket(kSchedulerChannel);
+      if (req_env == nullptr) {
+        return nullptr;
+      }
+      if (req_env->request().type_case() != internal::Request::kForwardBatchData) {
+        return nullptr;
+      }
+      for (const auto& batch : req_env->request().forward_batch_data().batch_data()) {
+        for (const auto& txn : batch.transactions()) {
+          received_txns_[i].push(new Transaction(txn));
+        }
+      }
     }
-    if (req_env->request().type_case() != internal::Request::kForwardTxn) {
+    if (received_txns_[i].empty()) {
       return nullptr;
     }
-    return req_env->mutable_request()->mutable_forward_txn()->release_txn();
+    auto txn = received_txns_[i].front();
+    received_txns_[i].pop();
+    return txn;
   }
 
   unique_ptr<Sender> senders_[4];
   unique_ptr<TestSlog> slogs_[4];
+  std::queue<Transaction*> received_txns_[4];
 };
 
 internal::Batch* MakeBatch(BatchId batch_id, const vector<Transaction*>& txns, TransactionType batch_type) {
@@ -0,0 +1,334 @@
+#include "module/scheduler_components/cg_lock_manager.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "common/proto_utils.h"
+#include "test/test_utils.h"
+
+using namespace std;
+using namespace slog;
+using testing::ElementsAre;
+using testing::UnorderedElementsAre;
+
+class CGLockManagerTest : public ::testing::Test {
+ protected:
+  CGLockManager lock_manager;
+};
+
+TEST_F(CGLockManagerTest, GetAllLocksOnFirstTry) {
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  auto holder = MakeTestTxnHolder(
+      configs[0], 100, {{"readA", KeyType::READ, 0}, {"readB", KeyType::READ, 0}, {"writeC", KeyType::WRITE, 0}});
+  ASSERT_EQ(lock_manager.AcquireLocks(holder.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  auto result = lock_manager.ReleaseLocks(holder.txn_id());
+  ASSERT_TRUE(result.empty());
+}
+
+TEST_F(CGLockManagerTest, ReadLocks) {
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  auto holder1 = MakeTestTxnHolder(configs[0], 100, {{"readA", KeyType::READ, 0}, {"readB", KeyType::READ, 0}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"readB", KeyType::READ, 0}, {"readC", KeyType::READ, 0}});
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder1.txn_id()).empty());
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder2.txn_id()).empty());
+}
+
+TEST_F(CGLockManagerTest, WriteLocks) {
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  auto holder1 = MakeTestTxnHolder(configs[0], 100, {{"writeA", KeyType::WRITE, 0}, {"writeB", KeyType::WRITE, 0}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"readA", KeyType::READ, 0}, {"writeA", KeyType::WRITE, 0}});
+
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  // The blocked txn becomes ready
+  ASSERT_EQ(lock_manager.ReleaseLocks(holder1.txn_id()).size(), 1U);
+  // Make sure the lock is already held by holder2
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::WAITING);
+}
+
+TEST_F(CGLockManagerTest, ReleaseLocksAndReturnMultipleNewLockHolders) {
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  auto holder1 =
+      MakeTestTxnHolder(configs[0], 100, {{"A", KeyType::READ, 0}, {"B", KeyType::WRITE, 0}, {"C", KeyType::WRITE, 0}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"B", KeyType::READ, 0}, {"A", KeyType::WRITE, 0}});
+  auto holder3 = MakeTestTxnHolder(configs[0], 300, {{"A", KeyType::WRITE, 0}});
+  auto holder4 = MakeTestTxnHolder(configs[0], 400, {{"C", KeyType::READ, 0}});
+
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder3.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder4.lock_only_txn(0)), AcquireLocksResult::WAITING);
+
+  auto result = lock_manager.ReleaseLocks(holder1.txn_id());
+  ASSERT_EQ(result.size(), 2U);
+  ASSERT_TRUE(find(result.begin(), result.end(), 200) != result.end());
+  ASSERT_TRUE(find(result.begin(), result.end(), 400) != result.end());
+
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder4.txn_id()).empty());
+
+  result = lock_manager.ReleaseLocks(holder2.txn_id());
+  ASSERT_THAT(result, ElementsAre(300));
+
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder3.txn_id()).empty());
+}
+
+TEST_F(CGLockManagerTest, AddLocks) {
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  auto holder1 = MakeTestTxnHolder(configs[0], 100, {{"A", KeyType::ADD, 0}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"A", KeyType::ADD, 0}, {"B", KeyType::ADD, 0}});
+  auto holder3 = MakeTestTxnHolder(configs[0], 300, {{"A", KeyType::READ, 0}});
+  auto holder4 = MakeTestTxnHolder(configs[0], 400, {{"A", KeyType::ADD, 0}});
+  auto holder5 = MakeTestTxnHolder(configs[0], 500, {{"B", KeyType::WRITE, 0}});
+
+  // Adds to the same key do not block each other
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  // Reads and writes wait for the adds before them and the adds after them wait for the reads
+  ASSERT_EQ(lock_manager.AcquireLocks(holder3.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder4.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder5.lock_only_txn(0)), AcquireLocksResult::WAITING);
+
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder1.txn_id()).empty());
+  ASSERT_THAT(lock_manager.ReleaseLocks(holder2.txn_id()), UnorderedElementsAre(300, 500));
+  ASSERT_THAT(lock_manager.ReleaseLocks(holder3.txn_id()), ElementsAre(400));
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder4.txn_id()).empty());
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder5.txn_id()).empty());
+}
+
+TEST_F(CGLockManagerTest, PartiallyAcquiredLocks) {
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  auto holder1 =
+      MakeTestTxnHolder(configs[0], 100, {{"A", KeyType::READ, 0}, {"B", KeyType::WRITE, 0}, {"C", KeyType::WRITE, 0}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"A", KeyType::READ, 0}, {"B", KeyType::WRITE, 0}});
+  auto holder3 = MakeTestTxnHolder(configs[0], 300, {{"A", KeyType::WRITE, 0}, {"C", KeyType::WRITE, 0}});
+
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder3.lock_only_txn(0)), AcquireLocksResult::WAITING);
+
+  auto result = lock_manager.ReleaseLocks(holder1.txn_id());
+  ASSERT_THAT(result, ElementsAre(200));
+
+  result = lock_manager.ReleaseLocks(holder2.txn_id());
+  ASSERT_THAT(result, ElementsAre(300));
+}
+
+TEST_F(CGLockManagerTest, AcquireLocksWithLockOnly1) {
+  auto configs = MakeTestConfigurations("locking", 2, 1);
+  auto holder1 =
+      MakeTestTxnHolder(configs[0], 100, {{"A", KeyType::READ, 0}, {"B", KeyType::WRITE, 0}, {"C", KeyType::WRITE, 0}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"A", KeyType::READ, 1}, {"B", KeyType::WRITE, 0}});
+
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(1)), AcquireLocksResult::ACQUIRED);
+
+  auto result = lock_manager.ReleaseLocks(holder2.txn_id());
+  ASSERT_THAT(result, ElementsAre(100));
+}
+
+TEST_F(CGLockManagerTest, AcquireLocksWithLockOnly2) {
+  auto configs = MakeTestConfigurations("locking", 2, 1);
+  auto holder1 =
+      MakeTestTxnHolder(configs[0], 100, {{"A", KeyType::READ, 0}, {"B", KeyType::WRITE, 0}, {"C", KeyType::WRITE, 0}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"A", KeyType::READ, 1}, {"B", KeyType::WRITE, 0}});
+
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(1)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(0)), AcquireLocksResult::WAITING);
+
+  auto result = lock_manager.ReleaseLocks(holder1.txn_id());
+  ASSERT_THAT(result, ElementsAre(200));
+}
+
+TEST_F(CGLockManagerTest, MultiEdgeBetweenTwoTxns) {
+  auto configs = MakeTestConfigurations("locking", 3, 1);
+  auto holder1 = MakeTestTxnHolder(configs[0], 100, {{"A", KeyType::WRITE, 1}, {"B", KeyType::WRITE, 2}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"A", KeyType::READ, 1}, {"B", KeyType::READ, 2}});
+
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(1)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(2)), AcquireLocksResult::ACQUIRED);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(1)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(2)), AcquireLocksResult::WAITING);
+
+  auto result = lock_manager.ReleaseLocks(holder1.txn_id());
+  ASSERT_THAT(result, ElementsAre(200));
+
+  result = lock_manager.ReleaseLocks(holder2.txn_id());
+  ASSERT_TRUE(result.empty());
+}
+
+TEST_F(CGLockManagerTest, KeyReplicaLocks) {
+  auto configs = MakeTestConfigurations("locking", 3, 1);
+  auto holder1 = MakeTestTxnHolder(configs[0], 100, {{"writeA", KeyType::WRITE, 2}, {"writeB", KeyType::WRITE, 2}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"readA", KeyType::READ, 1}, {"writeA", KeyType::WRITE, 1}});
+
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(2)), AcquireLocksResult::ACQUIRED);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(1)), AcquireLocksResult::ACQUIRED);
+}
+
+#ifdef REMASTER_PROTOCOL_COUNTERLESS
+TEST_F(CGLockManagerTest, RemasterTxn) {
+  auto configs = MakeTestConfigurations("locking", 3, 1);
+  auto holder = MakeTestTxnHolder(configs[0], 100, {{"A", KeyType::WRITE, 2}}, {}, 1 /* new_master */);
+
+  ASSERT_EQ(lock_manager.AcquireLocks(holder.lock_only_txn(1)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder.lock_only_txn(2)), AcquireLocksResult::ACQUIRED);
+  lock_manager.ReleaseLocks(holder.txn_id());
+
+  ASSERT_EQ(lock_manager.AcquireLocks(holder.lock_only_txn(2)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder.lock_only_txn(1)), AcquireLocksResult::ACQUIRED);
+  lock_manager.ReleaseLocks(holder.txn_id());
+}
+#endif
+
+TEST_F(CGLockManagerTest, EnsureStateIsClean) {
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  auto holder1 =
+      MakeTestTxnHolder(configs[0], 100, {{"A", KeyType::READ, 0}, {"B", KeyType::WRITE, 0}, {"C", KeyType::WRITE, 0}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"B", KeyType::READ, 0}, {"A", KeyType::WRITE, 0}});
+  auto holder3 = MakeTestTxnHolder(configs[0], 300, {{"C", KeyType::WRITE, 0}});
+
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder1.txn_id()).empty());
+
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder3.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder2.txn_id()).empty());
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder3.txn_id()).empty());
+}
+
+TEST_F(CGLockManagerTest, LongChain) {
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  auto holder1 = MakeTestTxnHolder(configs[0], 100, {{"A", KeyType::WRITE, 0}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"A", KeyType::READ, 0}});
+  auto holder3 = MakeTestTxnHolder(configs[0], 300, {{"A", KeyType::READ, 0}});
+  auto holder4 = MakeTestTxnHolder(configs[0], 400, {{"A", KeyType::WRITE, 0}});
+  auto holder5 = MakeTestTxnHolder(configs[0], 500, {{"A", KeyType::READ, 0}});
+
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder3.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder4.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder5.lock_only_txn(0)), AcquireLocksResult::WAITING);
+
+  auto result = lock_manager.ReleaseLocks(holder1.txn_id());
+  ASSERT_THAT(result, UnorderedElementsAre(200, 300));
+
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder2.txn_id()).empty());
+  result = lock_manager.ReleaseLocks(holder3.txn_id());
+  ASSERT_THAT(result, ElementsAre(400));
+
+  result = lock_manager.ReleaseLocks(holder4.txn_id());
+  ASSERT_THAT(result, ElementsAre(500));
+
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder5.txn_id()).empty());
+}
+
+TEST_F(CGLockManagerTest, GarbageCollectKeyTails) {
+  const int kNumTxns = 1000;
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  for (int i = 0; i < kNumTxns; i++) {
+    auto key = "key" + to_string(i);
+    auto holder = MakeTestTxnHolder(configs[0], 100 + i, {{key, KeyType::WRITE, 0}, {"hot", KeyType::READ, 0}});
+    ASSERT_EQ(lock_manager.AcquireLocks(holder.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+    ASSERT_TRUE(lock_manager.ReleaseLocks(holder.txn_id()).empty());
+  }
+
+  rapidjson::Document stats;
+  stats.SetObject();
+  lock_manager.GetStats(stats, 0);
+  // A tail is dropped as soon as the last txn accessing its key leaves
+  ASSERT_EQ(stats[LOCK_TABLE_SIZE].GetUint64(), 0U);
+  ASSERT_EQ(stats[NUM_CONFLICTS].GetUint64(), 0U);
+}
+
+TEST_F(CGLockManagerTest, BatchReturnsReadyTxnsInOrder) {
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  auto holder1 = MakeTestTxnHolder(configs[0], 100, {{"A", KeyType::WRITE, 0}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"A", KeyType::READ, 0}, {"B", KeyType::READ, 0}});
+  auto holder3 = MakeTestTxnHolder(configs[0], 300, {{"B", KeyType::READ, 0}});
+  auto holder4 = MakeTestTxnHolder(configs[0], 400, {{"A", KeyType::WRITE, 0}, {"C", KeyType::WRITE, 0}});
+  auto holder5 = MakeTestTxnHolder(configs[0], 500, {{"D", KeyType::WRITE, 0}});
+
+  lock_manager.BeginBatch();
+  for (auto holder : {&holder1, &holder2, &holder3, &holder4, &holder5}) {
+    ASSERT_EQ(lock_manager.AcquireLocks(holder->lock_only_txn(0)), AcquireLocksResult::WAITING);
+  }
+  ASSERT_THAT(lock_manager.EndBatch(), ElementsAre(100, 300, 500));
+
+  ASSERT_THAT(lock_manager.ReleaseLocks(holder1.txn_id()), ElementsAre(200));
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder3.txn_id()).empty());
+  ASSERT_THAT(lock_manager.ReleaseLocks(holder2.txn_id()), ElementsAre(400));
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder4.txn_id()).empty());
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder5.txn_id()).empty());
+
+  rapidjson::Document stats;
+  stats.SetObject();
+  lock_manager.GetStats(stats, 0);
+  ASSERT_EQ(stats[LOCK_TABLE_SIZE].GetUint64(), 0U);
+}
+
+TEST_F(CGLockManagerTest, BatchDependsOnPreviousBatch) {
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  auto holder1 = MakeTestTxnHolder(configs[0], 100, {{"A", KeyType::READ, 0}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"A", KeyType::WRITE, 0}});
+  auto holder3 = MakeTestTxnHolder(configs[0], 300, {{"A", KeyType::READ, 0}});
+
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+
+  lock_manager.BeginBatch();
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder3.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_TRUE(lock_manager.EndBatch().empty());
+
+  ASSERT_THAT(lock_manager.ReleaseLocks(holder1.txn_id()), ElementsAre(200));
+  ASSERT_THAT(lock_manager.ReleaseLocks(holder2.txn_id()), ElementsAre(300));
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder3.txn_id()).empty());
+}
+
+TEST_F(CGLockManagerTest, LockOnlyTxnsInSameBatch) {
+  auto configs = MakeTestConfigurations("locking", 2, 1);
+  auto holder1 = MakeTestTxnHolder(configs[0], 100, {{"A", KeyType::WRITE, 0}, {"B", KeyType::WRITE, 1}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"B", KeyType::READ, 1}});
+
+  lock_manager.BeginBatch();
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(1)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(1)), AcquireLocksResult::WAITING);
+  // The multi-home txn is returned only once
+  ASSERT_THAT(lock_manager.EndBatch(), ElementsAre(100));
+
+  ASSERT_THAT(lock_manager.ReleaseLocks(holder1.txn_id()), ElementsAre(200));
+}
+
+TEST_F(CGLockManagerTest, ReleaseLocksInsideBatch) {
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  auto holder1 = MakeTestTxnHolder(configs[0], 100, {{"A", KeyType::WRITE, 0}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"A", KeyType::WRITE, 0}});
+
+  lock_manager.BeginBatch();
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  // The first txn is aborted before the batch ends
+  ASSERT_THAT(lock_manager.ReleaseLocks(holder1.txn_id()), ElementsAre(200));
+  ASSERT_TRUE(lock_manager.EndBatch().empty());
+
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder2.txn_id()).empty());
+}
+
+TEST_F(CGLockManagerTest, WriterWaitsForWriterOfAbortedReader) {
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  auto holder1 = MakeTestTxnHolder(configs[0], 100, {{"A", KeyType::WRITE, 0}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"A", KeyType::READ, 0}});
+  auto holder3 = MakeTestTxnHolder(configs[0], 300, {{"A", KeyType::WRITE, 0}});
+
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  // The reader leaves early, e.g. due to a pre-dispatch abort
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder2.txn_id()).empty());
+  ASSERT_EQ(lock_manager.AcquireLocks(holder3.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_THAT(lock_manager.ReleaseLocks(holder1.txn_id()), ElementsAre(300));
+}
@@ -74,6 +74,29 @@ TEST_F(DDRLockManagerTest, ReleaseLocksAndReturnMultipleNewLockHolders) {
   ASSERT_TRUE(lock_manager.ReleaseLocks(holder3.txn_id()).empty());
 }
 
+TEST_F(DDRLockManagerTest, AddLocks) {
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  auto holder1 = MakeTestTxnHolder(configs[0], 100, {{"A", KeyType::ADD, 0}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"A", KeyType::ADD, 0}, {"B", KeyType::ADD, 0}});
+  auto holder3 = MakeTestTxnHolder(configs[0], 300, {{"A", KeyType::READ, 0}});
+  auto holder4 = MakeTestTxnHolder(configs[0], 400, {{"A", KeyType::ADD, 0}});
+  auto holder5 = MakeTestTxnHolder(configs[0], 500, {{"B", KeyType::WRITE, 0}});
+
+  // Adds to the same key do not block each other
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  // Reads and writes wait for the adds before them and the adds after them wait for the reads
+  ASSERT_EQ(lock_manager.AcquireLocks(holder3.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder4.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder5.lock_only_txn(0)), AcquireLocksResult::WAITING);
+
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder1.txn_id()).empty());
+  ASSERT_THAT(lock_manager.ReleaseLocks(holder2.txn_id()), UnorderedElementsAre(300, 500));
+  ASSERT_THAT(lock_manager.ReleaseLocks(holder3.txn_id()), ElementsAre(400));
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder4.txn_id()).empty());
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder5.txn_id()).empty());
+}
+
 TEST_F(DDRLockManagerTest, PartiallyAcquiredLocks) {
   auto configs = MakeTestConfigurations("locking", 1, 1);
   auto holder1 =
@@ -202,4 +225,34 @@ TEST_F(DDRLockManagerTest, LongChain) {
   ASSERT_THAT(result, ElementsAre(500));
 
   ASSERT_TRUE(lock_manager.ReleaseLocks(holder5.txn_id()).empty());
-}
\ No newline at end of file
+}
+
+TEST_F(DDRLockManagerTest, GarbageCollectLockTable) {
+  const int kNumTxns = 1000;
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  for (int i = 0; i < kNumTxns; i++) {
+    auto key = "key" + to_string(i);
+    auto holder = MakeTestTxnHolder(configs[0], 100 + i, {{key, KeyType::WRITE, 0}, {"hot", KeyType::READ, 0}});
+    ASSERT_EQ(lock_manager.AcquireLocks(holder.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+    ASSERT_TRUE(lock_manager.ReleaseLocks(holder.txn_id()).empty());
+  }
+
+  rapidjson::Document stats;
+  stats.SetObject();
+  lock_manager.GetStats(stats, 0);
+  // Every txn adds a new tail, which must be reclaimed after the txn leaves
+  ASSERT_LT(stats[LOCK_TABLE_SIZE].GetUint64(), 10U);
+  ASSERT_GT(stats[NUM_RECLAIMED_LOCK_QUEUE_TAILS].GetUint64(), kNumTxns - 10U);
+
+  // A lock held by a txn that is still in the lock manager is not reclaimed
+  auto holder1 = MakeTestTxnHolder(configs[0], 5000, {{"A", KeyType::WRITE, 0}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 6000, {{"A", KeyType::WRITE, 0}});
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  for (int i = 0; i < 10; i++) {
+    auto holder = MakeTestTxnHolder(configs[0], 7000 + i, {{"B", KeyType::WRITE, 0}});
+    ASSERT_EQ(lock_manager.AcquireLocks(holder.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+    ASSERT_TRUE(lock_manager.ReleaseLocks(holder.txn_id()).empty());
+  }
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_THAT(lock_manager.ReleaseLocks(holder1.txn_id()), ElementsAre(6000));
+}
@@ -71,6 +71,30 @@ TEST(OldLockManager, ReleaseLocksAndGetManyNewHolders) {
   ASSERT_THAT(ready_txns, UnorderedElementsAre(200, 400));
 }
 
+TEST(OldLockManager, AddLocks) {
+  OldLockManager lock_manager;
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  auto holder1 = MakeTestTxnHolder(configs[0], 100, {{"A", KeyType::ADD, 0}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"A", KeyType::ADD, 0}, {"B", KeyType::ADD, 0}});
+  auto holder3 = MakeTestTxnHolder(configs[0], 300, {{"A", KeyType::READ, 0}});
+  auto holder4 = MakeTestTxnHolder(configs[0], 400, {{"A", KeyType::ADD, 0}});
+  auto holder5 = MakeTestTxnHolder(configs[0], 500, {{"B", KeyType::WRITE, 0}});
+
+  // Adds to the same key do not block each other
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  // Reads and writes wait for the adds before them and the adds after them wait for the reads
+  ASSERT_EQ(lock_manager.AcquireLocks(holder3.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder4.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder5.lock_only_txn(0)), AcquireLocksResult::WAITING);
+
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder1.txn_id()).empty());
+  ASSERT_THAT(lock_manager.ReleaseLocks(holder2.txn_id()), UnorderedElementsAre(300, 500));
+  ASSERT_THAT(lock_manager.ReleaseLocks(holder3.txn_id()), ElementsAre(400));
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder4.txn_id()).empty());
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder5.txn_id()).empty());
+}
+
 TEST(OldLockManager, PartiallyAcquiredLocks) {
   auto configs = MakeTestConfigurations("locking", 1, 1);
   OldLockManager lock_manager;
@@ -68,6 +68,30 @@ TEST(RMALockManagerTest, ReleaseLocksAndGetMultipleNewLockHolders) {
   ASSERT_THAT(result, UnorderedElementsAre(200, 400));
 }
 
+TEST(RMALockManagerTest, AddLocks) {
+  RMALockManager lock_manager;
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  auto holder1 = MakeTestTxnHolder(configs[0], 100, {{"A", KeyType::ADD, 0}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"A", KeyType::ADD, 0}, {"B", KeyType::ADD, 0}});
+  auto holder3 = MakeTestTxnHolder(configs[0], 300, {{"A", KeyType::READ, 0}});
+  auto holder4 = MakeTestTxnHolder(configs[0], 400, {{"A", KeyType::ADD, 0}});
+  auto holder5 = MakeTestTxnHolder(configs[0], 500, {{"B", KeyType::WRITE, 0}});
+
+  // Adds to the same key do not block each other
+  ASSERT_EQ(lock_manager.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder2.lock_only_txn(0)), AcquireLocksResult::ACQUIRED);
+  // Reads and writes wait for the adds before them and the adds after them wait for the reads
+  ASSERT_EQ(lock_manager.AcquireLocks(holder3.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder4.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager.AcquireLocks(holder5.lock_only_txn(0)), AcquireLocksResult::WAITING);
+
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder1.txn_id()).empty());
+  ASSERT_THAT(lock_manager.ReleaseLocks(holder2.txn_id()), UnorderedElementsAre(300, 500));
+  ASSERT_THAT(lock_manager.ReleaseLocks(holder3.txn_id()), ElementsAre(400));
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder4.txn_id()).empty());
+  ASSERT_TRUE(lock_manager.ReleaseLocks(holder5.txn_id()).empty());
+}
+
 TEST(RMALockManagerTest, PartiallyAcquiredLocks) {
   RMALockManager lock_manager;
   auto configs = MakeTestConfigurations("locking", 1, 1);
@@ -141,4 +165,126 @@ TEST(RMALockManagerTest, RemasterTxn) {
   ASSERT_EQ(lock_manager.AcquireLocks(holder.lock_only_txn(1)), AcquireLocksResult::ACQUIRED);
   lock_manager.ReleaseLocks(holder.txn_id());
 }
-#endif
\ No newline at end of file
+#endif
+
+class ShardedRMALockManagerTest : public ::testing::Test {
+ protected:
+  static constexpr uint32_t kNumShards = 4;
+
+  void SetUp() {
+    context_ = make_shared<zmq::context_t>(1);
+    socket_ = lock_manager_.StartShards(context_, kNumShards, {}, 5ms);
+  }
+
+  // Collects the txns that become ready from the replies of the lock threads
+  vector<TxnId> ReceiveReadyTxns(size_t num_txns) {
+    vector<TxnId> ready_txns;
+    vector<zmq::pollitem_t> poll_items{{static_cast<void*>(socket_), 0, ZMQ_POLLIN, 0}};
+    while (ready_txns.size() < num_txns && zmq::poll(poll_items, 1000ms) > 0) {
+      for (zmq::message_t msg; socket_.recv(msg, zmq::recv_flags::dontwait);) {
+        auto new_ready_txns = lock_manager_.ProcessShardReply(msg);
+        ready_txns.insert(ready_txns.end(), new_ready_txns.begin(), new_ready_txns.end());
+      }
+    }
+    return ready_txns;
+  }
+
+  shared_ptr<zmq::context_t> context_;
+  RMALockManager lock_manager_;
+  zmq::socket_t socket_;
+};
+
+TEST_F(ShardedRMALockManagerTest, PartiallyAcquiredLocks) {
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  auto holder1 =
+      MakeTestTxnHolder(configs[0], 100, {{"A", KeyType::READ, 0}, {"B", KeyType::WRITE, 0}, {"C", KeyType::WRITE, 0}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"A", KeyType::READ, 0}, {"B", KeyType::WRITE, 0}});
+  auto holder3 = MakeTestTxnHolder(configs[0], 300, {{"A", KeyType::WRITE, 0}, {"C", KeyType::WRITE, 0}});
+
+  // Locks are granted by the lock threads so no txn is ready right away
+  ASSERT_EQ(lock_manager_.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager_.AcquireLocks(holder2.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager_.AcquireLocks(holder3.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_THAT(ReceiveReadyTxns(1), ElementsAre(100));
+
+  ASSERT_TRUE(lock_manager_.ReleaseLocks(holder1.txn_id()).empty());
+  ASSERT_THAT(ReceiveReadyTxns(1), ElementsAre(200));
+
+  ASSERT_TRUE(lock_manager_.ReleaseLocks(holder2.txn_id()).empty());
+  ASSERT_THAT(ReceiveReadyTxns(1), ElementsAre(300));
+}
+
+TEST_F(ShardedRMALockManagerTest, AcquireLocksWithLockOnly) {
+  auto configs = MakeTestConfigurations("locking", 2, 1);
+  auto holder1 =
+      MakeTestTxnHolder(configs[0], 100, {{"A", KeyType::READ, 0}, {"B", KeyType::WRITE, 0}, {"C", KeyType::WRITE, 0}});
+  auto holder2 = MakeTestTxnHolder(configs[0], 200, {{"A", KeyType::READ, 1}, {"B", KeyType::WRITE, 0}});
+
+  ASSERT_EQ(lock_manager_.AcquireLocks(holder2.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager_.AcquireLocks(holder1.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  ASSERT_EQ(lock_manager_.AcquireLocks(holder2.lock_only_txn(1)), AcquireLocksResult::WAITING);
+  ASSERT_THAT(ReceiveReadyTxns(1), ElementsAre(200));
+
+  ASSERT_TRUE(lock_manager_.ReleaseLocks(holder2.txn_id()).empty());
+  ASSERT_THAT(ReceiveReadyTxns(1), ElementsAre(100));
+}
+
+TEST_F(ShardedRMALockManagerTest, HotKeyLocksFollowLogOrder) {
+  const int kNumTxns = 50;
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  vector<TxnHolder> holders;
+  for (int i = 1; i <= kNumTxns; i++) {
+    holders.push_back(MakeTestTxnHolder(configs[0], i * 100,
+                                        {{"hot", KeyType::WRITE, 0},
+                                         {"cold" + to_string(i), KeyType::WRITE, 0},
+                                         {"warm" + to_string(i % 5), KeyType::READ, 0}}));
+  }
+  for (auto& holder : holders) {
+    ASSERT_EQ(lock_manager_.AcquireLocks(holder.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  }
+  // Every txn waits for the hot key so they must become ready one by one in log order
+  for (auto& holder : holders) {
+    ASSERT_THAT(ReceiveReadyTxns(1), ElementsAre(holder.txn_id()));
+    lock_manager_.ReleaseLocks(holder.txn_id());
+  }
+}
+
+TEST_F(ShardedRMALockManagerTest, BatchedRequests) {
+  const int kNumTxns = 20;
+  auto configs = MakeTestConfigurations("locking", 1, 1);
+  vector<TxnHolder> holders;
+  vector<TxnId> txn_ids;
+  for (int i = 1; i <= kNumTxns; i++) {
+    holders.push_back(MakeTestTxnHolder(configs[0], i * 100,
+                                        {{"key" + to_string(i), KeyType::WRITE, 0},
+                                         {"shared" + to_string(i % 3), KeyType::READ, 0}}));
+    txn_ids.push_back(i * 100);
+  }
+
+  lock_manager_.BeginBatch();
+  for (auto& holder : holders) {
+    ASSERT_EQ(lock_manager_.AcquireLocks(holder.lock_only_txn(0)), AcquireLocksResult::WAITING);
+  }
+  // Nothing is sent to the lock threads until the batch ends
+  ASSERT_TRUE(ReceiveReadyTxns(1).empty());
+  lock_manager_.EndBatch();
+
+  auto ready_txns = ReceiveReadyTxns(kNumTxns);
+  sort(ready_txns.begin(), ready_txns.end());
+  ASSERT_EQ(ready_txns, txn_ids);
+
+  // One message per lock thread for the whole batch
+  rapidjson::Document stats;
+  stats.SetObject();
+  lock_manager_.GetStats(stats, 0);
+  ASSERT_LE(stats[NUM_LOCK_SHARD_MESSAGES].GetUint64(), kNumShards);
+
+  lock_manager_.BeginBatch();
+  for (auto& holder : holders) {
+    ASSERT_TRUE(lock_manager_.ReleaseLocks(holder.txn_id()).empty());
+  }
+  lock_manager_.EndBatch();
+  stats.SetObject();
+  lock_manager_.GetStats(stats, 0);
+  ASSERT_LE(stats[NUM_LOCK_SHARD_MESSAGES].GetUint64(), 2 * kNumShards);
+}
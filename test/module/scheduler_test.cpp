@@ -1,8 +1,12 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <map>
 #include <vector>
 
+#include "common/constants.h"
 #include "common/proto_utils.h"
+#include "rapidjson/document.h"
 #include "test/test_utils.h"
 
 using namespace std;
@@ -15,7 +19,7 @@ class SchedulerTest : public ::testing::Test {
   static const uint32_t kNumPartitions = 3;
 
   void SetUp() {
-    ConfigVec configs = MakeTestConfigurations("scheduler", kNumReplicas, kNumPartitions);
+    ConfigVec configs = MakeTestConfigurations("scheduler", kNumReplicas, kNumPartitions, CommonConfig());
 
     for (size_t i = 0; i < kNumMachines; i++) {
       test_slogs[i] = make_unique<TestSlog>(configs[i]);
@@ -91,6 +95,8 @@ class SchedulerTest : public ::testing::Test {
     return txn;
   }
 
+  virtual internal::Configuration CommonConfig() { return {}; }
+
   MachineId MakeMachineId(int replica, int partition) { return replica * kNumPartitions + partition; }
 
   unique_ptr<TestSlog> test_slogs[kNumMachines];
@@ -387,6 +393,213 @@ TEST_F(SchedulerTest, AbortMultiHomeMultiPartition2Active) {
   ASSERT_EQ(output_txn.status(), TransactionStatus::ABORTED);
 }
 
+TEST_F(SchedulerTest, BatchOnArena) {
+  auto env = google::protobuf::Arena::CreateMessage<internal::Envelope>(NewArena().release());
+  auto batch = env->mutable_request()->mutable_forward_batch_data()->add_batch_data();
+  auto txn1 = MakeTestTransaction(test_slogs[0]->config(), 1000,
+                                  {{"C", KeyType::READ, {{0, 1}}}, {"F", KeyType::WRITE, {{0, 1}}}},
+                                  {{"GET", "C"}, {"SET", "F", "newF"}}, {}, MakeMachineId(0, 1));
+  auto txn2 = MakeTestTransaction(test_slogs[0]->config(), 2000, {{"F", KeyType::READ, {{0, 1}}}}, {{"GET", "F"}},
+                                  {}, MakeMachineId(0, 1));
+  batch->add_transactions()->CopyFrom(*txn1);
+  batch->add_transactions()->CopyFrom(*txn2);
+  delete txn1;
+  delete txn2;
+
+  // The scheduler takes over the arena along with the envelope
+  sender[1]->Send(EnvelopePtr(env), kSchedulerChannel);
+
+  auto output_txn1 = ReceiveMultipleAndMerge(1, 1);
+  ASSERT_EQ(output_txn1.internal().id(), 1000U);
+  ASSERT_EQ(output_txn1.status(), TransactionStatus::COMMITTED);
+  ASSERT_EQ(TxnValueEntry(output_txn1, "C").value(), "valueC");
+
+  auto output_txn2 = ReceiveMultipleAndMerge(1, 1);
+  ASSERT_EQ(output_txn2.internal().id(), 2000U);
+  ASSERT_EQ(output_txn2.status(), TransactionStatus::COMMITTED);
+  ASSERT_EQ(TxnValueEntry(output_txn2, "F").value(), "newF");
+}
+
+TEST_F(SchedulerTest, DropDuplicateSingleHomeTransaction) {
+  EnvelopePtr env = make_unique<internal::Envelope>();
+  auto batch = env->mutable_request()->mutable_forward_batch_data()->add_batch_data();
+  auto txn1 = MakeTestTransaction(test_slogs[0]->config(), 1000, {{"F", KeyType::WRITE, {{0, 1}}}},
+                                  {{"SET", "F", "newF"}}, {}, MakeMachineId(0, 1));
+  auto txn2 = MakeTestTransaction(test_slogs[0]->config(), 2000, {{"F", KeyType::READ, {{0, 1}}}}, {{"GET", "F"}},
+                                  {}, MakeMachineId(0, 1));
+  // The duplicate arrives while the first copy is still active since the whole batch is processed at once
+  batch->add_transactions()->CopyFrom(*txn1);
+  batch->add_transactions()->CopyFrom(*txn1);
+  batch->add_transactions()->CopyFrom(*txn2);
+  delete txn1;
+  delete txn2;
+
+  sender[1]->Send(move(env), kSchedulerChannel);
+
+  auto output_txn1 = ReceiveMultipleAndMerge(1, 1);
+  ASSERT_EQ(output_txn1.internal().id(), 1000U);
+  ASSERT_EQ(output_txn1.status(), TransactionStatus::COMMITTED);
+
+  // The duplicate is not executed
+  auto output_txn2 = ReceiveMultipleAndMerge(1, 1);
+  ASSERT_EQ(output_txn2.internal().id(), 2000U);
+  ASSERT_EQ(TxnValueEntry(output_txn2, "F").value(), "newF");
+}
+
+class MultiWorkerSchedulerTest : public SchedulerTest, public ::testing::WithParamInterface<internal::WorkerHandoff> {
+ protected:
+  internal::Configuration CommonConfig() override {
+    internal::Configuration config;
+    config.set_num_workers(4);
+    config.set_worker_handoff(GetParam());
+    return config;
+  }
+};
+
+TEST_P(MultiWorkerSchedulerTest, MultiPartitionTransactions) {
+  // The txns conflict with each other so the remote reads of a txn often arrive at a partition
+  // before the txn is dispatched there
+  const int kNumTxns = 20;
+  for (int i = 1; i <= kNumTxns; i++) {
+    auto txn = MakeTestTransaction(test_slogs[0]->config(), i * kMaxNumMachines,
+                                   {{"B", KeyType::WRITE, {{0, 1}}}, {"C", KeyType::WRITE, {{0, 1}}}},
+                                   {{"COPY", "C", "B"}, {"COPY", "B", "C"}});
+    SendTransaction(txn);
+  }
+
+  std::map<TxnId, int> num_subtxns;
+  for (int i = 0; i < 2 * kNumTxns; i++) {
+    auto env = test_slogs[0]->ReceiveFromOutputSocket(kServerChannel);
+    ASSERT_NE(env, nullptr);
+    const auto& txn = env->request().completed_subtxn().txn();
+    ASSERT_EQ(txn.status(), TransactionStatus::COMMITTED);
+    // Both partitions see the same values
+    ASSERT_EQ(TxnValueEntry(txn, "B").new_value(), TxnValueEntry(txn, "C").value());
+    ASSERT_EQ(TxnValueEntry(txn, "C").new_value(), TxnValueEntry(txn, "B").value());
+    num_subtxns[txn.internal().id()]++;
+  }
+  ASSERT_EQ(num_subtxns.size(), static_cast<size_t>(kNumTxns));
+  for (auto [txn_id, n] : num_subtxns) {
+    ASSERT_EQ(n, 2) << "Txn " << txn_id;
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(AllHandoffs, MultiWorkerSchedulerTest,
+                         ::testing::Values(internal::WorkerHandoff::LOCK_FREE_QUEUE,
+                                           internal::WorkerHandoff::ZMQ_SOCKET));
+
+class KeyAffinitySchedulerTest : public SchedulerTest,
+                                  public ::testing::WithParamInterface<internal::WorkerHandoff> {
+ protected:
+  static constexpr uint32_t kNumWorkers = 4;
+
+  internal::Configuration CommonConfig() override {
+    internal::Configuration config;
+    config.set_num_workers(kNumWorkers);
+    config.set_worker_handoff(GetParam());
+    config.set_worker_dispatch_policy(internal::WorkerDispatchPolicy::KEY_AFFINITY);
+    return config;
+  }
+
+  // Sends a batch of single-partition txns that all add to key C. The txns do not block each other
+  // in the lock manager so they are all dispatched at once. The first txn sleeps so that the other
+  // txns sent to its worker are still unfinished when the stats are taken
+  void SendAddBatch(TxnId first_id, int num_txns, const vector<int>& sleeping_txns) {
+    EnvelopePtr env = make_unique<internal::Envelope>();
+    auto batch = env->mutable_request()->mutable_forward_batch_data()->add_batch_data();
+    for (int i = 0; i < num_txns; i++) {
+      vector<vector<string>> code{{"ADD", "C", "1"}};
+      if (find(sleeping_txns.begin(), sleeping_txns.end(), i) != sleeping_txns.end()) {
+        code.push_back({"SLEEP", "1000"});
+      }
+      auto txn = MakeTestTransaction(test_slogs[1]->config(), first_id + i, {{"C", KeyType::ADD, {{0, 1}}}}, code,
+                                     {}, MakeMachineId(0, 1));
+      batch->add_transactions()->CopyFrom(*txn);
+      delete txn;
+    }
+    sender[1]->Send(move(env), kSchedulerChannel);
+  }
+
+  // The stats request is sent after the txns on the same channel so it is processed after they are dispatched
+  rapidjson::Document GetSchedulerStats() {
+    EnvelopePtr env = make_unique<internal::Envelope>();
+    env->mutable_request()->mutable_stats()->set_level(0);
+    sender[1]->Send(move(env), kSchedulerChannel);
+
+    auto res = test_slogs[1]->ReceiveFromOutputSocket(kServerChannel);
+    CHECK(res != nullptr);
+    CHECK(res->has_response());
+    rapidjson::Document stats;
+    stats.Parse(res->response().stats().stats_json().c_str());
+    return stats;
+  }
+
+  vector<uint32_t> GetArray(const rapidjson::Document& stats, const char* name) {
+    vector<uint32_t> result;
+    for (const auto& v : stats[name].GetArray()) {
+      result.push_back(v.GetUint());
+    }
+    return result;
+  }
+};
+
+TEST_P(KeyAffinitySchedulerTest, SameKeyOnOneWorker) {
+  const int kNumTxns = 8;
+  SendAddBatch(1000, kNumTxns, {0});
+
+  auto stats = GetSchedulerStats();
+  auto loads = GetArray(stats, WORKER_LOADS);
+  ASSERT_EQ(loads.size(), kNumWorkers);
+  uint32_t worker = max_element(loads.begin(), loads.end()) - loads.begin();
+  for (uint32_t i = 0; i < kNumWorkers; i++) {
+    ASSERT_EQ(loads[i], i == worker ? kNumTxns : 0U) << "Worker " << i;
+  }
+  if (GetParam() == internal::WorkerHandoff::LOCK_FREE_QUEUE) {
+    // The worker may or may not have taken the first txn out of its queue yet
+    auto depths = GetArray(stats, WORKER_QUEUE_DEPTHS);
+    for (uint32_t i = 0; i < kNumWorkers; i++) {
+      if (i == worker) {
+        ASSERT_GE(depths[i], kNumTxns - 1U);
+      } else {
+        ASSERT_EQ(depths[i], 0U) << "Worker " << i;
+      }
+    }
+  }
+
+  for (int i = 0; i < kNumTxns; i++) {
+    auto output_txn = ReceiveMultipleAndMerge(1, 1);
+    ASSERT_EQ(output_txn.status(), TransactionStatus::COMMITTED);
+  }
+}
+
+TEST_P(KeyAffinitySchedulerTest, FallBackToLeastLoadedWorker) {
+  // The last txn arrives when the worker of the key already has the maximum load
+  const int kNumTxns = kMaxWorkerLoadForKeyAffinity + 1;
+  SendAddBatch(1000, kNumTxns, {0, kNumTxns - 1});
+
+  auto loads = GetArray(GetSchedulerStats(), WORKER_LOADS);
+  ASSERT_EQ(loads.size(), kNumWorkers);
+  uint32_t worker = max_element(loads.begin(), loads.end()) - loads.begin();
+  ASSERT_EQ(loads[worker], kMaxWorkerLoadForKeyAffinity);
+  int num_other_workers_with_load = 0;
+  for (uint32_t i = 0; i < kNumWorkers; i++) {
+    if (i != worker && loads[i] > 0) {
+      ASSERT_EQ(loads[i], 1U) << "Worker " << i;
+      num_other_workers_with_load++;
+    }
+  }
+  ASSERT_EQ(num_other_workers_with_load, 1);
+
+  for (int i = 0; i < kNumTxns; i++) {
+    auto output_txn = ReceiveMultipleAndMerge(1, 1);
+    ASSERT_EQ(output_txn.status(), TransactionStatus::COMMITTED);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(AllHandoffs, KeyAffinitySchedulerTest,
+                         ::testing::Values(internal::WorkerHandoff::LOCK_FREE_QUEUE,
+                                           internal::WorkerHandoff::ZMQ_SOCKET));
+
 int main(int argc, char* argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
   google::InstallFailureSignalHandler();
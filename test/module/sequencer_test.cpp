@@ -332,6 +332,37 @@ TEST_P(SequencerTest, MultiHomeTransactionBypassedOrderer) {
   }
 }
 
+TEST(SequencerBatchingTest, FullBatchIsSentBeforeDelay) {
+  internal::Configuration extra_config;
+  extra_config.mutable_sequencer_batching()->set_max_batch_size(2);
+  // Long enough that only a full batch can be received within the test
+  extra_config.mutable_sequencer_batching()->set_max_delay_us(60000000);
+  auto configs = MakeTestConfigurations("sequencer_batching", 1, 1, extra_config);
+
+  TestSlog slog(configs[0]);
+  slog.AddSequencer();
+  slog.AddOutputSocket(kLocalLogChannel);
+  auto sender = slog.NewSender();
+  slog.StartInNewThreads();
+
+  for (int i = 0; i < 2; i++) {
+    auto txn = MakeTestTransaction(configs[0], 1000 + i, {{"A", KeyType::WRITE, 0}});
+    auto env = make_unique<Envelope>();
+    env->mutable_request()->mutable_forward_txn()->mutable_txn()->CopyFrom(*txn);
+    sender->Send(move(env), kSequencerChannel);
+  }
+
+  auto req_env = slog.ReceiveFromOutputSocket(kLocalLogChannel);
+  ASSERT_TRUE(req_env != nullptr);
+  ASSERT_EQ(req_env->request().type_case(), Request::kForwardBatchData);
+  const auto& forward_batch = req_env->request().forward_batch_data();
+  ASSERT_EQ(forward_batch.batch_data_size(), 1);
+  const auto& batch = forward_batch.batch_data(0);
+  ASSERT_EQ(batch.transactions_size(), 2);
+  ASSERT_EQ(batch.transactions(0).internal().id(), 1000);
+  ASSERT_EQ(batch.transactions(1).internal().id(), 1001);
+}
+
 INSTANTIATE_TEST_SUITE_P(AllSequencerTests, SequencerTest, testing::Values(false, true),
                          [](const testing::TestParamInfo<bool>& info) {
                            return info.param ? "Delayed" : "NotDelayed";
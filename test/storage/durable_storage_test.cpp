@@ -0,0 +1,301 @@
+#include "storage/durable_storage.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+
+using namespace std;
+using namespace slog;
+
+class DurableStorageTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    char dir_template[] = "/tmp/durable_storage_test_XXXXXX";
+    ASSERT_NE(mkdtemp(dir_template), nullptr);
+    options_.dir = dir_template;
+  }
+
+  void TearDown() {
+    for (const auto& file : ListFiles()) {
+      unlink((options_.dir + "/" + file).c_str());
+    }
+    rmdir(options_.dir.c_str());
+  }
+
+  vector<string> ListFiles() {
+    vector<string> files;
+    auto d = opendir(options_.dir.c_str());
+    while (auto ent = readdir(d)) {
+      string name(ent->d_name);
+      if (name != "." && name != "..") {
+        files.push_back(name);
+      }
+    }
+    closedir(d);
+    sort(files.begin(), files.end());
+    return files;
+  }
+
+  void AssertValue(const DurableStorage& storage, const Key& key, const string& value, uint32_t master = 0) {
+    Record record;
+    ASSERT_TRUE(storage.Read(key, record)) << "Key " << key << " not found";
+    ASSERT_EQ(record.value(), value);
+    ASSERT_EQ(record.metadata().master, master);
+  }
+
+  DurableStorageOptions options_;
+};
+
+TEST_F(DurableStorageTest, RecoverFromLog) {
+  {
+    DurableStorage storage(options_);
+    ASSERT_FALSE(storage.recovered());
+    storage.Write("A", Record("valA", 1, 2));
+    storage.Write("B", Record("valB"));
+    storage.Write("C", Record("valC"));
+    storage.Write("A", Record("newA", 1, 3));
+    storage.Delete("B");
+  }
+  DurableStorage storage(options_);
+  ASSERT_TRUE(storage.recovered());
+  ASSERT_EQ(storage.num_recovered_records(), 0U);
+  ASSERT_EQ(storage.num_replayed_log_entries(), 5U);
+  AssertValue(storage, "A", "newA", 1);
+  AssertValue(storage, "C", "valC");
+  Record record;
+  ASSERT_FALSE(storage.Read("B", record));
+  Metadata metadata;
+  ASSERT_TRUE(storage.ReadMetadata("A", metadata));
+  ASSERT_EQ(metadata.counter, 3U);
+}
+
+TEST_F(DurableStorageTest, NotInitializedAfterRecoveringFromLog) {
+  {
+    DurableStorage storage(options_);
+    ASSERT_FALSE(storage.initialized());
+    storage.Write("A", Record("valA"));
+    storage.Write("B", Record("valB"));
+  }
+  // Simulate a crash in the middle of the initial load, before any checkpoint
+  DurableStorage storage(options_);
+  ASSERT_TRUE(storage.recovered());
+  ASSERT_FALSE(storage.initialized());
+  ASSERT_EQ(storage.num_recovered_records(), 0U);
+  ASSERT_EQ(storage.num_replayed_log_entries(), 2U);
+}
+
+TEST_F(DurableStorageTest, InitializedAfterMarking) {
+  {
+    DurableStorage storage(options_);
+    storage.Write("A", Record("valA"));
+    // A checkpoint taken in the background in the middle of the initial load
+    storage.Checkpoint();
+    storage.Write("B", Record("valB"));
+  }
+  {
+    DurableStorage storage(options_);
+    ASSERT_TRUE(storage.recovered());
+    ASSERT_FALSE(storage.initialized());
+    storage.Write("C", Record("valC"));
+    storage.MarkInitialized();
+    ASSERT_TRUE(storage.initialized());
+  }
+  DurableStorage storage(options_);
+  ASSERT_TRUE(storage.initialized());
+  ASSERT_EQ(storage.num_recovered_records(), 3U);
+  ASSERT_EQ(storage.num_replayed_log_entries(), 0U);
+  AssertValue(storage, "A", "valA");
+  AssertValue(storage, "B", "valB");
+  AssertValue(storage, "C", "valC");
+}
+
+TEST_F(DurableStorageTest, RecoverUpdatesFromLog) {
+  const int kNumUpdatesPerThread = 1000;
+  auto increment = [](Record& record) { record.SetValue(to_string(stoi("0" + record.value()) + 1)); };
+  {
+    DurableStorage storage(options_);
+    auto Increments = [&]() {
+      for (int i = 0; i < kNumUpdatesPerThread; i++) {
+        storage.Update("A", increment);
+      }
+    };
+    thread t1(Increments);
+    thread t2(Increments);
+    t1.join();
+    t2.join();
+    AssertValue(storage, "A", to_string(2 * kNumUpdatesPerThread));
+  }
+  // The last logged record is the result of the last update
+  DurableStorage storage(options_);
+  ASSERT_EQ(storage.num_replayed_log_entries(), 2U * kNumUpdatesPerThread);
+  AssertValue(storage, "A", to_string(2 * kNumUpdatesPerThread));
+}
+
+TEST_F(DurableStorageTest, RecoverFromCheckpointAndLog) {
+  {
+    DurableStorage storage(options_);
+    for (int i = 0; i < 100; i++) {
+      storage.Write(to_string(i), Record("old"));
+    }
+    storage.Checkpoint();
+    for (int i = 0; i < 10; i++) {
+      storage.Write(to_string(i), Record("new"));
+    }
+    storage.Delete("99");
+  }
+  {
+    DurableStorage storage(options_);
+    ASSERT_EQ(storage.num_recovered_records(), 100U);
+    ASSERT_EQ(storage.num_replayed_log_entries(), 11U);
+    for (int i = 0; i < 99; i++) {
+      AssertValue(storage, to_string(i), i < 10 ? "new" : "old");
+    }
+    Record record;
+    ASSERT_FALSE(storage.Read("99", record));
+
+    // The segments covered by the new checkpoint are removed
+    storage.Checkpoint();
+  }
+  auto files = ListFiles();
+  ASSERT_EQ(files.size(), 2U);
+  ASSERT_EQ(files[0], "checkpoint");
+
+  DurableStorage storage(options_);
+  ASSERT_EQ(storage.num_recovered_records(), 99U);
+  ASSERT_EQ(storage.num_replayed_log_entries(), 0U);
+}
+
+TEST_F(DurableStorageTest, IgnoreTornTail) {
+  {
+    DurableStorage storage(options_);
+    storage.Write("A", Record("valA"));
+    storage.Write("B", Record("valB"));
+  }
+  // Simulate a crash in the middle of writing an entry
+  auto segment = options_.dir + "/" + ListFiles().back();
+  auto fd = open(segment.c_str(), O_WRONLY | O_APPEND);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(write(fd, "\x20\x00\x00\x00garbage", 11), 11);
+  close(fd);
+  {
+    DurableStorage storage(options_);
+    ASSERT_EQ(storage.num_replayed_log_entries(), 2U);
+    storage.Write("C", Record("valC"));
+  }
+  DurableStorage storage(options_);
+  ASSERT_EQ(storage.num_replayed_log_entries(), 3U);
+  AssertValue(storage, "A", "valA");
+  AssertValue(storage, "B", "valB");
+  AssertValue(storage, "C", "valC");
+}
+
+TEST_F(DurableStorageTest, CorruptEntryInTheMiddleOfLog) {
+  // Every restart starts a new segment
+  {
+    DurableStorage storage(options_);
+    storage.Write("A", Record("valA"));
+    storage.Write("B", Record("valB"));
+  }
+  {
+    DurableStorage storage(options_);
+    storage.Write("A", Record("staleA"));
+  }
+  {
+    DurableStorage storage(options_);
+    storage.Write("C", Record("valC"));
+  }
+  ASSERT_EQ(ListFiles().size(), 3U);
+  // Corrupt the last entry of the first segment
+  auto segment = options_.dir + "/" + ListFiles().front();
+  auto fd = open(segment.c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  auto size = lseek(fd, 0, SEEK_END);
+  ASSERT_EQ(pwrite(fd, "\xFF", 1, size - 1), 1);
+  close(fd);
+  {
+    DurableStorage storage(options_);
+    ASSERT_EQ(storage.num_replayed_log_entries(), 1U);
+    AssertValue(storage, "A", "valA");
+    storage.Write("D", Record("valD"));
+  }
+  // The segments after the corrupt entry are not replayed on top of the newer entries
+  DurableStorage storage(options_);
+  ASSERT_EQ(storage.num_replayed_log_entries(), 2U);
+  AssertValue(storage, "A", "valA");
+  AssertValue(storage, "D", "valD");
+  Record record;
+  ASSERT_FALSE(storage.Read("B", record));
+  ASSERT_FALSE(storage.Read("C", record));
+}
+
+TEST_F(DurableStorageTest, MissingBeginningOfLog) {
+  {
+    DurableStorage storage(options_);
+    storage.Write("A", Record("valA"));
+  }
+  {
+    DurableStorage storage(options_);
+    storage.Write("B", Record("valB"));
+  }
+  unlink((options_.dir + "/" + ListFiles().front()).c_str());
+  DurableStorage storage(options_);
+  ASSERT_EQ(storage.num_replayed_log_entries(), 0U);
+  Record record;
+  ASSERT_FALSE(storage.Read("B", record));
+}
+
+TEST_F(DurableStorageTest, SynchronousCommitWithDirectIO) {
+  const int kNumWriters = 4;
+  options_.use_direct_io = true;
+  options_.synchronous_commit = true;
+  // Long enough for the writes of the other writers to join each flush
+  options_.group_commit_interval = chrono::milliseconds(1);
+  {
+    DurableStorage storage(options_);
+    auto Writes = [&storage](int start) {
+      for (int i = start; i < 200; i += kNumWriters) {
+        storage.Write(to_string(i), Record(string(i * 50, 'x')));
+      }
+    };
+    vector<thread> writers;
+    for (int i = 0; i < kNumWriters; i++) {
+      writers.emplace_back(Writes, i);
+    }
+    for (auto& w : writers) {
+      w.join();
+    }
+    // Writes are grouped into fewer flushes
+    ASSERT_LT(storage.log().num_flushes(), 200U);
+  }
+  DurableStorage storage(options_);
+  ASSERT_EQ(storage.num_replayed_log_entries(), 200U);
+  for (int i = 0; i < 200; i++) {
+    AssertValue(storage, to_string(i), string(i * 50, 'x'));
+  }
+}
+
+TEST_F(DurableStorageTest, CheckpointDuringWrites) {
+  const int kNumKeys = 1000;
+  {
+    DurableStorage storage(options_);
+    thread writer([&storage] {
+      for (int round = 0; round < 5; round++) {
+        for (int i = 0; i < kNumKeys; i++) {
+          storage.Write(to_string(i), Record(to_string(round)));
+        }
+      }
+    });
+    for (int i = 0; i < 3; i++) {
+      storage.Checkpoint();
+    }
+    writer.join();
+  }
+  DurableStorage storage(options_);
+  for (int i = 0; i < kNumKeys; i++) {
+    AssertValue(storage, to_string(i), "4");
+  }
+}
@@ -17,4 +17,41 @@ TEST(MemOnlyStorageTest, ReadWriteTest) {
   bool ok = storage.Read(key, ret);
   ASSERT_TRUE(ok);
   ASSERT_EQ(value, ret.to_string());
+}
+
+TEST(MemOnlyStorageTest, ReadDoesNotCopyValue) {
+  MemOnlyStorage storage;
+  storage.Write("key1", Record(std::string(1000, 'x'), 1, 2));
+
+  Record ret1, ret2;
+  ASSERT_TRUE(storage.Read("key1", ret1));
+  ASSERT_TRUE(storage.Read("key1", ret2));
+  ASSERT_EQ(ret1.data(), ret2.data());
+  ASSERT_EQ(ret1.value(), std::string(1000, 'x'));
+
+  // Overwriting the record does not affect the values that were read before
+  storage.Write("key1", Record("value2", 1, 3));
+  ASSERT_EQ(ret1.value(), std::string(1000, 'x'));
+}
+
+TEST(MemOnlyStorageTest, ReadMetadata) {
+  MemOnlyStorage storage;
+  storage.Write("key1", Record("value1", 1, 2));
+
+  Metadata metadata;
+  ASSERT_TRUE(storage.ReadMetadata("key1", metadata));
+  ASSERT_EQ(metadata.master, 1U);
+  ASSERT_EQ(metadata.counter, 2U);
+  ASSERT_FALSE(storage.ReadMetadata("key2", metadata));
+}
+
+TEST(MemOnlyStorageTest, Update) {
+  MemOnlyStorage storage;
+  auto append_x = [](Record& record) { record.SetValue(record.value() + "x"); };
+  ASSERT_FALSE(storage.Update("key1", append_x));
+  ASSERT_TRUE(storage.Update("key1", append_x));
+
+  Record ret;
+  ASSERT_TRUE(storage.Read("key1", ret));
+  ASSERT_EQ(ret.value(), "xx");
 }
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "storage/snapshot.h"
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <mutex>
+#include <unordered_map>
+
+#include "storage/mem_only_storage.h"
+#include "storage/write_ahead_log.h"
+
+using namespace std;
+using namespace slog;
+
+class SnapshotTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    char path_template[] = "/tmp/snapshot_test_XXXXXX";
+    auto fd = mkstemp(path_template);
+    ASSERT_GE(fd, 0);
+    close(fd);
+    path_ = path_template;
+  }
+
+  void TearDown() { unlink(path_.c_str()); }
+
+  string path_;
+};
+
+TEST_F(SnapshotTest, WriteAndRead) {
+  {
+    SnapshotWriter writer(path_, 2, 4, 123);
+    writer.Add("A", Record("valA", 1, 5));
+    writer.Add("B", Record("valB", 0, 0));
+    writer.Add("", Record("", 3, 1));
+    writer.Finish();
+    ASSERT_EQ(writer.num_records(), 3U);
+  }
+  SnapshotReader reader(path_);
+  ASSERT_EQ(reader.version(), kSnapshotVersion);
+  ASSERT_EQ(reader.partition(), 2U);
+  ASSERT_EQ(reader.num_partitions(), 4U);
+  ASSERT_EQ(reader.sequence(), 123U);
+  ASSERT_EQ(reader.num_records(), 3U);
+  ASSERT_EQ(reader.num_chunks(), 1U);
+
+  vector<tuple<string, string, uint32_t, uint32_t>> records;
+  reader.ForEachInChunk(0, [&](string_view key, string_view value, const Metadata& metadata) {
+    records.emplace_back(key, value, metadata.master, metadata.counter);
+  });
+  ASSERT_EQ(records.size(), 3U);
+  ASSERT_EQ(records[0], make_tuple("A", "valA", 1U, 5U));
+  ASSERT_EQ(records[1], make_tuple("B", "valB", 0U, 0U));
+  ASSERT_EQ(records[2], make_tuple("", "", 3U, 1U));
+}
+
+TEST_F(SnapshotTest, EmptySnapshot) {
+  SnapshotWriter(path_).Finish();
+  SnapshotReader reader(path_);
+  ASSERT_EQ(reader.num_records(), 0U);
+  ASSERT_EQ(reader.num_chunks(), 0U);
+  reader.ParallelForEach(4, [](string_view, string_view, const Metadata&) { FAIL(); });
+}
+
+TEST_F(SnapshotTest, ParallelLoad) {
+  const int kNumRecords = 50000;
+  {
+    SnapshotWriter writer(path_);
+    for (int i = 0; i < kNumRecords; i++) {
+      writer.Add(to_string(i), Record(string(100, 'a' + i % 26), i % 3));
+    }
+    writer.Finish();
+  }
+  SnapshotReader reader(path_);
+  ASSERT_EQ(reader.num_records(), static_cast<uint64_t>(kNumRecords));
+  ASSERT_GT(reader.num_chunks(), 1U);
+
+  MemOnlyStorage storage;
+  reader.ParallelForEach(4, [&storage](string_view key, string_view value, const Metadata& metadata) {
+    storage.Write(Key(key), Record(string(value), metadata.master, metadata.counter));
+  });
+  for (int i = 0; i < kNumRecords; i++) {
+    Record record;
+    ASSERT_TRUE(storage.Read(to_string(i), record));
+    ASSERT_EQ(record.value(), string(100, 'a' + i % 26));
+    ASSERT_EQ(record.metadata().master, static_cast<uint32_t>(i % 3));
+  }
+}
+
+TEST_F(SnapshotTest, DetectCorruptedChunk) {
+  {
+    SnapshotWriter writer(path_);
+    writer.Add("A", Record("valA"));
+    writer.Finish();
+  }
+  // Flip a byte in the value of the only record
+  auto fd = open(path_.c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(pwrite(fd, "X", 1, kSnapshotHeaderSize + 16 + 1), 1);
+  close(fd);
+
+  SnapshotReader reader(path_);
+  ASSERT_DEATH(reader.ForEachInChunk(0, [](string_view, string_view, const Metadata&) {}), "corrupted");
+}
+
+TEST_F(SnapshotTest, DetectRecordOutOfChunk) {
+  {
+    SnapshotWriter writer(path_);
+    writer.Add("A", Record("valA"));
+    writer.Finish();
+  }
+  // Make the key size of the only record point past the chunk and update the checksum of the
+  // chunk accordingly, as a buggy writer would do
+  const size_t kChunkSize = 16 + 1 + 4;
+  string chunk(kChunkSize, '\0');
+  auto fd = open(path_.c_str(), O_RDWR);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(pread(fd, chunk.data(), kChunkSize, kSnapshotHeaderSize), static_cast<ssize_t>(kChunkSize));
+  chunk[1] = 0x10;
+  ASSERT_EQ(pwrite(fd, chunk.data(), kChunkSize, kSnapshotHeaderSize), static_cast<ssize_t>(kChunkSize));
+  auto checksum = Crc32c(chunk.data(), chunk.size());
+  char encoded[4] = {static_cast<char>(checksum), static_cast<char>(checksum >> 8), static_cast<char>(checksum >> 16),
+                     static_cast<char>(checksum >> 24)};
+  ASSERT_EQ(pwrite(fd, encoded, 4, kSnapshotHeaderSize + kChunkSize + 12), 4);
+  close(fd);
+
+  SnapshotReader reader(path_);
+  ASSERT_DEATH(reader.ForEachInChunk(0, [](string_view, string_view, const Metadata&) {}), "corrupted");
+}
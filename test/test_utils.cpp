@@ -139,11 +139,12 @@ void TestSlog::AddServerAndClient() { server_ = MakeRunnerFor<Server>(broker_, n
 void TestSlog::AddForwarder() {
   metadata_initializer_ = std::make_shared<ConstantMetadataInitializer>(0);
   forwarder_ = MakeRunnerFor<Forwarder>(broker_->context(), broker_->config(), storage_, metadata_initializer_, nullptr,
-                                        kTestModuleTimeout);
+                                        kTestModuleTimeout, broker_->backlog());
 }
 
 void TestSlog::AddSequencer() {
-  sequencer_ = MakeRunnerFor<Sequencer>(broker_->context(), broker_->config(), nullptr, kTestModuleTimeout);
+  sequencer_ = MakeRunnerFor<Sequencer>(broker_->context(), broker_->config(), nullptr, kTestModuleTimeout,
+                                        broker_->backlog());
 }
 
 void TestSlog::AddInterleaver() { interleaver_ = MakeRunnerFor<Interleaver>(broker_, nullptr, kTestModuleTimeout); }
@@ -258,4 +259,19 @@ Transaction TestSlog::RecvTxnResult() {
   return txn;
 }
 
+rapidjson::Document TestSlog::GetStats(ModuleId module) {
+  CHECK(server_ != nullptr) << "TestSlog does not have a server";
+  api::Request request;
+  request.mutable_stats()->set_module(module);
+  SendSerializedProtoWithEmptyDelim(client_socket_, request);
+
+  api::Response res;
+  if (!RecvDeserializedProtoWithEmptyDelim(client_socket_, res)) {
+    LOG(FATAL) << "Malformed response to stats request.";
+  }
+  rapidjson::Document stats;
+  stats.Parse(res.stats().stats_json().c_str());
+  return stats;
+}
+
 }  // namespace slog
@@ -13,6 +13,8 @@
 #include "connection/zmq_utils.h"
 #include "module/base/module.h"
 #include "proto/internal.pb.h"
+#include "proto/modules.pb.h"
+#include "rapidjson/document.h"
 #include "storage/mem_only_storage.h"
 #include "storage/metadata_initializer.h"
 
@@ -67,6 +69,8 @@ class TestSlog {
   void StartInNewThreads();
   void SendTxn(Transaction* txn);
   Transaction RecvTxnResult();
+  // Must not be called while waiting for the result of a txn
+  rapidjson::Document GetStats(ModuleId module);
 
   const ConfigurationPtr& config() const { return config_; }
   const SharderPtr& sharder() const { return sharder_; }
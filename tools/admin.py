@@ -330,6 +330,8 @@ class GenDataCommand(AdminCommand):
             f"--record-size {args.record_size} "
             f"--max-jobs {args.max_jobs} "
         )
+        if args.snapshot:
+            shell_cmd += "--snapshot "
         containers = []
         for client, addr, *_ in self.remote_procs:
             cleanup_container(client, self.NAME, addr=addr)
@@ -22,6 +22,7 @@ from google.protobuf.internal.encoder import _VarintBytes
 from multiprocessing import Pool
 
 from fnv_hash import fnv_hash
+from snapshot import SnapshotWriter
 from proto.configuration_pb2 import Configuration
 from proto.offline_data_pb2 import Datum
 
@@ -36,6 +37,7 @@ MULTIPLIERS = {
 KEY_SIZE = 12   # 8 bytes + overhead from base64 encoding
 MASTER_SIZE = 2
 FILE_EXTENSION = '.dat'
+SNAPSHOT_FILE_EXTENSION = '.snap'
 
 logging.basicConfig(
     level=logging.INFO,
@@ -84,7 +86,7 @@ class DataGenerator:
         encoded = encode_key(key)
         return fnv_hash(encoded, self.partition_bytes) % self.num_partitions
 
-    def gen_data(self, partition: int, as_text: bool) -> None:
+    def gen_data(self, partition: int, as_text: bool, as_snapshot: bool) -> None:
         if partition >= self.num_partitions:
             raise IndexError(
                 "Partition number cannot be larger than or equal to "
@@ -116,6 +118,7 @@ class DataGenerator:
         func = partial(
             DataGenerator.gen_data_per_partition,
             as_text=as_text,
+            as_snapshot=as_snapshot,
             obj=self,
         )
         with Pool(num_jobs) as pool:
@@ -129,13 +132,17 @@ class DataGenerator:
         partition: int,
         keys: list,
         as_text: bool,
+        as_snapshot: bool,
         obj: object,
     ):
         """
         Wrapper for the class method __gen_data_per_partition so that it can be
         used in multiprocessing.
         """
-        obj.__gen_data_per_partition(partition, keys, as_text)
+        if as_snapshot:
+            obj.__gen_snapshot_per_partition(partition, keys)
+        else:
+            obj.__gen_data_per_partition(partition, keys, as_text)
 
     def __gen_data_per_partition(
         self,
@@ -185,7 +192,40 @@ class DataGenerator:
 
         part_file.close()
 
-    def __gen_datum(self, key: int, as_text=False):
+    def __gen_snapshot_per_partition(self, partition: int, keys: list) -> None:
+        # Same seed as __gen_data_per_partition so that both formats contain
+        # the same data
+        np.random.seed(partition)
+
+        file_name = os.path.join(
+            self.data_dir,
+            self.prefix + str(partition) + SNAPSHOT_FILE_EXTENSION
+        )
+        LOG.info("Generating snapshot %s", file_name)
+        writer = SnapshotWriter(file_name, partition, self.num_partitions)
+
+        last_time = time.time()
+        last_index = 0
+        for i, key in enumerate(keys):
+            encoded_key, record, master = self.__gen_key_record_master(key)
+            writer.add(encoded_key, record.encode(), master)
+
+            now = time.time()
+            if now - last_time >= LOG_EVERY_SEC:
+                pct = (i) / len(keys) * 100
+                rate = (i - last_index) / LOG_EVERY_SEC
+                LOG.info(
+                    "Progress: %d/%d (%.1f%%). Rate: %d records/s",
+                    i + 1,
+                    len(keys),
+                    pct,
+                    rate)
+                last_time = now
+                last_index = i
+
+        writer.finish()
+
+    def __gen_key_record_master(self, key: int):
         encoded_key = encode_key(key)
         record = ''.join(
             np.random.choice(
@@ -194,6 +234,10 @@ class DataGenerator:
             )
         )
         master = key % self.num_replicas
+        return encoded_key, record, master
+
+    def __gen_datum(self, key: int, as_text=False):
+        encoded_key, record, master = self.__gen_key_record_master(key)
 
         if as_text:
             datum_tuple = map(str, (encoded_key.decode(), record, master))
@@ -257,6 +301,12 @@ def add_exported_gen_data_arguments(parser):
              "Set to 0 (default) to use the whole key. If --config is used, "
              "this option will not be used."
     )
+    parser.add_argument(
+        "--snapshot",
+        action='store_true',
+        help="Generate data as snapshot files, which are loaded much faster "
+             "than the default format"
+    )
 
 
 if __name__ == "__main__":
@@ -319,4 +369,5 @@ if __name__ == "__main__":
     ).gen_data(
         partition=args.partition,
         as_text=args.as_text,
+        as_snapshot=args.snapshot,
     )
\ No newline at end of file
@@ -0,0 +1,98 @@
+#!/usr/bin/python3
+"""Snapshot writer
+
+Writes the snapshot format read by storage/snapshot.h. See that file for the
+layout of a snapshot.
+"""
+import struct
+
+try:
+    # Much faster than the pure Python implementation below if available
+    from crc32c import crc32c as _crc32c
+except ImportError:
+    _crc32c = None
+
+MAGIC = b'SLOGSNAP'
+VERSION = 1
+HEADER_SIZE = 64
+CHUNK_SIZE = 1 << 20
+
+_CRC32C_TABLE = []
+for i in range(256):
+    c = i
+    for _ in range(8):
+        c = (c >> 1) ^ 0x82F63B78 if c & 1 else c >> 1
+    _CRC32C_TABLE.append(c)
+
+
+def crc32c(data: bytes) -> int:
+    if _crc32c is not None:
+        return _crc32c(data)
+    crc = 0xFFFFFFFF
+    for byte in data:
+        crc = _CRC32C_TABLE[(crc ^ byte) & 0xFF] ^ (crc >> 8)
+    return crc ^ 0xFFFFFFFF
+
+
+class SnapshotWriter:
+
+    def __init__(
+        self,
+        path: str,
+        partition: int = 0,
+        num_partitions: int = 1,
+        sequence: int = 0,
+    ):
+        self.file = open(path, 'wb')
+        self.partition = partition
+        self.num_partitions = num_partitions
+        self.sequence = sequence
+        self.chunk = bytearray()
+        self.num_chunk_records = 0
+        self.chunks = []
+        self.num_records = 0
+        # Leave room for the header, which is written last
+        self.file.write(bytes(HEADER_SIZE))
+
+    def add(self, key: bytes, value: bytes, master: int, counter: int = 0) -> None:
+        self.chunk += struct.pack('<IIII', len(key), len(value), master, counter)
+        self.chunk += key
+        self.chunk += value
+        self.num_chunk_records += 1
+        self.num_records += 1
+        if len(self.chunk) >= CHUNK_SIZE:
+            self.__flush_chunk()
+
+    def finish(self) -> None:
+        self.__flush_chunk()
+        index_offset = self.file.tell()
+        for offset, num_records, checksum in self.chunks:
+            self.file.write(struct.pack('<QII', offset, num_records, checksum))
+
+        header = MAGIC + struct.pack(
+            '<IIIIQQQQI',
+            VERSION,
+            self.partition,
+            self.num_partitions,
+            0,
+            self.num_records,
+            index_offset,
+            len(self.chunks),
+            self.sequence,
+            0,
+        )
+        header += struct.pack('<I', crc32c(header))
+        assert len(header) == HEADER_SIZE
+        self.file.seek(0)
+        self.file.write(header)
+        self.file.close()
+
+    def __flush_chunk(self) -> None:
+        if not self.chunk:
+            return
+        self.chunks.append(
+            (self.file.tell(), self.num_chunk_records, crc32c(bytes(self.chunk)))
+        )
+        self.file.write(self.chunk)
+        self.chunk = bytearray()
+        self.num_chunk_records = 0
@@ -45,6 +45,9 @@ constexpr char HOT_RECORDS[] = "hot_records";
 constexpr char WRITES[] = "writes";
 // Size of a written value in bytes
 constexpr char VALUE_SIZE[] = "value_size";
+// If set to 1, the hot records that are written are incremented with INCR instead of
+// being overwritten with SET, so they behave like counters
+constexpr char HOT_INCR[] = "hot_incr";
 // If set to 1, a SH txn will always be sent to the nearest
 // region, a MH txn will always have a part that touches the nearest region
 constexpr char NEAREST[] = "nearest";
@@ -55,7 +58,8 @@ constexpr char SP_PARTITION[] = "sp_partition";
 
 const RawParamMap DEFAULT_PARAMS = {{MH_PCT, "0"},   {MH_HOMES, "2"},     {MH_ZIPF, "0"},  {MP_PCT, "0"},
                                     {MP_PARTS, "2"}, {HOT, "0"},          {RECORDS, "10"}, {HOT_RECORDS, "0"},
-                                    {WRITES, "10"},  {VALUE_SIZE, "100"}, {NEAREST, "1"},  {SP_PARTITION, "-1"}};
+                                    {WRITES, "10"},  {VALUE_SIZE, "100"}, {NEAREST, "1"},  {SP_PARTITION, "-1"},
+                                    {HOT_INCR, "0"}};
 
 }  // namespace
 
@@ -205,6 +209,7 @@ std::pair<Transaction*, TransactionProfile> BasicWorkload::NextTransaction() {
 
   auto writes = params_.GetUInt32(WRITES);
   auto hot_records = params_.GetUInt32(HOT_RECORDS);
+  auto hot_incr = params_.GetInt32(HOT_INCR) != 0;
   auto records = params_.GetUInt32(RECORDS);
   auto value_size = params_.GetUInt32(VALUE_SIZE);
 
@@ -229,7 +234,11 @@ std::pair<Transaction*, TransactionProfile> BasicWorkload::NextTransaction() {
       auto& record = ins.first->second;
       record.is_hot = is_hot;
       // Decide whether this is a read or a write record
-      if (i < writes) {
+      if (i < writes && is_hot && hot_incr) {
+        code.push_back({"INCR", key});
+        keys.emplace_back(key, KeyType::ADD);
+        record.is_write = true;
+      } else if (i < writes) {
         code.push_back({"SET", key, rnd_str_(value_size)});
         keys.emplace_back(key, KeyType::WRITE);
         record.is_write = true;